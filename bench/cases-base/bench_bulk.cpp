@@ -0,0 +1,42 @@
+
+#include "base/main.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+using namespace eokas;
+
+static f64_t bulk_seconds(const std::function<void()>& body, int rounds) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        body();
+    }
+    std::chrono::duration<f64_t> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds;
+}
+
+// libc, the streaming kernel, then the kernel split over the pool, on 64 MB.
+int main() {
+    printf("bulk kernel: %s\n", MemoryBulk::kernel());
+
+    ThreadPool pool(4, ThreadPoolMode::WorkStealing);
+    size_t size = 64 * 1024 * 1024 + 12345;
+    MemoryBuffer src(size, 64, eMemoryFlags_NoZero);
+    MemoryBuffer dst(size + 1, 64, eMemoryFlags_NoZero);
+    u8_t* from = (u8_t*) src.data();
+    u8_t* to = (u8_t*) dst.data() + 1;
+    for (size_t i = 0; i < size; i++) {
+        from[i] = (u8_t) (i ^ (i >> 8));
+    }
+
+    int rounds = 4;
+    f64_t gb = (f64_t) size / (1024.0 * 1024.0 * 1024.0);
+    f64_t libcCopy = bulk_seconds([&]() { memcpy(to, from, size); }, rounds);
+    f64_t bulkCopy = bulk_seconds([&]() { MemoryBulk::copy(to, from, size); }, rounds);
+    f64_t poolCopy = bulk_seconds([&]() { MemoryBulk::copy(pool, to, from, size); }, rounds);
+    f64_t libcFill = bulk_seconds([&]() { memset(to, 0, size); }, rounds);
+    f64_t bulkFill = bulk_seconds([&]() { MemoryBulk::fill(to, 0, size); }, rounds);
+    f64_t poolFill = bulk_seconds([&]() { MemoryBulk::fill(pool, to, 0, size); }, rounds);
+    printf("copy 64MB  libc %6.2f GB/s  bulk %6.2f GB/s  pool %6.2f GB/s\n", gb / libcCopy, gb / bulkCopy, gb / poolCopy);
+    printf("fill 64MB  libc %6.2f GB/s  bulk %6.2f GB/s  pool %6.2f GB/s\n", gb / libcFill, gb / bulkFill, gb / poolFill);
+    return 0;
+}
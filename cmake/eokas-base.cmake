@@ -45,3 +45,4 @@ install(TARGETS ${EOKAS_TARGET_NAME} DESTINATION lib/${EOKAS_OS_NAME}/${CMAKE_BU
 
 
 eokas_test_setup(${EOKAS_TARGET_NAME})
+eokas_bench_setup(${EOKAS_TARGET_NAME})
@@ -37,3 +37,18 @@ function(eokas_test_setup TEST_LIB_NAME)
 
     message("Test> Build ${TEST_LIB_NAME} Done.")
 endfunction()
+
+
+# benchmarks are plain executables, one per file, built with the tests but never run by ctest.
+function(eokas_bench_setup BENCH_LIB_NAME)
+    if(${BUILD_TESTING})
+        file(GLOB BENCH_CASES_FILES ./bench/cases-${BENCH_LIB_NAME}/*.cpp)
+        foreach (FILE_NAME ${BENCH_CASES_FILES})
+            get_filename_component (BENCH_CASE_NAME ${FILE_NAME} NAME_WE)
+            add_executable(${BENCH_CASE_NAME} ${FILE_NAME})
+            target_include_directories(${BENCH_CASE_NAME} PRIVATE ${EOKAS_SOURCE_DIR})
+            target_link_libraries(${BENCH_CASE_NAME} PRIVATE ${BENCH_LIB_NAME} ${ARGN})
+            message("Bench> Case: ${BENCH_CASE_NAME} => ${FILE_NAME}")
+        endforeach ()
+    endif()
+endfunction()
@@ -0,0 +1,101 @@
+
+#include "./arena.h"
+#include "./memory.h"
+
+namespace eokas {
+
+    static size_t align_up(size_t value, size_t align) {
+        return (value + align - 1) & ~(align - 1);
+    }
+
+    MemoryArena::MemoryArena(size_t reserveSize, size_t commitSize)
+        : mBase(nullptr), mReserved(0), mCommitted(0), mGranularity(0), mUsed(0), mTag(MemoryTracker::current()) {
+        size_t pageSize = MemoryUtility::page_size();
+        mGranularity = align_up(commitSize > 0 ? commitSize : pageSize, pageSize);
+        mReserved = align_up(reserveSize, mGranularity);
+        mBase = (u8_t*) MemoryUtility::reserve_v(mReserved);
+        if (mBase == nullptr) {
+            mReserved = 0;
+            return;
+        }
+        MemoryTracker::add(mTag, 0, 1);
+    }
+
+    MemoryArena::~MemoryArena() {
+        if (mBase != nullptr) {
+            MemoryTracker::remove(mTag, mCommitted, 1);
+            MemoryUtility::free_v(mBase, mReserved);
+        }
+        mBase = nullptr;
+        mReserved = 0;
+        mCommitted = 0;
+        mUsed = 0;
+    }
+
+    void* MemoryArena::alloc(size_t size, size_t align) {
+        if (mBase == nullptr)
+            return nullptr;
+        if (align == 0 || (align & (align - 1)) != 0)
+            return nullptr;
+
+        size_t offset = align_up(mUsed, align);
+        if (offset < mUsed || offset + size < offset)
+            return nullptr;
+
+        size_t end = offset + size;
+        if (end > mCommitted && !this->commit(end))
+            return nullptr;
+
+        mUsed = end;
+        return mBase + offset;
+    }
+
+    MemoryArena::Marker MemoryArena::mark() const {
+        return Marker{mUsed};
+    }
+
+    void MemoryArena::rewind(const Marker& marker) {
+        if (marker.offset <= mUsed) {
+            mUsed = marker.offset;
+        }
+    }
+
+    void MemoryArena::reset(bool decommit) {
+        mUsed = 0;
+        if (decommit && mCommitted > mGranularity) {
+            // keep the first granule hot, hand the rest back to the OS.
+            MemoryUtility::decommit_v(mBase + mGranularity, mCommitted - mGranularity);
+            MemoryTracker::remove(mTag, mCommitted - mGranularity, 0);
+            mCommitted = mGranularity;
+        }
+    }
+
+    bool MemoryArena::owns(const void* ptr) const {
+        const u8_t* p = (const u8_t*) ptr;
+        return mBase != nullptr && p >= mBase && p < mBase + mUsed;
+    }
+
+    size_t MemoryArena::used() const {
+        return mUsed;
+    }
+
+    size_t MemoryArena::committed() const {
+        return mCommitted;
+    }
+
+    size_t MemoryArena::reserved() const {
+        return mReserved;
+    }
+
+    bool MemoryArena::commit(size_t size) {
+        size_t target = align_up(size, mGranularity);
+        if (target > mReserved)
+            return false;
+        if (!MemoryUtility::commit_v(mBase + mCommitted, target - mCommitted, 3))
+            return false;
+        MemoryTracker::add(mTag, target - mCommitted, 0);
+        mCommitted = target;
+        return true;
+    }
+
+}
@@ -0,0 +1,166 @@
+
+#ifndef _EOKAS_BASE_ARENA_H_
+#define _EOKAS_BASE_ARENA_H_
+
+#include "./header.h"
+#include "./tracker.h"
+#include <new>
+#include <cstddef>
+#include <utility>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== MemoryArena
+    ==== Reserves a large address range up front, commits pages on demand and hands out
+    ==== memory with a bump pointer. Nothing is freed individually, use rewind() to go back
+    ==== to a marker or reset() to drop everything in O(1).
+    ==== Committed bytes are charged to the MemoryTagScope active at construction.
+    ============================================================================================
+    */
+    class MemoryArena {
+    public:
+        struct Marker {
+            size_t offset;
+        };
+
+        static const size_t kDefaultReserve = (size_t) 1024 * 1024 * 1024;
+        static const size_t kDefaultCommit = (size_t) 64 * 1024;
+
+    public:
+        MemoryArena(size_t reserveSize = kDefaultReserve, size_t commitSize = kDefaultCommit);
+        ~MemoryArena();
+
+        _ForbidCopy(MemoryArena);
+        _ForbidAssign(MemoryArena);
+
+    public:
+        void* alloc(size_t size, size_t align = alignof(std::max_align_t));
+        Marker mark() const;
+        void rewind(const Marker& marker);
+        void reset(bool decommit = false);
+        bool owns(const void* ptr) const;
+
+        size_t used() const;
+        size_t committed() const;
+        size_t reserved() const;
+
+        template<typename T, typename... Args>
+        T* make(Args&& ... args) {
+            void* ptr = this->alloc(sizeof(T), alignof(T));
+            if (ptr == nullptr)
+                return nullptr;
+            return new(ptr)T(std::forward<Args>(args)...);
+        }
+
+        template<typename T>
+        T* makeArray(size_t count) {
+            void* ptr = this->alloc(sizeof(T) * count, alignof(T));
+            if (ptr == nullptr)
+                return nullptr;
+            T* array = (T*) ptr;
+            for (size_t i = 0; i < count; i++) {
+                new(array + i)T();
+            }
+            return array;
+        }
+
+    private:
+        bool commit(size_t size);
+
+        u8_t* mBase;
+        size_t mReserved;
+        size_t mCommitted;
+        size_t mGranularity;
+        size_t mUsed;
+        MemoryTag mTag;
+    };
+
+    /*
+    ============================================================================================
+    ==== MemoryArenaScope
+    ==== Rewinds the arena to where it was when the scope was opened.
+    ============================================================================================
+    */
+    class MemoryArenaScope {
+    public:
+        MemoryArenaScope(MemoryArena& arena)
+            : mArena(arena), mMarker(arena.mark()) {
+        }
+
+        ~MemoryArenaScope() {
+            mArena.rewind(mMarker);
+        }
+
+        _ForbidCopy(MemoryArenaScope);
+        _ForbidAssign(MemoryArenaScope);
+
+    private:
+        MemoryArena& mArena;
+        MemoryArena::Marker mMarker;
+    };
+
+    /*
+    ============================================================================================
+    ==== ArenaAllocator
+    ==== Standard allocator over a MemoryArena, deallocate is a no-op.
+    ==== A null arena falls back to the global heap, so containers can take it unconditionally.
+    ============================================================================================
+    */
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        template<typename U>
+        struct rebind {
+            using other = ArenaAllocator<U>;
+        };
+
+    public:
+        ArenaAllocator(MemoryArena* arena = nullptr) noexcept
+            : mArena(arena) {
+        }
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+            : mArena(other.arena()) {
+        }
+
+        T* allocate(size_t n) {
+            if (mArena == nullptr)
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            void* ptr = mArena->alloc(n * sizeof(T), alignof(T));
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+            return static_cast<T*>(ptr);
+        }
+
+        void deallocate(T* ptr, size_t) noexcept {
+            if (mArena == nullptr) {
+                ::operator delete(ptr);
+            }
+        }
+
+        MemoryArena* arena() const noexcept {
+            return mArena;
+        }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& rhs) const noexcept {
+            return mArena == rhs.arena();
+        }
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>& rhs) const noexcept {
+            return mArena != rhs.arena();
+        }
+
+    private:
+        MemoryArena* mArena;
+    };
+
+}
+
+#endif//_EOKAS_BASE_ARENA_H_
@@ -0,0 +1,326 @@
+
+#include "./ascil.h"
+
+#if _EOKAS_ARCH == _EOKAS_ARCH_X64
+#define _EOKAS_ASCIL_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define _EOKAS_ASCIL_TARGET(isa)
+#else
+#define _EOKAS_ASCIL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace eokas {
+
+    enum class AscilRun {
+        White, Number, Identifier
+    };
+
+    /*
+    ============================================================================================
+    ==== scalar
+    ============================================================================================
+    */
+    template<AscilRun Run>
+    static size_t ascil_run_scalar(const u8_t* data, size_t size) {
+        const u16_t classes = Run == AscilRun::White ? Ascil::kWhite : (Run == AscilRun::Number ? Ascil::kNumber : Ascil::kAlphaNumber_);
+        size_t i = 0;
+        while (i < size && (Ascil::kTable.classes[data[i]] & classes) != 0) {
+            i += 1;
+        }
+        return i;
+    }
+
+    // adds or takes 0x20 where the byte is in [first, first + 25].
+    static void ascil_case_scalar(u8_t* dst, const u8_t* src, size_t size, u8_t first) {
+        for (size_t i = 0; i < size; i++) {
+            u8_t c = src[i];
+            dst[i] = (u8_t) (c - first) < 26 ? (u8_t) (c ^ 0x20) : c;
+        }
+    }
+
+    static int ascil_compare_scalar(const u8_t* a, const u8_t* b, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            u8_t x = (u8_t) (a[i] - 'A') < 26 ? (u8_t) (a[i] | 0x20) : a[i];
+            u8_t y = (u8_t) (b[i] - 'A') < 26 ? (u8_t) (b[i] | 0x20) : b[i];
+            if (x != y)
+                return (int) x - (int) y;
+        }
+        return 0;
+    }
+
+#if defined(_EOKAS_ASCIL_X64)
+    static u32_t ascil_ctz(u32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return (u32_t) __builtin_ctz(mask);
+#endif
+    }
+
+    /*
+    ============================================================================================
+    ==== sse2
+    ==== A byte is in [lo, hi] when min(c - lo, hi - lo) == c - lo, unsigned. (c | 0x20) is
+    ==== in [a-z] for letters of either case and nothing else.
+    ============================================================================================
+    */
+    static inline __m128i ascil_range_sse2(__m128i c, char lo, char hi) {
+        __m128i d = _mm_sub_epi8(c, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8((char) (hi - lo))), d);
+    }
+
+    template<AscilRun Run>
+    static inline __m128i ascil_match_sse2(__m128i c) {
+        if constexpr (Run == AscilRun::White) {
+            return _mm_or_si128(ascil_range_sse2(c, 0x09, 0x0D), _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')));
+        } else if constexpr (Run == AscilRun::Number) {
+            return ascil_range_sse2(c, '0', '9');
+        } else {
+            __m128i alpha = ascil_range_sse2(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'z');
+            __m128i number = ascil_range_sse2(c, '0', '9');
+            return _mm_or_si128(_mm_or_si128(alpha, number), _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+        }
+    }
+
+    template<AscilRun Run>
+    static size_t ascil_run_sse2(const u8_t* data, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i c = _mm_loadu_si128((const __m128i*) (data + i));
+            u32_t miss = ~(u32_t) _mm_movemask_epi8(ascil_match_sse2<Run>(c)) & 0xFFFFu;
+            if (miss != 0)
+                return i + ascil_ctz(miss);
+        }
+        return i + ascil_run_scalar<Run>(data + i, size - i);
+    }
+
+    static inline __m128i ascil_case_sse2(__m128i c, char first) {
+        __m128i letter = ascil_range_sse2(c, first, (char) (first + 25));
+        return _mm_xor_si128(c, _mm_and_si128(letter, _mm_set1_epi8(0x20)));
+    }
+
+    static void ascil_upper_sse2(u8_t* dst, const u8_t* src, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i c = _mm_loadu_si128((const __m128i*) (src + i));
+            _mm_storeu_si128((__m128i*) (dst + i), ascil_case_sse2(c, 'a'));
+        }
+        ascil_case_scalar(dst + i, src + i, size - i, 'a');
+    }
+
+    static void ascil_lower_sse2(u8_t* dst, const u8_t* src, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i c = _mm_loadu_si128((const __m128i*) (src + i));
+            _mm_storeu_si128((__m128i*) (dst + i), ascil_case_sse2(c, 'A'));
+        }
+        ascil_case_scalar(dst + i, src + i, size - i, 'A');
+    }
+
+    static int ascil_compare_sse2(const u8_t* a, const u8_t* b, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i x = ascil_case_sse2(_mm_loadu_si128((const __m128i*) (a + i)), 'A');
+            __m128i y = ascil_case_sse2(_mm_loadu_si128((const __m128i*) (b + i)), 'A');
+            u32_t miss = ~(u32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFFu;
+            if (miss != 0) {
+                i += ascil_ctz(miss);
+                return ascil_compare_scalar(a + i, b + i, 1);
+            }
+        }
+        return ascil_compare_scalar(a + i, b + i, size - i);
+    }
+
+    /*
+    ============================================================================================
+    ==== avx2
+    ============================================================================================
+    */
+#if !defined(_MSC_VER) || defined(__clang__)
+    _EOKAS_ASCIL_TARGET("avx2")
+    static inline __m256i ascil_range_avx2(__m256i c, char lo, char hi) {
+        __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8(lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8((char) (hi - lo))), d);
+    }
+
+    template<AscilRun Run>
+    _EOKAS_ASCIL_TARGET("avx2")
+    static inline __m256i ascil_match_avx2(__m256i c) {
+        if constexpr (Run == AscilRun::White) {
+            return _mm256_or_si256(ascil_range_avx2(c, 0x09, 0x0D), _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')));
+        } else if constexpr (Run == AscilRun::Number) {
+            return ascil_range_avx2(c, '0', '9');
+        } else {
+            __m256i alpha = ascil_range_avx2(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 'z');
+            __m256i number = ascil_range_avx2(c, '0', '9');
+            return _mm256_or_si256(_mm256_or_si256(alpha, number), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+        }
+    }
+
+    template<AscilRun Run>
+    _EOKAS_ASCIL_TARGET("avx2")
+    static size_t ascil_run_avx2(const u8_t* data, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i c = _mm256_loadu_si256((const __m256i*) (data + i));
+            u32_t miss = ~(u32_t) _mm256_movemask_epi8(ascil_match_avx2<Run>(c));
+            if (miss != 0)
+                return i + ascil_ctz(miss);
+        }
+        return i + ascil_run_sse2<Run>(data + i, size - i);
+    }
+
+    _EOKAS_ASCIL_TARGET("avx2")
+    static inline __m256i ascil_case_avx2(__m256i c, char first) {
+        __m256i letter = ascil_range_avx2(c, first, (char) (first + 25));
+        return _mm256_xor_si256(c, _mm256_and_si256(letter, _mm256_set1_epi8(0x20)));
+    }
+
+    _EOKAS_ASCIL_TARGET("avx2")
+    static void ascil_upper_avx2(u8_t* dst, const u8_t* src, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i c = _mm256_loadu_si256((const __m256i*) (src + i));
+            _mm256_storeu_si256((__m256i*) (dst + i), ascil_case_avx2(c, 'a'));
+        }
+        ascil_upper_sse2(dst + i, src + i, size - i);
+    }
+
+    _EOKAS_ASCIL_TARGET("avx2")
+    static void ascil_lower_avx2(u8_t* dst, const u8_t* src, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i c = _mm256_loadu_si256((const __m256i*) (src + i));
+            _mm256_storeu_si256((__m256i*) (dst + i), ascil_case_avx2(c, 'A'));
+        }
+        ascil_lower_sse2(dst + i, src + i, size - i);
+    }
+
+    _EOKAS_ASCIL_TARGET("avx2")
+    static int ascil_compare_avx2(const u8_t* a, const u8_t* b, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i x = ascil_case_avx2(_mm256_loadu_si256((const __m256i*) (a + i)), 'A');
+            __m256i y = ascil_case_avx2(_mm256_loadu_si256((const __m256i*) (b + i)), 'A');
+            u32_t miss = ~(u32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+            if (miss != 0) {
+                i += ascil_ctz(miss);
+                return ascil_compare_scalar(a + i, b + i, 1);
+            }
+        }
+        return ascil_compare_sse2(a + i, b + i, size - i);
+    }
+#endif
+#endif
+
+    /*
+    ============================================================================================
+    ==== dispatch
+    ============================================================================================
+    */
+    using AscilRunKernel = size_t (*)(const u8_t* data, size_t size);
+    using AscilCaseKernel = void (*)(u8_t* dst, const u8_t* src, size_t size);
+    using AscilCompareKernel = int (*)(const u8_t* a, const u8_t* b, size_t size);
+
+#if !defined(_EOKAS_ASCIL_X64)
+    static void ascil_upper_scalar(u8_t* dst, const u8_t* src, size_t size) {
+        ascil_case_scalar(dst, src, size, 'a');
+    }
+
+    static void ascil_lower_scalar(u8_t* dst, const u8_t* src, size_t size) {
+        ascil_case_scalar(dst, src, size, 'A');
+    }
+#endif
+
+    struct AscilKernels {
+        const char* name;
+        AscilRunKernel white;
+        AscilRunKernel number;
+        AscilRunKernel identifier;
+        AscilCaseKernel upper;
+        AscilCaseKernel lower;
+        AscilCompareKernel compare;
+
+        static const AscilKernels& instance() {
+            static const AscilKernels sInstance = AscilKernels::detect();
+            return sInstance;
+        }
+
+        static AscilKernels detect() {
+#if defined(_EOKAS_ASCIL_X64) && (!defined(_MSC_VER) || defined(__clang__))
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return {"avx2", ascil_run_avx2<AscilRun::White>, ascil_run_avx2<AscilRun::Number>,
+                        ascil_run_avx2<AscilRun::Identifier>, ascil_upper_avx2, ascil_lower_avx2, ascil_compare_avx2};
+            }
+#endif
+#if defined(_EOKAS_ASCIL_X64)
+            // every x64 has SSE2.
+            return {"sse2", ascil_run_sse2<AscilRun::White>, ascil_run_sse2<AscilRun::Number>,
+                    ascil_run_sse2<AscilRun::Identifier>, ascil_upper_sse2, ascil_lower_sse2, ascil_compare_sse2};
+#else
+            return {"scalar", ascil_run_scalar<AscilRun::White>, ascil_run_scalar<AscilRun::Number>,
+                    ascil_run_scalar<AscilRun::Identifier>, ascil_upper_scalar, ascil_lower_scalar, ascil_compare_scalar};
+#endif
+        }
+    };
+
+    // runs shorter than a vector are common in source text, the table takes those.
+    static const size_t kAscilShortRun = 8;
+
+    template<AscilRun Run>
+    static size_t ascil_run(const char* data, size_t size, AscilRunKernel kernel) {
+        const u8_t* bytes = (const u8_t*) data;
+        size_t head = size < kAscilShortRun ? size : kAscilShortRun;
+        size_t i = ascil_run_scalar<Run>(bytes, head);
+        if (i < head)
+            return i;
+        return i + kernel(bytes + i, size - i);
+    }
+
+    /*
+    ============================================================================================
+    ==== Ascil
+    ============================================================================================
+    */
+    const char* Ascil::kernel() {
+        return AscilKernels::instance().name;
+    }
+
+    size_t Ascil::whiteRun(const char* data, size_t size) {
+        return ascil_run<AscilRun::White>(data, size, AscilKernels::instance().white);
+    }
+
+    size_t Ascil::numberRun(const char* data, size_t size) {
+        return ascil_run<AscilRun::Number>(data, size, AscilKernels::instance().number);
+    }
+
+    size_t Ascil::identifierRun(const char* data, size_t size) {
+        return ascil_run<AscilRun::Identifier>(data, size, AscilKernels::instance().identifier);
+    }
+
+    void Ascil::toUpper(char* dst, const char* src, size_t size) {
+        AscilKernels::instance().upper((u8_t*) dst, (const u8_t*) src, size);
+    }
+
+    void Ascil::toLower(char* dst, const char* src, size_t size) {
+        AscilKernels::instance().lower((u8_t*) dst, (const u8_t*) src, size);
+    }
+
+    int Ascil::compareIgnoreCase(const char* a, const char* b, size_t size) {
+        return AscilKernels::instance().compare((const u8_t*) a, (const u8_t*) b, size);
+    }
+
+    int Ascil::compareIgnoreCase(const char* a, size_t aSize, const char* b, size_t bSize) {
+        int result = Ascil::compareIgnoreCase(a, b, aSize < bSize ? aSize : bSize);
+        if (result != 0)
+            return result;
+        return aSize < bSize ? -1 : (aSize > bSize ? 1 : 0);
+    }
+
+}
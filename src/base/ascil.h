@@ -8,92 +8,204 @@ namespace eokas {
 
 #define _ascil_in_range(c, a, b)        ((c) >= (a) && (c) <= (b))
 #define _ascil_is_ascil(c)                _ascil_in_range(c, 0x00, 0x7F)
-#define _ascil_is_control(c)            (_ascil_in_range(c, 0x01, 0x1F) || (c) == 0x7F)
-#define _ascil_is_space(c)                ((c) == 0x20)
-#define _ascil_is_number(c)                _ascil_in_range(c, 0x30, 0x39)
-#define _ascil_is_upper(c)                _ascil_in_range(c, 0x41, 0x5A)
-#define _ascil_is_lower(c)                _ascil_in_range(c, 0x61, 0x7A)
-#define _ascil_is_punct(c)                (\
-                                        _ascil_in_range(c, 0x21, 0x2F) || \
-                                        _ascil_in_range(c, 0x3A, 0x40) || \
-                                        _ascil_in_range(c, 0x5B, 0x60) || \
-                                        _ascil_in_range(c, 0x7B, 0x7E) \
-                                        )
-#define _ascil_is_alpha(c)                (_ascil_is_upper(c) || _ascil_is_lower(c))
-#define _ascil_is_alpha_number(c)        (_ascil_is_alpha(c) || _ascil_is_number(c))
-#define _ascil_is_hex(c)                (_ascil_is_number(c) || _ascil_in_range(c, 'A', 'F') || _ascil_in_range(c, 'a', 'f'))
-#define _ascil_is_alpha_(c)                (_ascil_is_alpha(c) || (c) == '_')
-#define _ascil_is_alpha_number_(c)        (_ascil_is_alpha_number(c) || (c) == '_')
-    
+#define _ascil_is_control(c)            eokas::Ascil::is(c, eokas::Ascil::kControl)
+#define _ascil_is_space(c)                eokas::Ascil::is(c, eokas::Ascil::kSpace)
+#define _ascil_is_white(c)                eokas::Ascil::is(c, eokas::Ascil::kWhite)
+#define _ascil_is_number(c)                eokas::Ascil::is(c, eokas::Ascil::kNumber)
+#define _ascil_is_upper(c)                eokas::Ascil::is(c, eokas::Ascil::kUpper)
+#define _ascil_is_lower(c)                eokas::Ascil::is(c, eokas::Ascil::kLower)
+#define _ascil_is_punct(c)                eokas::Ascil::is(c, eokas::Ascil::kPunct)
+#define _ascil_is_alpha(c)                eokas::Ascil::is(c, eokas::Ascil::kAlpha)
+#define _ascil_is_alpha_number(c)        eokas::Ascil::is(c, eokas::Ascil::kAlphaNumber)
+#define _ascil_is_hex(c)                eokas::Ascil::is(c, eokas::Ascil::kHex)
+#define _ascil_is_alpha_(c)                eokas::Ascil::is(c, eokas::Ascil::kAlpha_)
+#define _ascil_is_alpha_number_(c)        eokas::Ascil::is(c, eokas::Ascil::kAlphaNumber_)
+
+    /*
+    ============================================================================================
+    ==== AscilTable
+    ==== The classes of every byte, built at compile time. Bytes from 0x80 up are in none.
+    ============================================================================================
+    */
+    struct AscilTable {
+        u16_t classes[256];
+
+        constexpr AscilTable(u16_t control, u16_t space, u16_t white, u16_t number, u16_t upper,
+                             u16_t lower, u16_t punct, u16_t hex, u16_t underscore)
+            : classes() {
+            for (u32_t c = 0; c < 128; c++) {
+                u16_t bits = 0;
+                bits |= (c >= 0x01 && c <= 0x1F) || c == 0x7F ? control : 0;
+                bits |= c == 0x20 ? space : 0;
+                bits |= (c >= 0x09 && c <= 0x0D) || c == 0x20 ? white : 0;
+                bits |= c >= '0' && c <= '9' ? number : 0;
+                bits |= c >= 'A' && c <= 'Z' ? upper : 0;
+                bits |= c >= 'a' && c <= 'z' ? lower : 0;
+                bits |= (c >= 0x21 && c <= 0x2F) || (c >= 0x3A && c <= 0x40) ||
+                        (c >= 0x5B && c <= 0x60) || (c >= 0x7B && c <= 0x7E) ? punct : 0;
+                bits |= (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f') ? hex : 0;
+                bits |= c == '_' ? underscore : 0;
+                classes[c] = bits;
+            }
+        }
+    };
+
+    /*
+    ============================================================================================
+    ==== Ascil
+    ==== One char through the class table, or whole buffers at a time. The bulk functions
+    ==== look at 16 or 32 bytes per step (SSE2 or AVX2, picked once at run time) and only
+    ==== know ASCII: bytes from 0x80 up are in no class and case mapping leaves them alone.
+    ==== Space is ' ' alone, white is ' ' and \t \n \v \f \r.
+    ============================================================================================
+    */
     struct Ascil {
+        static const u16_t kControl = 1 << 0;
+        static const u16_t kSpace = 1 << 1;
+        static const u16_t kWhite = 1 << 2;
+        static const u16_t kNumber = 1 << 3;
+        static const u16_t kUpper = 1 << 4;
+        static const u16_t kLower = 1 << 5;
+        static const u16_t kPunct = 1 << 6;
+        static const u16_t kHex = 1 << 7;
+        static const u16_t kUnderscore = 1 << 8;
+        static const u16_t kAlpha = kUpper | kLower;
+        static const u16_t kAlphaNumber = kAlpha | kNumber;
+        static const u16_t kAlpha_ = kAlpha | kUnderscore;
+        static const u16_t kAlphaNumber_ = kAlphaNumber | kUnderscore;
+
+        static constexpr AscilTable kTable{kControl, kSpace, kWhite, kNumber, kUpper, kLower, kPunct, kHex, kUnderscore};
+
+        /// true if c is in any of the classes.
+        static constexpr bool is(char c, u16_t classes) {
+            return (kTable.classes[(u8_t) c] & classes) != 0;
+        }
+
+        /*
+        ========================================================================================
+        ==== bulk
+        ========================================================================================
+        */
+        /// "avx2", "sse2" or "scalar", the kernels in use.
+        static const char* kernel();
+
+        /// bytes of white at the start of data.
+        static size_t whiteLength(const char* data, size_t size) {
+            return size > 0 && is(data[0], kWhite) ? Ascil::whiteRun(data, size) : 0;
+        }
+
+        /// bytes of [0-9] at the start of data.
+        static size_t numberLength(const char* data, size_t size) {
+            return size > 0 && is(data[0], kNumber) ? Ascil::numberRun(data, size) : 0;
+        }
+
+        /// bytes of [A-Za-z0-9_] at the start of data, the caller decides about a leading digit.
+        static size_t identifierLength(const char* data, size_t size) {
+            return size > 0 && is(data[0], kAlphaNumber_) ? Ascil::identifierRun(data, size) : 0;
+        }
+
+        /// dst may be src.
+        static void toUpper(char* dst, const char* src, size_t size);
+        static void toLower(char* dst, const char* src, size_t size);
+
+        /// like memcmp on lower cased bytes.
+        static int compareIgnoreCase(const char* a, const char* b, size_t size);
+        static int compareIgnoreCase(const char* a, size_t aSize, const char* b, size_t bSize);
+
+        static bool equalsIgnoreCase(const char* a, size_t aSize, const char* b, size_t bSize) {
+            return aSize == bSize && Ascil::compareIgnoreCase(a, b, aSize) == 0;
+        }
+
+        /*
+        ========================================================================================
+        ==== one char
+        ========================================================================================
+        */
         char value;
-        
+
         Ascil(char c)
             : value(c) {
         }
-        
+
         Ascil& operator=(char c) {
             this->value = c;
             return *this;
         }
-        
-        operator char() {
+
+        operator char() const {
             return this->value;
         }
-        
-        inline bool inRange(char a, char b) {
+
+        inline bool inRange(char a, char b) const {
             return _ascil_in_range(this->value, a, b);
         }
-        
-        inline bool isAscil() {
+
+        inline bool isAscil() const {
             return _ascil_is_ascil(this->value);
         }
-        
-        inline bool isControl() {
-            return _ascil_is_control(this->value);
+
+        inline bool isControl() const {
+            return is(this->value, kControl);
+        }
+
+        inline bool isSpace() const {
+            return is(this->value, kSpace);
         }
-        
-        inline bool isSpace() {
-            return _ascil_is_space(this->value);
+
+        inline bool isWhite() const {
+            return is(this->value, kWhite);
+        }
+
+        inline bool isNumber() const {
+            return is(this->value, kNumber);
+        }
+
+        inline bool isUpper() const {
+            return is(this->value, kUpper);
         }
-        
-        inline bool isNumber() {
-            return _ascil_is_number(this->value);
+
+        inline bool isLower() const {
+            return is(this->value, kLower);
         }
-        
-        inline bool isUpper() {
-            return _ascil_is_upper(this->value);
+
+        inline bool isPunct() const {
+            return is(this->value, kPunct);
         }
-        
-        inline bool isLower() {
-            return _ascil_is_lower(this->value);
+
+        inline bool isAlpha() const {
+            return is(this->value, kAlpha);
         }
-        
-        inline bool isPunct() {
-            return _ascil_is_punct(this->value);
+
+        inline bool isHex() const {
+            return is(this->value, kHex);
         }
-        
-        inline bool isAlpha() {
-            return _ascil_is_alpha(this->value);
+
+        inline bool isAlphaNumber() const {
+            return is(this->value, kAlphaNumber);
         }
-        
-        inline bool isHex() {
-            return _ascil_is_hex(this->value);
+
+        inline bool isAlpha_() const {
+            return is(this->value, kAlpha_);
         }
-        
-        inline bool isAlphaNumber() {
-            return _ascil_is_alpha_number(this->value);
+
+        inline bool isAlphaNumber_() const {
+            return is(this->value, kAlphaNumber_);
         }
-        
-        inline bool isAlpha_() {
-            return _ascil_is_alpha_(this->value);
+
+        inline char toUpper() const {
+            return is(this->value, kLower) ? (char) (this->value - 0x20) : this->value;
         }
-        
-        inline bool isAlphaNumber_() {
-            return _ascil_is_alpha_number_(this->value);
+
+        inline char toLower() const {
+            return is(this->value, kUpper) ? (char) (this->value + 0x20) : this->value;
         }
+
+    private:
+        static size_t whiteRun(const char* data, size_t size);
+        static size_t numberRun(const char* data, size_t size);
+        static size_t identifierRun(const char* data, size_t size);
     };
-    
+
 }
 
 #endif//_EOKAS_BASE_ASCIL_H_
@@ -0,0 +1,373 @@
+
+#include "./async.h"
+
+namespace eokas {
+
+    static const u32_t kSpinCount = 64;
+
+    // xorshift32, only used to pick victims.
+    static u32_t next_random(u32_t& seed) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    struct ThreadPoolWorker {
+        ThreadPool* pool;
+        int index;
+        u32_t seed;
+        std::atomic<bool> busy;
+        WorkStealingDeque<Task> deque;
+        std::thread thread;
+
+        ThreadPoolWorker(ThreadPool* pool, int index)
+            : pool(pool), index(index), seed(0x9E3779B9u * (u32_t) (index + 1)), busy(false), deque(), thread() {
+        }
+    };
+
+    static thread_local ThreadPoolWorker* tWorker = nullptr;
+
+    // fibers move between workers, so the address of tWorker must not be cached across a wait.
+#if defined(__GNUC__)
+    __attribute__((noinline))
+#endif
+    static ThreadPoolWorker* current_worker() {
+        ThreadPoolWorker** worker = &tWorker;
+#if defined(__GNUC__)
+        asm volatile("" : "+r"(worker));
+#endif
+        return *worker;
+    }
+
+    ThreadPool::ThreadPool(unsigned short size, ThreadPoolMode mode)
+        : mMode(mode), mCapacity(maxSize()), mWorkers(new std::atomic<ThreadPoolWorker*>[maxSize()]) {
+        for (unsigned short i = 0; i < mCapacity; i++) {
+            mWorkers[i].store(nullptr, std::memory_order_relaxed);
+        }
+        this->expand(size);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mParkMutex);
+            mRunning = false;
+            mParkEpoch += 1;
+        }
+        mParkCond.notify_all();
+
+        // workers drain the remaining tasks before they leave. expand() adds no worker once
+        // mRunning is false, so the count taken under the lock is final; the lock is not held
+        // while joining, a draining task may still be in submit().
+        int count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mExpandMutex);
+            count = this->size();
+        }
+        for (int i = 0; i < count; i++) {
+            ThreadPoolWorker* worker = this->worker(i);
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            delete this->worker(i);
+        }
+        for (Task* task: mQueue) {
+            mTaskPool.release(task);
+        }
+        mQueue.clear();
+        for (Fiber* fiber: mFreeFibers) {
+            Fiber::destroy(fiber);
+        }
+        mFreeFibers.clear();
+    }
+
+    unsigned short ThreadPool::maxSize() {
+        unsigned int cores = std::thread::hardware_concurrency();
+        if (cores < THREADPOOL_MAX_NUM)
+            return THREADPOOL_MAX_NUM;
+        return cores > 0xFFFF ? 0xFFFF : (unsigned short) cores;
+    }
+
+    void ThreadPool::expand(unsigned short size) {
+        if (size <= 0)
+            return;
+        std::lock_guard<std::mutex> lock(mExpandMutex);
+        if (!mRunning)
+            return;
+        for (unsigned short i = 0; i < size; i++) {
+            int index = mSize.load(std::memory_order_relaxed);
+            if (index >= mCapacity)
+                break;
+            ThreadPoolWorker* worker = new ThreadPoolWorker(this, index);
+            mWorkers[index].store(worker, std::memory_order_release);
+            mSize.store(index + 1, std::memory_order_release);
+            worker->thread = std::thread([this, worker] {
+                this->run(worker);
+            });
+        }
+    }
+
+    int ThreadPool::idle_size() const {
+        int idle = 0;
+        int count = this->size();
+        for (int i = 0; i < count; i++) {
+            if (!this->worker(i)->busy.load(std::memory_order_relaxed)) {
+                idle++;
+            }
+        }
+        return idle;
+    }
+
+    ThreadPoolWorker* ThreadPool::worker(int index) const {
+        return mWorkers[index].load(std::memory_order_acquire);
+    }
+
+    bool ThreadPool::accepts() const {
+        // tasks that are still draining may keep spawning work after shutdown started.
+        ThreadPoolWorker* self = current_worker();
+        return mRunning || (self != nullptr && self->pool == this);
+    }
+
+    void ThreadPool::submit(Task&& value) {
+        Task* task = mTaskPool.acquire(std::move(value));
+        if (task == nullptr)
+            throw std::bad_alloc();
+
+        ThreadPoolWorker* self = current_worker();
+        if (mMode != ThreadPoolMode::Shared && self != nullptr && self->pool == this) {
+            self->deque.push(task);
+        }
+        else {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            mQueue.push_back(task);
+            mQueueSize.store(mQueue.size(), std::memory_order_relaxed);
+        }
+
+        if (mMode == ThreadPoolMode::Shared && mRunning && this->size() < mCapacity && this->idle_size() < 1) {
+            this->expand(1);
+        }
+
+        this->notify();
+    }
+
+    void ThreadPool::notify() {
+        if (mSleeping.load(std::memory_order_seq_cst) < 1)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mParkMutex);
+            mParkEpoch += 1;
+        }
+        mParkCond.notify_one();
+    }
+
+    Task* ThreadPool::find(ThreadPoolWorker* self) {
+        Task* task = nullptr;
+        if (self != nullptr) {
+            task = self->deque.pop();
+            if (task != nullptr)
+                return task;
+        }
+
+        if (mQueueSize.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            if (!mQueue.empty()) {
+                task = mQueue.front();
+                mQueue.pop_front();
+                mQueueSize.store(mQueue.size(), std::memory_order_relaxed);
+                return task;
+            }
+        }
+
+        if (mMode == ThreadPoolMode::Shared)
+            return nullptr;
+
+        int count = this->size();
+        if (count < (self != nullptr ? 2 : 1))
+            return nullptr;
+        static thread_local u32_t tSeed = 0x2545F491u;
+        u32_t random = next_random(self != nullptr ? self->seed : tSeed);
+        int start = (int) (random % (u32_t) count);
+        for (int i = 0; i < count; i++) {
+            ThreadPoolWorker* victim = this->worker((start + i) % count);
+            if (victim == self)
+                continue;
+            task = victim->deque.steal();
+            if (task != nullptr)
+                return task;
+        }
+        return nullptr;
+    }
+
+    bool ThreadPool::help() {
+        ThreadPoolWorker* self = current_worker();
+        if (self != nullptr && self->pool != this) {
+            self = nullptr;
+        }
+        Task* task = this->find(self);
+        if (task == nullptr)
+            return false;
+        (*task)();
+        mTaskPool.release(task);
+        return true;
+    }
+
+    bool ThreadPool::hasWork() {
+        {
+            std::lock_guard<std::mutex> lock(mReadyMutex);
+            if (!mReadyFibers.empty())
+                return true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            if (!mQueue.empty())
+                return true;
+        }
+        int count = this->size();
+        for (int i = 0; i < count; i++) {
+            if (!this->worker(i)->deque.empty())
+                return true;
+        }
+        return false;
+    }
+
+    bool ThreadPool::park() {
+        std::unique_lock<std::mutex> lock(mParkMutex);
+        mSleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (this->hasWork()) {
+            mSleeping.fetch_sub(1);
+            return true;
+        }
+        // parked fibers still have to finish on some worker.
+        if (!mRunning && mSuspended.load(std::memory_order_seq_cst) == 0) {
+            mSleeping.fetch_sub(1);
+            return false;
+        }
+        u64_t epoch = mParkEpoch;
+        mParkCond.wait(lock, [this, epoch] {
+            return mParkEpoch != epoch;
+        });
+        mSleeping.fetch_sub(1);
+        return true;
+    }
+
+    void ThreadPool::run(ThreadPoolWorker* self) {
+        tWorker = self;
+        Fiber* fiber = mMode == ThreadPoolMode::Fiber ? this->acquireFiber() : nullptr;
+        if (fiber != nullptr) {
+            Fiber::run(fiber);
+        }
+        else {
+            this->loop();
+        }
+        tWorker = nullptr;
+    }
+
+    void ThreadPool::loop() {
+        while (true) {
+            ThreadPoolWorker* self = current_worker();
+            self->busy.store(false, std::memory_order_relaxed);
+
+            if (mMode == ThreadPoolMode::Fiber) {
+                Fiber* ready = this->readyFiber();
+                if (ready != nullptr) {
+                    // only this loop lives on the current fiber, it is restarted from scratch.
+                    Fiber::switchTo(ready, &ThreadPool::recycleFiber, this, true);
+                }
+            }
+
+            Task* task = this->find(self);
+            for (u32_t spin = 0; task == nullptr && spin < kSpinCount; spin++) {
+                if (mReadySize.load(std::memory_order_relaxed) > 0)
+                    break;
+                std::this_thread::yield();
+                task = this->find(self);
+            }
+            if (task == nullptr) {
+                if (mReadySize.load(std::memory_order_relaxed) > 0)
+                    continue;
+                if (!this->park())
+                    break;
+                continue;
+            }
+
+            self->busy.store(true, std::memory_order_relaxed);
+            (*task)();
+            mTaskPool.release(task);
+        }
+    }
+
+    /*
+    ============================================================================================
+    ==== fibers
+    ============================================================================================
+    */
+    Fiber* ThreadPool::acquireFiber() {
+        if (!Fiber::isSupported())
+            return nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mFreeMutex);
+            if (!mFreeFibers.empty()) {
+                Fiber* fiber = mFreeFibers.back();
+                mFreeFibers.pop_back();
+                return fiber;
+            }
+        }
+        return Fiber::create(this, &ThreadPool::fiberMain, this);
+    }
+
+    Fiber* ThreadPool::readyFiber() {
+        if (mReadySize.load(std::memory_order_relaxed) == 0)
+            return nullptr;
+        std::lock_guard<std::mutex> lock(mReadyMutex);
+        if (mReadyFibers.empty())
+            return nullptr;
+        Fiber* fiber = mReadyFibers.front();
+        mReadyFibers.pop_front();
+        mReadySize.store(mReadyFibers.size(), std::memory_order_relaxed);
+        return fiber;
+    }
+
+    Fiber* ThreadPool::spare() {
+        Fiber* fiber = this->acquireFiber();
+        if (fiber != nullptr) {
+            mSuspended.fetch_add(1, std::memory_order_seq_cst);
+        }
+        return fiber;
+    }
+
+    void ThreadPool::schedule(Fiber* fiber) {
+        {
+            std::lock_guard<std::mutex> lock(mReadyMutex);
+            mReadyFibers.push_back(fiber);
+            mReadySize.store(mReadyFibers.size(), std::memory_order_relaxed);
+        }
+        mSuspended.fetch_sub(1, std::memory_order_seq_cst);
+
+        if (mRunning) {
+            this->notify();
+            return;
+        }
+        // during shutdown every parked worker rechecks whether it may leave.
+        {
+            std::lock_guard<std::mutex> lock(mParkMutex);
+            mParkEpoch += 1;
+        }
+        mParkCond.notify_all();
+    }
+
+    void ThreadPool::fiberMain(void* arg) {
+        ThreadPool* self = (ThreadPool*) arg;
+        self->loop();
+        Fiber::exit(&ThreadPool::recycleFiber, self);
+    }
+
+    void ThreadPool::recycleFiber(Fiber* fiber, void* arg) {
+        ThreadPool* self = (ThreadPool*) arg;
+        fiber->restart();
+        std::lock_guard<std::mutex> lock(self->mFreeMutex);
+        self->mFreeFibers.push_back(fiber);
+    }
+
+}
@@ -2,109 +2,686 @@
 #define _EOKAS_BASE_ASYNC_H_
 
 #include "./header.h"
+#include "./pool.h"
+#include "./fiber.h"
 
+#include <new>
+#include <cstddef>
+#include <tuple>
 #include <atomic>
+#include <mutex>
+#include <thread>
 #include <future>
 #include <stdexcept>
+#include <exception>
 #include <functional>
+#include <type_traits>
+#include <condition_variable>
 
 namespace eokas {
 
 #define  THREADPOOL_MAX_NUM 16
-    
-    class ThreadPool {
+
+    /*
+    ============================================================================================
+    ==== WorkStealingDeque
+    ==== Chase-Lev deque. The owner thread pushes and pops at the bottom (LIFO), any other
+    ==== thread steals from the top (FIFO). steal() may return null when it loses a race,
+    ==== the caller just moves on to the next victim.
+    ============================================================================================
+    */
+    template<typename T>
+    class WorkStealingDeque {
     public:
-        inline ThreadPool(unsigned short size = 4) {
-            this->expand(size);
-        }
-        
-        inline ~ThreadPool() {
-            mRunning = false;
-            mCond.notify_all();
-            for (std::thread& thread: mThreads) {
-                //thread.detach();
-                if (thread.joinable()) {
-                    thread.join();
+        explicit WorkStealingDeque(i64_t capacity = 256)
+            : mTop(0), mBottom(0), mArray(new Array(capacity)), mRetired() {
+        }
+
+        ~WorkStealingDeque() {
+            delete mArray.load(std::memory_order_relaxed);
+            for (Array* array: mRetired) {
+                delete array;
+            }
+        }
+
+        _ForbidCopy(WorkStealingDeque);
+        _ForbidAssign(WorkStealingDeque);
+
+        void push(T* item) {
+            i64_t b = mBottom.load(std::memory_order_relaxed);
+            i64_t t = mTop.load(std::memory_order_acquire);
+            Array* array = mArray.load(std::memory_order_relaxed);
+            if (b - t > array->capacity - 1) {
+                array = this->grow(array, b, t);
+            }
+            array->put(b, item);
+            // seq_cst so a worker about to park either sees the item or is seen sleeping.
+            mBottom.store(b + 1, std::memory_order_seq_cst);
+        }
+
+        T* pop() {
+            i64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+            Array* array = mArray.load(std::memory_order_relaxed);
+            mBottom.store(b, std::memory_order_seq_cst);
+            i64_t t = mTop.load(std::memory_order_seq_cst);
+            if (t > b) {
+                mBottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* item = array->get(b);
+            if (t == b) {
+                // last item, race the thieves for it.
+                if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
                 }
+                mBottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        T* steal() {
+            i64_t t = mTop.load(std::memory_order_seq_cst);
+            i64_t b = mBottom.load(std::memory_order_seq_cst);
+            if (t >= b)
+                return nullptr;
+            Array* array = mArray.load(std::memory_order_acquire);
+            T* item = array->get(t);
+            if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return item;
+        }
+
+        bool empty() const {
+            i64_t t = mTop.load(std::memory_order_seq_cst);
+            i64_t b = mBottom.load(std::memory_order_seq_cst);
+            return t >= b;
+        }
+
+        size_t size() const {
+            i64_t t = mTop.load(std::memory_order_seq_cst);
+            i64_t b = mBottom.load(std::memory_order_seq_cst);
+            return b > t ? (size_t) (b - t) : 0;
+        }
+
+    private:
+        struct Array {
+            i64_t capacity;
+            i64_t mask;
+            std::atomic<T*>* items;
+
+            explicit Array(i64_t capacity)
+                : capacity(capacity), mask(capacity - 1), items(new std::atomic<T*>[capacity]) {
+            }
+
+            ~Array() {
+                delete[] items;
+            }
+
+            T* get(i64_t index) const {
+                return items[index & mask].load(std::memory_order_relaxed);
+            }
+
+            void put(i64_t index, T* item) {
+                items[index & mask].store(item, std::memory_order_relaxed);
+            }
+        };
+
+        Array* grow(Array* array, i64_t b, i64_t t) {
+            Array* bigger = new Array(array->capacity * 2);
+            for (i64_t i = t; i < b; i++) {
+                bigger->put(i, array->get(i));
+            }
+            // thieves may still read the old array, keep it until the deque dies.
+            mRetired.push_back(array);
+            mArray.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        alignas(64) std::atomic<i64_t> mTop;
+        alignas(64) std::atomic<i64_t> mBottom;
+        std::atomic<Array*> mArray;
+        std::vector<Array*> mRetired;
+    };
+
+    /*
+    ============================================================================================
+    ==== Task
+    ==== Move-only void() callable. Callables up to kInlineSize bytes are stored inline, only
+    ==== bigger ones go to the heap, so wrapping a small lambda never allocates.
+    ============================================================================================
+    */
+    class Task {
+    public:
+        static const size_t kInlineSize = 48;
+
+        Task() noexcept
+            : mInvoke(nullptr), mManage(nullptr) {
+        }
+
+        template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+        Task(F&& f)
+            : mInvoke(nullptr), mManage(nullptr) {
+            using Fn = typename std::decay<F>::type;
+            if constexpr (isInline<Fn>()) {
+                new(mStorage) Fn(std::forward<F>(f));
+                mInvoke = &Task::invokeInline<Fn>;
+                mManage = &Task::manageInline<Fn>;
+            }
+            else {
+                *reinterpret_cast<Fn**>(mStorage) = new Fn(std::forward<F>(f));
+                mInvoke = &Task::invokeHeap<Fn>;
+                mManage = &Task::manageHeap<Fn>;
+            }
+        }
+
+        Task(Task&& other) noexcept
+            : mInvoke(nullptr), mManage(nullptr) {
+            this->take(other);
+        }
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                this->reset();
+                this->take(other);
+            }
+            return *this;
+        }
+
+        ~Task() {
+            this->reset();
+        }
+
+        _ForbidCopy(Task);
+        _ForbidAssign(Task);
+
+        explicit operator bool() const {
+            return mInvoke != nullptr;
+        }
+
+        void operator()() {
+            mInvoke(mStorage);
+        }
+
+        void reset() {
+            if (mManage != nullptr) {
+                mManage(nullptr, mStorage);
             }
+            mInvoke = nullptr;
+            mManage = nullptr;
         }
-        
-        void expand(unsigned short size) {
-            if (size <= 0)
+
+    private:
+        using Invoke = void (*)(u8_t* storage);
+        using Manage = void (*)(u8_t* dst, u8_t* src);
+
+        template<typename Fn>
+        static constexpr bool isInline() {
+            return sizeof(Fn) <= kInlineSize
+                && alignof(Fn) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible<Fn>::value;
+        }
+
+        template<typename Fn>
+        static void invokeInline(u8_t* storage) {
+            (*reinterpret_cast<Fn*>(storage))();
+        }
+
+        // moves into dst when given, then destroys src.
+        template<typename Fn>
+        static void manageInline(u8_t* dst, u8_t* src) {
+            Fn* fn = reinterpret_cast<Fn*>(src);
+            if (dst != nullptr) {
+                new(dst) Fn(std::move(*fn));
+            }
+            fn->~Fn();
+        }
+
+        template<typename Fn>
+        static void invokeHeap(u8_t* storage) {
+            (**reinterpret_cast<Fn**>(storage))();
+        }
+
+        template<typename Fn>
+        static void manageHeap(u8_t* dst, u8_t* src) {
+            Fn** fn = reinterpret_cast<Fn**>(src);
+            if (dst != nullptr) {
+                *reinterpret_cast<Fn**>(dst) = *fn;
+            }
+            else {
+                delete *fn;
+            }
+            *fn = nullptr;
+        }
+
+        void take(Task& other) {
+            if (other.mManage != nullptr) {
+                other.mManage(mStorage, other.mStorage);
+            }
+            mInvoke = other.mInvoke;
+            mManage = other.mManage;
+            other.mInvoke = nullptr;
+            other.mManage = nullptr;
+        }
+
+        alignas(std::max_align_t) u8_t mStorage[kInlineSize];
+        Invoke mInvoke;
+        Manage mManage;
+    };
+
+    /*
+    ============================================================================================
+    ==== Future / Promise
+    ==== Both sides share an intrusively counted FutureState taken from a per-type
+    ==== ConcurrentPool, so a result slot costs no heap allocation once the pool is warm.
+    ==== Waiting spins briefly, then parks the calling fiber or sleeps the calling thread.
+    ============================================================================================
+    */
+    template<typename T>
+    struct FutureValue {
+        alignas(T) u8_t storage[sizeof(T)];
+
+        template<typename U>
+        void set(U&& value) {
+            new(storage) T(std::forward<U>(value));
+        }
+
+        T take() {
+            T* ptr = reinterpret_cast<T*>(storage);
+            T value(std::move(*ptr));
+            ptr->~T();
+            return value;
+        }
+
+        void destroy() {
+            reinterpret_cast<T*>(storage)->~T();
+        }
+    };
+
+    template<>
+    struct FutureValue<void> {
+        void set() {
+        }
+
+        void take() {
+        }
+
+        void destroy() {
+        }
+    };
+
+    template<typename T>
+    class FutureState {
+    public:
+        static const u32_t kSpinCount = 64;
+
+        static FutureState* create() {
+            return pool().acquire();
+        }
+
+        FutureState()
+            : mRefs(1), mReady(), mHasValue(false), mException(), mValue() {
+        }
+
+        ~FutureState() {
+            if (mHasValue) {
+                mValue.destroy();
+            }
+        }
+
+        _ForbidCopy(FutureState);
+        _ForbidAssign(FutureState);
+
+        void retain() {
+            mRefs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void release() {
+            if (mRefs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                pool().release(this);
+            }
+        }
+
+        bool isReady() const {
+            return mReady.isSet();
+        }
+
+        template<typename... U>
+        void setValue(U&& ... value) {
+            mValue.set(std::forward<U>(value)...);
+            mHasValue = true;
+            this->publish();
+        }
+
+        void setException(std::exception_ptr exception) {
+            mException = exception;
+            this->publish();
+        }
+
+        void wait() {
+            for (u32_t spin = 0; spin < kSpinCount; spin++) {
+                if (this->isReady())
+                    return;
+                std::this_thread::yield();
+            }
+            mReady.wait();
+        }
+
+        T take() {
+            this->wait();
+            if (mException) {
+                std::rethrow_exception(mException);
+            }
+            mHasValue = false;
+            return mValue.take();
+        }
+
+    private:
+        static ConcurrentPool<FutureState>& pool() {
+            // leaked on purpose: states may be released by threads outliving static destruction.
+            static ConcurrentPool<FutureState>* sPool = new ConcurrentPool<FutureState>();
+            return *sPool;
+        }
+
+        void publish() {
+            mReady.set();
+        }
+
+        std::atomic<u32_t> mRefs;
+        FiberEvent mReady;
+        bool mHasValue;
+        std::exception_ptr mException;
+        FutureValue<T> mValue;
+    };
+
+    template<typename T>
+    class Future {
+    public:
+        Future()
+            : mState(nullptr) {
+        }
+
+        explicit Future(FutureState<T>* state)
+            : mState(state) {
+        }
+
+        Future(Future&& other) noexcept
+            : mState(other.mState) {
+            other.mState = nullptr;
+        }
+
+        Future& operator=(Future&& other) noexcept {
+            if (this != &other) {
+                if (mState != nullptr) {
+                    mState->release();
+                }
+                mState = other.mState;
+                other.mState = nullptr;
+            }
+            return *this;
+        }
+
+        ~Future() {
+            if (mState != nullptr) {
+                mState->release();
+            }
+        }
+
+        _ForbidCopy(Future);
+        _ForbidAssign(Future);
+
+        bool valid() const {
+            return mState != nullptr;
+        }
+
+        bool isReady() const {
+            return mState != nullptr && mState->isReady();
+        }
+
+        void wait() const {
+            if (mState != nullptr) {
+                mState->wait();
+            }
+        }
+
+        /// the result can be taken once, the future is invalid afterwards.
+        T get() {
+            if (mState == nullptr)
+                throw std::future_error(std::future_errc::no_state);
+            FutureState<T>* state = mState;
+            mState = nullptr;
+            struct Releaser {
+                FutureState<T>* state;
+
+                ~Releaser() {
+                    state->release();
+                }
+            } releaser{state};
+            return state->take();
+        }
+
+    private:
+        FutureState<T>* mState;
+    };
+
+    template<typename T>
+    class Promise {
+    public:
+        Promise()
+            : mState(FutureState<T>::create()), mFutureTaken(false) {
+        }
+
+        Promise(Promise&& other) noexcept
+            : mState(other.mState), mFutureTaken(other.mFutureTaken) {
+            other.mState = nullptr;
+        }
+
+        Promise& operator=(Promise&& other) noexcept {
+            if (this != &other) {
+                this->abandon();
+                mState = other.mState;
+                mFutureTaken = other.mFutureTaken;
+                other.mState = nullptr;
+            }
+            return *this;
+        }
+
+        ~Promise() {
+            this->abandon();
+        }
+
+        _ForbidCopy(Promise);
+        _ForbidAssign(Promise);
+
+        Future<T> getFuture() {
+            if (mState == nullptr || mFutureTaken)
+                throw std::future_error(std::future_errc::future_already_retrieved);
+            mFutureTaken = true;
+            mState->retain();
+            return Future<T>(mState);
+        }
+
+        template<typename... U>
+        void setValue(U&& ... value) {
+            if (mState == nullptr)
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            mState->setValue(std::forward<U>(value)...);
+            mState->release();
+            mState = nullptr;
+        }
+
+        void setException(std::exception_ptr exception) {
+            if (mState == nullptr)
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            mState->setException(exception);
+            mState->release();
+            mState = nullptr;
+        }
+
+    private:
+        void abandon() {
+            if (mState == nullptr)
                 return;
-            for (unsigned short i = 0; i < size && mThreads.size() < THREADPOOL_MAX_NUM; i++) {
-                mThreads.emplace_back([this] {
-                    while (mRunning) {
-                        Task task;
-                        {
-                            std::unique_lock<std::mutex> lock{mMutex};
-                            mCond.wait(lock, [this] {
-                                return !mRunning || !mTasks.empty();
-                            });
-                            
-                            if (!mRunning && mTasks.empty())
-                                return;
-                            
-                            task = std::move(mTasks.front());
-                            mTasks.pop();
-                        }
-                        
-                        mIdleCount--;
-                        task();
-                        mIdleCount++;
-                    }
-                });
-                
-                mIdleCount++;
+            if (!mState->isReady()) {
+                mState->setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
             }
+            mState->release();
+            mState = nullptr;
         }
-        
+
+        FutureState<T>* mState;
+        bool mFutureTaken;
+    };
+
+    /*
+    ============================================================================================
+    ==== ThreadPool
+    ==== Shared: every task goes through one queue, the pool grows when no worker is idle.
+    ==== WorkStealing: tasks submitted from a worker stay on its own deque, idle workers steal
+    ==== from random victims, spin for a while and then park.
+    ==== Fiber: WorkStealing where every worker runs on a fiber. A task waiting on a Future,
+    ==== FiberEvent or FiberMutex parks its fiber and the worker carries on with a spare one,
+    ==== so blocked tasks never pin a thread. std::future from exec() still blocks the thread.
+    ==== Falls back to WorkStealing where fibers are not supported.
+    ==== Workers are capped by ThreadPool::maxSize(), the core count but at least
+    ==== THREADPOOL_MAX_NUM.
+    ============================================================================================
+    */
+    enum class ThreadPoolMode {
+        Shared,
+        WorkStealing,
+        Fiber,
+    };
+
+    struct ThreadPoolWorker;
+
+    class ThreadPool : public FiberScheduler {
+    public:
+        ThreadPool(unsigned short size = 4, ThreadPoolMode mode = ThreadPoolMode::Shared);
+        ~ThreadPool();
+
+        _ForbidCopy(ThreadPool);
+        _ForbidAssign(ThreadPool);
+
+        static unsigned short maxSize();
+
+        void expand(unsigned short size);
+
         // 1, bind: .exec(std::bind(&Dog::sayHello, &dog));
         // 2, mem_fn: .exec(std::mem_fn(&Dog::sayHello), this)
         template<typename F, typename... Args>
-        auto exec(F&& f, Args&& ... args) -> future<decltype(f(args...))> {
-            if (!mRunning)
+        auto exec(F&& f, Args&& ... args) -> std::future<decltype(f(args...))> {
+            if (!this->accepts())
                 throw std::runtime_error("commit on ThreadPool is stopped.");
-            
+
             using RetType = decltype(f(args...));
-            
-            auto task = std::make_shared<std::packaged_task<RetType()>>(bind(std::forward<F>(f), std::forward<Args>(args)...));
-            
-            std::future<RetType> future = task->get_future();
-            {
-                std::lock_guard<std::mutex> lock{mMutex};
-                mTasks.emplace([task]() {
-                    (*task)();
-                });
+
+            std::packaged_task<RetType()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+            std::future<RetType> future = task.get_future();
+            this->submit(std::move(task));
+
+            return future;
+        }
+
+        /// fire and forget, nothing is allocated for small callables. The task must not throw.
+        template<typename F, typename... Args>
+        void post(F&& f, Args&& ... args) {
+            if (!this->accepts())
+                throw std::runtime_error("commit on ThreadPool is stopped.");
+
+            if constexpr (sizeof...(Args) == 0) {
+                this->submit(std::forward<F>(f));
             }
-            
-            if (mIdleCount < 1 && mThreads.size() < THREADPOOL_MAX_NUM) {
-                this->expand(1);
+            else {
+                this->submit([fn = std::forward<F>(f), params = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                    std::apply(fn, params);
+                });
             }
-            
-            mCond.notify_one();
-            
+        }
+
+        /// like exec, but the result comes back through a pooled Future.
+        template<typename F, typename... Args>
+        auto spawn(F&& f, Args&& ... args) -> Future<decltype(f(args...))> {
+            using RetType = decltype(f(args...));
+
+            Promise<RetType> promise;
+            Future<RetType> future = promise.getFuture();
+            this->post([fn = std::forward<F>(f), promise = std::move(promise)](auto&& ... params) mutable {
+                try {
+                    if constexpr (std::is_void<RetType>::value) {
+                        fn(params...);
+                        promise.setValue();
+                    }
+                    else {
+                        promise.setValue(fn(params...));
+                    }
+                }
+                catch (...) {
+                    promise.setException(std::current_exception());
+                }
+            }, std::forward<Args>(args)...);
+
             return future;
         }
-        
-        int idle_size() const {
-            return mIdleCount;
+
+        ThreadPoolMode mode() const {
+            return mMode;
         }
-        
+
+        /// runs one pending task on the calling thread, used by joins that help instead of blocking.
+        bool help();
+
+        int idle_size() const;
+
         int size() const {
-            return mThreads.size();
+            return mSize.load(std::memory_order_acquire);
         }
-    
+
+        Fiber* spare() override;
+        void schedule(Fiber* fiber) override;
+
     private:
-        using Task = std::function<void()>;
-        std::vector<std::thread> mThreads;
-        std::queue<Task> mTasks;
-        std::mutex mMutex;
-        std::condition_variable mCond;
+        friend struct ThreadPoolWorker;
+
+        bool accepts() const;
+        void submit(Task&& task);
+        void notify();
+        void run(ThreadPoolWorker* worker);
+        void loop();
+        Fiber* acquireFiber();
+        Fiber* readyFiber();
+        static void fiberMain(void* arg);
+        static void recycleFiber(Fiber* fiber, void* arg);
+        bool park();
+        bool hasWork();
+        Task* find(ThreadPoolWorker* worker);
+        ThreadPoolWorker* worker(int index) const;
+
+        ThreadPoolMode mMode;
+        unsigned short mCapacity;
+        std::unique_ptr<std::atomic<ThreadPoolWorker*>[]> mWorkers;
+        std::atomic<int> mSize{0};
+        std::mutex mExpandMutex;
+        ConcurrentPool<Task, 256, 64> mTaskPool;
+
+        std::mutex mQueueMutex;
+        std::deque<Task*> mQueue;
+        std::atomic<size_t> mQueueSize{0};
+
+        std::mutex mParkMutex;
+        std::condition_variable mParkCond;
+        u64_t mParkEpoch = 0;
+        std::atomic<int> mSleeping{0};
+
+        std::mutex mReadyMutex;
+        std::deque<Fiber*> mReadyFibers;
+        std::atomic<size_t> mReadySize{0};
+        std::mutex mFreeMutex;
+        std::vector<Fiber*> mFreeFibers;
+        std::atomic<int> mSuspended{0};
+
         std::atomic<bool> mRunning{true};
-        std::atomic<int> mIdleCount{0};
     };
-    
+
 }
 
 #endif//_EOKAS_BASE_ASYNC_H_
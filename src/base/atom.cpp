@@ -0,0 +1,250 @@
+
+#include "./atom.h"
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== table
+    ==== Entries live in chunks that are never freed, so a name stays where it is once its id
+    ==== is out. Ids are found through 16 open addressing shards. Readers probe a shard without
+    ==== its lock, a writer fills the entry before it publishes the id in a slot. A shard that
+    ==== grows publishes a new slot array and keeps the old one, a reader may still probe it.
+    ==== Ids are reserved from count, never past the capacity, and made visible to fromId()
+    ==== through ready in id order once their entry is filled.
+    ============================================================================================
+    */
+    struct AtomEntry {
+        String name;
+        u32_t hash = 0;
+    };
+
+    struct AtomSlots {
+        u32_t mask;
+        u32_t used;
+        std::atomic<u32_t>* slots;
+        AtomSlots* retired;
+
+        explicit AtomSlots(u32_t capacity)
+            : mask(capacity - 1), used(0), slots(new std::atomic<u32_t>[capacity]), retired(nullptr) {
+            for (u32_t i = 0; i < capacity; i++) {
+                slots[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct AtomShard {
+        std::mutex mutex;
+        std::atomic<AtomSlots*> slots{nullptr};
+    };
+
+    static const u32_t kAtomShardBits = 4;
+
+    struct AtomTable {
+        std::atomic<AtomEntry*> chunks[Atom::kMaxChunks];
+        std::atomic<u32_t> count;
+        std::atomic<u32_t> ready;
+        AtomShard shards[1 << kAtomShardBits];
+
+        AtomTable() : count(1), ready(1) {
+            for (auto& chunk: chunks) {
+                chunk.store(nullptr, std::memory_order_relaxed);
+            }
+            for (auto& shard: shards) {
+                shard.slots.store(new AtomSlots(64), std::memory_order_relaxed);
+            }
+            chunks[0].store(new AtomEntry[Atom::kChunkSize], std::memory_order_release);
+        }
+
+        static AtomTable& instance() {
+            // leaked on purpose: atoms are used as keys by other statics.
+            static AtomTable* sInstance = new AtomTable();
+            return *sInstance;
+        }
+
+        AtomEntry& entry(u32_t id) {
+            AtomEntry* chunk = chunks[id / Atom::kChunkSize].load(std::memory_order_acquire);
+            return chunk[id % Atom::kChunkSize];
+        }
+
+        u32_t probe(AtomSlots* table, const StringView& name, u32_t hash) {
+            for (u32_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+                u32_t id = table->slots[i].load(std::memory_order_acquire);
+                if (id == 0)
+                    return 0;
+                AtomEntry& candidate = this->entry(id);
+                if (candidate.hash == hash && candidate.name.view() == name)
+                    return id;
+            }
+        }
+
+        u32_t find(const StringView& name, u32_t hash) {
+            AtomShard& shard = shards[hash >> (32 - kAtomShardBits)];
+            return this->probe(shard.slots.load(std::memory_order_acquire), name, hash);
+        }
+
+        u32_t intern(const StringView& name, u32_t hash) {
+            u32_t id = this->find(name, hash);
+            if (id != 0)
+                return id;
+
+            AtomShard& shard = shards[hash >> (32 - kAtomShardBits)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            AtomSlots* table = shard.slots.load(std::memory_order_relaxed);
+            id = this->probe(table, name, hash);
+            if (id != 0)
+                return id;
+
+            id = this->allocate();
+            AtomEntry& created = this->entry(id);
+            try {
+                created.name = String(name);
+            }
+            catch (...) {
+                // the id stays reserved with an empty name and no slot, later ids still publish.
+                this->publish(id);
+                throw;
+            }
+            created.hash = hash;
+            this->publish(id);
+
+            if ((table->used + 1) * 4 > (table->mask + 1) * 3) {
+                table = this->grow(shard, table);
+            }
+            this->insert(table, id, hash);
+            return id;
+        }
+
+        // the chunk of an id is in place before the id is reserved, a full table reserves nothing.
+        u32_t allocate() {
+            u32_t id = count.load(std::memory_order_relaxed);
+            for (;;) {
+                if (id / Atom::kChunkSize >= Atom::kMaxChunks)
+                    throw std::overflow_error("too many atoms.");
+                std::atomic<AtomEntry*>& chunk = chunks[id / Atom::kChunkSize];
+                if (chunk.load(std::memory_order_acquire) == nullptr) {
+                    AtomEntry* fresh = new AtomEntry[Atom::kChunkSize];
+                    AtomEntry* expected = nullptr;
+                    if (!chunk.compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) {
+                        delete[] fresh;
+                    }
+                }
+                if (count.compare_exchange_weak(id, id + 1, std::memory_order_relaxed))
+                    return id;
+            }
+        }
+
+        // ids are reserved under different shard locks, each waits for the one before it.
+        void publish(u32_t id) {
+            while (ready.load(std::memory_order_acquire) != id) {
+                std::this_thread::yield();
+            }
+            ready.store(id + 1, std::memory_order_release);
+        }
+
+        void insert(AtomSlots* table, u32_t id, u32_t hash) {
+            u32_t i = hash & table->mask;
+            while (table->slots[i].load(std::memory_order_relaxed) != 0) {
+                i = (i + 1) & table->mask;
+            }
+            table->slots[i].store(id, std::memory_order_release);
+            table->used += 1;
+        }
+
+        AtomSlots* grow(AtomShard& shard, AtomSlots* table) {
+            AtomSlots* bigger = new AtomSlots((table->mask + 1) * 2);
+            for (u32_t i = 0; i <= table->mask; i++) {
+                u32_t id = table->slots[i].load(std::memory_order_relaxed);
+                if (id != 0) {
+                    this->insert(bigger, id, this->entry(id).hash);
+                }
+            }
+            bigger->retired = table;
+            shard.slots.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+    };
+
+    // FNV-1a with a final avalanche, the top bits pick the shard.
+    static u32_t atom_hash(const StringView& name) {
+        u32_t hash = 2166136261u;
+        for (char c: name) {
+            hash ^= (u8_t) c;
+            hash *= 16777619u;
+        }
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        hash *= 0xC2B2AE35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    /*
+    ============================================================================================
+    ==== Atom
+    ============================================================================================
+    */
+    Atom::Atom(const char* name)
+        : Atom(StringView(name)) {
+    }
+
+    Atom::Atom(const StringView& name)
+        : mId(0) {
+        if (!name.isEmpty()) {
+            mId = AtomTable::instance().intern(name, atom_hash(name));
+        }
+    }
+
+    Atom::Atom(const String& name)
+        : Atom(name.view()) {
+    }
+
+    Atom Atom::lookup(const StringView& name) {
+        if (name.isEmpty())
+            return Atom();
+        return Atom(AtomTable::instance().find(name, atom_hash(name)));
+    }
+
+    Atom Atom::tryIntern(const StringView& name, u32_t limit) {
+        Atom atom = Atom::lookup(name);
+        if (!atom.isEmpty() || name.isEmpty() || Atom::count() >= limit)
+            return atom;
+        try {
+            return Atom(name);
+        } catch (const std::overflow_error&) {
+            return Atom();
+        }
+    }
+
+    Atom Atom::fromId(u32_t id) {
+        if (id >= Atom::count())
+            return Atom();
+        return Atom(id);
+    }
+
+    u32_t Atom::count() {
+        return AtomTable::instance().ready.load(std::memory_order_acquire);
+    }
+
+    u32_t Atom::hash() const {
+        return AtomTable::instance().entry(mId).hash;
+    }
+
+    const String& Atom::name() const {
+        return AtomTable::instance().entry(mId).name;
+    }
+
+    const char* Atom::cstr() const {
+        return this->name().cstr();
+    }
+
+    size_t Atom::length() const {
+        return this->name().length();
+    }
+
+}
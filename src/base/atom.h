@@ -0,0 +1,86 @@
+#ifndef _EOKAS_BASE_ATOM_H_
+#define _EOKAS_BASE_ATOM_H_
+
+#include "./header.h"
+#include "./string.h"
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== Atom
+    ==== An interned string, four bytes. Equal names give the same id in every thread, so
+    ==== atoms compare and hash by id, the name and its hash are looked up in the table.
+    ==== Names are interned for the lifetime of the process, ids are dense from 1 up and the
+    ==== empty name is always 0. Interning an existing name takes no lock.
+    ==== Literal keys on hot paths should be interned once per call site with _Atom("name").
+    ==== Past kChunkSize * kMaxChunks names the constructors throw std::overflow_error. Names
+    ==== that come from data go through tryIntern(), which stops at kMaxDataAtoms instead.
+    ============================================================================================
+    */
+    class Atom {
+    public:
+        static const u32_t kChunkSize = 4096;
+        static const u32_t kMaxChunks = 4096;
+        /// interned names beyond which tryIntern() takes no new one.
+        static const u32_t kMaxDataAtoms = 1024 * 1024;
+
+        Atom() : mId(0) {}
+        explicit Atom(const char* name);
+        explicit Atom(const StringView& name);
+        explicit Atom(const String& name);
+
+        /// the atom of an already interned name, the empty atom otherwise.
+        static Atom lookup(const StringView& name);
+        /// the atom of name, interned only while fewer than limit names are. The empty atom
+        /// for a new name past the limit, never throws for a full table.
+        static Atom tryIntern(const StringView& name, u32_t limit = kMaxDataAtoms);
+        /// the empty atom for ids that were never handed out.
+        static Atom fromId(u32_t id);
+        /// interned names, the empty one included.
+        static u32_t count();
+
+        u32_t id() const {
+            return mId;
+        }
+
+        bool isEmpty() const {
+            return mId == 0;
+        }
+
+        u32_t hash() const;
+        const String& name() const;
+        const char* cstr() const;
+        size_t length() const;
+
+        bool operator==(const Atom& rhs) const {
+            return mId == rhs.mId;
+        }
+
+        bool operator!=(const Atom& rhs) const {
+            return mId != rhs.mId;
+        }
+
+        /// orders by id, which is the order names were first interned in.
+        bool operator<(const Atom& rhs) const {
+            return mId < rhs.mId;
+        }
+
+    private:
+        explicit Atom(u32_t id) : mId(id) {}
+
+        u32_t mId;
+    };
+
+    struct AtomHash {
+        size_t operator()(const Atom& atom) const {
+            return atom.hash();
+        }
+    };
+
+}
+
+/// interns the literal the first time this line runs, later runs only copy the id.
+#define _Atom(literal) ([]() -> eokas::Atom { static const eokas::Atom sAtom(literal); return sAtom; }())
+
+#endif//_EOKAS_BASE_ATOM_H_
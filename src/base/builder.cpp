@@ -0,0 +1,189 @@
+
+#include "./builder.h"
+#include "./slab.h"
+#include <cstring>
+
+namespace eokas {
+
+    StringBuilder::StringBuilder()
+        : mCursor(mInline), mLimit(mInline + kInlineCapacity), mHead(nullptr), mTail(nullptr), mSealed(0), mInlineSize(0),
+          mStream(nullptr), mFailed(false) {
+    }
+
+    StringBuilder::StringBuilder(size_t capacity)
+        : StringBuilder() {
+        this->reserve(capacity);
+    }
+
+    StringBuilder::StringBuilder(Stream& stream)
+        : StringBuilder() {
+        mStream = &stream;
+    }
+
+    StringBuilder::~StringBuilder() {
+        this->flush();
+        this->clear();
+    }
+
+    StringBuilder& StringBuilder::append(char c, size_t count) {
+        while (count > 0) {
+            if (mCursor == mLimit) {
+                this->grow(count);
+            }
+            size_t room = (size_t) (mLimit - mCursor);
+            size_t n = count < room ? count : room;
+            memset(mCursor, c, n);
+            mCursor += n;
+            count -= n;
+        }
+        return *this;
+    }
+
+    StringBuilder& StringBuilder::appendChunked(const char* data, size_t size) {
+        size_t room = (size_t) (mLimit - mCursor);
+        memcpy(mCursor, data, room);
+        mCursor += room;
+        this->grow(size - room);
+        memcpy(mCursor, data + room, size - room);
+        mCursor += size - room;
+        return *this;
+    }
+
+    void StringBuilder::reserve(size_t size) {
+        if ((size_t) (mLimit - mCursor) < size) {
+            this->grow(size);
+        }
+    }
+
+    void StringBuilder::clear() {
+        Chunk* chunk = mHead;
+        while (chunk != nullptr) {
+            Chunk* next = chunk->next;
+            SlabAllocator::free(chunk, sizeof(Chunk) + chunk->capacity);
+            chunk = next;
+        }
+        mCursor = mInline;
+        mLimit = mInline + kInlineCapacity;
+        mHead = nullptr;
+        mTail = nullptr;
+        mSealed = 0;
+        mInlineSize = 0;
+    }
+
+    size_t StringBuilder::length() const {
+        const char* start = mTail != nullptr ? mTail->data() : mInline;
+        return mSealed + (size_t) (mCursor - start);
+    }
+
+    bool StringBuilder::isEmpty() const {
+        return this->length() == 0;
+    }
+
+    String StringBuilder::toString() const {
+        size_t length = this->length();
+        String result;
+        if (length == 0)
+            return result;
+        char* dst = result.reserve(length, false);
+        this->foreach([&](const StringView& piece) -> void {
+            memcpy(dst, piece.data(), piece.length());
+            dst += piece.length();
+        });
+        result.resize(length);
+        return result;
+    }
+
+    void StringBuilder::foreach(const std::function<void(const StringView& piece)>& func) const {
+        size_t inlineSize = mTail != nullptr ? mInlineSize : (size_t) (mCursor - mInline);
+        if (inlineSize > 0) {
+            func(StringView(mInline, inlineSize));
+        }
+        for (Chunk* chunk = mHead; chunk != nullptr; chunk = chunk->next) {
+            size_t size = chunk == mTail ? (size_t) (mCursor - chunk->data()) : chunk->size;
+            if (size > 0) {
+                func(StringView(chunk->data(), size));
+            }
+        }
+    }
+
+    size_t StringBuilder::writeTo(Stream& stream) const {
+        size_t written = 0;
+        bool stopped = false;
+        this->foreach([&](const StringView& piece) -> void {
+            if (stopped)
+                return;
+            size_t n = stream.write((void*) piece.data(), piece.length());
+            written += n;
+            stopped = n < piece.length();
+        });
+        return written;
+    }
+
+    bool StringBuilder::flush() {
+        if (mStream == nullptr)
+            return true;
+        size_t length = this->length();
+        if (length > 0 && !mFailed) {
+            mFailed = this->writeTo(*mStream) != length;
+        }
+
+        // the last chunk takes the text to come, the others go.
+        Chunk* chunk = mHead;
+        while (chunk != mTail) {
+            Chunk* next = chunk->next;
+            SlabAllocator::free(chunk, sizeof(Chunk) + chunk->capacity);
+            chunk = next;
+        }
+        mHead = mTail;
+        if (mTail != nullptr) {
+            mTail->size = 0;
+            mCursor = mTail->data();
+            mLimit = mCursor + mTail->capacity;
+        } else {
+            mCursor = mInline;
+        }
+        mSealed = 0;
+        mInlineSize = 0;
+        return !mFailed;
+    }
+
+    // a chunk for at least size chars, about as big as the text so far. A builder over a
+    // stream writes what it has first and reuses its chunk when that is big enough.
+    void StringBuilder::grow(size_t size) {
+        if (mStream != nullptr) {
+            this->flush();
+            if ((size_t) (mLimit - mCursor) >= size)
+                return;
+        }
+        this->seal();
+        size_t least = mStream != nullptr ? kStreamChunkSize : kInlineCapacity * 4;
+        size_t capacity = mSealed < least ? least : mSealed;
+        capacity = capacity < kMaxChunkSize ? capacity : kMaxChunkSize;
+        capacity = capacity > size ? capacity : size;
+        size_t bytes = SlabAllocator::blockSize(sizeof(Chunk) + capacity);
+
+        Chunk* chunk = (Chunk*) SlabAllocator::alloc(bytes);
+        chunk->next = nullptr;
+        chunk->size = 0;
+        chunk->capacity = bytes - sizeof(Chunk);
+        if (mTail != nullptr) {
+            mTail->next = chunk;
+        } else {
+            mHead = chunk;
+        }
+        mTail = chunk;
+        mCursor = chunk->data();
+        mLimit = mCursor + chunk->capacity;
+    }
+
+    void StringBuilder::seal() {
+        if (mTail != nullptr) {
+            mTail->size = (size_t) (mCursor - mTail->data());
+            mSealed += mTail->size;
+        } else {
+            mInlineSize = (size_t) (mCursor - mInline);
+            mSealed += mInlineSize;
+        }
+    }
+
+}
@@ -0,0 +1,146 @@
+#ifndef _EOKAS_BASE_BUILDER_H_
+#define _EOKAS_BASE_BUILDER_H_
+
+#include "./header.h"
+#include "./string.h"
+#include "./number.h"
+#include "./stream.h"
+#include <cstring>
+#include <type_traits>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== StringBuilder
+    ==== Collects text in chunks that are never moved: the first kInlineCapacity chars live in
+    ==== the builder itself, then every chunk is about as big as all the text before it, up to
+    ==== kMaxChunkSize. Growing never copies what is written, toString() copies it once into
+    ==== a String of the exact length and writeTo() hands the chunks to a Stream as they are.
+    ==== reserve() makes room up front when the size is known.
+    ==== A builder made over a Stream never holds much: whenever its chunk is full the text
+    ==== so far goes to the stream, flush() sends the rest. The text held then is only what
+    ==== has not been written yet.
+    ============================================================================================
+    */
+    class StringBuilder {
+    public:
+        static const size_t kInlineCapacity = 256;
+        static const size_t kMaxChunkSize = 1024 * 1024;
+        /// the chunk a builder over a stream fills before writing.
+        static const size_t kStreamChunkSize = 64 * 1024;
+
+    public:
+        StringBuilder();
+        explicit StringBuilder(size_t capacity);
+        explicit StringBuilder(Stream& stream);
+        /// flushes a builder over a stream.
+        ~StringBuilder();
+
+        _ForbidCopy(StringBuilder);
+        _ForbidAssign(StringBuilder);
+
+    public:
+        StringBuilder& append(const char* data, size_t size) {
+            if (size <= (size_t) (mLimit - mCursor)) {
+                memcpy(mCursor, data, size);
+                mCursor += size;
+                return *this;
+            }
+            return this->appendChunked(data, size);
+        }
+
+        StringBuilder& append(const StringView& str) {
+            return this->append(str.data(), str.length());
+        }
+
+        StringBuilder& append(char c) {
+            if (mCursor == mLimit) {
+                this->grow(1);
+            }
+            *mCursor++ = c;
+            return *this;
+        }
+
+        StringBuilder& append(char c, size_t count);
+
+        StringBuilder& operator<<(const StringView& str) {
+            return this->append(str.data(), str.length());
+        }
+
+        StringBuilder& operator<<(const String& str) {
+            return this->append(str.cstr(), str.length());
+        }
+
+        StringBuilder& operator<<(const char* str) {
+            return this->append(StringView(str));
+        }
+
+        StringBuilder& operator<<(char c) {
+            return this->append(c);
+        }
+
+        /// numbers the way String::valueToString writes them, without a String in between.
+        template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+        StringBuilder& operator<<(T value) {
+            char buffer[NumberChars::kMaxChars];
+            if constexpr (std::is_same<T, bool>::value) {
+                return value ? this->append("true", 4) : this->append("false", 5);
+            } else if constexpr (std::is_floating_point<T>::value) {
+                using Float = typename std::conditional<std::is_same<T, f32_t>::value, f32_t, f64_t>::type;
+                return this->append(buffer, NumberChars::format(buffer, (Float) value));
+            } else if constexpr (std::is_same<T, char>::value) {
+                return this->append(value);
+            } else if constexpr (std::is_signed<T>::value) {
+                return this->append(buffer, NumberChars::format(buffer, (i64_t) value));
+            } else {
+                return this->append(buffer, NumberChars::format(buffer, (u64_t) value));
+            }
+        }
+
+        /// room for size more chars, the next appends up to it take no allocation.
+        void reserve(size_t size);
+        /// drops the text and every chunk but the inline one.
+        void clear();
+
+        size_t length() const;
+        bool isEmpty() const;
+
+        String toString() const;
+        /// the chunks in order, the last one may be empty.
+        void foreach(const std::function<void(const StringView& piece)>& func) const;
+        /// the bytes the stream took, length() unless it stopped early.
+        size_t writeTo(Stream& stream) const;
+        /// writes the text held to the builder's stream and drops it. false once the stream
+        /// took less than it was given, the text after that is dropped unwritten.
+        bool flush();
+
+    private:
+        struct Chunk {
+            Chunk* next;
+            size_t size;
+            size_t capacity;
+
+            char* data() {
+                return (char*) (this + 1);
+            }
+        };
+
+        StringBuilder& appendChunked(const char* data, size_t size);
+        void grow(size_t size);
+        void seal();
+
+        char* mCursor;
+        char* mLimit;
+        Chunk* mHead;
+        Chunk* mTail;
+        size_t mSealed;
+        size_t mInlineSize;
+        Stream* mStream;
+        bool mFailed;
+        char mInline[kInlineCapacity];
+    };
+
+}
+
+#endif//_EOKAS_BASE_BUILDER_H_
@@ -0,0 +1,267 @@
+
+#include "./bulk.h"
+#include "./parallel.h"
+#include <cstring>
+#include <atomic>
+
+#if _EOKAS_ARCH == _EOKAS_ARCH_X64
+#define _EOKAS_BULK_X64 1
+#include <immintrin.h>
+#if _EOKAS_COMPILER_FAMILY == _EOKAS_COMPILER_FAMILY_MSVC
+#include <intrin.h>
+#define _EOKAS_BULK_TARGET(isa)
+#else
+#define _EOKAS_BULK_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace eokas {
+
+    using BulkCopyKernel = void (*)(u8_t* dst, const u8_t* src, size_t size);
+    using BulkFillKernel = void (*)(u8_t* dst, u8_t value, size_t size);
+
+    static void bulk_copy_libc(u8_t* dst, const u8_t* src, size_t size) {
+        memcpy(dst, src, size);
+    }
+
+    static void bulk_fill_libc(u8_t* dst, u8_t value, size_t size) {
+        memset(dst, value, size);
+    }
+
+#if defined(_EOKAS_BULK_X64)
+    /*
+    ============================================================================================
+    ==== kernels
+    ==== The head up to the first aligned destination line and the tail go through libc, the
+    ==== body is streamed in blocks of four vectors. sfence orders the streamed stores before
+    ==== anything the caller writes next, e.g. a flag telling another thread the copy is done.
+    ============================================================================================
+    */
+    static size_t bulk_head(const u8_t* dst, size_t alignment, size_t size) {
+        size_t head = (alignment - ((size_t) dst & (alignment - 1))) & (alignment - 1);
+        return head < size ? head : size;
+    }
+
+    static void bulk_copy_sse2(u8_t* dst, const u8_t* src, size_t size) {
+        size_t head = bulk_head(dst, 16, size);
+        memcpy(dst, src, head);
+        dst += head, src += head, size -= head;
+        for (; size >= 64; dst += 64, src += 64, size -= 64) {
+            __m128i a = _mm_loadu_si128((const __m128i*) src);
+            __m128i b = _mm_loadu_si128((const __m128i*) (src + 16));
+            __m128i c = _mm_loadu_si128((const __m128i*) (src + 32));
+            __m128i d = _mm_loadu_si128((const __m128i*) (src + 48));
+            _mm_stream_si128((__m128i*) dst, a);
+            _mm_stream_si128((__m128i*) (dst + 16), b);
+            _mm_stream_si128((__m128i*) (dst + 32), c);
+            _mm_stream_si128((__m128i*) (dst + 48), d);
+        }
+        _mm_sfence();
+        memcpy(dst, src, size);
+    }
+
+    static void bulk_fill_sse2(u8_t* dst, u8_t value, size_t size) {
+        size_t head = bulk_head(dst, 16, size);
+        memset(dst, value, head);
+        dst += head, size -= head;
+        __m128i v = _mm_set1_epi8((char) value);
+        for (; size >= 64; dst += 64, size -= 64) {
+            _mm_stream_si128((__m128i*) dst, v);
+            _mm_stream_si128((__m128i*) (dst + 16), v);
+            _mm_stream_si128((__m128i*) (dst + 32), v);
+            _mm_stream_si128((__m128i*) (dst + 48), v);
+        }
+        _mm_sfence();
+        memset(dst, value, size);
+    }
+
+    _EOKAS_BULK_TARGET("avx2")
+    static void bulk_copy_avx2(u8_t* dst, const u8_t* src, size_t size) {
+        size_t head = bulk_head(dst, 32, size);
+        memcpy(dst, src, head);
+        dst += head, src += head, size -= head;
+        for (; size >= 128; dst += 128, src += 128, size -= 128) {
+            __m256i a = _mm256_loadu_si256((const __m256i*) src);
+            __m256i b = _mm256_loadu_si256((const __m256i*) (src + 32));
+            __m256i c = _mm256_loadu_si256((const __m256i*) (src + 64));
+            __m256i d = _mm256_loadu_si256((const __m256i*) (src + 96));
+            _mm256_stream_si256((__m256i*) dst, a);
+            _mm256_stream_si256((__m256i*) (dst + 32), b);
+            _mm256_stream_si256((__m256i*) (dst + 64), c);
+            _mm256_stream_si256((__m256i*) (dst + 96), d);
+        }
+        _mm_sfence();
+        _mm256_zeroupper();
+        memcpy(dst, src, size);
+    }
+
+    _EOKAS_BULK_TARGET("avx2")
+    static void bulk_fill_avx2(u8_t* dst, u8_t value, size_t size) {
+        size_t head = bulk_head(dst, 32, size);
+        memset(dst, value, head);
+        dst += head, size -= head;
+        __m256i v = _mm256_set1_epi8((char) value);
+        for (; size >= 128; dst += 128, size -= 128) {
+            _mm256_stream_si256((__m256i*) dst, v);
+            _mm256_stream_si256((__m256i*) (dst + 32), v);
+            _mm256_stream_si256((__m256i*) (dst + 64), v);
+            _mm256_stream_si256((__m256i*) (dst + 96), v);
+        }
+        _mm_sfence();
+        _mm256_zeroupper();
+        memset(dst, value, size);
+    }
+
+    _EOKAS_BULK_TARGET("avx512f")
+    static void bulk_copy_avx512(u8_t* dst, const u8_t* src, size_t size) {
+        size_t head = bulk_head(dst, 64, size);
+        memcpy(dst, src, head);
+        dst += head, src += head, size -= head;
+        for (; size >= 256; dst += 256, src += 256, size -= 256) {
+            __m512i a = _mm512_loadu_si512((const void*) src);
+            __m512i b = _mm512_loadu_si512((const void*) (src + 64));
+            __m512i c = _mm512_loadu_si512((const void*) (src + 128));
+            __m512i d = _mm512_loadu_si512((const void*) (src + 192));
+            _mm512_stream_si512((__m512i*) dst, a);
+            _mm512_stream_si512((__m512i*) (dst + 64), b);
+            _mm512_stream_si512((__m512i*) (dst + 128), c);
+            _mm512_stream_si512((__m512i*) (dst + 192), d);
+        }
+        _mm_sfence();
+        _mm256_zeroupper();
+        memcpy(dst, src, size);
+    }
+
+    _EOKAS_BULK_TARGET("avx512f")
+    static void bulk_fill_avx512(u8_t* dst, u8_t value, size_t size) {
+        size_t head = bulk_head(dst, 64, size);
+        memset(dst, value, head);
+        dst += head, size -= head;
+        __m512i v = _mm512_set1_epi32((int) (value * 0x01010101u));
+        for (; size >= 256; dst += 256, size -= 256) {
+            _mm512_stream_si512((__m512i*) dst, v);
+            _mm512_stream_si512((__m512i*) (dst + 64), v);
+            _mm512_stream_si512((__m512i*) (dst + 128), v);
+            _mm512_stream_si512((__m512i*) (dst + 192), v);
+        }
+        _mm_sfence();
+        _mm256_zeroupper();
+        memset(dst, value, size);
+    }
+
+#if _EOKAS_COMPILER_FAMILY == _EOKAS_COMPILER_FAMILY_MSVC
+    static bool bulk_supports(int level) {
+        int info[4] = {0};
+        __cpuid(info, 1);
+        // AVX state must be enabled by the OS as well (OSXSAVE, then XCR0).
+        if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+            return false;
+        unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if (level == 2)
+            return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+        return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+    }
+#else
+    static bool bulk_supports(int level) {
+        __builtin_cpu_init();
+        if (level == 2)
+            return __builtin_cpu_supports("avx2");
+        return __builtin_cpu_supports("avx512f");
+    }
+#endif
+#endif
+
+    struct BulkKernels {
+        const char* name;
+        BulkCopyKernel copy;
+        BulkFillKernel fill;
+
+        static const BulkKernels& instance() {
+            static const BulkKernels sInstance = BulkKernels::detect();
+            return sInstance;
+        }
+
+        static BulkKernels detect() {
+#if defined(_EOKAS_BULK_X64)
+            if (bulk_supports(3))
+                return {"avx512", bulk_copy_avx512, bulk_fill_avx512};
+            if (bulk_supports(2))
+                return {"avx2", bulk_copy_avx2, bulk_fill_avx2};
+            return {"sse2", bulk_copy_sse2, bulk_fill_sse2};
+#else
+            return {"libc", bulk_copy_libc, bulk_fill_libc};
+#endif
+        }
+    };
+
+    static std::atomic<size_t> sBulkThreshold{MemoryBulk::kDefaultThreshold};
+
+    /*
+    ============================================================================================
+    ==== MemoryBulk
+    ============================================================================================
+    */
+    const char* MemoryBulk::kernel() {
+        return BulkKernels::instance().name;
+    }
+
+    size_t MemoryBulk::threshold() {
+        return sBulkThreshold.load(std::memory_order_relaxed);
+    }
+
+    void MemoryBulk::setThreshold(size_t bytes) {
+        sBulkThreshold.store(bytes, std::memory_order_relaxed);
+    }
+
+    void MemoryBulk::copy(void* dst, const void* src, size_t size) {
+        BulkCopyKernel kernel = size < threshold() ? bulk_copy_libc : BulkKernels::instance().copy;
+        kernel((u8_t*) dst, (const u8_t*) src, size);
+    }
+
+    void MemoryBulk::fill(void* dst, u8_t value, size_t size) {
+        BulkFillKernel kernel = size < threshold() ? bulk_fill_libc : BulkKernels::instance().fill;
+        kernel((u8_t*) dst, value, size);
+    }
+
+    // about one page aligned chunk per thread, a single memory stream saturates well before
+    // the core count, more chunks only add scheduling.
+    static size_t bulk_chunk(ThreadPool& pool, size_t size) {
+        size_t threads = (size_t) pool.size() + 1;
+        size_t chunk = (size + threads - 1) / threads;
+        chunk = (chunk + 4095) & ~(size_t) 4095;
+        return chunk > MemoryBulk::kMinChunk ? chunk : MemoryBulk::kMinChunk;
+    }
+
+    void MemoryBulk::copy(ThreadPool& pool, void* dst, const void* src, size_t size) {
+        size_t chunk = bulk_chunk(pool, size);
+        if (size <= chunk) {
+            MemoryBulk::copy(dst, src, size);
+            return;
+        }
+        // the kernel follows the whole block, chunks may be below the threshold.
+        BulkCopyKernel kernel = size < threshold() ? bulk_copy_libc : BulkKernels::instance().copy;
+        size_t chunks = (size + chunk - 1) / chunk;
+        parallel_for(pool, (size_t) 0, chunks, [=](size_t i) {
+            size_t offset = i * chunk;
+            size_t length = size - offset < chunk ? size - offset : chunk;
+            kernel((u8_t*) dst + offset, (const u8_t*) src + offset, length);
+        }, (size_t) 1);
+    }
+
+    void MemoryBulk::fill(ThreadPool& pool, void* dst, u8_t value, size_t size) {
+        size_t chunk = bulk_chunk(pool, size);
+        if (size <= chunk) {
+            MemoryBulk::fill(dst, value, size);
+            return;
+        }
+        BulkFillKernel kernel = size < threshold() ? bulk_fill_libc : BulkKernels::instance().fill;
+        size_t chunks = (size + chunk - 1) / chunk;
+        parallel_for(pool, (size_t) 0, chunks, [=](size_t i) {
+            size_t offset = i * chunk;
+            size_t length = size - offset < chunk ? size - offset : chunk;
+            kernel((u8_t*) dst + offset, value, length);
+        }, (size_t) 1);
+    }
+
+}
@@ -0,0 +1,41 @@
+#ifndef _EOKAS_BASE_BULK_H_
+#define _EOKAS_BASE_BULK_H_
+
+#include "./header.h"
+
+namespace eokas {
+
+    class ThreadPool;
+
+    /*
+    ============================================================================================
+    ==== MemoryBulk
+    ==== Copy and fill for blocks large enough to flush the caches anyway. From threshold()
+    ==== bytes on, the destination is written with non-temporal stores, so the copy neither
+    ==== evicts the working set nor reads the destination lines first. The widest kernel the
+    ==== CPU supports (AVX-512, AVX2, SSE2) is picked once at startup, smaller blocks and other
+    ==== targets go to libc. The pool overloads split the block into page aligned chunks.
+    ==== Non-temporal data is not in cache afterwards, do not use it for blocks read next.
+    ============================================================================================
+    */
+    class MemoryBulk {
+    public:
+        static const size_t kDefaultThreshold = 4 * 1024 * 1024;
+        /// smallest chunk handed to one worker by the pool overloads.
+        static const size_t kMinChunk = 2 * 1024 * 1024;
+
+        /// "avx512", "avx2", "sse2" or "libc".
+        static const char* kernel();
+        static size_t threshold();
+        /// 0 sends every block to the non-temporal kernel, (size_t)-1 turns it off.
+        static void setThreshold(size_t bytes);
+
+        static void copy(void* dst, const void* src, size_t size);
+        static void fill(void* dst, u8_t value, size_t size);
+        static void copy(ThreadPool& pool, void* dst, const void* src, size_t size);
+        static void fill(ThreadPool& pool, void* dst, u8_t value, size_t size);
+    };
+
+}
+
+#endif//_EOKAS_BASE_BULK_H_
@@ -44,10 +44,18 @@ namespace eokas::cli {
         return opt->value;
     }
     
+    // names are compatible with "-v,--version".
+    static bool cli_name_matches(const String& names, const StringView& name) {
+        for (const StringView& fragment: StringTokenizer(names, ",")) {
+            if (fragment == name)
+                return true;
+        }
+        return false;
+    }
+    
     std::optional<Option> Command::fetchOption(const String& shortName) const {
         for (auto& iter: this->options) {
-            auto fragments = iter.first.split(",");
-            if (std::find(fragments.begin(), fragments.end(), shortName) != fragments.end())
+            if (cli_name_matches(iter.first, shortName))
                 return iter.second;
         }
         return std::nullopt;
@@ -55,8 +63,7 @@ namespace eokas::cli {
     
     std::optional<Command> Command::fetchCommand(const String& shortName) const {
         for (auto& iter: this->subCommands) {
-            auto fragments = iter.first.split(",");
-            if (std::find(fragments.begin(), fragments.end(), shortName) != fragments.end())
+            if (cli_name_matches(iter.first, shortName))
                 return iter.second;
         }
         return std::nullopt;
@@ -74,25 +81,20 @@ namespace eokas::cli {
     }
     
     void Command::exec(size_t argc, char const* const* argv) {
-        if (argc <= 0 || this->name != String(argv[0]))
+        if (argc <= 0 || this->name.view() != StringView(argv[0]))
             throw std::invalid_argument("Invalid arguments");
         
-        std::vector<StringValue> args;
-        for (size_t i = 0; i < argc; i++) {
-            String arg = argv[i];
-            args.emplace_back(arg);
-        }
+        // views over argv, only option values that are kept become Strings.
+        StringViewVector args(argv, argv + argc);
         
         bool isArgumentsConsumedByCommands = false;
         bool isArgumentsConsumedByOptions = false;
         
         // process sub-commands.
         if (args.size() > 1 && this->subCommands.size() > 0) {
-            String cmdName = args[1];
+            const StringView& cmdName = args[1];
             for (auto& cmd: this->subCommands) {
-                // compatible with "-v,--version"
-                auto fragments = cmd.first.split(",");
-                if (std::find(fragments.begin(), fragments.end(), cmdName) == fragments.end())
+                if (!cli_name_matches(cmd.first, cmdName))
                     continue;
                 
                 isArgumentsConsumedByCommands = true;
@@ -105,8 +107,7 @@ namespace eokas::cli {
         if (args.size() > 1 && this->options.size() > 0) {
             for (auto& opt: this->options) {
                 // compatible with "-v,--version"
-                auto fragments = opt.first.split(",");
-                for (const auto& frag: fragments) {
+                for (const StringView& frag: StringTokenizer(opt.first, ",")) {
                     auto argIter = std::find(args.begin(), args.end(), frag);
                     if (argIter == args.end())
                         continue;
@@ -114,7 +115,11 @@ namespace eokas::cli {
                     ++argIter;
                     
                     // --option0 --option1
-                    opt.second.value = argIter == args.end() || argIter->string().startsWith("-") ? "true" : *argIter;
+                    if (argIter == args.end() || argIter->startsWith("-")) {
+                        opt.second.value = StringValue::trueValue;
+                    } else {
+                        opt.second.value = String(*argIter);
+                    }
                     
                     isArgumentsConsumedByOptions = true;
                 }
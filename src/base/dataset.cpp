@@ -1,6 +1,7 @@
 
 #include "./dataset.h"
 #include "./string.h"
+#include <cstring>
 
 namespace eokas {
     /*
@@ -9,7 +10,7 @@ namespace eokas {
     ============================================================================================
     */
     DataCell::DataCell()
-        : mLength(0), mData(nullptr) {
+        : mLength(0), mData(nullptr), mIsNewm(false) {
     }
     
     DataCell::~DataCell() {
@@ -29,14 +30,32 @@ namespace eokas {
         mData = new u8_t[length];
         memcpy(mData, data, length);
         mLength = length;
+        mIsNewm = true;
+    }
+    
+    void DataCell::setData(u8_t* data, u16_t length, MemoryArena* arena) {
+        if (arena == nullptr) {
+            this->setData(data, length);
+            return;
+        }
+        this->clear();
+        mData = (u8_t*) arena->alloc(length, 1);
+        if (mData == nullptr)
+            return;
+        memcpy(mData, data, length);
+        mLength = length;
+        mIsNewm = false;
     }
     
     void DataCell::clear() {
         mLength = 0;
         if (mData != nullptr) {
-            delete[]mData;
+            if (mIsNewm) {
+                delete[]mData;
+            }
             mData = nullptr;
         }
+        mIsNewm = false;
     }
     
     DataCell& DataCell::operator=(const DataCell& cell) {
@@ -173,11 +192,27 @@ namespace eokas {
         return *(this->getCell(colName));
     }
     
-    void DataRow::setCell(const String& colName, DataCell* cell) {
+    DataCell& DataRow::operator[](const Atom& colName) {
+        return *(this->getCell(colName));
+    }
+    
+    bool DataRow::setCell(const String& colName, DataCell* cell) {
+        Atom atom = Atom::tryIntern(colName);
+        if (atom.isEmpty() && !colName.isEmpty())
+            return false;
+        mCells[atom] = cell;
+        return true;
+    }
+    
+    void DataRow::setCell(const Atom& colName, DataCell* cell) {
         mCells[colName] = cell;
     }
     
     DataCell* DataRow::getCell(const String& colName) {
+        return this->getCell(Atom::lookup(colName));
+    }
+    
+    DataCell* DataRow::getCell(const Atom& colName) {
         auto cellIter = mCells.find(colName);
         if (cellIter == mCells.end())
             return nullptr;
@@ -493,7 +528,7 @@ namespace eokas {
         }
     }
     
-    void DataSet::load(u8_t* bytes) {
+    void DataSet::load(u8_t* bytes, MemoryArena* arena) {
         if (bytes == nullptr)
             return;
         
@@ -564,12 +599,10 @@ namespace eokas {
                 for (u16_t rowId = 0; rowId < rowCount; rowId++) {
                     u16_t cellLength = *((u16_t*) ptr);
                     ptr += 2;
-                    u8_t* cellData = new u8_t[cellLength];
-                    memcpy(cellData, ptr, cellLength);
-                    ptr += cellLength;
                     
                     DataCell* cell = col->createCell();
-                    cell->setData(cellData, cellLength);
+                    cell->setData(ptr, cellLength, arena);
+                    ptr += cellLength;
                 }
             }
         }
@@ -4,6 +4,9 @@
 
 #include "./header.h"
 #include "./string.h"
+#include "./atom.h"
+#include "./arena.h"
+#include <unordered_map>
 
 namespace eokas {
 
@@ -29,6 +32,7 @@ namespace eokas {
         u8_t* data() const;
         u16_t length() const;
         void setData(u8_t* data, u16_t length);
+        void setData(u8_t* data, u16_t length, MemoryArena* arena);
         void clear();
     
     public:
@@ -62,6 +66,7 @@ namespace eokas {
     private:
         u16_t mLength;
         u8_t* mData;
+        bool mIsNewm;
     };
     
     /*
@@ -109,13 +114,18 @@ namespace eokas {
     
     public:
         DataCell& operator[](const String& colName);
+        DataCell& operator[](const Atom& colName);
     
     public:
-        void setCell(const String& colName, DataCell* cell);
+        /// a new column name is interned for the life of the process through Atom::tryIntern(),
+        /// so past Atom::kMaxDataAtoms names the cell is not set and false comes back.
+        bool setCell(const String& colName, DataCell* cell);
+        void setCell(const Atom& colName, DataCell* cell);
         DataCell* getCell(const String& colName);
+        DataCell* getCell(const Atom& colName);
     
     private:
-        std::map<String, DataCell*> mCells;
+        std::unordered_map<Atom, DataCell*, AtomHash> mCells;
     };
     
     /*
@@ -175,7 +185,9 @@ namespace eokas {
         DataTable* createTable(const String& tableName);
         DataTable* selectTable(const String& tableName);
         void deleteTable(const String& tableName);
-        void load(u8_t* bytes);
+        /// cell data is copied into the arena when one is given,
+        /// the arena must outlive the DataSet (or its clear()).
+        void load(u8_t* bytes, MemoryArena* arena = nullptr);
         void save(u8_t* bytes, size_t* length);
         void clear();
     
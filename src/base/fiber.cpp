@@ -0,0 +1,609 @@
+
+#include "./fiber.h"
+#include "./memory.h"
+#include <cstdlib>
+
+#if _EOKAS_OS == _EOKAS_OS_LINUX
+    #define _EOKAS_FIBER 1
+    #if defined(__x86_64__)
+        #define _EOKAS_FIBER_ASM 1
+    #else
+        #include <ucontext.h>
+    #endif
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+    #define _EOKAS_FIBER_ASAN 1
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define _EOKAS_FIBER_ASAN 1
+    #endif
+#endif
+#if defined(__SANITIZE_THREAD__)
+    #define _EOKAS_FIBER_TSAN 1
+#elif defined(__has_feature)
+    #if __has_feature(thread_sanitizer)
+        #define _EOKAS_FIBER_TSAN 1
+    #endif
+#endif
+
+#if defined(_EOKAS_FIBER_ASAN)
+    #include <sanitizer/asan_interface.h>
+    #include <sanitizer/common_interface_defs.h>
+#endif
+#if defined(_EOKAS_FIBER_TSAN)
+    #include <sanitizer/tsan_interface.h>
+#endif
+
+#if defined(_EOKAS_FIBER_ASM)
+/*
+ * eokas_fiber_swap(void** from, void* to)
+ * Pushes the callee-saved registers plus mxcsr / x87 control word, stores the stack pointer in
+ * *from and pops the same frame from `to`. A fresh stack is laid out so that the final ret
+ * lands in eokas_fiber_start with r12 holding the function to call.
+ */
+asm(R"(
+    .pushsection .text
+    .globl eokas_fiber_swap
+    .type eokas_fiber_swap, @function
+eokas_fiber_swap:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size eokas_fiber_swap, .-eokas_fiber_swap
+
+    .globl eokas_fiber_start
+    .type eokas_fiber_start, @function
+eokas_fiber_start:
+    callq *%r12
+    ud2
+    .size eokas_fiber_start, .-eokas_fiber_start
+    .popsection
+)");
+
+extern "C" void eokas_fiber_swap(void** from, void* to);
+extern "C" void eokas_fiber_start();
+#endif
+
+namespace eokas {
+
+#if defined(__GNUC__)
+    #define _EOKAS_FIBER_NOINLINE __attribute__((noinline))
+#else
+    #define _EOKAS_FIBER_NOINLINE
+#endif
+
+    /*
+    ============================================================================================
+    ==== per thread state
+    ==== Always read through fiber_thread(): a fiber that was parked on one thread can wake up
+    ==== on another, so the address of a thread_local must not be cached across a switch.
+    ============================================================================================
+    */
+    struct FiberThread {
+        Fiber* current;
+        void* context;
+        bool leavingThread;
+        bool recycling;
+        Fiber::Action action;
+        Fiber* actionFiber;
+        void* actionArg;
+        const void* stackBottom;
+        size_t stackSize;
+        void* fakeStack;
+        void* tsanFiber;
+#if defined(_EOKAS_FIBER) && !defined(_EOKAS_FIBER_ASM)
+        ucontext_t threadContext;
+#endif
+    };
+
+    static thread_local FiberThread tFiberThread;
+
+    _EOKAS_FIBER_NOINLINE static FiberThread& fiber_thread() {
+        FiberThread* thread = &tFiberThread;
+#if defined(__GNUC__)
+        asm volatile("" : "+r"(thread));
+#endif
+        return *thread;
+    }
+
+    /*
+    ============================================================================================
+    ==== stack pool
+    ==== Default sized stacks are kept for reuse, the pool is leaked on purpose.
+    ============================================================================================
+    */
+    struct FiberStackPool {
+        static const size_t kMaxCount = 1024;
+
+        std::mutex mutex;
+        std::vector<u8_t*> mappings;
+        size_t mappingSize = 0;
+
+        static FiberStackPool& instance() {
+            static FiberStackPool* sInstance = new FiberStackPool();
+            return *sInstance;
+        }
+    };
+
+    static size_t fiber_align_up(size_t value, size_t align) {
+        return (value + align - 1) / align * align;
+    }
+
+    /*
+    ============================================================================================
+    ==== FiberRuntime
+    ============================================================================================
+    */
+    struct FiberRuntime {
+#if defined(_EOKAS_FIBER)
+        static void main() {
+            Fiber* self = fiber_thread().current;
+            arrive();
+            self->mEntry(self->mArg);
+            // entries leave through Fiber::exit or by switching away for good.
+            std::abort();
+        }
+
+        static void prepare(Fiber* fiber) {
+            fiber->mFakeStack = nullptr;
+#if defined(_EOKAS_FIBER_TSAN)
+            // a recycled fiber never unwound its frames, start over with a clean shadow stack.
+            if (fiber->mTsanFiber != nullptr) {
+                __tsan_destroy_fiber(fiber->mTsanFiber);
+            }
+            fiber->mTsanFiber = __tsan_create_fiber(0);
+#endif
+#if defined(_EOKAS_FIBER_ASAN)
+            __asan_unpoison_memory_region(fiber->mStack, fiber->mStackSize);
+#endif
+#if defined(_EOKAS_FIBER_ASM)
+            void** sp = (void**) (fiber->mStack + fiber->mStackSize);
+            *--sp = (void*) &eokas_fiber_start;
+            *--sp = nullptr;                // rbp
+            *--sp = nullptr;                // rbx
+            *--sp = (void*) &FiberRuntime::main; // r12
+            *--sp = nullptr;                // r13
+            *--sp = nullptr;                // r14
+            *--sp = nullptr;                // r15
+            *--sp = nullptr;
+            u32_t* control = (u32_t*) sp;
+            control[0] = 0x1F80;            // mxcsr: all exceptions masked, round to nearest
+            control[1] = 0x037F;            // x87: all exceptions masked, extended precision
+            fiber->mContext = sp;
+#else
+            ucontext_t* context = (ucontext_t*) fiber->mContext;
+            getcontext(context);
+            context->uc_stack.ss_sp = fiber->mStack;
+            context->uc_stack.ss_size = fiber->mStackSize;
+            context->uc_link = nullptr;
+            makecontext(context, &FiberRuntime::main, 0);
+#endif
+        }
+
+        static void swap(FiberThread& thread, Fiber* from, Fiber* to) {
+#if defined(_EOKAS_FIBER_ASM)
+            void** fromContext = from != nullptr ? &from->mContext : &thread.context;
+            void* toContext = to != nullptr ? to->mContext : thread.context;
+#else
+            ucontext_t* fromContext = from != nullptr ? (ucontext_t*) from->mContext : &thread.threadContext;
+            ucontext_t* toContext = to != nullptr ? (ucontext_t*) to->mContext : &thread.threadContext;
+#endif
+            thread.leavingThread = from == nullptr;
+#if defined(_EOKAS_FIBER_ASAN)
+            void** fakeStack = thread.recycling ? nullptr : (from != nullptr ? &from->mFakeStack : &thread.fakeStack);
+            const void* bottom = to != nullptr ? to->mStack : thread.stackBottom;
+            size_t size = to != nullptr ? to->mStackSize : thread.stackSize;
+            __sanitizer_start_switch_fiber(fakeStack, bottom, size);
+#endif
+#if defined(_EOKAS_FIBER_TSAN)
+            __tsan_switch_to_fiber(to != nullptr ? to->mTsanFiber : thread.tsanFiber, 0);
+#endif
+#if defined(_EOKAS_FIBER_ASM)
+            eokas_fiber_swap(fromContext, toContext);
+#else
+            swapcontext(fromContext, toContext);
+#endif
+            arrive();
+        }
+
+        // runs on the context that was just switched to.
+        static void arrive() {
+            FiberThread& thread = fiber_thread();
+#if defined(_EOKAS_FIBER_ASAN)
+            // the fiber now running, set before the switch by whoever switched to it.
+            Fiber* self = thread.current;
+            const void* bottom = nullptr;
+            size_t size = 0;
+            __sanitizer_finish_switch_fiber(self != nullptr ? self->mFakeStack : thread.fakeStack, &bottom, &size);
+            if (thread.leavingThread) {
+                thread.stackBottom = bottom;
+                thread.stackSize = size;
+            }
+#endif
+            Fiber::Action action = thread.action;
+            if (action != nullptr) {
+                thread.action = nullptr;
+                action(thread.actionFiber, thread.actionArg);
+            }
+        }
+#endif
+    };
+
+    /*
+    ============================================================================================
+    ==== Fiber
+    ============================================================================================
+    */
+    Fiber::Fiber()
+        : next(nullptr)
+        , mScheduler(nullptr)
+        , mEntry(nullptr)
+        , mArg(nullptr)
+        , mMapping(nullptr)
+        , mMappingSize(0)
+        , mStack(nullptr)
+        , mStackSize(0)
+        , mContext(nullptr)
+        , mFakeStack(nullptr)
+        , mTsanFiber(nullptr) {
+    }
+
+    Fiber::~Fiber() {
+    }
+
+#if defined(_EOKAS_FIBER)
+
+    bool Fiber::isSupported() {
+        return true;
+    }
+
+    Fiber* Fiber::current() {
+        return fiber_thread().current;
+    }
+
+    Fiber* Fiber::create(FiberScheduler* scheduler, Entry entry, void* arg, size_t stackSize) {
+        size_t pageSize = MemoryUtility::page_size();
+        size_t mappingSize = fiber_align_up(stackSize, pageSize) + pageSize;
+
+        u8_t* mapping = nullptr;
+        FiberStackPool& pool = FiberStackPool::instance();
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (pool.mappingSize == mappingSize && !pool.mappings.empty()) {
+                mapping = pool.mappings.back();
+                pool.mappings.pop_back();
+            }
+        }
+        if (mapping == nullptr) {
+            mapping = (u8_t*) MemoryUtility::alloc_v(mappingSize, 3);
+            if (mapping == nullptr)
+                return nullptr;
+            // the stack grows down, an overflow runs into the inaccessible lowest page.
+            if (MemoryUtility::prot_v(mapping, pageSize, 0) != 0) {
+                MemoryUtility::free_v(mapping, mappingSize);
+                return nullptr;
+            }
+        }
+
+        Fiber* fiber = new Fiber();
+        fiber->mScheduler = scheduler;
+        fiber->mEntry = entry;
+        fiber->mArg = arg;
+        fiber->mMapping = mapping;
+        fiber->mMappingSize = mappingSize;
+        fiber->mStack = mapping + pageSize;
+        fiber->mStackSize = mappingSize - pageSize;
+#if !defined(_EOKAS_FIBER_ASM)
+        fiber->mContext = new ucontext_t();
+#endif
+        FiberRuntime::prepare(fiber);
+        return fiber;
+    }
+
+    void Fiber::destroy(Fiber* fiber) {
+        if (fiber == nullptr)
+            return;
+#if !defined(_EOKAS_FIBER_ASM)
+        delete (ucontext_t*) fiber->mContext;
+#endif
+#if defined(_EOKAS_FIBER_TSAN)
+        __tsan_destroy_fiber(fiber->mTsanFiber);
+#endif
+        bool pooled = false;
+        FiberStackPool& pool = FiberStackPool::instance();
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (pool.mappings.empty()) {
+                pool.mappingSize = fiber->mMappingSize;
+            }
+            if (pool.mappingSize == fiber->mMappingSize && pool.mappings.size() < FiberStackPool::kMaxCount) {
+                pool.mappings.push_back(fiber->mMapping);
+                pooled = true;
+            }
+        }
+        if (!pooled) {
+            MemoryUtility::free_v(fiber->mMapping, fiber->mMappingSize);
+        }
+        delete fiber;
+    }
+
+    void Fiber::run(Fiber* fiber) {
+        FiberThread& thread = fiber_thread();
+        if (thread.current != nullptr || fiber == nullptr)
+            return;
+#if defined(_EOKAS_FIBER_TSAN)
+        thread.tsanFiber = __tsan_get_current_fiber();
+#endif
+        thread.action = nullptr;
+        thread.current = fiber;
+        thread.recycling = false;
+        FiberRuntime::swap(thread, nullptr, fiber);
+    }
+
+    void Fiber::switchTo(Fiber* fiber, Action action, void* arg, bool recycle) {
+        FiberThread& thread = fiber_thread();
+        Fiber* from = thread.current;
+        if (from == nullptr || fiber == nullptr || fiber == from)
+            return;
+        thread.action = action;
+        thread.actionFiber = from;
+        thread.actionArg = arg;
+        thread.current = fiber;
+        thread.recycling = recycle;
+        FiberRuntime::swap(thread, from, fiber);
+    }
+
+    void Fiber::exit(Action action, void* arg) {
+        FiberThread& thread = fiber_thread();
+        Fiber* from = thread.current;
+        if (from == nullptr)
+            return;
+        thread.action = action;
+        thread.actionFiber = from;
+        thread.actionArg = arg;
+        thread.current = nullptr;
+        thread.recycling = true;
+        FiberRuntime::swap(thread, from, nullptr);
+        std::abort();
+    }
+
+    bool Fiber::suspend(Action publish, void* arg) {
+        Fiber* self = Fiber::current();
+        if (self == nullptr || self->mScheduler == nullptr)
+            return false;
+        Fiber* spare = self->mScheduler->spare();
+        if (spare == nullptr)
+            return false;
+        Fiber::switchTo(spare, publish, arg);
+        return true;
+    }
+
+    void Fiber::restart() {
+        FiberRuntime::prepare(this);
+    }
+
+#else
+
+    bool Fiber::isSupported() {
+        return false;
+    }
+
+    Fiber* Fiber::current() {
+        return nullptr;
+    }
+
+    Fiber* Fiber::create(FiberScheduler* scheduler, Entry entry, void* arg, size_t stackSize) {
+        return nullptr;
+    }
+
+    void Fiber::destroy(Fiber* fiber) {
+        delete fiber;
+    }
+
+    void Fiber::run(Fiber* fiber) {
+    }
+
+    void Fiber::switchTo(Fiber* fiber, Action action, void* arg, bool recycle) {
+    }
+
+    void Fiber::exit(Action action, void* arg) {
+    }
+
+    bool Fiber::suspend(Action publish, void* arg) {
+        return false;
+    }
+
+    void Fiber::restart() {
+    }
+
+#endif
+
+    void Fiber::wake() {
+        mScheduler->schedule(this);
+    }
+
+    /*
+    ============================================================================================
+    ==== FiberEvent
+    ============================================================================================
+    */
+    FiberEvent::FiberEvent()
+        : mSet(false), mWaiting(0), mMutex(), mCond(), mFibers(nullptr) {
+    }
+
+    FiberEvent::~FiberEvent() {
+    }
+
+    void FiberEvent::set() {
+        mSet.store(true, std::memory_order_seq_cst);
+        if (mWaiting.load(std::memory_order_seq_cst) == 0)
+            return;
+
+        Fiber* fibers = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            fibers = mFibers;
+            mFibers = nullptr;
+            for (Fiber* fiber = fibers; fiber != nullptr; fiber = fiber->next) {
+                mWaiting.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        mCond.notify_all();
+
+        while (fibers != nullptr) {
+            Fiber* fiber = fibers;
+            fibers = fiber->next;
+            fiber->next = nullptr;
+            fiber->wake();
+        }
+    }
+
+    void FiberEvent::reset() {
+        mSet.store(false, std::memory_order_seq_cst);
+    }
+
+    void FiberEvent::wait() {
+        if (this->isSet())
+            return;
+        if (Fiber::current() != nullptr && Fiber::suspend(&FiberEvent::park, this))
+            return;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWaiting.fetch_add(1, std::memory_order_seq_cst);
+        mCond.wait(lock, [this] {
+            return mSet.load(std::memory_order_seq_cst);
+        });
+        mWaiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void FiberEvent::park(Fiber* fiber, void* arg) {
+        FiberEvent* self = (FiberEvent*) arg;
+        {
+            std::lock_guard<std::mutex> lock(self->mMutex);
+            self->mWaiting.fetch_add(1, std::memory_order_seq_cst);
+            if (!self->mSet.load(std::memory_order_seq_cst)) {
+                fiber->next = self->mFibers;
+                self->mFibers = fiber;
+                return;
+            }
+            self->mWaiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+        fiber->wake();
+    }
+
+    /*
+    ============================================================================================
+    ==== FiberMutex
+    ============================================================================================
+    */
+    FiberMutex::FiberMutex()
+        : mMutex(), mCond(), mLocked(false), mThreadWaiters(0), mHead(nullptr), mTail(nullptr) {
+    }
+
+    FiberMutex::~FiberMutex() {
+    }
+
+    void FiberMutex::lock() {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (!mLocked) {
+                mLocked = true;
+                return;
+            }
+            if (Fiber::current() == nullptr) {
+                mThreadWaiters += 1;
+                mCond.wait(lock, [this] {
+                    return !mLocked;
+                });
+                mThreadWaiters -= 1;
+                mLocked = true;
+                return;
+            }
+        }
+        // unlock() hands the lock over before it wakes us.
+        if (Fiber::suspend(&FiberMutex::park, this))
+            return;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mThreadWaiters += 1;
+        mCond.wait(lock, [this] {
+            return !mLocked;
+        });
+        mThreadWaiters -= 1;
+        mLocked = true;
+    }
+
+    bool FiberMutex::try_lock() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mLocked)
+            return false;
+        mLocked = true;
+        return true;
+    }
+
+    void FiberMutex::unlock() {
+        Fiber* next = nullptr;
+        bool notify = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mHead != nullptr) {
+                next = mHead;
+                mHead = next->next;
+                if (mHead == nullptr) {
+                    mTail = nullptr;
+                }
+                next->next = nullptr;
+            }
+            else {
+                mLocked = false;
+                notify = mThreadWaiters > 0;
+            }
+        }
+        if (next != nullptr) {
+            next->wake();
+        }
+        else if (notify) {
+            mCond.notify_one();
+        }
+    }
+
+    void FiberMutex::park(Fiber* fiber, void* arg) {
+        FiberMutex* self = (FiberMutex*) arg;
+        {
+            std::lock_guard<std::mutex> lock(self->mMutex);
+            if (self->mLocked) {
+                fiber->next = nullptr;
+                if (self->mTail != nullptr) {
+                    self->mTail->next = fiber;
+                }
+                else {
+                    self->mHead = fiber;
+                }
+                self->mTail = fiber;
+                return;
+            }
+            self->mLocked = true;
+        }
+        fiber->wake();
+    }
+
+}
@@ -0,0 +1,164 @@
+#ifndef _EOKAS_BASE_FIBER_H_
+#define _EOKAS_BASE_FIBER_H_
+
+#include "./header.h"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace eokas {
+
+    class Fiber;
+
+    /*
+    ============================================================================================
+    ==== FiberScheduler
+    ============================================================================================
+    */
+    class FiberScheduler : public Interface {
+    public:
+        /// a fresh fiber that keeps the current thread busy while the running fiber is parked.
+        virtual Fiber* spare() = 0;
+        /// makes a parked fiber runnable again, may be called from any thread.
+        virtual void schedule(Fiber* fiber) = 0;
+    };
+
+    /*
+    ============================================================================================
+    ==== Fiber
+    ==== User-mode execution context on a pooled stack with a guard page below it.
+    ==== Switching saves the callee-saved registers only; after a switch the pending action of
+    ==== the fiber that left runs on the fiber that arrived, so a parked fiber is published to
+    ==== its waiters only once it is off the CPU.
+    ==== A parked fiber may be resumed on another thread, thread_local state read before a
+    ==== wait can be stale after it.
+    ==== Only available on Linux, isSupported() is false everywhere else.
+    ============================================================================================
+    */
+    class Fiber {
+    public:
+        using Entry = void (*)(void* arg);
+        using Action = void (*)(Fiber* fiber, void* arg);
+
+        static const size_t kDefaultStackSize = 256 * 1024;
+
+        static bool isSupported();
+
+        /// the fiber running on the calling thread, null on a plain thread.
+        static Fiber* current();
+
+        static Fiber* create(FiberScheduler* scheduler, Entry entry, void* arg, size_t stackSize = kDefaultStackSize);
+        static void destroy(Fiber* fiber);
+
+        /// leaves the thread's own stack for the fiber, returns once a fiber calls exit().
+        static void run(Fiber* fiber);
+
+        /// switches from the current fiber to another one. When `recycle` is set the current
+        /// fiber will never be switched back to, only restarted.
+        static void switchTo(Fiber* fiber, Action action, void* arg, bool recycle = false);
+
+        /// leaves the current fiber for good and returns into run() on this thread.
+        static void exit(Action action, void* arg);
+
+        /// parks the current fiber on the scheduler's spare fiber. `publish` runs once the
+        /// fiber is off the CPU and must make sure someone calls wake() later. Returns false
+        /// without parking when there is no fiber or no spare one, callers then block instead.
+        static bool suspend(Action publish, void* arg);
+
+        void wake();
+
+        /// rewinds a recycled fiber to its entry.
+        void restart();
+
+        FiberScheduler* scheduler() const {
+            return mScheduler;
+        }
+
+        /// intrusive link for wait lists, owned by whoever parked the fiber.
+        Fiber* next;
+
+    private:
+        friend struct FiberRuntime;
+
+        Fiber();
+        ~Fiber();
+
+        FiberScheduler* mScheduler;
+        Entry mEntry;
+        void* mArg;
+        u8_t* mMapping;
+        size_t mMappingSize;
+        u8_t* mStack;
+        size_t mStackSize;
+        void* mContext;
+        void* mFakeStack;
+        void* mTsanFiber;
+    };
+
+    /*
+    ============================================================================================
+    ==== FiberEvent
+    ==== Manual-reset event. wait() parks the calling fiber, or blocks a plain thread.
+    ==== set() only takes the lock when somebody waits.
+    ============================================================================================
+    */
+    class FiberEvent {
+    public:
+        FiberEvent();
+        ~FiberEvent();
+
+        _ForbidCopy(FiberEvent);
+        _ForbidAssign(FiberEvent);
+
+        bool isSet() const {
+            return mSet.load(std::memory_order_acquire);
+        }
+
+        void set();
+        void reset();
+        void wait();
+
+    private:
+        static void park(Fiber* fiber, void* arg);
+
+        std::atomic<bool> mSet;
+        std::atomic<u32_t> mWaiting;
+        std::mutex mMutex;
+        std::condition_variable mCond;
+        Fiber* mFibers;
+    };
+
+    /*
+    ============================================================================================
+    ==== FiberMutex
+    ==== Lock handed over to waiters in FIFO order, parked fibers are preferred over blocked
+    ==== threads. Usable with std::lock_guard / std::unique_lock.
+    ============================================================================================
+    */
+    class FiberMutex {
+    public:
+        FiberMutex();
+        ~FiberMutex();
+
+        _ForbidCopy(FiberMutex);
+        _ForbidAssign(FiberMutex);
+
+        void lock();
+        bool try_lock();
+        void unlock();
+
+    private:
+        static void park(Fiber* fiber, void* arg);
+
+        std::mutex mMutex;
+        std::condition_variable mCond;
+        bool mLocked;
+        u32_t mThreadWaiters;
+        Fiber* mHead;
+        Fiber* mTail;
+    };
+
+}
+
+#endif//_EOKAS_BASE_FIBER_H_
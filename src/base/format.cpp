@@ -0,0 +1,435 @@
+
+#include "./format.h"
+#include "./number.h"
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== FormatWriter
+    ============================================================================================
+    */
+    void FormatWriter::append(char c, size_t count) {
+        while (count > 0) {
+            if (mUsed == mCapacity) {
+                this->drain();
+                if (mUsed == mCapacity) {
+                    mTotal += count;
+                    return;
+                }
+            }
+            size_t room = mCapacity - mUsed;
+            size_t n = count < room ? count : room;
+            memset(mBuffer + mUsed, c, n);
+            mUsed += n;
+            mTotal += n;
+            count -= n;
+        }
+    }
+
+    void FormatWriter::append(const char* data, size_t size) {
+        if (mFlush != nullptr && size >= mCapacity) {
+            // bigger than the whole buffer, no point in copying it through.
+            this->drain();
+            mFlush(mTarget, data, size);
+            mTotal += size;
+            return;
+        }
+        while (size > 0) {
+            if (mUsed == mCapacity) {
+                this->drain();
+                if (mUsed == mCapacity) {
+                    mTotal += size;
+                    return;
+                }
+            }
+            size_t room = mCapacity - mUsed;
+            size_t n = size < room ? size : room;
+            memcpy(mBuffer + mUsed, data, n);
+            mUsed += n;
+            mTotal += n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    void FormatWriter::flush() {
+        this->drain();
+    }
+
+    void FormatWriter::drain() {
+        if (mFlush != nullptr && mUsed > 0) {
+            mFlush(mTarget, mBuffer, mUsed);
+            mUsed = 0;
+        }
+    }
+
+    /*
+    ============================================================================================
+    ==== layout
+    ============================================================================================
+    */
+    // code points, what width and precision count for text.
+    static size_t format_units(const char* data, size_t size) {
+        size_t units = 0;
+        for (size_t i = 0; i < size; i++) {
+            units += ((u8_t) data[i] & 0xC0) != 0x80 ? 1 : 0;
+        }
+        return units;
+    }
+
+    // bytes of the first count code points.
+    static size_t format_prefix(const char* data, size_t size, size_t count) {
+        size_t i = 0;
+        for (; i < size; i++) {
+            if (((u8_t) data[i] & 0xC0) != 0x80) {
+                if (count == 0)
+                    break;
+                count -= 1;
+            }
+        }
+        return i;
+    }
+
+    // head is the sign and base prefix of a number, the zero flag pads between it and body.
+    static void format_fill(FormatWriter& out, const FormatSpec& spec, char align, bool numeric,
+                            const char* head, size_t headSize, const char* body, size_t bodySize, size_t units) {
+        size_t padding = spec.width > units ? spec.width - units : 0;
+        if (padding > 0 && numeric && spec.zero && spec.align == '\0') {
+            out.append(head, headSize);
+            out.append('0', padding);
+            out.append(body, bodySize);
+            return;
+        }
+        align = spec.align != '\0' ? spec.align : align;
+        size_t left = align == '>' ? padding : (align == '^' ? padding / 2 : 0);
+        out.append(spec.fill, left);
+        out.append(head, headSize);
+        out.append(body, bodySize);
+        out.append(spec.fill, padding - left);
+    }
+
+    static void format_text(FormatWriter& out, const char* data, size_t size, const FormatSpec& spec) {
+        if (spec.precision >= 0) {
+            size = format_prefix(data, size, (size_t) spec.precision);
+        }
+        size_t units = spec.width > 0 ? format_units(data, size) : size;
+        format_fill(out, spec, '<', false, "", 0, data, size, units);
+    }
+
+    static size_t format_sign(char* head, bool negative, const FormatSpec& spec) {
+        if (negative) {
+            head[0] = '-';
+            return 1;
+        }
+        if (spec.sign == '+' || spec.sign == ' ') {
+            head[0] = spec.sign;
+            return 1;
+        }
+        return 0;
+    }
+
+    static void format_integer(FormatWriter& out, u64_t magnitude, bool negative, const FormatSpec& spec) {
+        if (spec.type == 'c') {
+            char c = (char) magnitude;
+            format_fill(out, spec, '<', false, "", 0, &c, 1, 1);
+            return;
+        }
+
+        char head[4];
+        size_t headSize = format_sign(head, negative, spec);
+        char body[64];
+        size_t bodySize = 0;
+        u32_t shift = spec.type == 'x' || spec.type == 'X' ? 4 : (spec.type == 'o' ? 3 : (spec.type == 'b' ? 1 : 0));
+        if (shift == 0) {
+            bodySize = NumberChars::format(body, magnitude);
+        } else {
+            const char* digits = spec.type == 'X' ? "0123456789ABCDEF" : "0123456789abcdef";
+            u64_t mask = (1u << shift) - 1;
+            char* end = body + sizeof(body);
+            char* ptr = end;
+            do {
+                *--ptr = digits[magnitude & mask];
+                magnitude >>= shift;
+            } while (magnitude != 0);
+            bodySize = (size_t) (end - ptr);
+            memmove(body, ptr, bodySize);
+            if (spec.alternate) {
+                head[headSize++] = '0';
+                if (spec.type != 'o') {
+                    head[headSize++] = spec.type;
+                }
+            }
+        }
+        format_fill(out, spec, '>', true, head, headSize, body, bodySize, headSize + bodySize);
+    }
+
+    // 'f' from the shortest digits. No other decimal of precision digits or fewer lies as near
+    // to the value as they do, so rounding them gives what rounding the exact value gives,
+    // unless they end on a tie or have fewer digits than precision and the float is coarser
+    // than the grid. 0 leaves those to printf.
+    static size_t format_fixed(char* body, f64_t magnitude, bool single, u32_t precision) {
+        static const f64_t kPowers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        char digits[NumberChars::kMaxChars];
+        size_t size = single ? NumberChars::format(digits, (f32_t) magnitude) : NumberChars::format(digits, magnitude);
+        if (memchr(digits, 'e', size) != nullptr)
+            return 0;
+        const char* point = (const char*) memchr(digits, '.', size);
+        size_t whole = point != nullptr ? (size_t) (point - digits) : size;
+        size_t fraction = point != nullptr ? size - whole - 1 : 0;
+
+        if (fraction <= precision) {
+            // the ulp is at most magnitude / 2^52 (2^23 for f32) and has to stay under the grid.
+            if (precision > 22 || magnitude * kPowers[precision] >= (single ? 8388608.0 : 4503599627370496.0))
+                return 0;
+            memcpy(body, digits, size);
+            if (precision > 0 && point == nullptr) {
+                body[size++] = '.';
+            }
+            memset(body + size, '0', precision - fraction);
+            return size + precision - fraction;
+        }
+
+        size_t cut = whole + 1 + precision;
+        if (cut + 1 == size && digits[cut] == '5')
+            return 0;
+        bool up = digits[cut] >= '5';
+        size = precision > 0 ? cut : whole;
+        memcpy(body + 1, digits, size);
+        body[0] = '0';
+        for (size_t i = size; up && i > 0; i--) {
+            if (body[i] == '.')
+                continue;
+            up = body[i] == '9';
+            body[i] = up ? '0' : (char) (body[i] + 1);
+        }
+        if (up) {
+            body[0] = '1';
+            return size + 1;
+        }
+        memmove(body, body + 1, size);
+        return size;
+    }
+
+    static void format_float(FormatWriter& out, f64_t value, bool single, const FormatSpec& spec) {
+        bool negative = std::signbit(value) && !std::isnan(value);
+        f64_t magnitude = std::fabs(value);
+
+        // enough for %f of the largest double with the largest precision kept below.
+        char body[448];
+        size_t bodySize = 0;
+        if ((spec.type == '\0' && spec.precision < 0) || !std::isfinite(magnitude)) {
+            bodySize = single ? NumberChars::format(body, (f32_t) magnitude) : NumberChars::format(body, magnitude);
+        }
+        if (bodySize == 0 && spec.type == 'f') {
+            bodySize = format_fixed(body, magnitude, single, spec.precision < 0 ? 6 : (u32_t) spec.precision);
+        }
+        if (bodySize == 0) {
+            char pattern[] = "%.*g";
+            pattern[3] = spec.type != '\0' ? spec.type : 'g';
+            int precision = spec.precision < 0 ? 6 : (spec.precision > 100 ? 100 : spec.precision);
+            int size = snprintf(body, sizeof(body), pattern, precision, magnitude);
+            bodySize = size > 0 ? (size_t) size : 0;
+            // printf writes the point of the C locale, the text here is locale free.
+            char point = localeconv()->decimal_point[0];
+            if (point != '.') {
+                char* found = (char*) memchr(body, point, bodySize);
+                if (found != nullptr) {
+                    *found = '.';
+                }
+            }
+        }
+
+        char head[1];
+        size_t headSize = format_sign(head, negative, spec);
+        format_fill(out, spec, '>', true, head, headSize, body, bodySize, headSize + bodySize);
+    }
+
+    /*
+    ============================================================================================
+    ==== Format
+    ============================================================================================
+    */
+    void Format::write(FormatWriter& out, const StringView& fmt, const FormatArg* args, size_t count) {
+        const char* text = fmt.data();
+        size_t size = fmt.length();
+        size_t next = 0;
+        size_t pos = 0;
+        while (pos < size) {
+            size_t start = pos;
+            while (pos < size && text[pos] != '{' && text[pos] != '}') {
+                pos += 1;
+            }
+            out.append(text + start, pos - start);
+            if (pos == size)
+                break;
+
+            char c = text[pos];
+            if (c == '}' || (pos + 1 < size && text[pos + 1] == '{')) {
+                // "{{", "}}" and a stray '}' all write one brace.
+                out.append(c);
+                pos += pos + 1 < size && text[pos + 1] == c ? 2 : 1;
+                continue;
+            }
+
+            FormatField field;
+            size_t stop = FormatParser::field(text, size, pos + 1, field);
+            if (stop == 0) {
+                out.append(c);
+                pos += 1;
+                continue;
+            }
+            size_t index = field.index == FormatField::kNext ? next++ : field.index;
+            if (index < count) {
+                Format::write(out, args[index], field.spec);
+            } else {
+                out.append(text + pos, stop - pos);
+            }
+            pos = stop;
+        }
+    }
+
+    void Format::write(FormatWriter& out, const FormatArg& arg, const FormatSpec& spec) {
+        switch (arg.kind) {
+            case FormatKind::Bool:
+                if (arg.boolean) {
+                    format_text(out, "true", 4, spec);
+                } else {
+                    format_text(out, "false", 5, spec);
+                }
+                break;
+            case FormatKind::Char:
+                if (spec.type == '\0' || spec.type == 'c') {
+                    format_text(out, &arg.chr, 1, spec);
+                } else {
+                    format_integer(out, (u8_t) arg.chr, false, spec);
+                }
+                break;
+            case FormatKind::Signed:
+                format_integer(out, arg.sint < 0 ? 0 - (u64_t) arg.sint : (u64_t) arg.sint, arg.sint < 0, spec);
+                break;
+            case FormatKind::Unsigned:
+                format_integer(out, arg.uint, false, spec);
+                break;
+            case FormatKind::F32:
+                format_float(out, arg.f32, true, spec);
+                break;
+            case FormatKind::F64:
+                format_float(out, arg.f64, false, spec);
+                break;
+            case FormatKind::Text:
+                format_text(out, arg.text.data, arg.text.size, spec);
+                break;
+            case FormatKind::Pointer: {
+                FormatSpec hex = spec;
+                hex.type = 'x';
+                hex.alternate = true;
+                format_integer(out, (u64_t) (uintptr_t) arg.pointer, false, hex);
+                break;
+            }
+            case FormatKind::Custom:
+                arg.custom.write(out, arg.custom.value, spec);
+                break;
+        }
+    }
+
+    /*
+    ============================================================================================
+    ==== Formatters of the base types
+    ============================================================================================
+    */
+    void Formatter<Vector3>::write(FormatWriter& out, const Vector3& value, const FormatSpec& spec) {
+        out.append('(');
+        Format::value(out, value.x, spec);
+        out.append(", ", 2);
+        Format::value(out, value.y, spec);
+        out.append(", ", 2);
+        Format::value(out, value.z, spec);
+        out.append(')');
+    }
+
+    void Formatter<Matrix4>::write(FormatWriter& out, const Matrix4& value, const FormatSpec& spec) {
+        out.append('(');
+        for (u32_t row = 0; row < 4; row++) {
+            out.append(row == 0 ? "(" : ", (", row == 0 ? 1 : 3);
+            for (u32_t col = 0; col < 4; col++) {
+                if (col > 0) {
+                    out.append(", ", 2);
+                }
+                Format::value(out, value.value[row][col], spec);
+            }
+            out.append(')');
+        }
+        out.append(')');
+    }
+
+    void Formatter<Color>::write(FormatWriter& out, const Color& value, const FormatSpec& spec) {
+        if (spec.type == 'x' || spec.type == 'X') {
+            const char* digits = spec.type == 'X' ? "0123456789ABCDEF" : "0123456789abcdef";
+            const f32_t channels[] = {value.r, value.g, value.b, value.a};
+            char body[9] = {'#'};
+            for (u32_t i = 0; i < 4; i++) {
+                f32_t channel = channels[i] < 0 ? 0 : (channels[i] > 1 ? 1 : channels[i]);
+                u32_t byte = (u32_t) (channel * 255.0f + 0.5f);
+                body[1 + i * 2] = digits[byte >> 4];
+                body[2 + i * 2] = digits[byte & 15];
+            }
+            format_fill(out, spec, '<', false, "", 0, body, sizeof(body), sizeof(body));
+            return;
+        }
+        out.append("rgba(", 5);
+        Format::value(out, value.r, spec);
+        out.append(", ", 2);
+        Format::value(out, value.g, spec);
+        out.append(", ", 2);
+        Format::value(out, value.b, spec);
+        out.append(", ", 2);
+        Format::value(out, value.a, spec);
+        out.append(')');
+    }
+
+    void Formatter<TimeSpan>::write(FormatWriter& out, const TimeSpan& value, const FormatSpec& spec) {
+        // the parts of a negative span are all negative or zero.
+        bool negative = value.dayPart() < 0 || value.hourPart() < 0 || value.minutePart() < 0 ||
+                        value.secondPart() < 0 || value.millisecondPart() < 0 || value.microsecondPart() < 0;
+        i64_t sign = negative ? -1 : 1;
+        u64_t days = (u64_t) (value.dayPart() * sign);
+        u32_t hours = (u32_t) (value.hourPart() * sign);
+        u32_t minutes = (u32_t) (value.minutePart() * sign);
+        u32_t seconds = (u32_t) (value.secondPart() * sign);
+        u32_t micros = (u32_t) (value.millisecondPart() * sign * 1000 + value.microsecondPart() * sign);
+
+        char body[48];
+        size_t size = 0;
+        if (negative) {
+            body[size++] = '-';
+        }
+        if (days > 0) {
+            size += NumberChars::format(body + size, days);
+            body[size++] = '.';
+        }
+        const u32_t fields[] = {hours, minutes, seconds};
+        for (u32_t i = 0; i < 3; i++) {
+            if (i > 0) {
+                body[size++] = ':';
+            }
+            body[size++] = (char) ('0' + fields[i] / 10);
+            body[size++] = (char) ('0' + fields[i] % 10);
+        }
+        if (micros > 0) {
+            body[size++] = '.';
+            for (u32_t scale = 100000; scale > 0; scale /= 10) {
+                body[size++] = (char) ('0' + micros / scale % 10);
+            }
+        }
+        format_fill(out, spec, '>', false, "", 0, body, size, size);
+    }
+
+}
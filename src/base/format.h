@@ -0,0 +1,598 @@
+#ifndef _EOKAS_BASE_FORMAT_H_
+#define _EOKAS_BASE_FORMAT_H_
+
+#include "./header.h"
+#include "./string.h"
+#include "./math.h"
+#include "./color.h"
+#include "./time.h"
+#include <cstring>
+#include <type_traits>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== FormatSpec
+    ==== What follows the ':' of a field, [[fill]align][sign][#][0][width][.precision][type]:
+    ====     {:>8}  {:*^12}  {:+.3f}  {:#x}  {:08.2e}  {:.5s}
+    ==== align is '<', '>' or '^', sign '-', '+' or ' '. Numbers default to the right, the rest
+    ==== to the left. Width and precision count code points for text.
+    ============================================================================================
+    */
+    struct FormatSpec {
+        char fill = ' ';
+        char align = '\0';
+        char sign = '-';
+        bool alternate = false;
+        bool zero = false;
+        u32_t width = 0;
+        i32_t precision = -1;
+        char type = '\0';
+    };
+
+    struct FormatField {
+        static const size_t kNext = (size_t) -1;
+
+        size_t index = kNext;
+        FormatSpec spec;
+    };
+
+    enum class FormatError {
+        None, Syntax, MissingArgument, UnusedArgument, BadSpec
+    };
+
+    /*
+    ============================================================================================
+    ==== FormatParser
+    ==== The grammar of a field, the same code checks literals at compile time and drives
+    ==== Format::write at run time.
+    ============================================================================================
+    */
+    struct FormatParser {
+        /// parses the field whose '{' is just before pos, returns the offset after its '}',
+        /// 0 if it is malformed.
+        static constexpr size_t field(const char* text, size_t size, size_t pos, FormatField& field) {
+            if (pos < size && text[pos] >= '0' && text[pos] <= '9') {
+                size_t index = 0;
+                while (pos < size && text[pos] >= '0' && text[pos] <= '9') {
+                    index = index * 10 + (size_t) (text[pos++] - '0');
+                    if (index > 0xFFFF)
+                        return 0;
+                }
+                field.index = index;
+            }
+            if (pos < size && text[pos] == ':') {
+                pos = FormatParser::spec(text, size, pos + 1, field.spec);
+                if (pos == 0)
+                    return 0;
+            }
+            return pos < size && text[pos] == '}' ? pos + 1 : 0;
+        }
+
+        static constexpr size_t spec(const char* text, size_t size, size_t pos, FormatSpec& spec) {
+            if (pos + 1 < size && isAlign(text[pos + 1]) && text[pos] != '}') {
+                spec.fill = text[pos];
+                spec.align = text[pos + 1];
+                pos += 2;
+            } else if (pos < size && isAlign(text[pos])) {
+                spec.align = text[pos++];
+            }
+            if (pos < size && (text[pos] == '+' || text[pos] == '-' || text[pos] == ' ')) {
+                spec.sign = text[pos++];
+            }
+            if (pos < size && text[pos] == '#') {
+                spec.alternate = true;
+                pos += 1;
+            }
+            if (pos < size && text[pos] == '0') {
+                spec.zero = true;
+                pos += 1;
+            }
+            u32_t width = 0;
+            while (pos < size && text[pos] >= '0' && text[pos] <= '9') {
+                width = width * 10 + (u32_t) (text[pos++] - '0');
+                if (width > 0xFFFF)
+                    return 0;
+            }
+            spec.width = width;
+            if (pos < size && text[pos] == '.') {
+                pos += 1;
+                if (pos >= size || text[pos] < '0' || text[pos] > '9')
+                    return 0;
+                i32_t precision = 0;
+                while (pos < size && text[pos] >= '0' && text[pos] <= '9') {
+                    precision = precision * 10 + (i32_t) (text[pos++] - '0');
+                    if (precision > 0xFFFF)
+                        return 0;
+                }
+                spec.precision = precision;
+            }
+            if (pos < size && text[pos] != '}') {
+                spec.type = text[pos++];
+            }
+            return pos;
+        }
+
+        static constexpr bool isAlign(char c) {
+            return c == '<' || c == '>' || c == '^';
+        }
+    };
+
+    /*
+    ============================================================================================
+    ==== FormatWriter
+    ==== A buffer the formatter writes into. Without a flush function it is a fixed buffer that
+    ==== drops what does not fit, with one it hands each full buffer and the rest at flush() to
+    ==== the target. size() counts every char written, the dropped ones included.
+    ============================================================================================
+    */
+    class FormatWriter {
+    public:
+        typedef void (* Flush)(void* target, const char* data, size_t size);
+
+        FormatWriter(char* buffer, size_t capacity, Flush flush = nullptr, void* target = nullptr)
+            : mBuffer(buffer), mCapacity(capacity), mUsed(0), mTotal(0), mFlush(flush), mTarget(target) {
+        }
+
+        void append(char c) {
+            if (mUsed == mCapacity) {
+                this->drain();
+            }
+            if (mUsed < mCapacity) {
+                mBuffer[mUsed++] = c;
+            }
+            mTotal += 1;
+        }
+
+        void append(char c, size_t count);
+        void append(const char* data, size_t size);
+
+        void append(const StringView& str) {
+            this->append(str.data(), str.length());
+        }
+
+        /// hands what is buffered to the target, a fixed buffer keeps it.
+        void flush();
+
+        size_t size() const {
+            return mTotal;
+        }
+
+        const char* data() const {
+            return mBuffer;
+        }
+
+        /// chars in the buffer right now.
+        size_t used() const {
+            return mUsed;
+        }
+
+        bool truncated() const {
+            return mFlush == nullptr && mTotal > mCapacity;
+        }
+
+    private:
+        void drain();
+
+        char* mBuffer;
+        size_t mCapacity;
+        size_t mUsed;
+        size_t mTotal;
+        Flush mFlush;
+        void* mTarget;
+    };
+
+    /*
+    ============================================================================================
+    ==== Formatter
+    ==== Specialize it to make a type formattable:
+    ====     template<> struct Formatter<Foo> {
+    ====         static constexpr bool accepts(char type) { return type == '\0'; }
+    ====         static void write(FormatWriter& out, const Foo& value, const FormatSpec& spec);
+    ====     };
+    ==== accepts() sees the type char of every field the value goes to, literals are checked
+    ==== against it at compile time. Format::value() writes the built in types with a spec.
+    ============================================================================================
+    */
+    template<typename T>
+    struct Formatter {
+        static_assert(sizeof(T) == 0, "no eokas::Formatter for this type.");
+    };
+
+    enum class FormatKind : u8_t {
+        Bool, Char, Signed, Unsigned, F32, F64, Text, Pointer, Custom
+    };
+
+    struct FormatArg {
+        typedef void (* Write)(FormatWriter& out, const void* value, const FormatSpec& spec);
+
+        struct Text {
+            const char* data;
+            size_t size;
+        };
+
+        struct Custom {
+            const void* value;
+            Write write;
+        };
+
+        FormatKind kind;
+        union {
+            bool boolean;
+            char chr;
+            i64_t sint;
+            u64_t uint;
+            f32_t f32;
+            f64_t f64;
+            Text text;
+            const void* pointer;
+            Custom custom;
+        };
+    };
+
+    template<typename T, typename Enable = void>
+    struct FormatTraits {
+        static constexpr bool accepts(char type) {
+            return Formatter<T>::accepts(type);
+        }
+
+        static void write(FormatWriter& out, const void* value, const FormatSpec& spec) {
+            Formatter<T>::write(out, *(const T*) value, spec);
+        }
+
+        static FormatArg arg(const T& value) {
+            FormatArg arg;
+            arg.kind = FormatKind::Custom;
+            arg.custom.value = &value;
+            arg.custom.write = &FormatTraits::write;
+            return arg;
+        }
+    };
+
+    struct FormatTypes {
+        static constexpr bool integer(char type) {
+            return type == '\0' || type == 'd' || type == 'x' || type == 'X' || type == 'b' || type == 'o' || type == 'c';
+        }
+
+        static constexpr bool floating(char type) {
+            return type == '\0' || type == 'f' || type == 'e' || type == 'E' || type == 'g' || type == 'G';
+        }
+    };
+
+    template<>
+    struct FormatTraits<bool> {
+        static constexpr bool accepts(char type) {
+            return type == '\0' || type == 's';
+        }
+
+        static FormatArg arg(bool value) {
+            FormatArg arg;
+            arg.kind = FormatKind::Bool;
+            arg.boolean = value;
+            return arg;
+        }
+    };
+
+    template<>
+    struct FormatTraits<char> {
+        static constexpr bool accepts(char type) {
+            return FormatTypes::integer(type);
+        }
+
+        static FormatArg arg(char value) {
+            FormatArg arg;
+            arg.kind = FormatKind::Char;
+            arg.chr = value;
+            return arg;
+        }
+    };
+
+    // i8_t and u8_t are numbers, like in String::valueToString.
+    template<typename T>
+    struct FormatTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>::type> {
+        static constexpr bool accepts(char type) {
+            return FormatTypes::integer(type);
+        }
+
+        static FormatArg arg(T value) {
+            FormatArg arg;
+            if (std::is_signed<T>::value) {
+                arg.kind = FormatKind::Signed;
+                arg.sint = (i64_t) value;
+            } else {
+                arg.kind = FormatKind::Unsigned;
+                arg.uint = (u64_t) value;
+            }
+            return arg;
+        }
+    };
+
+    template<typename T>
+    struct FormatTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+        static constexpr bool accepts(char type) {
+            return FormatTypes::floating(type);
+        }
+
+        static FormatArg arg(T value) {
+            FormatArg arg;
+            if (std::is_same<T, f32_t>::value) {
+                arg.kind = FormatKind::F32;
+                arg.f32 = (f32_t) value;
+            } else {
+                arg.kind = FormatKind::F64;
+                arg.f64 = (f64_t) value;
+            }
+            return arg;
+        }
+    };
+
+    struct FormatTextTraits {
+        static constexpr bool accepts(char type) {
+            return type == '\0' || type == 's';
+        }
+
+        static FormatArg arg(const char* data, size_t size) {
+            FormatArg arg;
+            arg.kind = FormatKind::Text;
+            arg.text.data = data;
+            arg.text.size = size;
+            return arg;
+        }
+    };
+
+    template<>
+    struct FormatTraits<const char*> : FormatTextTraits {
+        static FormatArg arg(const char* value) {
+            return value != nullptr ? FormatTextTraits::arg(value, strlen(value)) : FormatTextTraits::arg("(null)", 6);
+        }
+    };
+
+    template<>
+    struct FormatTraits<char*> : FormatTraits<const char*> {
+    };
+
+    template<>
+    struct FormatTraits<StringView> : FormatTextTraits {
+        static FormatArg arg(const StringView& value) {
+            return FormatTextTraits::arg(value.data(), value.length());
+        }
+    };
+
+    template<>
+    struct FormatTraits<String> : FormatTextTraits {
+        static FormatArg arg(const String& value) {
+            return FormatTextTraits::arg(value.cstr(), value.length());
+        }
+    };
+
+    template<>
+    struct FormatTraits<MBString> : FormatTextTraits {
+        static FormatArg arg(const MBString& value) {
+            return FormatTextTraits::arg(value.data(), value.size());
+        }
+    };
+
+    template<typename T>
+    struct FormatTraits<T*, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+        static constexpr bool accepts(char type) {
+            return type == '\0' || type == 'p';
+        }
+
+        static FormatArg arg(const T* value) {
+            FormatArg arg;
+            arg.kind = FormatKind::Pointer;
+            arg.pointer = (const void*) value;
+            return arg;
+        }
+    };
+
+    template<>
+    struct FormatTraits<std::nullptr_t> : FormatTraits<void*> {
+    };
+
+    /*
+    ============================================================================================
+    ==== FormatCheck
+    ==== Walks a format string at compile time: braces must balance, every field needs an
+    ==== argument whose type accepts the field's type char and every argument must be used.
+    ============================================================================================
+    */
+    template<typename... Args>
+    struct FormatCheck {
+        static constexpr bool accepts(size_t index, [[maybe_unused]] char type) {
+            const bool results[] = {FormatTraits<Args>::accepts(type)..., false};
+            return results[index];
+        }
+
+        static constexpr FormatError check(const char* text, size_t size) {
+            bool used[sizeof...(Args) + 1] = {};
+            size_t next = 0;
+            size_t pos = 0;
+            while (pos < size) {
+                char c = text[pos];
+                if (c == '{' && pos + 1 < size && text[pos + 1] == '{') {
+                    pos += 2;
+                } else if (c == '}' && pos + 1 < size && text[pos + 1] == '}') {
+                    pos += 2;
+                } else if (c == '{') {
+                    FormatField field;
+                    pos = FormatParser::field(text, size, pos + 1, field);
+                    if (pos == 0)
+                        return FormatError::Syntax;
+                    size_t index = field.index == FormatField::kNext ? next++ : field.index;
+                    if (index >= sizeof...(Args))
+                        return FormatError::MissingArgument;
+                    if (!accepts(index, field.spec.type))
+                        return FormatError::BadSpec;
+                    used[index] = true;
+                } else if (c == '}') {
+                    return FormatError::Syntax;
+                } else {
+                    pos += 1;
+                }
+            }
+            for (size_t i = 0; i < sizeof...(Args); i++) {
+                if (!used[i])
+                    return FormatError::UnusedArgument;
+            }
+            return FormatError::None;
+        }
+    };
+
+    /// the base of the types _Format makes, each of them carries its literal in text().
+    struct FormatLiteral {
+    };
+
+    template<typename T>
+    using FormatDecay = typename std::decay<T>::type;
+
+    /*
+    ============================================================================================
+    ==== Format
+    ==== {}-style formatting without a heap on the common path. Fields are {}, {index} and
+    ==== {index:spec}, {{ and }} are braces. A format given as _Format("...") is checked at
+    ==== compile time, any other StringView is checked as it is written and a field that is
+    ==== malformed or has no argument is copied to the output as it is.
+    ====     char buffer[64];
+    ====     Format::to(buffer, sizeof(buffer), _Format("{} at {:.2f}"), name, position);
+    ====     Format::append(line, _Format("{:>6}|"), count);
+    ====     String text = Format::string(_Format("{:#x}"), flags);
+    ==== Text is written through a stack buffer, only a String that outgrows its inline chars
+    ==== allocates.
+    ============================================================================================
+    */
+    class Format {
+    public:
+        static const size_t kBufferSize = 256;
+
+        /// writes into a buffer of capacity chars that is always terminated, returns the length
+        /// the whole text takes like snprintf does.
+        template<typename F, typename... Args>
+        static size_t to(char* buffer, size_t capacity, const F& fmt, const Args& ... args) {
+            Format::verify<F, Args...>();
+            FormatWriter out(buffer, capacity > 0 ? capacity - 1 : 0);
+            Format::dispatch(out, fmt, args...);
+            if (capacity > 0) {
+                buffer[out.used()] = '\0';
+            }
+            return out.size();
+        }
+
+        /// appends to a String or anything else with append(const char*, size_t).
+        template<typename Sink, typename F, typename... Args>
+        static void append(Sink& sink, const F& fmt, const Args& ... args) {
+            Format::verify<F, Args...>();
+            char buffer[kBufferSize];
+            FormatWriter out(buffer, sizeof(buffer), &Format::flushTo<Sink>, &sink);
+            Format::dispatch(out, fmt, args...);
+            out.flush();
+        }
+
+        template<typename F, typename... Args>
+        static String string(const F& fmt, const Args& ... args) {
+            String result;
+            Format::append(result, fmt, args...);
+            return result;
+        }
+
+        /// the heart of it, for formatters that nest a format of their own.
+        static void write(FormatWriter& out, const StringView& fmt, const FormatArg* args, size_t count);
+        /// one value laid out by spec.
+        static void write(FormatWriter& out, const FormatArg& arg, const FormatSpec& spec);
+
+        template<typename T>
+        static void value(FormatWriter& out, const T& value, const FormatSpec& spec) {
+            Format::write(out, FormatTraits<FormatDecay<T>>::arg(value), spec);
+        }
+
+        template<typename F, typename... Args>
+        static constexpr bool verify() {
+            if constexpr (std::is_base_of<FormatLiteral, F>::value) {
+                constexpr FormatError error = FormatCheck<FormatDecay<Args>...>::check(F::text(), F::size());
+                static_assert(error != FormatError::Syntax, "format: unbalanced brace or malformed field.");
+                static_assert(error != FormatError::MissingArgument, "format: a field has no argument.");
+                static_assert(error != FormatError::UnusedArgument, "format: an argument is never used.");
+                static_assert(error != FormatError::BadSpec, "format: a field's type does not fit its argument.");
+            }
+            return true;
+        }
+
+        template<typename F, typename... Args>
+        static void dispatch(FormatWriter& out, const F& fmt, const Args& ... args) {
+            const FormatArg list[] = {FormatTraits<FormatDecay<Args>>::arg(args)..., FormatArg()};
+            Format::write(out, Format::text(fmt), list, sizeof...(Args));
+        }
+
+    private:
+        template<typename F>
+        static StringView text(const F& fmt) {
+            if constexpr (std::is_base_of<FormatLiteral, F>::value) {
+                return StringView(F::text(), F::size());
+            } else {
+                return StringView(fmt);
+            }
+        }
+
+        template<typename Sink>
+        static void flushTo(void* target, const char* data, size_t size) {
+            ((Sink*) target)->append(data, size);
+        }
+    };
+
+    /*
+    ============================================================================================
+    ==== Formatters of the base types
+    ==== The spec goes to every component: {:.2f} gives (1.00, 2.00, 3.00) for a Vector3.
+    ==== Matrix4 is written row by row, Color as rgba(r, g, b, a) or with 'x' as #RRGGBBAA.
+    ==== TimeSpan is [-][d.]hh:mm:ss[.uuuuuu] and its spec lays out the whole text.
+    ============================================================================================
+    */
+    template<>
+    struct Formatter<Vector3> {
+        static constexpr bool accepts(char type) {
+            return FormatTypes::floating(type);
+        }
+
+        static void write(FormatWriter& out, const Vector3& value, const FormatSpec& spec);
+    };
+
+    template<>
+    struct Formatter<Matrix4> {
+        static constexpr bool accepts(char type) {
+            return FormatTypes::floating(type);
+        }
+
+        static void write(FormatWriter& out, const Matrix4& value, const FormatSpec& spec);
+    };
+
+    template<>
+    struct Formatter<Color> {
+        static constexpr bool accepts(char type) {
+            return FormatTypes::floating(type) || type == 'x' || type == 'X';
+        }
+
+        static void write(FormatWriter& out, const Color& value, const FormatSpec& spec);
+    };
+
+    template<>
+    struct Formatter<TimeSpan> {
+        static constexpr bool accepts(char type) {
+            return type == '\0';
+        }
+
+        static void write(FormatWriter& out, const TimeSpan& value, const FormatSpec& spec);
+    };
+
+}
+
+/// a format literal that Format and Logger check against their arguments at compile time.
+#define _Format(literal) ([]() { \
+    struct Literal : eokas::FormatLiteral { \
+        static constexpr const char* text() { return literal; } \
+        static constexpr size_t size() { return sizeof(literal) - 1; } \
+    }; \
+    return Literal(); \
+}())
+
+#endif//_EOKAS_BASE_FORMAT_H_
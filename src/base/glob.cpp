@@ -0,0 +1,591 @@
+
+#include "./glob.h"
+#include "./ascil.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== program
+    ==== Thompson style NFA: Step eats one char of its set and goes on, Loop eats any number
+    ==== of chars of its set and goes on without eating, Split and Jump move without eating,
+    ==== Accept ends a pattern. Every pattern of a set ends in its own Accept.
+    ==== The DFA is the subset construction over the byte classes the sets tell apart, built
+    ==== in full at compile time. Its rows are stored premultiplied by the class count and
+    ==== row 0 is the dead state: no pattern can match any more.
+    ============================================================================================
+    */
+    struct GlobBits {
+        u64_t words[4];
+
+        void add(u8_t c) {
+            words[c >> 6] |= (u64_t) 1 << (c & 63);
+        }
+
+        bool has(u8_t c) const {
+            return (words[c >> 6] >> (c & 63)) & 1;
+        }
+
+        bool operator<(const GlobBits& rhs) const {
+            return memcmp(words, rhs.words, sizeof(words)) < 0;
+        }
+    };
+
+    enum class GlobOp : u8_t {
+        Step, Loop, Split, Jump, Accept
+    };
+
+    struct GlobState {
+        GlobOp op;
+        u32_t set;      // Step, Loop: index into sets
+        u32_t next;     // Step, Loop: the state after, Jump: its target, Accept: the pattern
+        u32_t edges;    // Split: first target in edges
+        u32_t count;    // Split: number of targets
+    };
+
+    struct GlobProgram {
+        static const u32_t kMaxDfaStates = 4096;
+        static const size_t kMaxDfaTable = 1 << 20;
+        static const size_t kMaxDfaWork = 1 << 24;
+
+        std::vector<GlobState> states;
+        std::vector<u32_t> edges;
+        std::vector<GlobBits> sets;
+
+        // the Step, Loop and Accept states each state reaches without input, sorted.
+        std::vector<u32_t> closureBegin;
+        std::vector<u32_t> closures;
+        std::vector<u32_t> startSet;
+
+        u8_t classes[256];
+        u32_t classCount;
+        bool hasDfa;
+        u32_t dfaStart;
+        std::vector<u32_t> table;
+        std::vector<u32_t> acceptBegin;
+        std::vector<u32_t> accepts;
+    };
+
+    /*
+    ============================================================================================
+    ==== compiler
+    ============================================================================================
+    */
+    class GlobCompiler {
+    public:
+        static constexpr size_t npos = (size_t) -1;
+
+        GlobCompiler(GlobProgram& program, u32_t flags)
+            : mProgram(program), mFlags(flags), mText(), mBraces() {
+            GlobBits all;
+            memset(all.words, 0xFF, sizeof(all.words));
+            mAll = this->intern(all, false);
+            GlobBits file = all;
+            file.words['/' >> 6] &= ~((u64_t) 1 << ('/' & 63));
+            mFile = this->intern(file, false);
+        }
+
+        // the first state of the pattern.
+        u32_t compile(const StringView& pattern, u32_t index) {
+            mText = pattern;
+            this->matchBraces();
+            u32_t start = (u32_t) mProgram.states.size();
+            bool boundary = true;
+            this->sequence(0, false, boundary);
+            this->emit(GlobOp::Accept, 0, index);
+            return start;
+        }
+
+    private:
+        // pairs up the braces, one without its partner is a plain char.
+        void matchBraces() {
+            size_t size = mText.length();
+            mBraces.assign(size, npos);
+            std::vector<size_t> open;
+            for (size_t i = 0; i < size; i++) {
+                char c = mText[i];
+                if (c == '\\') {
+                    i += 1;
+                } else if (c == '[') {
+                    size_t close = this->bracketEnd(i);
+                    i = close != npos ? close : i;
+                } else if (c == '{') {
+                    open.push_back(i);
+                } else if (c == '}' && !open.empty()) {
+                    mBraces[open.back()] = i;
+                    open.pop_back();
+                }
+            }
+        }
+
+        // compiles up to the end of the text, or to the ',' or '}' of the brace it is in.
+        // boundary tells if the next char starts a path segment.
+        size_t sequence(size_t pos, bool inBrace, bool& boundary) {
+            size_t size = mText.length();
+            while (pos < size) {
+                char c = mText[pos];
+                if (inBrace && (c == ',' || c == '}'))
+                    return pos;
+                if (c == '*') {
+                    size_t after = pos + 1;
+                    while (after < size && mText[after] == '*') {
+                        after += 1;
+                    }
+                    if (after - pos == 1) {
+                        this->emit(GlobOp::Loop, mFile, 0);
+                    } else if (boundary && after < size && mText[after] == '/') {
+                        // "**/" is nothing, or any run that ends in '/'.
+                        u32_t split = this->emit(GlobOp::Split, 0, 0);
+                        u32_t loop = this->emit(GlobOp::Loop, mAll, 0);
+                        this->emit(GlobOp::Step, this->literal('/'), 0);
+                        this->link(split, {loop, (u32_t) mProgram.states.size()});
+                        after += 1;
+                    } else {
+                        this->emit(GlobOp::Loop, mAll, 0);
+                    }
+                    boundary = mText[after - 1] == '/';
+                    pos = after;
+                    continue;
+                }
+                if (c == '?') {
+                    this->emit(GlobOp::Step, mFile, 0);
+                    boundary = false;
+                    pos += 1;
+                    continue;
+                }
+                if (c == '[') {
+                    size_t close = this->bracketEnd(pos);
+                    if (close != npos) {
+                        this->emit(GlobOp::Step, this->bracket(pos, close), 0);
+                        boundary = false;
+                        pos = close + 1;
+                        continue;
+                    }
+                }
+                if (c == '{' && mBraces[pos] != npos) {
+                    pos = this->brace(pos, boundary);
+                    continue;
+                }
+                if (c == '\\' && pos + 1 < size) {
+                    pos += 1;
+                    c = mText[pos];
+                }
+                this->emit(GlobOp::Step, this->literal(c), 0);
+                boundary = c == '/';
+                pos += 1;
+            }
+            return pos;
+        }
+
+        // a Split to every alternative, each of them jumps past the brace when done.
+        size_t brace(size_t pos, bool& boundary) {
+            size_t close = mBraces[pos];
+            u32_t split = this->emit(GlobOp::Split, 0, 0);
+            std::vector<u32_t> targets;
+            std::vector<u32_t> jumps;
+            bool after = true;
+            while (pos < close) {
+                targets.push_back((u32_t) mProgram.states.size());
+                bool inner = boundary;
+                pos = this->sequence(pos + 1, true, inner);
+                after = after && inner;
+                jumps.push_back(this->emit(GlobOp::Jump, 0, 0));
+            }
+            for (u32_t jump : jumps) {
+                mProgram.states[jump].next = (u32_t) mProgram.states.size();
+            }
+            this->link(split, targets);
+            boundary = after;
+            return close + 1;
+        }
+
+        size_t bracketEnd(size_t pos) const {
+            size_t size = mText.length();
+            size_t i = pos + 1;
+            if (i < size && (mText[i] == '!' || mText[i] == '^')) {
+                i += 1;
+            }
+            if (i < size && mText[i] == ']') {
+                i += 1;
+            }
+            while (i < size && mText[i] != ']') {
+                i += mText[i] == '\\' ? 2 : 1;
+            }
+            return i < size ? i : npos;
+        }
+
+        u32_t bracket(size_t pos, size_t close) {
+            GlobBits bits = {};
+            size_t i = pos + 1;
+            bool negate = mText[i] == '!' || mText[i] == '^';
+            i += negate ? 1 : 0;
+            bool first = true;
+            while (i < close && (first || mText[i] != ']')) {
+                first = false;
+                u8_t low = this->bracketChar(i, close);
+                u8_t high = low;
+                if (i + 1 < close && mText[i] == '-') {
+                    i += 1;
+                    high = this->bracketChar(i, close);
+                }
+                for (u32_t c = low; c <= high; c++) {
+                    bits.add((u8_t) c);
+                }
+            }
+            if (negate) {
+                for (u64_t& word : bits.words) {
+                    word = ~word;
+                }
+            }
+            bits.words['/' >> 6] &= ~((u64_t) 1 << ('/' & 63));
+            return this->intern(bits, true);
+        }
+
+        // the char at i, escaped or not, and moves i past it.
+        u8_t bracketChar(size_t& i, size_t close) const {
+            if (mText[i] == '\\' && i + 1 < close) {
+                i += 1;
+            }
+            return (u8_t) mText[i++];
+        }
+
+        u32_t literal(char c) {
+            GlobBits bits = {};
+            bits.add((u8_t) c);
+            return this->intern(bits, true);
+        }
+
+        u32_t intern(GlobBits bits, bool fold) {
+            if (fold && (mFlags & Glob::kIgnoreCase) != 0) {
+                for (u32_t c = 'A'; c <= 'Z'; c++) {
+                    if (bits.has((u8_t) c) || bits.has((u8_t) (c + 0x20))) {
+                        bits.add((u8_t) c);
+                        bits.add((u8_t) (c + 0x20));
+                    }
+                }
+            }
+            auto iter = mSets.find(bits);
+            if (iter != mSets.end())
+                return iter->second;
+            u32_t index = (u32_t) mProgram.sets.size();
+            mProgram.sets.push_back(bits);
+            mSets.insert(std::make_pair(bits, index));
+            return index;
+        }
+
+        u32_t emit(GlobOp op, u32_t set, u32_t next) {
+            u32_t index = (u32_t) mProgram.states.size();
+            GlobState state = {op, set, next, 0, 0};
+            if (op == GlobOp::Step || op == GlobOp::Loop) {
+                state.next = index + 1;
+            }
+            mProgram.states.push_back(state);
+            return index;
+        }
+
+        void link(u32_t split, const std::vector<u32_t>& targets) {
+            GlobState& state = mProgram.states[split];
+            state.edges = (u32_t) mProgram.edges.size();
+            state.count = (u32_t) targets.size();
+            mProgram.edges.insert(mProgram.edges.end(), targets.begin(), targets.end());
+        }
+
+        GlobProgram& mProgram;
+        u32_t mFlags;
+        StringView mText;
+        std::vector<size_t> mBraces;
+        std::map<GlobBits, u32_t> mSets;
+        u32_t mAll;
+        u32_t mFile;
+    };
+
+    // marks holds the stamp of every state already visited.
+    static void glob_closure(const GlobProgram& program, u32_t state, std::vector<u32_t>& marks, u32_t stamp, std::vector<u32_t>& out) {
+        std::vector<u32_t> stack(1, state);
+        while (!stack.empty()) {
+            u32_t index = stack.back();
+            stack.pop_back();
+            if (marks[index] == stamp)
+                continue;
+            marks[index] = stamp;
+            const GlobState& s = program.states[index];
+            switch (s.op) {
+                case GlobOp::Step:
+                case GlobOp::Accept:
+                    out.push_back(index);
+                    break;
+                case GlobOp::Loop:
+                    out.push_back(index);
+                    stack.push_back(s.next);
+                    break;
+                case GlobOp::Jump:
+                    stack.push_back(s.next);
+                    break;
+                case GlobOp::Split:
+                    for (u32_t i = s.count; i > 0; i--) {
+                        stack.push_back(program.edges[s.edges + i - 1]);
+                    }
+                    break;
+            }
+        }
+    }
+
+    // the states set reaches on byte c.
+    static void glob_advance(const GlobProgram& program, const std::vector<u32_t>& set, u8_t c, std::vector<u32_t>& out) {
+        out.clear();
+        for (u32_t index : set) {
+            const GlobState& s = program.states[index];
+            if (s.op != GlobOp::Step && s.op != GlobOp::Loop)
+                continue;
+            if (!program.sets[s.set].has(c))
+                continue;
+            u32_t target = s.op == GlobOp::Step ? s.next : index;
+            const u32_t* begin = program.closures.data() + program.closureBegin[target];
+            const u32_t* end = program.closures.data() + program.closureBegin[target + 1];
+            out.insert(out.end(), begin, end);
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    static void glob_classes(GlobProgram& program) {
+        memset(program.classes, 0, sizeof(program.classes));
+        program.classCount = 1;
+        for (const GlobBits& bits : program.sets) {
+            u32_t remap[512];
+            memset(remap, 0xFF, sizeof(remap));
+            u32_t count = 0;
+            for (u32_t c = 0; c < 256; c++) {
+                u32_t key = program.classes[c] * 2 + (bits.has((u8_t) c) ? 1 : 0);
+                if (remap[key] == (u32_t) -1) {
+                    remap[key] = count++;
+                }
+                program.classes[c] = (u8_t) remap[key];
+            }
+            program.classCount = count;
+        }
+    }
+
+    static bool glob_dfa(GlobProgram& program) {
+        u32_t classCount = program.classCount;
+        u8_t samples[256];
+        for (u32_t c = 256; c > 0; c--) {
+            samples[program.classes[c - 1]] = (u8_t) (c - 1);
+        }
+
+        std::map<std::vector<u32_t>, u32_t> ids;
+        std::vector<std::vector<u32_t>> subsets;
+        auto intern = [&](const std::vector<u32_t>& subset) -> u32_t {
+            auto iter = ids.find(subset);
+            if (iter != ids.end())
+                return iter->second;
+            u32_t id = (u32_t) subsets.size();
+            ids.insert(std::make_pair(subset, id));
+            subsets.push_back(subset);
+            return id;
+        };
+        intern(std::vector<u32_t>());
+        program.dfaStart = intern(program.startSet) * classCount;
+
+        std::vector<u32_t> next;
+        size_t work = 0;
+        for (u32_t id = 0; id < subsets.size(); id++) {
+            work += subsets[id].size() * classCount;
+            if (subsets.size() > GlobProgram::kMaxDfaStates || subsets.size() * classCount > GlobProgram::kMaxDfaTable)
+                return false;
+            if (work > GlobProgram::kMaxDfaWork)
+                return false;
+            program.acceptBegin.push_back((u32_t) program.accepts.size());
+            for (u32_t index : subsets[id]) {
+                const GlobState& s = program.states[index];
+                if (s.op == GlobOp::Accept) {
+                    program.accepts.push_back(s.next);
+                }
+            }
+            std::sort(program.accepts.begin() + program.acceptBegin.back(), program.accepts.end());
+            for (u32_t k = 0; k < classCount; k++) {
+                glob_advance(program, subsets[id], samples[k], next);
+                program.table.push_back(intern(next) * classCount);
+            }
+        }
+        program.acceptBegin.push_back((u32_t) program.accepts.size());
+        return true;
+    }
+
+    static GlobProgram* glob_compile(const StringView* patterns, size_t count, u32_t flags) {
+        GlobProgram* program = new GlobProgram();
+        GlobCompiler compiler(*program, flags);
+        std::vector<u32_t> starts;
+        for (size_t i = 0; i < count; i++) {
+            starts.push_back(compiler.compile(patterns[i], (u32_t) i));
+        }
+
+        size_t stateCount = program->states.size();
+        std::vector<u32_t> marks(stateCount, 0);
+        for (u32_t index = 0; index < stateCount; index++) {
+            size_t begin = program->closures.size();
+            program->closureBegin.push_back((u32_t) begin);
+            glob_closure(*program, index, marks, index + 1, program->closures);
+            std::sort(program->closures.begin() + begin, program->closures.end());
+        }
+        program->closureBegin.push_back((u32_t) program->closures.size());
+        for (u32_t start : starts) {
+            glob_closure(*program, start, marks, (u32_t) stateCount + 1, program->startSet);
+        }
+        std::sort(program->startSet.begin(), program->startSet.end());
+
+        glob_classes(*program);
+        program->hasDfa = glob_dfa(*program);
+        if (!program->hasDfa) {
+            program->table.clear();
+            program->acceptBegin.clear();
+            program->accepts.clear();
+        }
+        return program;
+    }
+
+    // hands the patterns that match all of name to visit in ascending order until it says stop.
+    template<typename Visit>
+    static void glob_run(const GlobProgram* program, const StringView& name, Visit visit) {
+        const u8_t* data = (const u8_t*) name.data();
+        size_t size = name.length();
+        if (program->hasDfa) {
+            const u32_t* table = program->table.data();
+            const u8_t* classes = program->classes;
+            u32_t row = program->dfaStart;
+            for (size_t i = 0; i < size && row != 0; i++) {
+                row = table[row + classes[data[i]]];
+            }
+            u32_t id = row / program->classCount;
+            for (u32_t i = program->acceptBegin[id]; i < program->acceptBegin[id + 1]; i++) {
+                if (!visit(program->accepts[i]))
+                    return;
+            }
+            return;
+        }
+
+        std::vector<u32_t> current = program->startSet;
+        std::vector<u32_t> next;
+        for (size_t i = 0; i < size && !current.empty(); i++) {
+            glob_advance(*program, current, data[i], next);
+            current.swap(next);
+        }
+        for (u32_t index : current) {
+            const GlobState& s = program->states[index];
+            if (s.op == GlobOp::Accept && !visit(s.next))
+                return;
+        }
+    }
+
+    /*
+    ============================================================================================
+    ==== Glob
+    ============================================================================================
+    */
+    Glob::Glob(const StringView& pattern, u32_t flags)
+        : mProgram(glob_compile(&pattern, 1, flags)), mPattern(pattern.data(), pattern.length()) {
+    }
+
+    Glob::Glob(Glob&& other) noexcept
+        : mProgram(other.mProgram), mPattern(std::move(other.mPattern)) {
+        other.mProgram = nullptr;
+    }
+
+    Glob::~Glob() {
+        delete mProgram;
+    }
+
+    Glob& Glob::operator=(Glob&& rhs) noexcept {
+        if (this != &rhs) {
+            delete mProgram;
+            mProgram = rhs.mProgram;
+            mPattern = std::move(rhs.mPattern);
+            rhs.mProgram = nullptr;
+        }
+        return *this;
+    }
+
+    bool Glob::match(const StringView& name) const {
+        bool matched = false;
+        if (mProgram == nullptr)
+            return matched;
+        glob_run(mProgram, name, [&](u32_t) -> bool {
+            matched = true;
+            return false;
+        });
+        return matched;
+    }
+
+    const String& Glob::pattern() const {
+        return mPattern;
+    }
+
+    /*
+    ============================================================================================
+    ==== GlobSet
+    ============================================================================================
+    */
+    GlobSet::GlobSet(const StringViewVector& patterns, u32_t flags)
+        : mProgram(glob_compile(patterns.data(), patterns.size(), flags)), mSize(patterns.size()) {
+    }
+
+    GlobSet::GlobSet(const StringVector& patterns, u32_t flags)
+        : GlobSet(StringViewVector(patterns.begin(), patterns.end()), flags) {
+    }
+
+    GlobSet::GlobSet(GlobSet&& other) noexcept
+        : mProgram(other.mProgram), mSize(other.mSize) {
+        other.mProgram = nullptr;
+        other.mSize = 0;
+    }
+
+    GlobSet::~GlobSet() {
+        delete mProgram;
+    }
+
+    GlobSet& GlobSet::operator=(GlobSet&& rhs) noexcept {
+        if (this != &rhs) {
+            delete mProgram;
+            mProgram = rhs.mProgram;
+            mSize = rhs.mSize;
+            rhs.mProgram = nullptr;
+            rhs.mSize = 0;
+        }
+        return *this;
+    }
+
+    size_t GlobSet::size() const {
+        return mSize;
+    }
+
+    bool GlobSet::matchAny(const StringView& name) const {
+        return this->matchFirst(name) != npos;
+    }
+
+    size_t GlobSet::matchFirst(const StringView& name) const {
+        size_t first = npos;
+        if (mProgram == nullptr)
+            return first;
+        glob_run(mProgram, name, [&](u32_t index) -> bool {
+            first = index;
+            return false;
+        });
+        return first;
+    }
+
+    size_t GlobSet::match(const StringView& name, std::vector<u32_t>& indices) const {
+        size_t count = 0;
+        if (mProgram == nullptr)
+            return count;
+        glob_run(mProgram, name, [&](u32_t index) -> bool {
+            indices.push_back(index);
+            count += 1;
+            return true;
+        });
+        return count;
+    }
+
+}
@@ -0,0 +1,91 @@
+#ifndef _EOKAS_BASE_GLOB_H_
+#define _EOKAS_BASE_GLOB_H_
+
+#include "./header.h"
+#include "./string.h"
+
+namespace eokas {
+
+    struct GlobProgram;
+
+    /*
+    ============================================================================================
+    ==== Glob
+    ==== A wildcard pattern compiled once, then matched against whole names.
+    ====   *        any run of chars except '/'
+    ====   ?        one char except '/'
+    ====   [a-z0-9] one char of the set, [!...] or [^...] one char not in it, never '/'
+    ====   **       any run of chars, '/' included; a segment that is just ** can also
+    ====            stand for no folder at all, together with the '/' after it
+    ====   {a,b}    either alternative, alternatives may hold wildcards and nest
+    ====   \c       c itself
+    ==== A '[' or '{' without its closing bracket is a plain char. The pattern is turned into
+    ==== an NFA and from there into a DFA over byte classes, matching is one table lookup per
+    ==== byte. Patterns whose DFA would be too big are matched on the NFA instead.
+    ==== Compiled globs are immutable and can be used from several threads.
+    ============================================================================================
+    */
+    class Glob {
+    public:
+        /// ASCII letters match either case.
+        static const u32_t kIgnoreCase = 1 << 0;
+
+    public:
+        explicit Glob(const StringView& pattern, u32_t flags = 0);
+        Glob(Glob&& other) noexcept;
+        ~Glob();
+
+        _ForbidCopy(Glob);
+        _ForbidAssign(Glob);
+
+    public:
+        Glob& operator=(Glob&& rhs) noexcept;
+
+        /// true if all of name matches.
+        bool match(const StringView& name) const;
+        const String& pattern() const;
+
+    private:
+        GlobProgram* mProgram;
+        String mPattern;
+    };
+
+    /*
+    ============================================================================================
+    ==== GlobSet
+    ==== Many globs compiled into one automaton, a name is matched against all of them in a
+    ==== single pass. Patterns are numbered in the order they were given.
+    ============================================================================================
+    */
+    class GlobSet {
+    public:
+        static const size_t npos = (size_t) -1;
+
+    public:
+        explicit GlobSet(const StringViewVector& patterns, u32_t flags = 0);
+        explicit GlobSet(const StringVector& patterns, u32_t flags = 0);
+        GlobSet(GlobSet&& other) noexcept;
+        ~GlobSet();
+
+        _ForbidCopy(GlobSet);
+        _ForbidAssign(GlobSet);
+
+    public:
+        GlobSet& operator=(GlobSet&& rhs) noexcept;
+
+        size_t size() const;
+        /// true if any pattern matches.
+        bool matchAny(const StringView& name) const;
+        /// the lowest index that matches, npos if none does.
+        size_t matchFirst(const StringView& name) const;
+        /// appends the indices that match in ascending order, returns how many.
+        size_t match(const StringView& name, std::vector<u32_t>& indices) const;
+
+    private:
+        GlobProgram* mProgram;
+        size_t mSize;
+    };
+
+}
+
+#endif//_EOKAS_BASE_GLOB_H_
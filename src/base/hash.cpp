@@ -1,9 +1,46 @@
 
 #include "./hash.h"
 #include "./string.h"
+#include "./memory.h"
 #include <cstring>
 
 namespace eokas {
+    String digestHex(const u8_t* digest, size_t size)
+    {
+        static const char digits[] = "0123456789abcdef";
+        String result;
+        char hex[128];
+        while (size > 0) {
+            size_t count = size < sizeof(hex) / 2 ? size : sizeof(hex) / 2;
+            for (size_t i = 0; i < count; i++) {
+                hex[i * 2] = digits[digest[i] >> 4];
+                hex[i * 2 + 1] = digits[digest[i] & 0x0F];
+            }
+            result.append(hex, count * 2);
+            digest += count;
+            size -= count;
+        }
+        return result;
+    }
+
+    // feeds the stream to update blockSize bytes at a time until it ends, returns the bytes read.
+    // a read that gives nothing before eos() stops it early, the caller checks eos() to tell.
+    template<typename Update>
+    static u64_t hash_stream(Stream& stream, size_t blockSize, Update update)
+    {
+        u64_t total = 0;
+        u8_t* block = (u8_t*) MemoryUtility::alloc(blockSize);
+        while (!stream.eos()) {
+            size_t size = stream.read(block, blockSize);
+            if (size == 0)
+                break;
+            update(block, size);
+            total += size;
+        }
+        MemoryUtility::free(block);
+        return total;
+    }
+
 /**
  * =================================================================
  * MD5
@@ -93,32 +130,50 @@ namespace eokas {
     }
 
     MD5::MD5()
-    { }
+    {
+        this->init();
+    }
 
-    String MD5::compute(const String& input)
+    u64_t MD5::update(Stream& stream)
+    {
+        return hash_stream(stream, STREAM_BLOCK_SIZE, [this](const u8_t* data, size_t size) {
+            this->update(data, size);
+        });
+    }
+
+    String MD5::finalizeHex()
     {
         u8_t digest[DIGEST_SIZE];
-        memset(digest, 0, DIGEST_SIZE);
+        this->finalize(digest);
+        return digestHex(digest, DIGEST_SIZE);
+    }
 
+    String MD5::compute(const String& input)
+    {
         this->init();
-        this->update((const u8_t*)input.cstr(), (u32_t)input.length());
-        this->finalize(digest);
+        this->update(input.cstr(), input.length());
+        return this->finalizeHex();
+    }
 
-        char buf[DIGEST_SIZE * 2 + 1];
-        for (int i = 0; i < DIGEST_SIZE; i++)
-        {
-            // sprintf(buf + i * 2, "%02x", digest[i]);
-            snprintf(buf + i * 2, 2, "%02x", digest[i]);
-        }
-        buf[DIGEST_SIZE * 2] = 0;
+    bool MD5::hashStream(Stream& stream, u8_t* digest)
+    {
+        MD5 md5;
+        md5.update(stream);
+        md5.finalize(digest);
+        return stream.eos();
+    }
 
-        return String{buf};
+    String MD5::hashStream(Stream& stream)
+    {
+        u8_t digest[DIGEST_SIZE];
+        if (!hashStream(stream, digest))
+            return String();
+        return digestHex(digest, DIGEST_SIZE);
     }
 
     void MD5::init()
     {
-        count[0] = 0;
-        count[1] = 0;
+        count = 0;
 
         // load magic initialization constants.
         state[0] = 0x67452301;
@@ -215,21 +270,19 @@ namespace eokas {
 
     // MD5 block update operation. Continues an MD5 message-digest
     // operation, processing another message block
-    void MD5::update(const u8_t* input, u32_t length)
+    void MD5::update(const void* data, size_t length)
     {
-        // compute number of bytes mod 64
-        u32_t index = count[0] / 8 % blocksize;
+        const u8_t* input = (const u8_t*) data;
 
-        // Update number of bits
-        if ((count[0] += (length << 3)) < (length << 3))
-            count[1]++;
-        count[1] += (length >> 29);
+        // compute number of bytes mod 64
+        size_t index = (size_t) (count % blocksize);
+        count += length;
 
         // number of bytes we need to fill in buffer
-        u32_t firstpart = 64 - index;
+        size_t firstpart = blocksize - index;
 
         // transform as many times as possible.
-        u32_t offset = 0;
+        size_t offset = 0;
         if (length >= firstpart)
         {
             // fill buffer first, transform
@@ -250,7 +303,7 @@ namespace eokas {
     }
 
     // MD5 finalization. Ends an MD5 message-digest operation, writing the
-    // the message digest and zeroizing the context.
+    // the message digest and starting over.
     void MD5::finalize(u8_t* digest) {
         static unsigned char padding[64] = {
             0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -260,10 +313,12 @@ namespace eokas {
 
         // Save number of bits
         u8_t bits[8];
-        encode(bits, count, 8);
+        u64_t bitCount = count << 3;
+        u32_t words[2] = {(u32_t) bitCount, (u32_t) (bitCount >> 32)};
+        encode(bits, words, 8);
 
         // pad out to 56 mod 64.
-        u32_t index = count[0] / 8 % 64;
+        u32_t index = (u32_t) (count % 64);
         u32_t padLen = (index < 56) ? (56 - index) : (120 - index);
         update(padding, padLen);
 
@@ -275,7 +330,7 @@ namespace eokas {
 
         // Zeroize sensitive information.
         memset(buffer, 0, sizeof buffer);
-        memset(count, 0, sizeof count);
+        this->init();
     }
 
     String md5(const String& input)
@@ -283,6 +338,11 @@ namespace eokas {
         return MD5().compute(input);
     }
 
+    String md5(Stream& stream)
+    {
+        return MD5::hashStream(stream);
+    }
+
 /**
  * =================================================================
  * SHA256
@@ -336,27 +396,45 @@ namespace eokas {
     };
 
     SHA256::SHA256()
-    { }
+    {
+        this->init();
+    }
 
-    String SHA256::compute(const eokas::String& input)
+    u64_t SHA256::update(Stream& stream)
     {
-        u8_t digest[SHA256::DIGEST_SIZE];
-        memset(digest,0,SHA256::DIGEST_SIZE);
+        return hash_stream(stream, STREAM_BLOCK_SIZE, [this](const u8_t* data, size_t size) {
+            this->update(data, size);
+        });
+    }
 
-        SHA256 ctx = SHA256();
-        ctx.init();
-        ctx.update((const u8_t*)input.cstr(), (u32_t)input.length());
-        ctx.finalize(digest);
+    String SHA256::finalizeHex()
+    {
+        u8_t digest[DIGEST_SIZE];
+        this->finalize(digest);
+        return digestHex(digest, DIGEST_SIZE);
+    }
 
-        char buf[SHA256::DIGEST_SIZE * 2 + 1];
-        for (int i = 0; i < SHA256::DIGEST_SIZE; i++)
-        {
-            // sprintf(buf + i * 2, "%02x", digest[i]);
-            snprintf(buf + i * 2, 2, "%02x", digest[i]);
-        }
-        buf[SHA256::DIGEST_SIZE * 2] = 0;
+    String SHA256::compute(const eokas::String& input)
+    {
+        this->init();
+        this->update(input.cstr(), input.length());
+        return this->finalizeHex();
+    }
+
+    bool SHA256::hashStream(Stream& stream, u8_t* digest)
+    {
+        SHA256 sha256;
+        sha256.update(stream);
+        sha256.finalize(digest);
+        return stream.eos();
+    }
 
-        return String(buf);
+    String SHA256::hashStream(Stream& stream)
+    {
+        u8_t digest[DIGEST_SIZE];
+        if (!hashStream(stream, digest))
+            return String();
+        return digestHex(digest, DIGEST_SIZE);
     }
 
     void SHA256::init()
@@ -373,11 +451,11 @@ namespace eokas {
         m_tot_len = 0;
     }
 
-    void SHA256::transform(const u8_t* message, u32_t block_nb)
+    void SHA256::transform(const u8_t* message, size_t block_nb)
     {
         u32_t w[64];
         u32_t wv[8];
-        for (int i = 0; i < (int) block_nb; i++) {
+        for (size_t i = 0; i < block_nb; i++) {
             const u8_t* sub_block = message + (i << 6);
             for (int j = 0; j < 16; j++) {
                 SHA2_PACK32(&sub_block[j << 2], &w[j]);
@@ -406,43 +484,51 @@ namespace eokas {
         }
     }
 
-    void SHA256::update(const u8_t* message, u32_t len)
+    void SHA256::update(const void* data, size_t len)
     {
-        u32_t tmp_len = SHA224_256_BLOCK_SIZE - m_len;
-        u32_t rem_len = len < tmp_len ? len : tmp_len;
+        const u8_t* message = (const u8_t*) data;
+        size_t tmp_len = SHA224_256_BLOCK_SIZE - m_len;
+        size_t rem_len = len < tmp_len ? len : tmp_len;
         memcpy(&m_block[m_len], message, rem_len);
         if (m_len + len < SHA224_256_BLOCK_SIZE) {
-            m_len += len;
+            m_len += (u32_t) len;
             return;
         }
 
-        u32_t new_len = len - rem_len;
-        u32_t block_nb = new_len / SHA224_256_BLOCK_SIZE;
+        size_t new_len = len - rem_len;
+        size_t block_nb = new_len / SHA224_256_BLOCK_SIZE;
         const u8_t* shifted_message = message + rem_len;
         transform(m_block, 1);
         transform(shifted_message, block_nb);
         rem_len = new_len % SHA224_256_BLOCK_SIZE;
         memcpy(m_block, &shifted_message[block_nb << 6], rem_len);
-        m_len = rem_len;
-        m_tot_len += (block_nb + 1) << 6;
+        m_len = (u32_t) rem_len;
+        m_tot_len += (u64_t) (block_nb + 1) << 6;
     }
 
     void SHA256::finalize(u8_t* digest)
     {
         u32_t block_nb = (1 + ((SHA224_256_BLOCK_SIZE - 9) < (m_len % SHA224_256_BLOCK_SIZE)));
-        u32_t len_b = (m_tot_len + m_len) << 3;
+        u64_t len_b = (m_tot_len + m_len) << 3;
         u32_t pm_len = block_nb << 6;
         memset(m_block + m_len, 0, pm_len - m_len);
         m_block[m_len] = 0x80;
-        SHA2_UNPACK32(len_b, m_block + pm_len - 4);
+        SHA2_UNPACK32((u32_t) (len_b >> 32), m_block + pm_len - 8);
+        SHA2_UNPACK32((u32_t) len_b, m_block + pm_len - 4);
         transform(m_block, block_nb);
         for (int i = 0 ; i < 8; i++) {
             SHA2_UNPACK32(m_h[i], &digest[i << 2]);
         }
+        this->init();
     }
 
     String sha256(const String& input)
     {
         return SHA256().compute(input);
     }
+
+    String sha256(Stream& stream)
+    {
+        return SHA256::hashStream(stream);
+    }
 }
@@ -3,8 +3,23 @@
 #define _EOKAS_BASE_HASH_H_
 
 #include "./header.h"
+#include "./stream.h"
 
 namespace eokas {
+    /*
+    ============================================================================================
+    ==== Hashes
+    ==== MD5 and SHA256 take their input in pieces: init(), update() as often as needed, then
+    ==== finalize() writes the raw digest and starts over. Lengths are counted in 64 bits.
+    ==== hashStream() reads a stream to its end STREAM_BLOCK_SIZE bytes at a time, so inputs of
+    ==== any size are hashed without holding them in memory. A read that returns nothing before
+    ==== eos() is a failure, hashStream() then returns false or an empty String. compute() and
+    ==== the hex results give the digest as lower case hex.
+    ============================================================================================
+    */
+    /// two lower case hex digits per byte.
+    String digestHex(const u8_t* digest, size_t size);
+
     /* MD5
      * converted to C++ class by Frank Thilo (thilo@unix-ag.org)
      * for bzflag (http://www.bzflag.org)
@@ -38,9 +53,22 @@ namespace eokas {
     class MD5 {
     public:
         static const u32_t DIGEST_SIZE = 16;
+        static const size_t STREAM_BLOCK_SIZE = 1024 * 1024;
         
         MD5();
+        
+        void init();
+        void update(const void* data, size_t size);
+        /// the bytes read, stream.eos() tells if it was read to its end.
+        u64_t update(Stream& stream);
+        void finalize(u8_t* digest);
+        String finalizeHex();
+        
         String compute(const String& input);
+        /// false if the stream stopped before its end, the digest is then of what was read.
+        static bool hashStream(Stream& stream, u8_t* digest);
+        /// empty if the stream stopped before its end.
+        static String hashStream(Stream& stream);
     
     private:
         static const u32_t blocksize = 64;
@@ -58,17 +86,15 @@ namespace eokas {
         static void encode(u8_t* output, const u32_t* input, u32_t len);
         static void decode(u32_t* output, const u8_t* input, u32_t len);
         
-        void init();
         void transform(const u8_t block[blocksize]);
-        void update(const u8_t* buf, u32_t length);
-        void finalize(u8_t* digest);
         
         u8_t buffer[blocksize];         // bytes that didn't fit in last 64 byte chunk
-        u32_t count[2];                 // 64bit counter for number of bits (lo, hi)
+        u64_t count;                    // number of bytes so far
         u32_t state[4];                 // digest so far
     };
     
     String md5(const String& input);
+    String md5(Stream& stream);
     
     /*
      * Updated to C++, zedwood.com 2012
@@ -109,26 +135,37 @@ namespace eokas {
     class SHA256 {
     public:
         static const u32_t DIGEST_SIZE = (256 / 8);
+        static const size_t STREAM_BLOCK_SIZE = 1024 * 1024;
         
         SHA256();
+        
+        void init();
+        void update(const void* data, size_t size);
+        /// the bytes read, stream.eos() tells if it was read to its end.
+        u64_t update(Stream& stream);
+        void finalize(u8_t* digest);
+        String finalizeHex();
+        
         String compute(const String& input);
+        /// false if the stream stopped before its end, the digest is then of what was read.
+        static bool hashStream(Stream& stream, u8_t* digest);
+        /// empty if the stream stopped before its end.
+        static String hashStream(Stream& stream);
     
     private:
         static const u32_t sha256_k[];
         static const u32_t SHA224_256_BLOCK_SIZE = (512 / 8);
         
-        void init();
-        void transform(const u8_t* message, u32_t block_nb);
-        void update(const u8_t* message, u32_t len);
-        void finalize(u8_t* digest);
+        void transform(const u8_t* message, size_t block_nb);
         
-        u32_t m_tot_len;
+        u64_t m_tot_len;
         u32_t m_len;
         u8_t m_block[2 * SHA224_256_BLOCK_SIZE];
         u32_t m_h[8];
     };
     
     String sha256(const String& input);
+    String sha256(Stream& stream);
 }
 
 #endif //_EOKAS_BASE_HASH_H_
@@ -2,39 +2,39 @@
 #include "./hom.h"
 
 namespace eokas {
-    HomNode::HomNode(HomType type)
+    HomNode::HomNode(HomType type, MemoryArena* arena)
         : mType(type)
         , mValue() {
         if(mType == HomType::Number) {
-            mValue = std::make_shared<HomNumber>(0);
+            mValue = makeValue<HomNumber>(arena, 0);
         }
         else if(mType == HomType::Boolean){
-            mValue = std::make_shared<HomBoolean>(false);
+            mValue = makeValue<HomBoolean>(arena, false);
         }
         else if(mType == HomType::String) {
-            mValue = std::make_shared<HomString>("");
+            mValue = makeValue<HomString>(arena, "");
         }
         else if(mType == HomType::Array) {
-            mValue = std::make_shared<HomArray>();
+            mValue = makeValue<HomArray>(arena, arena);
         }
         else if(mType == HomType::Object) {
-            mValue = std::make_shared<HomObject>();
+            mValue = makeValue<HomObject>(arena, arena);
         }
     }
         
-    HomNode::HomNode(f64_t val)
+    HomNode::HomNode(f64_t val, MemoryArena* arena)
         : mType(HomType::Number)
-        , mValue(std::make_shared<HomNumber>(val)) {
+        , mValue(makeValue<HomNumber>(arena, val)) {
     }
     
-    HomNode::HomNode(bool val)
+    HomNode::HomNode(bool val, MemoryArena* arena)
         : mType(HomType::Boolean)
-        , mValue(std::make_shared<HomBoolean>(val)) {
+        , mValue(makeValue<HomBoolean>(arena, val)) {
     }
         
-    HomNode::HomNode(const String& val)
+    HomNode::HomNode(const String& val, MemoryArena* arena)
         : mType(HomType::String)
-        , mValue(std::make_shared<HomString>(val)) {
+        , mValue(makeValue<HomString>(arena, val)) {
     }
     
     HomNode::HomNode(const HomNode& other) {
@@ -126,19 +126,32 @@ namespace eokas {
     }
     
     HomNode HomNode::get(const String& key) {
+        return this->get(Atom::lookup(key));
+    }
+    
+    HomNode HomNode::get(const Atom& key) {
         if(mType != HomType::Object)
             return HomNode{HomType::Null};
-        auto& map = ((HomObject*)mValue.get())->object;
-        if(map.find(key) == map.end())
+        HomNode* val = ((HomObject*)mValue.get())->find(key);
+        if(val == nullptr)
             return HomNode{HomType::Null};
-        return map[key];
+        return *val;
+    }
+    
+    bool HomNode::set(const String& key, const HomNode& val) {
+        if(mType != HomType::Object)
+            return false;
+        Atom atom = Atom::tryIntern(key);
+        if(atom.isEmpty() && !key.isEmpty())
+            return false;
+        this->set(atom, val);
+        return true;
     }
     
-    void HomNode::set(const String& key, const HomNode& val) {
+    void HomNode::set(const Atom& key, const HomNode& val) {
         if(mType != HomType::Object)
             return;
-        auto& map = ((HomObject*)mValue.get())->object;
-        map[key] = val;
+        ((HomObject*)mValue.get())->set(key, val);
     }
     
     void HomNode::foreach(const std::function<void(const String& key, const HomNode& val)>& func) const {
@@ -146,7 +159,36 @@ namespace eokas {
             return;
         auto& map = ((HomObject*)mValue.get())->object;
         for(auto& pair : map) {
-            func(pair.first, pair.second);
+            func(pair.first.name(), pair.second);
+        }
+    }
+    
+    HomNode* HomNode::HomObject::find(const Atom& key) {
+        if(index.empty()) {
+            for(auto& pair : object) {
+                if(pair.first == key)
+                    return &pair.second;
+            }
+            return nullptr;
+        }
+        auto iter = index.find(key);
+        return iter != index.end() ? &object[iter->second].second : nullptr;
+    }
+    
+    void HomNode::HomObject::set(const Atom& key, const HomNode& val) {
+        HomNode* slot = this->find(key);
+        if(slot != nullptr) {
+            *slot = val;
+            return;
+        }
+        object.emplace_back(key, val);
+        if(!index.empty()) {
+            index.emplace(key, object.size() - 1);
+        }
+        else if(object.size() > kIndexThreshold) {
+            for(size_t i = 0; i < object.size(); i++) {
+                index.emplace(object[i].first, i);
+            }
         }
     }
 }
@@ -9,7 +9,10 @@
  * */
 
 #include "./string.h"
+#include "./atom.h"
+#include "./arena.h"
 #include <utility>
+#include <unordered_map>
 
 namespace eokas {
     
@@ -19,10 +22,12 @@ namespace eokas {
     
     class HomNode {
     public:
-        HomNode(HomType type = HomType::Null);
-        HomNode(f64_t val);
-        HomNode(bool val);
-        HomNode(const String& val);
+        /// nodes created with an arena keep their storage in it,
+        /// release every node of the document before the arena is reset.
+        HomNode(HomType type = HomType::Null, MemoryArena* arena = nullptr);
+        HomNode(f64_t val, MemoryArena* arena = nullptr);
+        HomNode(bool val, MemoryArena* arena = nullptr);
+        HomNode(const String& val, MemoryArena* arena = nullptr);
         HomNode(const HomNode& other);
 
         HomNode& operator=(const HomNode& other);
@@ -45,8 +50,14 @@ namespace eokas {
         void add(const HomNode& val);
         void foreach(const std::function<void(const HomNode& val)>& func) const;
         
+        /// keys are interned, a lookup of a name that was never interned is a miss without a
+        /// string compare. Members keep the order they were first set in.
         HomNode get(const String& key);
-        void set(const String& key, const HomNode& val);
+        HomNode get(const Atom& key);
+        /// a new key is interned for the life of the process through Atom::tryIntern(), so
+        /// past Atom::kMaxDataAtoms names the member is not set and false comes back.
+        bool set(const String& key, const HomNode& val);
+        void set(const Atom& key, const HomNode& val);
         void foreach(const std::function<void(const String& key, const HomNode& val)>& func) const;
     
     private:
@@ -70,15 +81,28 @@ namespace eokas {
         };
         
         struct HomArray :public HomValue {
-            std::vector<HomNode> array;
-            HomArray() :array() {}
+            std::vector<HomNode, ArenaAllocator<HomNode>> array;
+            HomArray(MemoryArena* arena) :array(ArenaAllocator<HomNode>(arena)) {}
         };
         
         struct HomObject :public HomValue {
-            std::map<String, HomNode> object;
-            HomObject() :object() {}
+            // small objects are scanned, the index is built once they outgrow a scan.
+            static const size_t kIndexThreshold = 16;
+            using Pair = std::pair<Atom, HomNode>;
+            using IndexPair = std::pair<const Atom, size_t>;
+            std::vector<Pair, ArenaAllocator<Pair>> object;
+            std::unordered_map<Atom, size_t, AtomHash, std::equal_to<Atom>, ArenaAllocator<IndexPair>> index;
+            HomObject(MemoryArena* arena) :object(ArenaAllocator<Pair>(arena)), index(0, AtomHash(), std::equal_to<Atom>(), ArenaAllocator<IndexPair>(arena)) {}
+            
+            HomNode* find(const Atom& key);
+            void set(const Atom& key, const HomNode& val);
         };
         
+        template<typename T, typename... Args>
+        static std::shared_ptr<HomValue> makeValue(MemoryArena* arena, Args&&... args) {
+            return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+        }
+        
         HomType mType;
         std::shared_ptr<HomValue> mValue;
     };
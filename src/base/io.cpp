@@ -1,7 +1,7 @@
 
 #include "./io.h"
 #include "./string.h"
-#include <regex>
+#include "./glob.h"
 
 #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
 #include <Windows.h>
@@ -355,12 +355,9 @@ namespace eokas {
     }
     
     FileList File::glob(const eokas::String& path, const eokas::String& pattern) {
+        Glob glob(pattern, Glob::kIgnoreCase);
         auto predicate = [&](const FileInfo& info)->bool{
-            std::string regex_pattern = std::regex_replace(pattern.cstr(), std::regex(R"(\.)"), R"(\.)");
-            regex_pattern = std::regex_replace(regex_pattern, std::regex(R"(\*)"), R"(.*)");
-            regex_pattern = std::regex_replace(regex_pattern, std::regex(R"(\?)"), R"(.)");
-            std::regex regex_expr(regex_pattern, std::regex::icase);
-            return std::regex_match(info.name.cstr(), regex_expr);
+            return glob.match(info.name);
         };
         return File::listFileInfos(path, predicate);
     };
@@ -88,6 +88,7 @@ namespace eokas {
         static FileList listFileInfos(const String& path, FileInfoPredicate predicate = FileInfoPredicate());
         static StringList listFileNames(const String& path, FileNamePredicate predicate = FileNamePredicate());
         static StringList listFolderNames(const String& path, FileNamePredicate predicate = FileNamePredicate());
+        /// the entries of path whose names match the Glob pattern, ignoring case.
         static FileList glob(const String& path, const String& pattern);
         static String absolutePath(const String& path);
         static String basePath(const String& path);
@@ -0,0 +1,218 @@
+
+#include "./job.h"
+
+namespace eokas {
+
+    static ConcurrentPool<Job>& job_pool() {
+        // leaked on purpose: jobs may be released by threads outliving static destruction.
+        static ConcurrentPool<Job>* sPool = new ConcurrentPool<Job>();
+        return *sPool;
+    }
+
+    /*
+    ============================================================================================
+    ==== JobRef
+    ============================================================================================
+    */
+    JobRef::JobRef(Job* job)
+        : mJob(job) {
+        if (mJob != nullptr) {
+            mJob->retain();
+        }
+    }
+
+    JobRef::JobRef(const JobRef& other)
+        : mJob(other.mJob) {
+        if (mJob != nullptr) {
+            mJob->retain();
+        }
+    }
+
+    JobRef::JobRef(JobRef&& other) noexcept
+        : mJob(other.mJob) {
+        other.mJob = nullptr;
+    }
+
+    JobRef::~JobRef() {
+        if (mJob != nullptr) {
+            mJob->release();
+        }
+    }
+
+    JobRef& JobRef::operator=(const JobRef& other) {
+        if (mJob != other.mJob) {
+            if (other.mJob != nullptr) {
+                other.mJob->retain();
+            }
+            if (mJob != nullptr) {
+                mJob->release();
+            }
+            mJob = other.mJob;
+        }
+        return *this;
+    }
+
+    JobRef& JobRef::operator=(JobRef&& other) noexcept {
+        if (this != &other) {
+            if (mJob != nullptr) {
+                mJob->release();
+            }
+            mJob = other.mJob;
+            other.mJob = nullptr;
+        }
+        return *this;
+    }
+
+    /*
+    ============================================================================================
+    ==== Job
+    ============================================================================================
+    */
+    Job* Job::alloc(ThreadPool& pool, Task&& work, bool any) {
+        Job* job = job_pool().acquire(&pool, std::move(work), any);
+        if (job == nullptr)
+            throw std::bad_alloc();
+        return job;
+    }
+
+    JobRef Job::whenAll(ThreadPool& pool, const std::vector<JobRef>& jobs) {
+        JobRef job(alloc(pool, Task(), false));
+        for (const JobRef& predecessor: jobs) {
+            job->after(predecessor);
+        }
+        job->submit();
+        return job;
+    }
+
+    JobRef Job::whenAny(ThreadPool& pool, const std::vector<JobRef>& jobs) {
+        JobRef job(alloc(pool, Task(), true));
+        for (const JobRef& predecessor: jobs) {
+            job->after(predecessor);
+        }
+        if (jobs.empty()) {
+            job->resolve();
+        }
+        job->submit();
+        return job;
+    }
+
+    Job::Job(ThreadPool* pool, Task&& work, bool any)
+        : mPool(pool)
+        , mWork(std::move(work))
+        , mRefs(0)
+        , mPending(any ? 2 : 1)
+        , mFired(false)
+        , mSubmitted(false)
+        , mDone(false)
+        , mAny(any)
+        , mCompleted(false)
+        , mMutex()
+        , mSuccessors()
+        , mException() {
+    }
+
+    Job::~Job() {
+    }
+
+    bool Job::after(const JobRef& predecessor) {
+        if (mSubmitted.load(std::memory_order_acquire))
+            return false;
+        if (!predecessor || predecessor.get() == this)
+            return false;
+
+        // an "any" job waits on one shared count, held since creation.
+        if (!mAny) {
+            mPending.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool linked = false;
+        {
+            std::lock_guard<std::mutex> lock(predecessor->mMutex);
+            if (!predecessor->mCompleted) {
+                predecessor->mSuccessors.push_back(JobRef(this));
+                linked = true;
+            }
+        }
+        if (!linked) {
+            this->resolve();
+        }
+        return true;
+    }
+
+    void Job::submit() {
+        bool expected = false;
+        if (!mSubmitted.compare_exchange_strong(expected, true))
+            return;
+        if (mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->schedule();
+        }
+    }
+
+    void Job::wait() {
+        while (!this->isDone()) {
+            if (!mPool->help()) {
+                std::this_thread::yield();
+            }
+        }
+        if (mException) {
+            std::rethrow_exception(mException);
+        }
+    }
+
+    void Job::retain() {
+        mRefs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Job::release() {
+        if (mRefs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            job_pool().release(this);
+        }
+    }
+
+    void Job::resolve() {
+        if (mAny && mFired.exchange(true, std::memory_order_acq_rel))
+            return;
+        if (mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->schedule();
+        }
+    }
+
+    void Job::schedule() {
+        if (!mWork) {
+            // joins have nothing to run, finish them in place.
+            this->retain();
+            this->execute();
+            return;
+        }
+        this->retain();
+        mPool->post([this]() {
+            this->execute();
+        });
+    }
+
+    void Job::execute() {
+        if (mWork) {
+            try {
+                mWork();
+            }
+            catch (...) {
+                mException = std::current_exception();
+            }
+            mWork.reset();
+        }
+
+        std::vector<JobRef> successors;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCompleted = true;
+            successors.swap(mSuccessors);
+        }
+        mDone.store(true, std::memory_order_release);
+
+        for (JobRef& successor: successors) {
+            successor->resolve();
+        }
+        this->release();
+    }
+
+}
@@ -0,0 +1,209 @@
+#ifndef _EOKAS_BASE_JOB_H_
+#define _EOKAS_BASE_JOB_H_
+
+#include "./header.h"
+#include "./async.h"
+
+namespace eokas {
+
+    class Job;
+
+    /*
+    ============================================================================================
+    ==== JobRef
+    ==== Intrusively counted reference to a Job.
+    ============================================================================================
+    */
+    class JobRef {
+    public:
+        JobRef()
+            : mJob(nullptr) {
+        }
+
+        explicit JobRef(Job* job);
+        JobRef(const JobRef& other);
+        JobRef(JobRef&& other) noexcept;
+        ~JobRef();
+
+        JobRef& operator=(const JobRef& other);
+        JobRef& operator=(JobRef&& other) noexcept;
+
+        Job* get() const {
+            return mJob;
+        }
+
+        Job* operator->() const {
+            return mJob;
+        }
+
+        explicit operator bool() const {
+            return mJob != nullptr;
+        }
+
+        bool operator==(const JobRef& other) const {
+            return mJob == other.mJob;
+        }
+
+        bool operator!=(const JobRef& other) const {
+            return mJob != other.mJob;
+        }
+
+    private:
+        Job* mJob;
+    };
+
+    /*
+    ============================================================================================
+    ==== Job
+    ==== A unit of work with predecessors. Every unfinished predecessor holds one count on the
+    ==== job, submit() drops the count held by its creator, and the job is posted to the pool
+    ==== when the count reaches zero. Finishing a job resolves its successors, so nothing
+    ==== ever blocks a worker; only wait() joins, and it helps the pool while waiting.
+    ==== Dependencies are declared before submit().
+    ============================================================================================
+    */
+    class Job {
+    public:
+        template<typename F>
+        static JobRef create(ThreadPool& pool, F&& f) {
+            return JobRef(alloc(pool, Task(std::forward<F>(f)), false));
+        }
+
+        /// runs after all of the given jobs.
+        static JobRef whenAll(ThreadPool& pool, const std::vector<JobRef>& jobs);
+
+        /// runs after the first of the given jobs.
+        static JobRef whenAny(ThreadPool& pool, const std::vector<JobRef>& jobs);
+
+        Job(ThreadPool* pool, Task&& work, bool any);
+        ~Job();
+
+        _ForbidCopy(Job);
+        _ForbidAssign(Job);
+
+        /// false when the job has already been submitted.
+        bool after(const JobRef& predecessor);
+
+        bool precede(const JobRef& successor) {
+            return successor->after(JobRef(this));
+        }
+
+        /// creates and submits a continuation.
+        template<typename F>
+        JobRef then(F&& f) {
+            JobRef job = create(*mPool, std::forward<F>(f));
+            job->after(JobRef(this));
+            job->submit();
+            return job;
+        }
+
+        void submit();
+
+        bool isDone() const {
+            return mDone.load(std::memory_order_acquire);
+        }
+
+        /// helps the pool until the job is done, then rethrows its exception if it threw.
+        void wait();
+
+    private:
+        friend class JobRef;
+
+        static Job* alloc(ThreadPool& pool, Task&& work, bool any);
+
+        void retain();
+        void release();
+        void resolve();
+        void schedule();
+        void execute();
+
+        ThreadPool* mPool;
+        Task mWork;
+        std::atomic<u32_t> mRefs;
+        std::atomic<i32_t> mPending;
+        std::atomic<bool> mFired;
+        std::atomic<bool> mSubmitted;
+        std::atomic<bool> mDone;
+        bool mAny;
+        bool mCompleted;
+        std::mutex mMutex;
+        std::vector<JobRef> mSuccessors;
+        std::exception_ptr mException;
+    };
+
+    inline JobRef when_all(ThreadPool& pool, const std::vector<JobRef>& jobs) {
+        return Job::whenAll(pool, jobs);
+    }
+
+    inline JobRef when_any(ThreadPool& pool, const std::vector<JobRef>& jobs) {
+        return Job::whenAny(pool, jobs);
+    }
+
+    /*
+    ============================================================================================
+    ==== JobGraph
+    ==== Builds a DAG of jobs, then submits them together. Jobs added after a submit() wait for
+    ==== the next one.
+    ============================================================================================
+    */
+    class JobGraph {
+    public:
+        explicit JobGraph(ThreadPool& pool)
+            : mPool(pool), mJobs(), mSubmitted(0) {
+        }
+
+        ~JobGraph() {
+            this->submit();
+            this->join();
+        }
+
+        _ForbidCopy(JobGraph);
+        _ForbidAssign(JobGraph);
+
+        template<typename F>
+        JobRef add(F&& f) {
+            JobRef job = Job::create(mPool, std::forward<F>(f));
+            mJobs.push_back(job);
+            return job;
+        }
+
+        bool precede(const JobRef& before, const JobRef& after) {
+            return after->after(before);
+        }
+
+        size_t size() const {
+            return mJobs.size();
+        }
+
+        void submit() {
+            for (; mSubmitted < mJobs.size(); mSubmitted++) {
+                mJobs[mSubmitted]->submit();
+            }
+        }
+
+        void wait() {
+            this->submit();
+            for (JobRef& job: mJobs) {
+                job->wait();
+            }
+        }
+
+    private:
+        void join() {
+            for (JobRef& job: mJobs) {
+                while (!job->isDone()) {
+                    if (!mPool.help()) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }
+
+        ThreadPool& mPool;
+        std::vector<JobRef> mJobs;
+        size_t mSubmitted;
+    };
+
+}
+
+#endif//_EOKAS_BASE_JOB_H_
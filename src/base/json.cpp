@@ -1,40 +1,65 @@
 
 #include "./json.h"
 #include "./ascil.h"
+#include "./utf8.h"
+#include <cmath>
 
 namespace eokas {
     
+    // reads the source through a view, names, numbers and strings without escapes are cut
+    // straight out of it.
     struct JsonParser {
-        String mSource;
+        StringView mSource;
         size_t mPosition;
+        MemoryArena* mArena;
+        bool mFailed;
         
-        explicit JsonParser(const String& source)
-            : mSource(source), mPosition(0) {
+        explicit JsonParser(const String& source, MemoryArena* arena = nullptr)
+            : mSource(source), mPosition(0), mArena(arena), mFailed(false) {
         }
         
-        String nextName() {
+        // known names cost no lock and no memory. New ones are interned for good, so past
+        // JSON::kMaxNameAtoms interned names the document fails instead.
+        Atom nameAtom(const StringView& name) {
+            Atom atom = Atom::tryIntern(name, JSON::kMaxNameAtoms);
+            if (atom.isEmpty() && !name.isEmpty()) {
+                mFailed = true;
+            }
+            return atom;
+        }
+        
+        Atom nextName() {
             char c = this->nextCleanChar();
             switch (c) {
                 case '\0': // eof
-                    return "";
+                    return Atom();
                 
                 case '\'':
                 case '"': {
+                    // names rarely carry escapes, intern those straight from the source.
+                    size_t start = mPosition;
+                    size_t end = mSource.find(c, start);
+                    if (end != StringView::npos) {
+                        StringView plain = mSource.substr(start, end - start);
+                        if (plain.find('\\') == StringView::npos) {
+                            mPosition = end + 1;
+                            return this->nameAtom(plain);
+                        }
+                    }
                     auto str = this->nextString(c);
-                    return str.asString();
+                    return this->nameAtom(str.asString());
                 }
                 default:
                     if (_ascil_is_alpha_(c)) {
-                        auto identifier = this->nextIdentifier(c);
-                        return identifier;
+                        return this->nameAtom(this->nextIdentifier());
                     }
             }
             
-            return "";
+            return Atom();
         }
         
         HomNode nextValue() {
-            char c = this->nextChar();
+            char c = this->nextCleanChar();
             switch (c) {
                 case '[':
                     return this->nextArray();
@@ -45,14 +70,14 @@ namespace eokas {
                     return this->nextString(c);
                 default:
                     if (_ascil_is_number(c) || c == '+' || c == '-') {
-                        return this->nextNumber(c);
+                        return this->nextNumber();
                     } else if (_ascil_is_alpha_(c)) {
                         size_t start = mPosition;
-                        auto identifier = this->nextIdentifier(c);
+                        StringView identifier = this->nextIdentifier();
                         if (identifier == "true")
-                            return HomNode{true};
+                            return HomNode{true, mArena};
                         else if (identifier == "false")
-                            return HomNode{false};
+                            return HomNode{false, mArena};
                         else if (identifier == "null")
                             return HomNode{HomType::Null};
                         mPosition = start;
@@ -62,14 +87,14 @@ namespace eokas {
         }
         
         HomNode nextArray() {
-            HomNode list(HomType::Array);
+            HomNode list(HomType::Array, mArena);
             
             int count = 0;
             
             char first = this->nextCleanChar();
             if (first == ']') {
                 return list;
-            } else if (first == '\0') {
+            } else if (first != '\0') {
                 mPosition -= 1;
             }
             
@@ -90,7 +115,7 @@ namespace eokas {
         }
         
         HomNode nextObject() {
-            HomNode object(HomType::Object);
+            HomNode object(HomType::Object, mArena);
             
             /* Peek to see if this is the empty object. */
             char first = this->nextCleanChar();
@@ -102,6 +127,8 @@ namespace eokas {
             
             while (true) {
                 auto name = this->nextName();
+                if (mFailed)
+                    return HomNode{};
                 
                 /*
                  * Expect the name/value separator to be either a colon ':', an
@@ -113,7 +140,7 @@ namespace eokas {
                     // error: "Expected ':' after " + name
                     return HomNode{};
                 }
-                if (mPosition < mSource.length() && mSource.substr(mPosition, 1).at(0) == '>') {
+                if (mPosition < mSource.length() && mSource[mPosition] == '>') {
                     mPosition++;
                 }
                 HomNode val = this->nextValue();
@@ -131,52 +158,13 @@ namespace eokas {
             }
         }
         
-        HomNode nextNumber(char first) {
-            String str(first);
-            if (first != '+' && first != '-') {
-                char c = this->nextChar();
-                if (c == '.') {
-                    str += c;
-                    c = this->nextChar();
-                    while (_ascil_is_number(c)) {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                } else {
-                    c = this->nextChar();
-                    while (_ascil_is_number(c)) {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                    if (c == '.') {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                    while (_ascil_is_number(c)) {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                }
-            } else {
-                char c = this->nextChar();
-                while (_ascil_is_number(c)) {
-                    str += c;
-                    c = this->nextChar();
-                }
-                if (c == '.') {
-                    str += c;
-                    c = this->nextChar();
-                }
-                while (_ascil_is_number(c)) {
-                    str += c;
-                    c = this->nextChar();
-                }
-            }
-            
-            mPosition -= 1;
-            
-            auto value = String::stringToValue<f64_t>(str);
-            return HomNode{value};
+        // the first char has been consumed already.
+        HomNode nextNumber() {
+            size_t start = mPosition - 1;
+            f64_t value = 0;
+            size_t used = NumberChars::parse(mSource.data() + start, mSource.data() + mSource.length(), value);
+            mPosition = start + (used > 0 ? used : 1);
+            return HomNode{value, mArena};
         }
         
         HomNode nextString(char quote) {
@@ -185,13 +173,13 @@ namespace eokas {
             size_t start = mPosition;
             for (char c = this->nextChar(); c != '\0'; c = this->nextChar()) {
                 if (c == quote) {
-                    str += mSource.substr(start, mPosition - start - 1);
-                    return HomNode{str};
+                    str.append(mSource.data() + start, mPosition - start - 1);
+                    return HomNode{str, mArena};
                 }
                 
                 if (c == '\\') {
-                    str += mSource.substr(start, mPosition - start - 1);
-                    str += this->escapeChar();
+                    str.append(mSource.data() + start, mPosition - start - 1);
+                    this->nextEscape(str);
                     start = mPosition;
                 }
             }
@@ -200,66 +188,83 @@ namespace eokas {
             return HomNode{};
         }
         
-        String nextIdentifier(char first) {
-            String str(first);
-            char c = this->nextChar();
-            while (_ascil_is_alpha_number(c)) {
-                str += c;
-                c = this->nextChar();
-            }
-            
-            mPosition -= 1;
-            
-            return str;
+        // the first char has been consumed already.
+        StringView nextIdentifier() {
+            size_t start = mPosition - 1;
+            mPosition += Ascil::identifierLength(mSource.data() + mPosition, mSource.length() - mPosition);
+            return mSource.substr(start, mPosition - start);
         }
         
-        char escapeChar() {
+        // appends what the escape stands for, \uXXXX and \uXXXX\uXXXX pairs as UTF-8.
+        void nextEscape(String& str) {
             char c = this->nextChar();
             switch (c) {
                 case 'u': {
-                    if (mPosition + 4 >= mSource.length()) {
-                        // error: Unterminated escape sequence
-                        return ' ';
+                    u32_t code = this->nextHex4();
+                    if (code >= 0xD800 && code < 0xDC00 && mSource.substr(mPosition, 2) == "\\u") {
+                        size_t mark = mPosition;
+                        mPosition += 2;
+                        u32_t low = this->nextHex4();
+                        if (low >= 0xDC00 && low < 0xE000) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        } else {
+                            mPosition = mark;
+                        }
                     }
-                    
-                    String hex = mSource.substr(mPosition, 4);
-                    mPosition += 4;
-                    
-                    // TODO: Int.parse(hex, 16) as char
-                    return ' ';
+                    // a lone surrogate becomes U+FFFD.
+                    char32_t unit = (char32_t) code;
+                    char utf8[4];
+                    str.append(utf8, UTF8::fromUtf32(&unit, 1, utf8, true));
+                    return;
                 }
                 
                 case 'a':
-                    return '\a';
+                    str += '\a';
+                    return;
                 case 'b':
-                    return '\b';
+                    str += '\b';
+                    return;
                 case 'f':
-                    return '\f';
+                    str += '\f';
+                    return;
                 case 't':
-                    return '\t';
+                    str += '\t';
+                    return;
                 case 'n':
-                    return '\n';
+                    str += '\n';
+                    return;
                 case 'r':
-                    return '\r';
+                    str += '\r';
+                    return;
                 case 'v':
-                    return '\v';
+                    str += '\v';
+                    return;
                 
                 case '\'':
                 case '"':
                 case '\\':
                 default:
-                    return c;
+                    str += c;
+                    return;
+            }
+        }
+        
+        // up to four hex digits, U+FFFD if there are fewer.
+        u32_t nextHex4() {
+            u32_t code = 0;
+            for (int i = 0; i < 4; i++) {
+                char c = mPosition < mSource.length() ? mSource[mPosition] : '\0';
+                if (!_ascil_is_hex(c))
+                    return 0xFFFD;
+                code = (code << 4) | (u32_t) (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+                mPosition += 1;
             }
+            return code;
         }
         
         char nextCleanChar() {
-            for (char c = this->nextChar(); c != '\0'; c = this->nextChar()) {
+            for (char c = this->nextWhite(); c != '\0'; c = this->nextWhite()) {
                 switch (c) {
-                    case ':':
-                    case '\t':
-                    case '\n':
-                    case '\r':
-                        continue;
                     case '#':  // php # comment
                         this->skipToEndOfLine();
                         continue;
@@ -297,6 +302,14 @@ namespace eokas {
             }
         }
         
+        // the char after a run of white.
+        char nextWhite() {
+            if (mPosition < mSource.length()) {
+                mPosition += Ascil::whiteLength(mSource.data() + mPosition, mSource.length() - mPosition);
+            }
+            return this->nextChar();
+        }
+        
         char nextChar() {
             if (mPosition >= mSource.length())
                 return '\0';
@@ -306,54 +319,110 @@ namespace eokas {
         }
     };
     
+    // quotes, backslashes and control chars are escaped, the rest is UTF-8 as it is.
+    static void json_write_string(StringBuilder& out, const StringView& str) {
+        static const char* hex = "0123456789abcdef";
+        out.append('"');
+        const char* run = str.begin();
+        for (const char* ptr = str.begin(); ptr != str.end(); ptr++) {
+            u8_t c = (u8_t) *ptr;
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            out.append(run, (size_t) (ptr - run));
+            run = ptr + 1;
+            switch (c) {
+                case '"': out.append("\\\"", 2); break;
+                case '\\': out.append("\\\\", 2); break;
+                case '\b': out.append("\\b", 2); break;
+                case '\f': out.append("\\f", 2); break;
+                case '\n': out.append("\\n", 2); break;
+                case '\r': out.append("\\r", 2); break;
+                case '\t': out.append("\\t", 2); break;
+                default: {
+                    const char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+                    out.append(escape, sizeof(escape));
+                    break;
+                }
+            }
+        }
+        out.append(run, (size_t) (str.end() - run));
+        out.append('"');
+    }
+    
     String JSON::stringify(const HomNode& json) {
+        StringBuilder out;
+        JSON::stringify(json, out);
+        return out.toString();
+    }
+    
+    void JSON::stringify(const HomNode& json, StringBuilder& out) {
         switch (json.type()) {
             case HomType::Null: {
-                return "null";
+                out.append("null", 4);
+                break;
             }
             case HomType::Number: {
-                return String::valueToString(json.asNumber());
+                // JSON has no nan or inf, JavaScript writes them as null too.
+                f64_t value = json.asNumber();
+                if (std::isfinite(value)) {
+                    out << value;
+                } else {
+                    out.append("null", 4);
+                }
+                break;
             }
             case HomType::Boolean: {
-                return String::valueToString(json.asBoolean());
+                out << json.asBoolean();
+                break;
             }
             case HomType::String: {
-                return String::format("\"%s\"", json.asString().cstr());
+                json_write_string(out, json.asString().view());
+                break;
             }
             case HomType::Array: {
-                String str = "[";
+                out.append('[');
                 bool first = true;
                 json.foreach([&](const HomNode& val)->void {
-                    if (first) {
-                        str += ", ";
-                        first = false;
+                    if (!first) {
+                        out.append(", ", 2);
                     }
-                    str += stringify(val);
+                    first = false;
+                    JSON::stringify(val, out);
                 });
-                str += "]";
-                return str;
+                out.append(']');
+                break;
             }
             case HomType::Object: {
-                String str = "{";
+                out.append('{');
                 bool first = true;
                 json.foreach([&](const String& key, const HomNode& val)->void {
-                    if (first) {
-                        str += ", ";
-                        first = false;
+                    if (!first) {
+                        out.append(", ", 2);
                     }
-                    str += String::format("\"%s\":", key.cstr());
-                    str += stringify(val);
+                    first = false;
+                    json_write_string(out, key.view());
+                    out.append(':');
+                    JSON::stringify(val, out);
                 });
-                str += "}";
-                return str;
+                out.append('}');
+                break;
             }
         }
-        return "";
     }
     
-    HomNode JSON::parse(const String& source) {
-        JsonParser parser{source};
-        return parser.nextValue();
+    bool JSON::stringify(const HomNode& json, Stream& stream) {
+        StringBuilder out(stream);
+        JSON::stringify(json, out);
+        return out.flush();
+    }
+    
+    HomNode JSON::parse(const String& source, MemoryArena* arena) {
+        // strings are cut out of the source as they are, so the source is checked up front.
+        if (!UTF8::validate(source.cstr(), source.length()))
+            return HomNode{};
+        JsonParser parser{source, arena};
+        HomNode root = parser.nextValue();
+        return parser.mFailed ? HomNode{} : root;
     }
     
 }
@@ -3,11 +3,29 @@
 #define  _EOKAS_BASE_JSON_H_
 
 #include "./hom.h"
+#include "./builder.h"
 
 namespace eokas {
+    /*
+    ============================================================================================
+    ==== JSON
+    ==== Object keys become Atoms, which live as long as the process. Documents whose keys
+    ==== come from data (ids, hashes, user input) keep adding names, so parse() gives up with
+    ==== a null node once kMaxNameAtoms names are interned in all, rather than growing the
+    ==== table without bound or letting it overflow.
+    ============================================================================================
+    */
     struct JSON {
+        /// interned names beyond which parse() takes no new key.
+        static const u32_t kMaxNameAtoms = Atom::kMaxDataAtoms;
+
         static String stringify(const HomNode& json);
-        static HomNode parse(const String& source);
+        static void stringify(const HomNode& json, StringBuilder& out);
+        /// written to the stream as the text comes, true if the stream took all of it.
+        static bool stringify(const HomNode& json, Stream& stream);
+        /// a null node for sources that are not well formed UTF-8 or bring new keys past
+        /// kMaxNameAtoms.
+        static HomNode parse(const String& source, MemoryArena* arena = nullptr);
     };
 }
 
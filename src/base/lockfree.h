@@ -0,0 +1,557 @@
+#ifndef _EOKAS_BASE_LOCKFREE_H_
+#define _EOKAS_BASE_LOCKFREE_H_
+
+#include "./header.h"
+
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <condition_variable>
+
+namespace eokas {
+
+    static const size_t kCacheLineSize = 64;
+
+    inline size_t lockfree_capacity(size_t capacity) {
+        size_t result = 2;
+        while (result < capacity) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    /*
+    ============================================================================================
+    ==== SpscQueue
+    ==== Wait-free ring buffer for one producer and one consumer. Each side caches the other
+    ==== side's index and only reloads it when the ring looks full or empty, so the shared
+    ==== cache lines are touched once per wrap instead of once per item.
+    ============================================================================================
+    */
+    template<typename T>
+    class SpscQueue {
+    public:
+        using Value = T;
+
+        explicit SpscQueue(size_t capacity = 1024)
+            : mCapacity(lockfree_capacity(capacity)), mMask(mCapacity - 1)
+            , mSlots(static_cast<Slot*>(::operator new(sizeof(Slot) * mCapacity)))
+            , mHead(0), mTailCache(0), mTail(0), mHeadCache(0) {
+        }
+
+        ~SpscQueue() {
+            size_t tail = mTail.load(std::memory_order_acquire);
+            for (size_t head = mHead.load(std::memory_order_acquire); head != tail; head++) {
+                mSlots[head & mMask].value()->~T();
+            }
+            ::operator delete(mSlots);
+        }
+
+        _ForbidCopy(SpscQueue);
+        _ForbidAssign(SpscQueue);
+
+        size_t capacity() const {
+            return mCapacity;
+        }
+
+        size_t size() const {
+            size_t tail = mTail.load(std::memory_order_acquire);
+            size_t head = mHead.load(std::memory_order_acquire);
+            return tail - head;
+        }
+
+        bool empty() const {
+            return this->size() == 0;
+        }
+
+        template<typename U>
+        bool tryPush(U&& value) {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            if (tail - mHeadCache >= mCapacity) {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+                if (tail - mHeadCache >= mCapacity)
+                    return false;
+            }
+            new(mSlots[tail & mMask].storage) T(std::forward<U>(value));
+            mTail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T& value) {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            if (head == mTailCache) {
+                mTailCache = mTail.load(std::memory_order_acquire);
+                if (head == mTailCache)
+                    return false;
+            }
+            T* slot = mSlots[head & mMask].value();
+            value = std::move(*slot);
+            slot->~T();
+            mHead.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// pushes as many of the items as fit, returns how many were pushed.
+        size_t pushBatch(const T* items, size_t count) {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            if (mCapacity - (tail - mHeadCache) < count) {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+            }
+            size_t space = mCapacity - (tail - mHeadCache);
+            size_t n = count < space ? count : space;
+            for (size_t i = 0; i < n; i++) {
+                new(mSlots[(tail + i) & mMask].storage) T(items[i]);
+            }
+            if (n > 0) {
+                mTail.store(tail + n, std::memory_order_release);
+            }
+            return n;
+        }
+
+        /// pops up to count items, returns how many were popped.
+        size_t popBatch(T* items, size_t count) {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            if (mTailCache - head < count) {
+                mTailCache = mTail.load(std::memory_order_acquire);
+            }
+            size_t available = mTailCache - head;
+            size_t n = count < available ? count : available;
+            for (size_t i = 0; i < n; i++) {
+                T* slot = mSlots[(head + i) & mMask].value();
+                items[i] = std::move(*slot);
+                slot->~T();
+            }
+            if (n > 0) {
+                mHead.store(head + n, std::memory_order_release);
+            }
+            return n;
+        }
+
+    private:
+        struct Slot {
+            alignas(T) u8_t storage[sizeof(T)];
+
+            T* value() {
+                return reinterpret_cast<T*>(storage);
+            }
+        };
+
+        const size_t mCapacity;
+        const size_t mMask;
+        Slot* const mSlots;
+
+        // consumer side
+        alignas(kCacheLineSize) std::atomic<size_t> mHead;
+        size_t mTailCache;
+
+        // producer side
+        alignas(kCacheLineSize) std::atomic<size_t> mTail;
+        size_t mHeadCache;
+
+        alignas(kCacheLineSize) u8_t mPadding[1];
+    };
+
+    /*
+    ============================================================================================
+    ==== MpscQueue
+    ==== Intrusive unbounded queue for many producers and one consumer (Vyukov).
+    ==== Items derive from MpscNode, the queue never allocates and never owns them.
+    ==== Pushing is one atomic exchange. tryPop() may see the queue empty for a moment while
+    ==== a producer is between its exchange and its link, the item shows up on a later call.
+    ============================================================================================
+    */
+    struct MpscNode {
+        std::atomic<MpscNode*> mpscNext{nullptr};
+    };
+
+    template<typename T>
+    class MpscQueue {
+    public:
+        using Value = T*;
+
+        MpscQueue()
+            : mHead(&mStub), mTail(&mStub), mStub() {
+        }
+
+        _ForbidCopy(MpscQueue);
+        _ForbidAssign(MpscQueue);
+
+        bool tryPush(T* item) {
+            MpscNode* node = static_cast<MpscNode*>(item);
+            node->mpscNext.store(nullptr, std::memory_order_relaxed);
+            this->link(node, node);
+            return true;
+        }
+
+        /// links the items in order and publishes them with one exchange.
+        size_t pushBatch(T* const* items, size_t count) {
+            if (count == 0)
+                return 0;
+            for (size_t i = 0; i < count; i++) {
+                MpscNode* node = static_cast<MpscNode*>(items[i]);
+                MpscNode* next = i + 1 < count ? static_cast<MpscNode*>(items[i + 1]) : nullptr;
+                node->mpscNext.store(next, std::memory_order_relaxed);
+            }
+            this->link(static_cast<MpscNode*>(items[0]), static_cast<MpscNode*>(items[count - 1]));
+            return count;
+        }
+
+        bool tryPop(T*& item) {
+            MpscNode* tail = mTail;
+            MpscNode* next = tail->mpscNext.load(std::memory_order_acquire);
+            if (tail == &mStub) {
+                if (next == nullptr)
+                    return false;
+                mTail = next;
+                tail = next;
+                next = next->mpscNext.load(std::memory_order_acquire);
+            }
+            if (next != nullptr) {
+                mTail = next;
+                item = static_cast<T*>(tail);
+                return true;
+            }
+            // tail is the last linked node, it can only go once the stub sits behind it.
+            if (tail != mHead.load(std::memory_order_acquire))
+                return false;
+            mStub.mpscNext.store(nullptr, std::memory_order_relaxed);
+            this->link(&mStub, &mStub);
+            next = tail->mpscNext.load(std::memory_order_acquire);
+            if (next == nullptr)
+                return false;
+            mTail = next;
+            item = static_cast<T*>(tail);
+            return true;
+        }
+
+        size_t popBatch(T** items, size_t count) {
+            size_t n = 0;
+            while (n < count && this->tryPop(items[n])) {
+                n++;
+            }
+            return n;
+        }
+
+        bool empty() const {
+            MpscNode* tail = mTail;
+            return tail == &mStub && tail->mpscNext.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        void link(MpscNode* first, MpscNode* last) {
+            MpscNode* prev = mHead.exchange(last, std::memory_order_acq_rel);
+            prev->mpscNext.store(first, std::memory_order_release);
+        }
+
+        // producers
+        alignas(kCacheLineSize) std::atomic<MpscNode*> mHead;
+        // consumer
+        alignas(kCacheLineSize) MpscNode* mTail;
+        MpscNode mStub;
+    };
+
+    /*
+    ============================================================================================
+    ==== MpmcQueue
+    ==== Bounded queue for many producers and consumers (Vyukov). Every cell carries a sequence
+    ==== number that tells producers and consumers whose turn it is, so a push or pop is one
+    ==== CAS on the shared position plus one release store on the cell.
+    ============================================================================================
+    */
+    template<typename T>
+    class MpmcQueue {
+    public:
+        using Value = T;
+
+        explicit MpmcQueue(size_t capacity = 1024)
+            : mCapacity(lockfree_capacity(capacity)), mMask(mCapacity - 1)
+            , mCells(static_cast<Cell*>(::operator new(sizeof(Cell) * mCapacity)))
+            , mEnqueuePos(0), mDequeuePos(0) {
+            for (size_t i = 0; i < mCapacity; i++) {
+                new(&mCells[i].sequence) std::atomic<size_t>(i);
+            }
+        }
+
+        ~MpmcQueue() {
+            size_t enqueue = mEnqueuePos.load(std::memory_order_acquire);
+            for (size_t pos = mDequeuePos.load(std::memory_order_acquire); pos != enqueue; pos++) {
+                mCells[pos & mMask].value()->~T();
+            }
+            for (size_t i = 0; i < mCapacity; i++) {
+                mCells[i].sequence.~atomic();
+            }
+            ::operator delete(mCells);
+        }
+
+        _ForbidCopy(MpmcQueue);
+        _ForbidAssign(MpmcQueue);
+
+        size_t capacity() const {
+            return mCapacity;
+        }
+
+        size_t size() const {
+            size_t enqueue = mEnqueuePos.load(std::memory_order_acquire);
+            size_t dequeue = mDequeuePos.load(std::memory_order_acquire);
+            return enqueue > dequeue ? enqueue - dequeue : 0;
+        }
+
+        bool empty() const {
+            return this->size() == 0;
+        }
+
+        template<typename U>
+        bool tryPush(U&& value) {
+            Cell* cell = nullptr;
+            size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                cell = &mCells[pos & mMask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+                if (diff == 0) {
+                    if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = mEnqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+            new(cell->storage) T(std::forward<U>(value));
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T& value) {
+            Cell* cell = nullptr;
+            size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+            while (true) {
+                cell = &mCells[pos & mMask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+                if (diff == 0) {
+                    if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = mDequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+            T* slot = cell->value();
+            value = std::move(*slot);
+            slot->~T();
+            cell->sequence.store(pos + mMask + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t pushBatch(const T* items, size_t count) {
+            size_t n = 0;
+            while (n < count && this->tryPush(items[n])) {
+                n++;
+            }
+            return n;
+        }
+
+        size_t popBatch(T* items, size_t count) {
+            size_t n = 0;
+            while (n < count && this->tryPop(items[n])) {
+                n++;
+            }
+            return n;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            alignas(T) u8_t storage[sizeof(T)];
+
+            T* value() {
+                return reinterpret_cast<T*>(storage);
+            }
+        };
+
+        const size_t mCapacity;
+        const size_t mMask;
+        Cell* const mCells;
+
+        alignas(kCacheLineSize) std::atomic<size_t> mEnqueuePos;
+        alignas(kCacheLineSize) std::atomic<size_t> mDequeuePos;
+        alignas(kCacheLineSize) u8_t mPadding[1];
+    };
+
+    /*
+    ============================================================================================
+    ==== BlockingQueue
+    ==== Wraps any of the queues above. push() waits while the queue is full and pop() while
+    ==== it is empty: both spin for a moment, then sleep. The other side only takes the lock
+    ==== when somebody is asleep. close() wakes everyone up, pop() keeps draining until empty.
+    ============================================================================================
+    */
+    template<typename Queue>
+    class BlockingQueue {
+    public:
+        using Value = typename Queue::Value;
+
+        static const u32_t kSpinCount = 64;
+
+        template<typename... Args>
+        explicit BlockingQueue(Args&& ... args)
+            : mQueue(std::forward<Args>(args)...), mMutex(), mNotEmpty(), mNotFull()
+            , mPopWaiters(0), mPushWaiters(0), mClosed(false) {
+        }
+
+        _ForbidCopy(BlockingQueue);
+        _ForbidAssign(BlockingQueue);
+
+        Queue& queue() {
+            return mQueue;
+        }
+
+        bool isClosed() const {
+            return mClosed.load(std::memory_order_acquire);
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mClosed.store(true, std::memory_order_release);
+            }
+            mNotEmpty.notify_all();
+            mNotFull.notify_all();
+        }
+
+        bool tryPush(Value value) {
+            if (this->isClosed() || !mQueue.tryPush(std::move(value)))
+                return false;
+            this->wake(mPopWaiters, mNotEmpty);
+            return true;
+        }
+
+        bool tryPop(Value& value) {
+            if (!mQueue.tryPop(value))
+                return false;
+            this->wake(mPushWaiters, mNotFull);
+            return true;
+        }
+
+        /// false when the queue has been closed.
+        /// tryPush() only consumes the value when it succeeds, so it can be retried.
+        bool push(Value value) {
+            for (u32_t spin = 0; spin < kSpinCount; spin++) {
+                if (this->isClosed())
+                    return false;
+                if (mQueue.tryPush(std::move(value))) {
+                    this->wake(mPopWaiters, mNotEmpty);
+                    return true;
+                }
+                std::this_thread::yield();
+            }
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mPushWaiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool pushed = false;
+            while (!this->isClosed()) {
+                if (mQueue.tryPush(std::move(value))) {
+                    pushed = true;
+                    break;
+                }
+                mNotFull.wait(lock);
+            }
+            mPushWaiters.fetch_sub(1, std::memory_order_relaxed);
+            lock.unlock();
+
+            if (pushed) {
+                this->wake(mPopWaiters, mNotEmpty);
+            }
+            return pushed;
+        }
+
+        /// false when the queue has been closed and drained.
+        bool pop(Value& value) {
+            for (u32_t spin = 0; spin < kSpinCount; spin++) {
+                if (mQueue.tryPop(value)) {
+                    this->wake(mPushWaiters, mNotFull);
+                    return true;
+                }
+                if (this->isClosed())
+                    break;
+                std::this_thread::yield();
+            }
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mPopWaiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool popped = false;
+            while (true) {
+                if (mQueue.tryPop(value)) {
+                    popped = true;
+                    break;
+                }
+                if (this->isClosed())
+                    break;
+                mNotEmpty.wait(lock);
+            }
+            mPopWaiters.fetch_sub(1, std::memory_order_relaxed);
+            lock.unlock();
+
+            if (popped) {
+                this->wake(mPushWaiters, mNotFull);
+            }
+            return popped;
+        }
+
+        size_t pushBatch(const Value* items, size_t count) {
+            if (this->isClosed())
+                return 0;
+            size_t n = mQueue.pushBatch(items, count);
+            if (n > 0) {
+                this->wake(mPopWaiters, mNotEmpty, n > 1);
+            }
+            return n;
+        }
+
+        size_t popBatch(Value* items, size_t count) {
+            size_t n = mQueue.popBatch(items, count);
+            if (n > 0) {
+                this->wake(mPushWaiters, mNotFull, n > 1);
+            }
+            return n;
+        }
+
+    private:
+        void wake(std::atomic<u32_t>& waiters, std::condition_variable& cond, bool all = false) {
+            // pairs with the fence after a sleeper registers itself.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters.load(std::memory_order_relaxed) == 0)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+            }
+            if (all) {
+                cond.notify_all();
+            }
+            else {
+                cond.notify_one();
+            }
+        }
+
+        Queue mQueue;
+        std::mutex mMutex;
+        std::condition_variable mNotEmpty;
+        std::condition_variable mNotFull;
+        std::atomic<u32_t> mPopWaiters;
+        std::atomic<u32_t> mPushWaiters;
+        std::atomic<bool> mClosed;
+    };
+
+}
+
+#endif//_EOKAS_BASE_LOCKFREE_H_
@@ -86,30 +86,54 @@ namespace eokas {
     }
     
     void Logger::info(const char* fmt, ...) {
-        String message;
-        _FormatVA(message, fmt);
-        this->message(LogLevel::Verbose, message);
+        va_list ap;
+        va_start(ap, fmt);
+        this->printVA(LogLevel::Verbose, fmt, ap);
+        va_end(ap);
     }
     
     void Logger::warning(const char* fmt, ...) {
-        String message;
-        _FormatVA(message, fmt);
-        this->message(LogLevel::Warning, message);
+        va_list ap;
+        va_start(ap, fmt);
+        this->printVA(LogLevel::Warning, fmt, ap);
+        va_end(ap);
     }
     
     void Logger::error(const char* fmt, ...) {
-        String message;
-        _FormatVA(message, fmt);
-        this->message(LogLevel::Error, message);
+        va_list ap;
+        va_start(ap, fmt);
+        this->printVA(LogLevel::Error, fmt, ap);
+        va_end(ap);
     }
     
     void Logger::message(LogLevel level, const String& message) {
+        this->write(level, message.view());
+    }
+    
+    void Logger::printVA(LogLevel level, const char* fmt, va_list ap) {
+        if (!mFile.is_open())
+            return;
+        char buffer[kLineSize];
+        va_list copy;
+        va_copy(copy, ap);
+        i32_t size = vsnprintf(buffer, sizeof(buffer), fmt, copy);
+        va_end(copy);
+        if (size < 0)
+            return;
+        if ((size_t) size < sizeof(buffer)) {
+            this->write(level, StringView(buffer, (size_t) size));
+        } else {
+            this->write(level, String::formatVA(fmt, ap));
+        }
+    }
+    
+    void Logger::write(LogLevel level, const StringView& message) {
         if (!mFile.is_open())
             return;
         if (this->callback.hasHandler()) {
             LogSignalMessage log;
             log.level = level;
-            log.message = message;
+            log.message = String(message);
             this->callback(log);
         }
         const char* head = nullptr;
@@ -118,6 +142,8 @@ namespace eokas {
         else if (level == LogLevel::Warning) head = "<span class='Warning'>";
         else if (level == LogLevel::Error) head = "<span class='Error'>";
         const char* tail = "</span></br>";
-        mFile << head << message.cstr() << tail << std::endl;
+        mFile << head;
+        mFile.write(message.data(), (std::streamsize) message.length());
+        mFile << tail << std::endl;
     }
 }
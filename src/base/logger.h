@@ -4,6 +4,7 @@
 
 #include "./header.h"
 #include "./string.h"
+#include "./format.h"
 #include "./signal.h"
 #include <fstream>
 
@@ -13,7 +14,18 @@ namespace eokas {
         Verbose, Notice, Warning, Error
     };
     
+    /*
+    ============================================================================================
+    ==== Logger
+    ==== info(), warning() and error() take a printf format or a _Format("...") literal with
+    ==== {} fields, which is checked against the arguments at compile time. Lines up to
+    ==== kLineSize chars are formatted on the stack.
+    ============================================================================================
+    */
     class Logger {
+    public:
+        static const size_t kLineSize = 512;
+
     public:
         static void push(const String& name);
         static void pop();
@@ -30,6 +42,21 @@ namespace eokas {
         void warning(const char* fmt, ...);
         void error(const char* fmt, ...);
         void message(LogLevel level, const String& message);
+
+        template<typename F, typename... Args, typename = typename std::enable_if<std::is_base_of<FormatLiteral, F>::value>::type>
+        void info(const F& fmt, const Args& ... args) {
+            this->print(LogLevel::Verbose, fmt, args...);
+        }
+
+        template<typename F, typename... Args, typename = typename std::enable_if<std::is_base_of<FormatLiteral, F>::value>::type>
+        void warning(const F& fmt, const Args& ... args) {
+            this->print(LogLevel::Warning, fmt, args...);
+        }
+
+        template<typename F, typename... Args, typename = typename std::enable_if<std::is_base_of<FormatLiteral, F>::value>::type>
+        void error(const F& fmt, const Args& ... args) {
+            this->print(LogLevel::Error, fmt, args...);
+        }
     
     public:
         struct LogSignalMessage {
@@ -39,6 +66,22 @@ namespace eokas {
         Signal<LogSignalMessage&> callback;
     
     private:
+        template<typename F, typename... Args>
+        void print(LogLevel level, const F& fmt, const Args& ... args) {
+            if (!mFile.is_open())
+                return;
+            char buffer[kLineSize];
+            size_t size = Format::to(buffer, sizeof(buffer), fmt, args...);
+            if (size < sizeof(buffer)) {
+                this->write(level, StringView(buffer, size));
+            } else {
+                this->write(level, Format::string(fmt, args...));
+            }
+        }
+
+        void printVA(LogLevel level, const char* fmt, va_list ap);
+        void write(LogLevel level, const StringView& message);
+
         std::ofstream mFile;
     };
 
@@ -10,11 +10,23 @@
 #include "./random.h"
 #include "./time.h"
 #include "./signal.h"
+#include "./number.h"
+#include "./utf8.h"
 #include "./string.h"
+#include "./atom.h"
+#include "./format.h"
 #include "./stream.h"
+#include "./builder.h"
+#include "./rope.h"
+#include "./glob.h"
 #include "./hash.h"
 #include "./table.h"
 #include "./pool.h"
+#include "./lockfree.h"
+#include "./fiber.h"
+#include "./async.h"
+#include "./parallel.h"
+#include "./job.h"
 #include "./logger.h"
 #include "./dataset.h"
 #include "./hom.h"
@@ -24,7 +36,11 @@
 #include "./io.h"
 #include "./cli.h"
 #include "./timer.h"
+#include "./tracker.h"
 #include "./memory.h"
+#include "./bulk.h"
+#include "./arena.h"
+#include "./slab.h"
 #include "./os.h"
 #include "./dll.h"
 
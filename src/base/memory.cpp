@@ -1,16 +1,26 @@
 
 #include "./memory.h"
+#include "./bulk.h"
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
+#include <cstddef>
 #include <exception>
 #include <algorithm>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
 #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
 #include <windows.h>
+#include <malloc.h>
 #elif _EOKAS_OS == _EOKAS_OS_MACOS || _EOKAS_OS == _EOKAS_OS_IOS
 #include <sys/mman.h>
+#include <unistd.h>
 #else
 #include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 namespace eokas {
@@ -19,19 +29,83 @@ namespace eokas {
     ==== Memory Functions
     ============================================================================================
     */
-    void* MemoryUtility::alloc(size_t size)
+    /*
+    ==== Every block from MemoryUtility carries a header right below the pointer: the tag it is
+    ==== charged to, its size and the way back to the malloc'ed base.
+    */
+    struct MemoryHeader
     {
-        void* ptr = std::malloc(size);
-        if(ptr != nullptr)
+        u64_t size;
+        u32_t offset;
+        MemoryTag tag;
+        u8_t sampled;
+        u8_t alignShift;
+    };
+    
+    static const size_t kMemoryDefaultAlign = alignof(std::max_align_t);
+    
+    static MemoryHeader* memory_header(void* ptr)
+    {
+        return (MemoryHeader*)ptr - 1;
+    }
+    
+    static void memory_attach(u8_t* ptr, size_t size, u8_t* base, size_t alignment)
+    {
+        MemoryHeader* header = memory_header(ptr);
+        header->size = size;
+        header->offset = (u32_t)(ptr - base);
+        header->tag = MemoryTracker::current();
+        header->alignShift = 0;
+        while(((size_t)1 << header->alignShift) < alignment)
+        {
+            header->alignShift += 1;
+        }
+        header->sampled = MemoryTracker::sample(header->tag, ptr, size) ? 1 : 0;
+        MemoryTracker::add(header->tag, size, 1);
+    }
+    
+    static void memory_detach(void* ptr)
+    {
+        MemoryHeader* header = memory_header(ptr);
+        MemoryTracker::remove(header->tag, (size_t)header->size, 1);
+        if(header->sampled)
+        {
+            MemoryTracker::unsample(ptr);
+        }
+    }
+    
+    static void* memory_alloc(size_t size, size_t alignment, bool zero)
+    {
+        if(alignment < kMemoryDefaultAlign)
+        {
+            alignment = kMemoryDefaultAlign;
+        }
+        if((alignment & (alignment - 1)) != 0)
+            return nullptr;
+        size_t extra = sizeof(MemoryHeader) + (alignment > kMemoryDefaultAlign ? alignment - 1 : 0);
+        if(size > (size_t)-1 - extra)
+            return nullptr;
+        
+        u8_t* base = (u8_t*)std::malloc(size + extra);
+        if(base == nullptr)
+            return nullptr;
+        u8_t* ptr = (u8_t*)(((size_t)base + sizeof(MemoryHeader) + alignment - 1) & ~(alignment - 1));
+        if(zero)
         {
             std::memset(ptr, 0, size);
         }
+        memory_attach(ptr, size, base, alignment);
         return ptr;
     }
     
+    void* MemoryUtility::alloc(size_t size)
+    {
+        return memory_alloc(size, 0, true);
+    }
+    
     void* MemoryUtility::alloc(size_t size, void* data)
     {
-        void* ptr = std::malloc(size);
+        void* ptr = memory_alloc(size, 0, false);
         if(ptr != nullptr && data != nullptr)
         {
             std::memcpy(ptr, data, size);
@@ -41,10 +115,9 @@ namespace eokas {
     
     void* MemoryUtility::alloc(size_t size, void* data, size_t leng)
     {
-        void* ptr = std::malloc(size);
+        void* ptr = memory_alloc(size, 0, true);
         if(ptr != nullptr)
         {
-            std::memset(ptr, 0, size);
             if(data != nullptr)
             {
                 size = size < leng ? size : leng;
@@ -56,25 +129,54 @@ namespace eokas {
     
     void* MemoryUtility::realloc(void* ptr, size_t size)
     {
-        return std::realloc(ptr, size);
+        if(ptr == nullptr)
+            return memory_alloc(size, 0, false);
+        
+        MemoryHeader header = *memory_header(ptr);
+        size_t alignment = (size_t)1 << header.alignShift;
+        if(alignment > kMemoryDefaultAlign)
+        {
+            void* block = memory_alloc(size, alignment, false);
+            if(block == nullptr)
+                return nullptr;
+            std::memcpy(block, ptr, size < header.size ? size : (size_t)header.size);
+            MemoryUtility::free(ptr);
+            return block;
+        }
+        
+        if(size > (size_t)-1 - sizeof(MemoryHeader))
+            return nullptr;
+        u8_t* base = (u8_t*)ptr - header.offset;
+        u8_t* block = (u8_t*)std::realloc(base, size + sizeof(MemoryHeader));
+        if(block == nullptr)
+            return nullptr;
+        // the old block is gone, settle its accounts from the copy of its header.
+        MemoryTracker::remove(header.tag, (size_t)header.size, 1);
+        if(header.sampled)
+        {
+            MemoryTracker::unsample(ptr);
+        }
+        u8_t* moved = block + sizeof(MemoryHeader);
+        memory_attach(moved, size, block, alignment);
+        return moved;
     }
     
     void MemoryUtility::free(void* ptr)
     {
         if(ptr == nullptr)
             return;
-        std::free(ptr);
-        ptr = nullptr;
+        memory_detach(ptr);
+        std::free((u8_t*)ptr - memory_header(ptr)->offset);
     }
     
     void MemoryUtility::clear(void* ptr, size_t size, u8_t value)
     {
-        std::memset(ptr, value, size);
+        MemoryBulk::fill(ptr, value, size);
     }
     
     void MemoryUtility::copy(void* dst, void* src, size_t size)
     {
-        std::memcpy(dst, src, size);
+        MemoryBulk::copy(dst, src, size);
     }
     
     int MemoryUtility::compare(void* ptr1, void* ptr2, size_t size)
@@ -82,6 +184,64 @@ namespace eokas {
         return std::memcmp(ptr1, ptr2, size);
     }
     
+    void* MemoryUtility::alloc_aligned(size_t size, size_t alignment, bool zero)
+    {
+        return memory_alloc(size, alignment, zero);
+    }
+    
+    void MemoryUtility::free_aligned(void* ptr)
+    {
+        MemoryUtility::free(ptr);
+    }
+    
+    /*
+    ==== Mappings from alloc_v have no room for a header, they are looked up by address.
+    */
+    struct MemoryMappings
+    {
+        struct Mapping
+        {
+            MemoryTag tag;
+            size_t size;
+        };
+        
+        std::mutex mutex;
+        std::unordered_map<void*, Mapping> mappings;
+        
+        static MemoryMappings& instance()
+        {
+            // leaked on purpose: mappings may be released during static destruction.
+            static MemoryMappings* sInstance = new MemoryMappings();
+            return *sInstance;
+        }
+    };
+    
+    static void memory_track_v(void* ptr, size_t size)
+    {
+        MemoryTag tag = MemoryTracker::current();
+        MemoryMappings& mappings = MemoryMappings::instance();
+        {
+            std::lock_guard<std::mutex> lock(mappings.mutex);
+            mappings.mappings[ptr] = MemoryMappings::Mapping{tag, size};
+        }
+        MemoryTracker::add(tag, size, 1);
+    }
+    
+    static void memory_untrack_v(void* ptr)
+    {
+        MemoryMappings::Mapping mapping = {MemoryTracker::kUntagged, 0};
+        MemoryMappings& mappings = MemoryMappings::instance();
+        {
+            std::lock_guard<std::mutex> lock(mappings.mutex);
+            auto iter = mappings.mappings.find(ptr);
+            if(iter == mappings.mappings.end())
+                return;
+            mapping = iter->second;
+            mappings.mappings.erase(iter);
+        }
+        MemoryTracker::remove(mapping.tag, mapping.size, 1);
+    }
+    
 #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
     
     static u32_t encode_prot(DWORD prot)
@@ -99,17 +259,34 @@ namespace eokas {
         return 0;
     }
     
-    void* MemoryUtility::alloc_v(size_t size, u32_t prot)
+    void* MemoryUtility::alloc_v(size_t size, u32_t prot, bool huge)
     {
         DWORD _type = MEM_RESERVE | MEM_COMMIT | MEM_TOP_DOWN;
         DWORD _prot = encode_prot(prot);
+        size_t hugeSize = huge ? huge_page_size() : 0;
+        if(hugeSize > 0 && size % hugeSize == 0)
+        {
+            // needs SeLockMemoryPrivilege, fall back to small pages without it.
+            void* ptr = VirtualAlloc(NULL, size, _type | MEM_LARGE_PAGES, _prot);
+            if(ptr != NULL)
+            {
+                memory_track_v(ptr, size);
+                return ptr;
+            }
+        }
         void* ptr = VirtualAlloc(NULL, size, _type, _prot);
+        if(ptr != NULL)
+        {
+            memory_track_v(ptr, size);
+        }
         return ptr;
     }
     
     void MemoryUtility::free_v(void* ptr, size_t size)
     {
-        VirtualFree(ptr, size, MEM_RELEASE);
+        memory_untrack_v(ptr);
+        // MEM_RELEASE takes the whole reservation and wants a size of 0.
+        VirtualFree(ptr, 0, MEM_RELEASE);
     }
     
     u32_t MemoryUtility::prot_v(void* ptr, size_t size, u32_t prot)
@@ -120,19 +297,79 @@ namespace eokas {
         return ret;
     }
     
+    static DWORD decode_prot(u32_t prot)
+    {
+        switch (prot)
+        {
+            case 1: return PAGE_READONLY;
+            case 2: return PAGE_READWRITE;
+            case 3: return PAGE_READWRITE;
+            case 4: return PAGE_EXECUTE;
+            case 5: return PAGE_EXECUTE_READ;
+            case 6: return PAGE_EXECUTE_READWRITE;
+            case 7: return PAGE_EXECUTE_READWRITE;
+        }
+        return PAGE_NOACCESS;
+    }
+    
+    void* MemoryUtility::reserve_v(size_t size)
+    {
+        return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+    }
+    
+    bool MemoryUtility::commit_v(void* ptr, size_t size, u32_t prot)
+    {
+        return VirtualAlloc(ptr, size, MEM_COMMIT, decode_prot(prot)) != NULL;
+    }
+    
+    bool MemoryUtility::decommit_v(void* ptr, size_t size)
+    {
+        return VirtualFree(ptr, size, MEM_DECOMMIT) != FALSE;
+    }
+    
+    size_t MemoryUtility::page_size()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+    }
+    
+    size_t MemoryUtility::huge_page_size()
+    {
+        return GetLargePageMinimum();
+    }
+    
 #else
     
-    void* MemoryUtility::alloc_v(size_t size, u32_t prot)
+    void* MemoryUtility::alloc_v(size_t size, u32_t prot, bool huge)
     {
+#if defined(MAP_HUGETLB)
+        // hugetlb mappings are unmapped in whole huge pages, so only take exact multiples.
+        size_t hugeSize = huge ? huge_page_size() : 0;
+        if (hugeSize > 0 && size % hugeSize == 0) {
+            void *p = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                memory_track_v(p, size);
+                return p;
+            }
+        }
+#endif
         void *p = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
         if (p == MAP_FAILED) {
             return nullptr;
         }
+#if defined(MADV_HUGEPAGE)
+        if (huge) {
+            madvise(p, size, MADV_HUGEPAGE);
+        }
+#endif
+        memory_track_v(p, size);
         return p;
     }
     
     void MemoryUtility::free_v(void* ptr, size_t size)
     {
+        memory_untrack_v(ptr);
         munmap(ptr, size);
     }
     
@@ -141,6 +378,57 @@ namespace eokas {
         return mprotect(ptr, size, prot);
     }
     
+    void* MemoryUtility::reserve_v(size_t size)
+    {
+        void *p = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+        return p;
+    }
+    
+    bool MemoryUtility::commit_v(void* ptr, size_t size, u32_t prot)
+    {
+        return mprotect(ptr, size, prot) == 0;
+    }
+    
+    bool MemoryUtility::decommit_v(void* ptr, size_t size)
+    {
+        // give the physical pages back, keep the address range reserved.
+        madvise(ptr, size, MADV_DONTNEED);
+        return mprotect(ptr, size, PROT_NONE) == 0;
+    }
+    
+    size_t MemoryUtility::page_size()
+    {
+        return (size_t)sysconf(_SC_PAGESIZE);
+    }
+    
+    size_t MemoryUtility::huge_page_size()
+    {
+#if _EOKAS_OS == _EOKAS_OS_MACOS || _EOKAS_OS == _EOKAS_OS_IOS
+        return 0;
+#else
+        static size_t sHugePageSize = []() -> size_t {
+            size_t size = 0;
+            FILE* file = fopen("/proc/meminfo", "r");
+            if (file == nullptr)
+                return 0;
+            char line[128];
+            while (fgets(line, sizeof(line), file) != nullptr) {
+                unsigned long kb = 0;
+                if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+                    size = (size_t)kb * 1024;
+                    break;
+                }
+            }
+            fclose(file);
+            return size;
+        }();
+        return sHugePageSize;
+#endif
+    }
+    
 #endif
     
     /*
@@ -152,16 +440,25 @@ namespace eokas {
         :mData(nullptr)
         ,mSize(0)
         ,mIsNewm(false)
+        ,mStorage(0)
+        ,mAlignment(0)
+        ,mFlags(eMemoryFlags_None)
     {}
     
     MemoryBuffer::MemoryBuffer(MemoryBuffer&& temp)
         :mData(nullptr)
         ,mSize(0)
         ,mIsNewm(false)
+        ,mStorage(0)
+        ,mAlignment(0)
+        ,mFlags(eMemoryFlags_None)
     {
         mData = temp.mData;
         mSize = temp.mSize;
         mIsNewm = temp.mIsNewm;
+        mStorage = temp.mStorage;
+        mAlignment = temp.mAlignment;
+        mFlags = temp.mFlags;
         temp.mData = nullptr;
         temp.mSize = 0;
         temp.mIsNewm = false;
@@ -169,16 +466,27 @@ namespace eokas {
     
     MemoryBuffer::MemoryBuffer(const MemoryBuffer& other)
         :mData(nullptr)
-        ,mSize(other.mSize)
+        ,mSize(0)
         ,mIsNewm(true)
+        ,mStorage(0)
+        ,mAlignment(other.mAlignment)
+        ,mFlags(other.mFlags | eMemoryFlags_NoZero)
     {
-        mData = MemoryUtility::alloc(other.mSize, other.mData);
+        this->allocate(other.mSize);
+        mFlags = other.mFlags;
+        if(mData != nullptr && other.mData != nullptr)
+        {
+            MemoryUtility::copy(mData, other.mData, mSize);
+        }
     }
     
     MemoryBuffer::MemoryBuffer(size_t size)
         :mData(nullptr)
         ,mSize(size)
         ,mIsNewm(true)
+        ,mStorage(0)
+        ,mAlignment(0)
+        ,mFlags(eMemoryFlags_None)
     {
         mData = MemoryUtility::alloc(mSize);
     }
@@ -187,6 +495,9 @@ namespace eokas {
         :mData(nullptr)
         ,mSize(size)
         ,mIsNewm(true)
+        ,mStorage(0)
+        ,mAlignment(0)
+        ,mFlags(eMemoryFlags_None)
     {
         mData = MemoryUtility::alloc(size, data, leng);
     }
@@ -195,6 +506,9 @@ namespace eokas {
         :mData(data)
         ,mSize(size)
         ,mIsNewm(newm)
+        ,mStorage(0)
+        ,mAlignment(0)
+        ,mFlags(eMemoryFlags_None)
     {
         if(newm)
         {
@@ -202,15 +516,20 @@ namespace eokas {
         }
     }
     
+    MemoryBuffer::MemoryBuffer(size_t size, size_t alignment, MemoryFlags flags)
+        :mData(nullptr)
+        ,mSize(0)
+        ,mIsNewm(true)
+        ,mStorage(0)
+        ,mAlignment(alignment)
+        ,mFlags(flags)
+    {
+        this->allocate(size);
+    }
+    
     MemoryBuffer::~MemoryBuffer()
     {
-        if(mIsNewm)
-        {
-            MemoryUtility::free(mData);
-        }
-        mData = nullptr;
-        mSize = 0;
-        mIsNewm = false;
+        this->release();
     }
     
     MemoryBuffer& MemoryBuffer::operator=(MemoryBuffer&& temp)
@@ -219,9 +538,13 @@ namespace eokas {
             return *this;
         // mIsNewm must be assigned
         // the ownership of data is changed.
+        this->release();
         mData = temp.mData;
         mSize = temp.mSize;
         mIsNewm = temp.mIsNewm;
+        mStorage = temp.mStorage;
+        mAlignment = temp.mAlignment;
+        mFlags = temp.mFlags;
         temp.mData = nullptr;
         temp.mSize = 0;
         temp.mIsNewm = false;
@@ -232,11 +555,16 @@ namespace eokas {
     {
         if(this == &other)
             return *this;
-        // mIsNewm should not be assigned
-        // the ownership of data is not changed.
-        MemoryUtility::free(mData);
-        mData = MemoryUtility::alloc(other.mSize, other.mData);
-        mSize = other.mSize;
+        // the copy is always owned, whatever this buffer held before.
+        this->release();
+        mAlignment = other.mAlignment;
+        mFlags = other.mFlags | eMemoryFlags_NoZero;
+        this->allocate(other.mSize);
+        mFlags = other.mFlags;
+        if(mData != nullptr && other.mData != nullptr)
+        {
+            MemoryUtility::copy(mData, other.mData, mSize);
+        }
         return *this;
     }
     
@@ -250,6 +578,16 @@ namespace eokas {
         return mData;
     }
     
+    size_t MemoryBuffer::alignment() const
+    {
+        return mAlignment;
+    }
+    
+    MemoryFlags MemoryBuffer::flags() const
+    {
+        return mFlags;
+    }
+    
     void MemoryBuffer::fill(void* data)
     {
         if(mData == nullptr)
@@ -287,25 +625,275 @@ namespace eokas {
     {
         if(!mIsNewm)
             return false;
-        mData = MemoryUtility::realloc(mData, mSize + size);
-        mSize = mSize + size;
+        if(mStorage == 0)
+        {
+            mData = MemoryUtility::realloc(mData, mSize + size);
+            mSize = mSize + size;
+            return true;
+        }
+        
+        // aligned and virtual blocks cannot grow in place.
+        MemoryBuffer bigger(mSize + size, mAlignment, mFlags | eMemoryFlags_NoZero);
+        if(bigger.data() == nullptr)
+            return false;
+        MemoryUtility::copy(bigger.mData, mData, mSize);
+        *this = std::move(bigger);
         return true;
     }
     
+    void MemoryBuffer::allocate(size_t size)
+    {
+        bool zero = (mFlags & eMemoryFlags_NoZero) == 0;
+        size_t hugeSize = (mFlags & eMemoryFlags_HugePages) != 0 ? MemoryUtility::huge_page_size() : 0;
+        if(hugeSize > 0 && size >= hugeSize)
+        {
+            // whole pages, so the huge path can map the block exactly.
+            mData = MemoryUtility::alloc_v((size + hugeSize - 1) / hugeSize * hugeSize, 3, true);
+            mStorage = 2;
+        }
+        else if(mAlignment > 0)
+        {
+            mData = MemoryUtility::alloc_aligned(size, mAlignment, zero);
+            mStorage = 1;
+        }
+        else
+        {
+            mData = MemoryUtility::alloc_aligned(size, 0, zero);
+            mStorage = 0;
+        }
+        mSize = mData != nullptr ? size : 0;
+        mIsNewm = true;
+    }
+    
+    void MemoryBuffer::release()
+    {
+        if(mIsNewm && mData != nullptr)
+        {
+            if(mStorage == 2)
+            {
+                size_t hugeSize = MemoryUtility::huge_page_size();
+                MemoryUtility::free_v(mData, (mSize + hugeSize - 1) / hugeSize * hugeSize);
+            }
+            else if(mStorage == 1)
+            {
+                MemoryUtility::free_aligned(mData);
+            }
+            else
+            {
+                MemoryUtility::free(mData);
+            }
+        }
+        mData = nullptr;
+        mSize = 0;
+        mIsNewm = false;
+        mStorage = 0;
+    }
+    
+    /*
+    ============================================================================================
+    ==== SharedBuffer
+    ============================================================================================
+    */
+    struct SharedBuffer::Block
+    {
+        std::atomic<u32_t> refs;
+        size_t size;
+        
+        u8_t* bytes()
+        {
+            return (u8_t*)this + kHeadSize;
+        }
+        
+        static const size_t kHeadSize = (sizeof(std::atomic<u32_t>) + sizeof(size_t) + 15) / 16 * 16;
+    };
+    
+    SharedBuffer::Block* SharedBuffer::create(size_t size, bool zero)
+    {
+        void* ptr = MemoryUtility::alloc_aligned(Block::kHeadSize + size, 0, false);
+        if(ptr == nullptr)
+            throw std::bad_alloc();
+        Block* block = new(ptr) Block();
+        block->refs.store(1, std::memory_order_relaxed);
+        block->size = size;
+        if(zero)
+        {
+            std::memset(block->bytes(), 0, size);
+        }
+        return block;
+    }
+    
+    void SharedBuffer::retain(Block* block)
+    {
+        if(block != nullptr)
+        {
+            block->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    void SharedBuffer::release(Block* block)
+    {
+        if(block != nullptr && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            block->~Block();
+            MemoryUtility::free(block);
+        }
+    }
+    
+    SharedBuffer::SharedBuffer()
+        :mBlock(nullptr)
+        ,mData(nullptr)
+        ,mSize(0)
+    {}
+    
+    SharedBuffer::SharedBuffer(size_t size, MemoryFlags flags)
+        :mBlock(nullptr)
+        ,mData(nullptr)
+        ,mSize(size)
+    {
+        mBlock = create(size, (flags & eMemoryFlags_NoZero) == 0);
+        mData = mBlock->bytes();
+    }
+    
+    SharedBuffer::SharedBuffer(const void* data, size_t size)
+        :mBlock(nullptr)
+        ,mData(nullptr)
+        ,mSize(size)
+    {
+        mBlock = create(size, data == nullptr);
+        mData = mBlock->bytes();
+        if(data != nullptr)
+        {
+            std::memcpy(mData, data, size);
+        }
+    }
+    
+    SharedBuffer::SharedBuffer(const SharedBuffer& other)
+        :mBlock(other.mBlock)
+        ,mData(other.mData)
+        ,mSize(other.mSize)
+    {
+        retain(mBlock);
+    }
+    
+    SharedBuffer::SharedBuffer(SharedBuffer&& temp)
+        :mBlock(temp.mBlock)
+        ,mData(temp.mData)
+        ,mSize(temp.mSize)
+    {
+        temp.mBlock = nullptr;
+        temp.mData = nullptr;
+        temp.mSize = 0;
+    }
+    
+    SharedBuffer::~SharedBuffer()
+    {
+        this->reset();
+    }
+    
+    SharedBuffer& SharedBuffer::operator=(const SharedBuffer& other)
+    {
+        if(this == &other)
+            return *this;
+        retain(other.mBlock);
+        release(mBlock);
+        mBlock = other.mBlock;
+        mData = other.mData;
+        mSize = other.mSize;
+        return *this;
+    }
+    
+    SharedBuffer& SharedBuffer::operator=(SharedBuffer&& temp)
+    {
+        if(this == &temp)
+            return *this;
+        release(mBlock);
+        mBlock = temp.mBlock;
+        mData = temp.mData;
+        mSize = temp.mSize;
+        temp.mBlock = nullptr;
+        temp.mData = nullptr;
+        temp.mSize = 0;
+        return *this;
+    }
+    
+    SharedBuffer::operator bool() const
+    {
+        return mBlock != nullptr;
+    }
+    
+    const u8_t* SharedBuffer::data() const
+    {
+        return mData;
+    }
+    
+    size_t SharedBuffer::size() const
+    {
+        return mSize;
+    }
+    
+    bool SharedBuffer::empty() const
+    {
+        return mSize == 0;
+    }
+    
+    bool SharedBuffer::unique() const
+    {
+        return mBlock != nullptr && mBlock->refs.load(std::memory_order_acquire) == 1;
+    }
+    
+    SharedBuffer SharedBuffer::slice(size_t offset, size_t length) const
+    {
+        SharedBuffer view;
+        if(mBlock == nullptr)
+            return view;
+        offset = offset < mSize ? offset : mSize;
+        length = length < mSize - offset ? length : mSize - offset;
+        retain(mBlock);
+        view.mBlock = mBlock;
+        view.mData = mData + offset;
+        view.mSize = length;
+        return view;
+    }
+    
+    u8_t* SharedBuffer::mutableData()
+    {
+        if(mBlock == nullptr)
+            return nullptr;
+        if(!this->unique())
+        {
+            Block* block = create(mSize, false);
+            std::memcpy(block->bytes(), mData, mSize);
+            release(mBlock);
+            mBlock = block;
+            mData = block->bytes();
+        }
+        return mData;
+    }
+    
+    void SharedBuffer::reset()
+    {
+        release(mBlock);
+        mBlock = nullptr;
+        mData = nullptr;
+        mSize = 0;
+    }
+    
     /*
     ============================================================================================
     ==== MemoryStream
     ============================================================================================
     */
     MemoryStream::MemoryStream()
-        :mBuffer(new MemoryBuffer(1024))
+        :mShared()
+        ,mBuffer(new MemoryBuffer(1024))
         ,mIsNewm(true)
         ,mIsOpen(false)
         ,mPos(0)
     {}
     
     MemoryStream::MemoryStream(MemoryStream&& temp)
-        :mBuffer(nullptr)
+        :mShared(std::move(temp.mShared))
+        ,mBuffer(nullptr)
         ,mIsNewm(false)
         ,mIsOpen(false)
         ,mPos(0)
@@ -317,21 +905,42 @@ namespace eokas {
     }
     
     MemoryStream::MemoryStream(const MemoryStream& other)
-        :mBuffer(new MemoryBuffer(*other.mBuffer))
+        :mShared(other.mShared)
+        ,mBuffer(nullptr)
         ,mIsNewm(true)
         ,mIsOpen(false)
         ,mPos(0)
-    {}
+    {
+        // a shared stream is copied by sharing the block again.
+        if(mShared)
+        {
+            mBuffer = new MemoryBuffer((void*)mShared.data(), mShared.size(), false);
+        }
+        else
+        {
+            mBuffer = new MemoryBuffer(*other.mBuffer);
+        }
+    }
     
     MemoryStream::MemoryStream(MemoryBuffer* memoryBuffer)
-        :mBuffer(memoryBuffer)
+        :mShared()
+        ,mBuffer(memoryBuffer)
         ,mIsNewm(false)
         ,mIsOpen(false)
         ,mPos(0)
     {}
     
     MemoryStream::MemoryStream(void* data, size_t size)
-        :mBuffer(new MemoryBuffer(data, size, false))
+        :mShared()
+        ,mBuffer(new MemoryBuffer(data, size, false))
+        ,mIsNewm(true)
+        ,mIsOpen(false)
+        ,mPos(0)
+    {}
+    
+    MemoryStream::MemoryStream(const SharedBuffer& buffer)
+        :mShared(buffer)
+        ,mBuffer(new MemoryBuffer((void*)buffer.data(), buffer.size(), false))
         ,mIsNewm(true)
         ,mIsOpen(false)
         ,mPos(0)
@@ -417,6 +1026,8 @@ namespace eokas {
     {
         if(!mIsOpen)
             return 0;
+        if(mShared && !this->detach(mPos + size))
+            return 0;
     
         if(mPos + size > mBuffer->size())
         {
@@ -457,6 +1068,11 @@ namespace eokas {
         if (this == &temp)
             return *this;
         // mIsNewm must be assigned because of the ownership of buffer is changed.
+        if(mIsNewm)
+        {
+            delete mBuffer;
+        }
+        mShared = std::move(temp.mShared);
         mBuffer = temp.mBuffer;
         mIsNewm = temp.mIsNewm;
         mIsOpen = temp.mIsOpen;
@@ -474,6 +1090,7 @@ namespace eokas {
             return *this;
         // mIsNewm should not be assigned because of the ownership of buffer is not changed.
         (*mBuffer) = (*other.mBuffer);
+        mShared.reset();
         mIsOpen = other.mIsOpen;
         mPos = other.mPos;
         return *this;
@@ -484,4 +1101,297 @@ namespace eokas {
         return mBuffer->data();
     }
     
+    SharedBuffer MemoryStream::slice(size_t size)
+    {
+        if(!mIsOpen || mPos >= mBuffer->size())
+            return SharedBuffer();
+        size_t leng = mBuffer->size() - mPos;
+        leng = size < leng ? size : leng;
+        
+        SharedBuffer result;
+        if(mShared)
+        {
+            result = mShared.slice(mPos, leng);
+        }
+        else
+        {
+            result = SharedBuffer((u8_t*)mBuffer->data() + mPos, leng);
+        }
+        mPos += leng;
+        return result;
+    }
+    
+    bool MemoryStream::detach(size_t size)
+    {
+        if(size > mShared.size())
+        {
+            // about to grow: move into an owned buffer and stop sharing.
+            *mBuffer = MemoryBuffer((void*)mShared.data(), mShared.size(), true);
+            mShared.reset();
+            return mBuffer->data() != nullptr || size == 0;
+        }
+        u8_t* data = mShared.mutableData();
+        *mBuffer = MemoryBuffer(data, mShared.size(), false);
+        return true;
+    }
+    
+    /*
+    ============================================================================================
+    ==== SegmentedMemoryStream
+    ============================================================================================
+    */
+    SegmentedMemoryStream::SegmentedMemoryStream(size_t pageSize)
+        :mPageSize(pageSize > 0 ? pageSize : kDefaultPageSize)
+        ,mHead(nullptr)
+        ,mHeadCapacity(0)
+        ,mPages()
+        ,mSize(0)
+        ,mPos(0)
+        ,mIsOpen(false)
+    {}
+    
+    SegmentedMemoryStream::SegmentedMemoryStream(SegmentedMemoryStream&& temp)
+        :mPageSize(temp.mPageSize)
+        ,mHead(temp.mHead)
+        ,mHeadCapacity(temp.mHeadCapacity)
+        ,mPages(std::move(temp.mPages))
+        ,mSize(temp.mSize)
+        ,mPos(temp.mPos)
+        ,mIsOpen(temp.mIsOpen)
+    {
+        temp.mHead = nullptr;
+        temp.mHeadCapacity = 0;
+        temp.mPages.clear();
+        temp.mSize = 0;
+        temp.mPos = 0;
+        temp.mIsOpen = false;
+    }
+    
+    SegmentedMemoryStream::~SegmentedMemoryStream()
+    {
+        this->clear();
+        mIsOpen = false;
+    }
+    
+    bool SegmentedMemoryStream::open()
+    {
+        mIsOpen = true;
+        mPos = 0;
+        return mIsOpen;
+    }
+    
+    void SegmentedMemoryStream::close()
+    {
+        mIsOpen = false;
+        mPos = 0;
+    }
+    
+    bool SegmentedMemoryStream::isOpen() const
+    {
+        return mIsOpen;
+    }
+    
+    bool SegmentedMemoryStream::readable() const
+    {
+        return true;
+    }
+    
+    bool SegmentedMemoryStream::writable() const
+    {
+        return true;
+    }
+    
+    bool SegmentedMemoryStream::eos() const
+    {
+        return mPos >= mSize;
+    }
+    
+    size_t SegmentedMemoryStream::pos() const
+    {
+        return mPos;
+    }
+    
+    size_t SegmentedMemoryStream::size() const
+    {
+        return mSize;
+    }
+    
+    size_t SegmentedMemoryStream::read(void* data, size_t size)
+    {
+        if(!mIsOpen || mPos >= mSize)
+            return 0;
+        
+        size = std::min(size, mSize - mPos);
+        u8_t* dst = (u8_t*)data;
+        size_t done = 0;
+        while(done < size)
+        {
+            size_t avail = 0;
+            u8_t* src = this->locate(mPos, avail);
+            size_t leng = std::min(avail, size - done);
+            memcpy(dst + done, src, leng);
+            done += leng;
+            mPos += leng;
+        }
+        return done;
+    }
+    
+    size_t SegmentedMemoryStream::write(void* data, size_t size)
+    {
+        if(!mIsOpen)
+            return 0;
+        if(!this->reserve(mPos + size))
+            return 0;
+        
+        const u8_t* src = (const u8_t*)data;
+        size_t done = 0;
+        while(done < size)
+        {
+            size_t avail = 0;
+            u8_t* dst = this->locate(mPos, avail);
+            size_t leng = std::min(avail, size - done);
+            memcpy(dst, src + done, leng);
+            done += leng;
+            mPos += leng;
+        }
+        mSize = std::max(mSize, mPos);
+        return done;
+    }
+    
+    bool SegmentedMemoryStream::seek(int offset, int origin) // 0:beg, 1:cur, 2:end
+    {
+        if(!mIsOpen)
+            return false;
+        if(origin < 0 || origin > 2)
+            return false;
+        i64_t ori = (origin == 0) ? 0 : (origin == 1 ? (i64_t)mPos : (i64_t)mSize);
+        i64_t ptr = ori + offset;
+        if(ptr < 0 || ptr > (i64_t)mSize)
+            return false;
+        mPos = (size_t)ptr;
+        return true;
+    }
+    
+    void SegmentedMemoryStream::flush()
+    {}
+    
+    size_t SegmentedMemoryStream::pageSize() const
+    {
+        return mPageSize;
+    }
+    
+    size_t SegmentedMemoryStream::capacity() const
+    {
+        return mHeadCapacity + mPages.size() * mPageSize;
+    }
+    
+    MemorySegmentList SegmentedMemoryStream::segments() const
+    {
+        MemorySegmentList list;
+        list.reserve(mPages.size() + 1);
+        size_t pos = 0;
+        while(pos < mSize)
+        {
+            size_t avail = 0;
+            u8_t* ptr = this->locate(pos, avail);
+            size_t leng = std::min(avail, mSize - pos);
+            list.push_back(MemorySegment{ptr, leng});
+            pos += leng;
+        }
+        return list;
+    }
+    
+    size_t SegmentedMemoryStream::writeTo(Stream& stream) const
+    {
+        size_t total = 0;
+        size_t pos = 0;
+        while(pos < mSize)
+        {
+            size_t avail = 0;
+            u8_t* ptr = this->locate(pos, avail);
+            size_t leng = std::min(avail, mSize - pos);
+            size_t written = stream.write(ptr, leng);
+            total += written;
+            if(written < leng)
+                break;
+            pos += leng;
+        }
+        return total;
+    }
+    
+    void* SegmentedMemoryStream::linearize()
+    {
+        if(mSize == 0)
+            return nullptr;
+        
+        size_t avail = 0;
+        u8_t* first = this->locate(0, avail);
+        if(avail >= mSize)
+            return first;
+        
+        // one copy into a block with page granularity, the slack takes later writes.
+        size_t capacity = (mSize + mPageSize - 1) / mPageSize * mPageSize;
+        u8_t* block = (u8_t*)MemoryUtility::alloc_aligned(capacity, 0, false);
+        if(block == nullptr)
+            return nullptr;
+        size_t pos = 0;
+        while(pos < mSize)
+        {
+            u8_t* ptr = this->locate(pos, avail);
+            size_t leng = std::min(avail, mSize - pos);
+            memcpy(block + pos, ptr, leng);
+            pos += leng;
+        }
+        
+        MemoryUtility::free(mHead);
+        for(u8_t* page : mPages)
+        {
+            MemoryUtility::free(page);
+        }
+        mPages.clear();
+        mHead = block;
+        mHeadCapacity = capacity;
+        return mHead;
+    }
+    
+    void SegmentedMemoryStream::clear()
+    {
+        MemoryUtility::free(mHead);
+        for(u8_t* page : mPages)
+        {
+            MemoryUtility::free(page);
+        }
+        mPages.clear();
+        mHead = nullptr;
+        mHeadCapacity = 0;
+        mSize = 0;
+        mPos = 0;
+    }
+    
+    u8_t* SegmentedMemoryStream::locate(size_t pos, size_t& avail) const
+    {
+        if(pos < mHeadCapacity)
+        {
+            avail = mHeadCapacity - pos;
+            return mHead + pos;
+        }
+        pos -= mHeadCapacity;
+        size_t offset = pos % mPageSize;
+        avail = mPageSize - offset;
+        return mPages[pos / mPageSize] + offset;
+    }
+    
+    bool SegmentedMemoryStream::reserve(size_t size)
+    {
+        while(this->capacity() < size)
+        {
+            // pages are not cleared, every byte below mSize has been written.
+            u8_t* page = (u8_t*)MemoryUtility::alloc_aligned(mPageSize, 0, false);
+            if(page == nullptr)
+                return false;
+            mPages.push_back(page);
+        }
+        return true;
+    }
+    
 }
@@ -4,9 +4,22 @@
 
 #include "./header.h"
 #include "./stream.h"
+#include "./tracker.h"
 
 namespace eokas {
     
+    enum MemoryFlags {
+        eMemoryFlags_None = 0,
+        /// the caller overwrites the whole block anyway.
+        eMemoryFlags_NoZero = 1,
+        /// back big blocks with huge pages where the system allows it.
+        eMemoryFlags_HugePages = 2,
+    };
+    
+    inline MemoryFlags operator|(MemoryFlags a, MemoryFlags b) {
+        return MemoryFlags((int) a | (int) b);
+    }
+    
     /*
     ============================================================================================
     ==== MemoryUtility
@@ -14,6 +27,8 @@ namespace eokas {
     */
     class MemoryUtility {
     public:
+        /// blocks are charged to the current MemoryTagScope, see MemoryTracker. Only free or
+        /// realloc them through MemoryUtility.
         static void* alloc(size_t size);
         static void* alloc(size_t size, void* data);
         static void* alloc(size_t size, void* data, size_t leng);
@@ -22,10 +37,22 @@ namespace eokas {
         static void clear(void* ptr, size_t size, u8_t value);
         static void copy(void* dst, void* src, size_t size);
         static int compare(void* ptr1, void* ptr2, size_t size);
+        /// alignment is a power of two, release with free_aligned.
+        static void* alloc_aligned(size_t size, size_t alignment, bool zero = true);
+        static void free_aligned(void* ptr);
         /// 1:r, 2:w, 3:rw, 4:x, 5:rx, 6:wx, 7:rwx
-        static void* alloc_v(size_t size, u32_t prot);
+        /// huge: explicit huge pages when size is a multiple of huge_page_size() and some are
+        /// available, transparent huge pages otherwise. Pages come back zeroed.
+        static void* alloc_v(size_t size, u32_t prot, bool huge = false);
         static void free_v(void* ptr, size_t size);
         static u32_t prot_v(void* ptr, size_t size, u32_t proto);
+        /// reserve address space only, pages must be committed before use.
+        static void* reserve_v(size_t size);
+        static bool commit_v(void* ptr, size_t size, u32_t prot);
+        static bool decommit_v(void* ptr, size_t size);
+        static size_t page_size();
+        /// 0 when the system has no huge pages.
+        static size_t huge_page_size();
     };
     
     /*
@@ -41,6 +68,8 @@ namespace eokas {
         MemoryBuffer(size_t size);
         MemoryBuffer(size_t size, void* data, size_t leng);
         MemoryBuffer(void* data, size_t size, bool newm = true);
+        /// alignment 0 means malloc's own, see MemoryFlags for the rest.
+        MemoryBuffer(size_t size, size_t alignment, MemoryFlags flags);
         ~MemoryBuffer();
     
     public:
@@ -50,20 +79,76 @@ namespace eokas {
     public:
         void* const data() const;
         size_t size() const;
+        size_t alignment() const;
+        MemoryFlags flags() const;
         void fill(void* data);
         void fill(void* data, size_t size);
         void clear();
         bool expand(size_t size);
     
     private:
+        void allocate(size_t size);
+        void release();
+        
         void* mData;
         size_t mSize;
         bool mIsNewm;
+        u8_t mStorage; // 0:malloc, 1:aligned, 2:virtual
+        size_t mAlignment;
+        MemoryFlags mFlags;
+    };
+    
+    /*
+    ============================================================================================
+    ==== SharedBuffer
+    ==== A view (offset, length) into a reference counted block. Copies and slices share the
+    ==== block and keep it alive. The bytes never change under a reader: mutableData() first
+    ==== copies the view into a block of its own unless this view is the only reference.
+    ============================================================================================
+    */
+    class SharedBuffer {
+    public:
+        SharedBuffer();
+        explicit SharedBuffer(size_t size, MemoryFlags flags = eMemoryFlags_None);
+        SharedBuffer(const void* data, size_t size);
+        SharedBuffer(const SharedBuffer& other);
+        SharedBuffer(SharedBuffer&& temp);
+        ~SharedBuffer();
+    
+    public:
+        SharedBuffer& operator=(const SharedBuffer& other);
+        SharedBuffer& operator=(SharedBuffer&& temp);
+        explicit operator bool() const;
+    
+    public:
+        const u8_t* data() const;
+        size_t size() const;
+        bool empty() const;
+        /// true when no other buffer or slice shares the block.
+        bool unique() const;
+        /// a view into the same block, clamped to this view.
+        SharedBuffer slice(size_t offset, size_t length) const;
+        /// writable bytes of this view, copies them first when the block is shared.
+        u8_t* mutableData();
+        void reset();
+    
+    private:
+        struct Block;
+        
+        static Block* create(size_t size, bool zero);
+        static void retain(Block* block);
+        static void release(Block* block);
+        
+        Block* mBlock;
+        u8_t* mData;
+        size_t mSize;
     };
     
     /*
     ============================================================================================
     ==== MemoryStream
+    ==== A stream over a SharedBuffer reads without copying and hands out slices of it, the
+    ==== first write takes a private copy.
     ============================================================================================
     */
     class MemoryStream : public Stream {
@@ -73,6 +158,7 @@ namespace eokas {
         MemoryStream(const MemoryStream& other);
         MemoryStream(MemoryBuffer* memoryBuffer);
         MemoryStream(void* data, size_t size);
+        MemoryStream(const SharedBuffer& buffer);
         virtual ~MemoryStream();
     
     public:
@@ -93,14 +179,84 @@ namespace eokas {
         MemoryStream& operator=(MemoryStream&& temp);
         MemoryStream& operator=(const MemoryStream& other);
         void* data() const;
+        /// the next `size` bytes as a slice, copied only when the stream is not shared.
+        SharedBuffer slice(size_t size);
     
     private:
+        bool detach(size_t size);
+        
+        SharedBuffer mShared;
         MemoryBuffer* mBuffer;
         bool mIsNewm;
         bool mIsOpen;
         size_t mPos;
     };
     
+    /*
+    ============================================================================================
+    ==== SegmentedMemoryStream
+    ==== Written bytes live in a chain of fixed-size pages, growing never moves what is
+    ==== already there. segments() lists them iovec-style for scatter/gather writes.
+    ==== linearize() folds the chain into one block once, later calls are free until the
+    ==== stream grows past that block again.
+    ============================================================================================
+    */
+    struct MemorySegment {
+        void* data;
+        size_t size;
+    };
+    
+    using MemorySegmentList = std::vector<MemorySegment>;
+    
+    class SegmentedMemoryStream : public Stream {
+    public:
+        static const size_t kDefaultPageSize = 64 * 1024;
+        
+        SegmentedMemoryStream(size_t pageSize = kDefaultPageSize);
+        SegmentedMemoryStream(SegmentedMemoryStream&& temp);
+        virtual ~SegmentedMemoryStream();
+        
+        _ForbidCopy(SegmentedMemoryStream);
+        _ForbidAssign(SegmentedMemoryStream);
+    
+    public:
+        virtual bool open() override;
+        virtual void close() override;
+        virtual bool isOpen() const override;
+        virtual bool readable() const override;
+        virtual bool writable() const override;
+        virtual bool eos() const override;
+        virtual size_t pos() const override;
+        virtual size_t size() const override;
+        virtual size_t read(void* data, size_t size) override;
+        virtual size_t write(void* data, size_t size) override;
+        virtual bool seek(int offset, int origin) override; // 0:beg, 1:cur, 2:end
+        virtual void flush() override;
+    
+    public:
+        size_t pageSize() const;
+        size_t capacity() const;
+        /// the written bytes in order, valid until the next write, linearize() or clear().
+        MemorySegmentList segments() const;
+        /// hands the segments to another stream one by one, returns the bytes it took.
+        size_t writeTo(Stream& stream) const;
+        /// all written bytes as one block, null when empty.
+        void* linearize();
+        void clear();
+    
+    private:
+        u8_t* locate(size_t pos, size_t& avail) const;
+        bool reserve(size_t size);
+        
+        size_t mPageSize;
+        u8_t* mHead;
+        size_t mHeadCapacity;
+        std::vector<u8_t*> mPages;
+        size_t mSize;
+        size_t mPos;
+        bool mIsOpen;
+    };
+    
 }
 
 #endif//_EOKAS_BASE_MEMORY_H_
@@ -0,0 +1,40 @@
+#ifndef _EOKAS_BASE_NUMBER_H_
+#define _EOKAS_BASE_NUMBER_H_
+
+#include "./header.h"
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== NumberChars
+    ==== Locale free conversion between numbers and text, '.' is always the decimal point.
+    ==== Floats are written with the fewest digits that read back to the same value (Ryu) and
+    ==== read with the Eisel-Lemire algorithm, both round to nearest even like the C library.
+    ==== Floats are written like JavaScript numbers: plain from 1e-6 up to 1e21, 1.5e+21 and
+    ==== 1.5e-7 outside of it, integral values without a fraction, "nan", "inf" and "-inf".
+    ============================================================================================
+    */
+    class NumberChars {
+    public:
+        /// enough for any value of any of the types below.
+        static const size_t kMaxChars = 32;
+
+        /// writes at most kMaxChars chars without a terminator, returns how many.
+        static size_t format(char* buffer, i64_t value);
+        static size_t format(char* buffer, u64_t value);
+        static size_t format(char* buffer, f64_t value);
+        static size_t format(char* buffer, f32_t value);
+
+        /// reads the longest number at the start of [begin, end) and returns the chars it took,
+        /// 0 if there is none and value is left alone. Integers out of range are clamped,
+        /// a '-' on an unsigned wraps around like strtoull.
+        static size_t parse(const char* begin, const char* end, i64_t& value);
+        static size_t parse(const char* begin, const char* end, u64_t& value);
+        static size_t parse(const char* begin, const char* end, f64_t& value);
+        static size_t parse(const char* begin, const char* end, f32_t& value);
+    };
+
+}
+
+#endif//_EOKAS_BASE_NUMBER_H_
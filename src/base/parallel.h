@@ -0,0 +1,276 @@
+#ifndef _EOKAS_BASE_PARALLEL_H_
+#define _EOKAS_BASE_PARALLEL_H_
+
+#include "./header.h"
+#include "./async.h"
+
+#include <iterator>
+#include <algorithm>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== TaskGroup
+    ==== Counts the tasks it has posted. wait() keeps running pending pool tasks on the calling
+    ==== thread until the count drops to zero, so a worker waiting on nested work never blocks
+    ==== the pool. The first exception thrown by a task is rethrown from wait().
+    ============================================================================================
+    */
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool)
+            : mPool(pool), mPending(0), mFailed(false), mException() {
+        }
+
+        ~TaskGroup() {
+            this->join();
+        }
+
+        _ForbidCopy(TaskGroup);
+        _ForbidAssign(TaskGroup);
+
+        ThreadPool& pool() const {
+            return mPool;
+        }
+
+        template<typename F>
+        void run(F&& f) {
+            mPending.fetch_add(1, std::memory_order_relaxed);
+            mPool.post([this, fn = std::forward<F>(f)]() mutable {
+                if (!mFailed.load(std::memory_order_relaxed)) {
+                    try {
+                        fn();
+                    }
+                    catch (...) {
+                        this->fail(std::current_exception());
+                    }
+                }
+                mPending.fetch_sub(1, std::memory_order_release);
+            });
+        }
+
+        void wait() {
+            this->join();
+            if (mException) {
+                std::exception_ptr exception = mException;
+                mException = nullptr;
+                mFailed = false;
+                std::rethrow_exception(exception);
+            }
+        }
+
+    private:
+        void join() {
+            while (mPending.load(std::memory_order_acquire) > 0) {
+                if (!mPool.help()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        void fail(std::exception_ptr exception) {
+            bool expected = false;
+            if (mFailed.compare_exchange_strong(expected, true)) {
+                mException = exception;
+            }
+        }
+
+        ThreadPool& mPool;
+        std::atomic<size_t> mPending;
+        std::atomic<bool> mFailed;
+        std::exception_ptr mException;
+    };
+
+    /*
+    ============================================================================================
+    ==== parallel algorithms
+    ==== A grain of 0 picks one that leaves about eight chunks per thread. parallel_for splits
+    ==== its range lazily: each task keeps halving its range, posts the upper half where idle
+    ==== workers can steal it and runs the rest itself.
+    ============================================================================================
+    */
+    template<typename Index>
+    Index parallel_grain(ThreadPool& pool, Index count, Index grain) {
+        if (grain > 0)
+            return grain;
+        Index chunks = (Index) (pool.size() + 1) * 8;
+        grain = (count + chunks - 1) / chunks;
+        return grain > 0 ? grain : 1;
+    }
+
+    template<typename Index, typename Body>
+    void parallel_split(TaskGroup& group, Index begin, Index end, Index grain, const Body& body) {
+        while (end - begin > grain) {
+            Index mid = begin + (end - begin) / 2;
+            group.run([&group, mid, end, grain, &body]() {
+                parallel_split(group, mid, end, grain, body);
+            });
+            end = mid;
+        }
+        body(begin, end);
+    }
+
+    /// body(begin, end) runs over sub ranges of [begin, end).
+    template<typename Index, typename Body>
+    void parallel_for_range(ThreadPool& pool, Index begin, Index end, const Body& body, Index grain = 0) {
+        if (end <= begin)
+            return;
+        grain = parallel_grain(pool, end - begin, grain);
+        if (end - begin <= grain) {
+            body(begin, end);
+            return;
+        }
+        TaskGroup group(pool);
+        parallel_split(group, begin, end, grain, body);
+        group.wait();
+    }
+
+    /// body(i) runs once for every i in [begin, end).
+    template<typename Index, typename Body>
+    void parallel_for(ThreadPool& pool, Index begin, Index end, const Body& body, Index grain = 0) {
+        parallel_for_range(pool, begin, end, [&body](Index first, Index last) {
+            for (Index i = first; i < last; i++) {
+                body(i);
+            }
+        }, grain);
+    }
+
+    /// folds map(i) over [begin, end) with an associative combine, chunks combine in order.
+    template<typename Index, typename T, typename Map, typename Combine>
+    T parallel_reduce(ThreadPool& pool, Index begin, Index end, T identity, const Map& map, const Combine& combine, Index grain = 0) {
+        if (end <= begin)
+            return identity;
+        Index count = end - begin;
+        grain = parallel_grain(pool, count, grain);
+        Index chunks = (count + grain - 1) / grain;
+
+        std::vector<T> partials((size_t) chunks, identity);
+        parallel_for(pool, (Index) 0, chunks, [&](Index chunk) {
+            Index first = begin + chunk * grain;
+            Index last = std::min(first + grain, end);
+            T value = identity;
+            for (Index i = first; i < last; i++) {
+                value = combine(value, map(i));
+            }
+            partials[(size_t) chunk] = value;
+        }, (Index) 1);
+
+        T result = identity;
+        for (T& value: partials) {
+            result = combine(result, value);
+        }
+        return result;
+    }
+
+    /// out[i] = op(first[i]), returns the end of the output range.
+    template<typename InputIt, typename OutputIt, typename Op>
+    OutputIt parallel_transform(ThreadPool& pool, InputIt first, InputIt last, OutputIt out, const Op& op, size_t grain = 0) {
+        size_t count = (size_t) std::distance(first, last);
+        parallel_for_range(pool, (size_t) 0, count, [&](size_t begin, size_t end) {
+            std::transform(first + begin, first + end, out + begin, op);
+        }, grain);
+        return out + count;
+    }
+
+    /// inclusive scan: out[i] = combine(first[0], ..., first[i]).
+    /// Chunks are reduced in parallel, their offsets are scanned serially, then every chunk
+    /// rescans itself from its offset.
+    template<typename InputIt, typename OutputIt, typename T, typename Combine>
+    OutputIt parallel_scan(ThreadPool& pool, InputIt first, InputIt last, OutputIt out, T identity, const Combine& combine, size_t grain = 0) {
+        size_t count = (size_t) std::distance(first, last);
+        if (count == 0)
+            return out;
+        grain = parallel_grain(pool, count, grain);
+        size_t chunks = (count + grain - 1) / grain;
+
+        std::vector<T> sums(chunks, identity);
+        parallel_for(pool, (size_t) 0, chunks, [&](size_t chunk) {
+            size_t begin = chunk * grain;
+            size_t end = std::min(begin + grain, count);
+            T value = identity;
+            for (size_t i = begin; i < end; i++) {
+                value = combine(value, first[i]);
+            }
+            sums[chunk] = value;
+        }, (size_t) 1);
+
+        T carry = identity;
+        for (T& sum: sums) {
+            T next = combine(carry, sum);
+            sum = carry;
+            carry = next;
+        }
+
+        parallel_for(pool, (size_t) 0, chunks, [&](size_t chunk) {
+            size_t begin = chunk * grain;
+            size_t end = std::min(begin + grain, count);
+            T value = sums[chunk];
+            for (size_t i = begin; i < end; i++) {
+                value = combine(value, first[i]);
+                out[i] = value;
+            }
+        }, (size_t) 1);
+        return out + count;
+    }
+
+    /// sorts chunks in parallel, then merges neighbouring runs pairwise through a buffer.
+    template<typename RandomIt, typename Compare>
+    void parallel_sort(ThreadPool& pool, RandomIt first, RandomIt last, const Compare& compare, size_t grain = 0) {
+        using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+        size_t count = (size_t) std::distance(first, last);
+        grain = parallel_grain(pool, count, grain);
+        if (grain < 1024) {
+            grain = 1024;
+        }
+        if (count <= grain) {
+            std::sort(first, last, compare);
+            return;
+        }
+
+        size_t chunks = (count + grain - 1) / grain;
+        parallel_for(pool, (size_t) 0, chunks, [&](size_t chunk) {
+            size_t begin = chunk * grain;
+            size_t end = std::min(begin + grain, count);
+            std::sort(first + begin, first + end, compare);
+        }, (size_t) 1);
+
+        std::vector<Value> buffer(count);
+        bool inBuffer = false;
+        for (size_t width = grain; width < count; width *= 2) {
+            size_t pairs = (count + width * 2 - 1) / (width * 2);
+            parallel_for(pool, (size_t) 0, pairs, [&](size_t pair) {
+                size_t begin = pair * width * 2;
+                size_t mid = std::min(begin + width, count);
+                size_t end = std::min(begin + width * 2, count);
+                if (inBuffer) {
+                    std::merge(std::make_move_iterator(buffer.begin() + begin), std::make_move_iterator(buffer.begin() + mid),
+                               std::make_move_iterator(buffer.begin() + mid), std::make_move_iterator(buffer.begin() + end),
+                               first + begin, compare);
+                }
+                else {
+                    std::merge(std::make_move_iterator(first + begin), std::make_move_iterator(first + mid),
+                               std::make_move_iterator(first + mid), std::make_move_iterator(first + end),
+                               buffer.begin() + begin, compare);
+                }
+            }, (size_t) 1);
+            inBuffer = !inBuffer;
+        }
+
+        if (inBuffer) {
+            parallel_for_range(pool, (size_t) 0, count, [&](size_t begin, size_t end) {
+                std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+            });
+        }
+    }
+
+    template<typename RandomIt>
+    void parallel_sort(ThreadPool& pool, RandomIt first, RandomIt last) {
+        using Value = typename std::iterator_traits<RandomIt>::value_type;
+        parallel_sort(pool, first, last, std::less<Value>());
+    }
+
+}
+
+#endif//_EOKAS_BASE_PARALLEL_H_
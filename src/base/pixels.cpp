@@ -5,42 +5,45 @@
 
 namespace eokas {
     
+    // cache line and widest SIMD register.
+    static const size_t kPixelAlignment = 64;
+    
     Pixelmap::Pixelmap()
-        : mWidth(0), mHeight(0), mFormat(PixelFormat::Unknown), mData(nullptr) {
+        : mWidth(0), mHeight(0), mFormat(PixelFormat::Unknown), mData() {
     }
     
     Pixelmap::Pixelmap(const Pixelmap& pxmp)
-        : mWidth(pxmp.mWidth), mHeight(pxmp.mHeight), mFormat(pxmp.mFormat), mData(nullptr) {
-        u32_t size = mWidth * mHeight * _PixelFormatSize(mFormat);
-        mData = new u8_t[size];
-        memset(mData, 0, size);
-        if (pxmp.mData != nullptr) {
-            memcpy(mData, pxmp.mData, size);
-        }
+        : mWidth(pxmp.mWidth), mHeight(pxmp.mHeight), mFormat(pxmp.mFormat), mData(pxmp.mData) {
     }
     
     Pixelmap::Pixelmap(u32_t width, u32_t height, PixelFormat format, void* data)
-        : mWidth(width), mHeight(height), mFormat(format), mData(nullptr) {
-        u32_t size = mWidth * mHeight * _PixelFormatSize(mFormat);
-        mData = new u8_t[size];
-        memset(mData, 0, size);
+        : Pixelmap(width, height, format, data, eMemoryFlags_None) {
+    }
+    
+    Pixelmap::Pixelmap(u32_t width, u32_t height, PixelFormat format, void* data, MemoryFlags flags)
+        : mWidth(width), mHeight(height), mFormat(format), mData() {
+        size_t size = (size_t) mWidth * mHeight * _PixelFormatSize(mFormat);
+        // pixels handed in overwrite everything, no need to clear first.
         if (data != nullptr) {
-            memcpy(mData, data, size);
+            flags = flags | eMemoryFlags_NoZero;
+        }
+        mData = MemoryBuffer(size, kPixelAlignment, flags);
+        if (data != nullptr && mData.data() != nullptr) {
+            memcpy(mData.data(), data, size);
         }
     }
     
     Pixelmap::Pixelmap(const Pixelmap& pxmp, u32_t x, u32_t y, u32_t w, u32_t h)
-        : mWidth(w), mHeight(h), mFormat(pxmp.mFormat), mData(nullptr) {
-        u32_t size = mWidth * mHeight * _PixelFormatSize(mFormat);
-        mData = new u8_t[size];
-        memset(mData, 0, size);
+        : mWidth(w), mHeight(h), mFormat(pxmp.mFormat), mData() {
+        u32_t pixel = _PixelFormatSize(mFormat);
+        mData = MemoryBuffer((size_t) mWidth * mHeight * pixel, kPixelAlignment, eMemoryFlags_None);
         if (x < pxmp.mWidth && y < pxmp.mHeight) {
             u32_t cw = std::min(pxmp.mWidth - x, w);
             u32_t ch = std::min(pxmp.mHeight - y, h);
-            u32_t row = cw * _PixelFormatSize(mFormat);
+            u32_t row = cw * pixel;
             for (u32_t i = 0; i < ch; i++) {
-                u8_t* src = (u8_t*) (pxmp.mData) + (y + i) * pxmp.mWidth + x;
-                u8_t* dst = (u8_t*) (mData) + i * mWidth;
+                u8_t* src = (u8_t*) (pxmp.mData.data()) + ((size_t) (y + i) * pxmp.mWidth + x) * pixel;
+                u8_t* dst = (u8_t*) (mData.data()) + (size_t) i * mWidth * pixel;
                 memcpy(dst, src, row);
             }
         }
@@ -63,7 +66,7 @@ namespace eokas {
     }
     
     void* const Pixelmap::data() const {
-        return mData;
+        return mData.data();
     }
     
     Pixelmap Pixelmap::getArea(u32_t x, u32_t y, u32_t w, u32_t h) {
@@ -75,19 +78,17 @@ namespace eokas {
             return;
         u32_t cw = std::min(mWidth - x, pxmp.mWidth);
         u32_t ch = std::min(mHeight - y, pxmp.mHeight);
-        u32_t row = _PixelFormatSize(mFormat) * cw;
+        u32_t pixel = _PixelFormatSize(mFormat);
+        u32_t row = pixel * cw;
         for (u32_t i = 0; i < ch; i++) {
-            u8_t* dst = (u8_t*) mData + (y + i) * mWidth + x;
-            u8_t* src = (u8_t*) pxmp.mData + i * cw;
+            u8_t* dst = (u8_t*) mData.data() + ((size_t) (y + i) * mWidth + x) * pixel;
+            u8_t* src = (u8_t*) pxmp.mData.data() + (size_t) i * pxmp.mWidth * pixel;
             memcpy(dst, src, row);
         }
     }
     
     void Pixelmap::clear() {
-        if (mData != nullptr) {
-            delete[]mData;
-            mData = nullptr;
-        }
+        mData = MemoryBuffer();
         mWidth = 0;
         mHeight = 0;
         mFormat = PixelFormat::Unknown;
@@ -3,6 +3,7 @@
 #define  _EOKAS_BASE_PIXELS_H_
 
 #include "./header.h"
+#include "./memory.h"
 
 namespace eokas {
     
@@ -157,6 +158,8 @@ namespace eokas {
         Pixelmap(const Pixelmap& pxmp);
         Pixelmap(u32_t width, u32_t height, PixelFormat format, void* data = nullptr);
         Pixelmap(const Pixelmap& pxmp, u32_t x, u32_t y, u32_t w, u32_t h);
+        /// extra MemoryFlags for the pixel storage, e.g. huge pages for very large maps.
+        Pixelmap(u32_t width, u32_t height, PixelFormat format, void* data, MemoryFlags flags);
         virtual ~Pixelmap();
     
     public:
@@ -172,7 +175,7 @@ namespace eokas {
         u32_t mWidth;
         u32_t mHeight;
         PixelFormat mFormat;
-        u8_t* mData;
+        MemoryBuffer mData;
     };
     
 }
@@ -1,125 +1,559 @@
-
 #ifndef  _EOKAS_BASE_POOL_H_
 #define  _EOKAS_BASE_POOL_H_
 
 #include "./header.h"
+#include <new>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <utility>
 #include <functional>
 
 namespace eokas {
-    
+
+    /*
+    ============================================================================================
+    ==== PoolHandle
+    ==== Index plus generation of a pooled object. A handle goes stale as soon as its object
+    ==== is released, even if the slot has been reused since.
+    ============================================================================================
+    */
+    struct PoolHandle {
+        static const u32_t kInvalidIndex = 0xFFFFFFFF;
+
+        u32_t index = kInvalidIndex;
+        u32_t generation = 0;
+
+        bool isValid() const {
+            return index != kInvalidIndex;
+        }
+
+        bool operator==(const PoolHandle& rhs) const {
+            return index == rhs.index && generation == rhs.generation;
+        }
+
+        bool operator!=(const PoolHandle& rhs) const {
+            return !(*this == rhs);
+        }
+    };
+
+    /*
+    ============================================================================================
+    ==== PoolSlot / PoolSlabs
+    ==== Slots live in slabs that double in size, slab k holds (BaseSize << k) slots.
+    ==== Slab addresses never move, so objects and slot indices stay stable while the pool grows.
+    ==== An odd generation means the slot holds a live object.
+    ============================================================================================
+    */
     template<typename TObject>
+    struct PoolSlot {
+        alignas(TObject) u8_t storage[sizeof(TObject)];
+        u32_t index;
+        u32_t next;
+        std::atomic<u32_t> generation;
+
+        TObject* object() {
+            return reinterpret_cast<TObject*>(storage);
+        }
+
+        bool isAlive() const {
+            return (generation.load(std::memory_order_acquire) & 1) != 0;
+        }
+
+        static PoolSlot* from(const TObject* object) {
+            // storage is the first member, the object address is the slot address.
+            return reinterpret_cast<PoolSlot*>(const_cast<TObject*>(object));
+        }
+    };
+
+    template<typename TObject, u32_t BaseSize>
+    class PoolSlabs {
+    public:
+        using Slot = PoolSlot<TObject>;
+        static const u32_t kMaxSlabs = 24;
+
+        PoolSlabs()
+            : mCapacity(0) {
+            for (u32_t k = 0; k < kMaxSlabs; k++) {
+                mSlabs[k].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        ~PoolSlabs() {
+            for (u32_t k = 0; k < kMaxSlabs; k++) {
+                Slot* slab = mSlabs[k].load(std::memory_order_relaxed);
+                _DeleteArray(slab);
+            }
+        }
+
+        _ForbidCopy(PoolSlabs);
+        _ForbidAssign(PoolSlabs);
+
+        u32_t capacity() const {
+            return mCapacity.load(std::memory_order_acquire);
+        }
+
+        Slot* at(u32_t index) const {
+            u32_t k = slabOf(index);
+            Slot* slab = mSlabs[k].load(std::memory_order_acquire);
+            return slab + (index - firstOf(k));
+        }
+
+        /// adds one slab, returns the index range [first, last) of the new slots.
+        bool grow(u32_t& first, u32_t& last) {
+            u32_t capacity = mCapacity.load(std::memory_order_relaxed);
+            u32_t k = slabOf(capacity);
+            if (k >= kMaxSlabs)
+                return false;
+            u32_t count = BaseSize << k;
+            Slot* slab = new Slot[count];
+            for (u32_t i = 0; i < count; i++) {
+                slab[i].index = capacity + i;
+                slab[i].next = PoolHandle::kInvalidIndex;
+                slab[i].generation.store(0, std::memory_order_relaxed);
+            }
+            mSlabs[k].store(slab, std::memory_order_release);
+            mCapacity.store(capacity + count, std::memory_order_release);
+            first = capacity;
+            last = capacity + count;
+            return true;
+        }
+
+    private:
+        static u32_t slabOf(u32_t index) {
+            u32_t n = index / BaseSize + 1;
+            u32_t k = 0;
+            while (n >>= 1) {
+                k++;
+            }
+            return k;
+        }
+
+        static u32_t firstOf(u32_t k) {
+            return BaseSize * ((1u << k) - 1);
+        }
+
+        std::atomic<Slot*> mSlabs[kMaxSlabs];
+        std::atomic<u32_t> mCapacity;
+    };
+
+    /*
+    ============================================================================================
+    ==== Pool
+    ==== Single threaded object pool. Acquire and release are O(1) through an intrusive
+    ==== freelist, iteration walks the slabs in address order and skips free slots.
+    ============================================================================================
+    */
+    template<typename TObject, u32_t BaseSize = 64>
     class Pool {
     public:
-        using Container = std::list<TObject*>;
-        using Iterator = typename Container::iterator;
-    
+        using Slot = PoolSlot<TObject>;
+        using Handle = PoolHandle;
+
+        class Iterator {
+        public:
+            Iterator(const Pool* pool, u32_t index)
+                : mPool(pool), mIndex(index) {
+                this->skip();
+            }
+
+            TObject* operator*() const {
+                return mPool->mSlabs.at(mIndex)->object();
+            }
+
+            Iterator& operator++() {
+                mIndex += 1;
+                this->skip();
+                return *this;
+            }
+
+            bool operator==(const Iterator& rhs) const {
+                return mIndex == rhs.mIndex;
+            }
+
+            bool operator!=(const Iterator& rhs) const {
+                return mIndex != rhs.mIndex;
+            }
+
+        private:
+            void skip() {
+                u32_t capacity = mPool->mSlabs.capacity();
+                while (mIndex < capacity && !mPool->mSlabs.at(mIndex)->isAlive()) {
+                    mIndex += 1;
+                }
+                if (mIndex > capacity) {
+                    mIndex = capacity;
+                }
+            }
+
+            const Pool* mPool;
+            u32_t mIndex;
+        };
+
     public:
         Pool()
-            : mAlive(), mDeath() {
+            : mSlabs(), mFreeHead(PoolHandle::kInvalidIndex), mSize(0) {
         }
-        
+
         ~Pool() {
             this->destroy();
         }
-    
+
+        _ForbidCopy(Pool);
+        _ForbidAssign(Pool);
+
     public:
         bool empty() const {
-            return mAlive.empty();
+            return mSize == 0;
         }
-        
+
         size_t size() const {
-            return mAlive.size();
+            return mSize;
+        }
+
+        size_t capacity() const {
+            return mSlabs.capacity();
         }
-        
+
         Iterator begin() {
-            return mAlive.begin();
+            return Iterator(this, 0);
         }
-        
+
         Iterator end() {
-            return mAlive.end();
+            return Iterator(this, mSlabs.capacity());
         }
-        
+
         template<typename... Args>
-        TObject* acquire(Args... args) {
-            TObject* ptr = nullptr;
-            if (!mDeath.empty()) {
-                ptr = mDeath.front();
-                mDeath.pop_front();
-                new(ptr)TObject(args...);
-            } else {
-                ptr = new TObject(args...);
-                mAlive.push_back(ptr);
+        TObject* acquire(Args&&... args) {
+            if (mFreeHead == PoolHandle::kInvalidIndex) {
+                u32_t first = 0, last = 0;
+                if (!mSlabs.grow(first, last))
+                    return nullptr;
+                // link the new slots so the lowest index is handed out first.
+                for (u32_t index = last; index > first; index--) {
+                    Slot* slot = mSlabs.at(index - 1);
+                    slot->next = mFreeHead;
+                    mFreeHead = index - 1;
+                }
             }
+
+            Slot* slot = mSlabs.at(mFreeHead);
+            mFreeHead = slot->next;
+            TObject* ptr = new(slot->storage)TObject(std::forward<Args>(args)...);
+            slot->generation.fetch_add(1, std::memory_order_release);
+            mSize += 1;
             return ptr;
         }
-        
+
         void release(TObject* o) {
             if (o == nullptr)
                 return;
-            mDeath.push_back(o);
-            mAlive.remove(o);
+            Slot* slot = Slot::from(o);
+            if (!slot->isAlive())
+                return;
+            o->~TObject();
+            slot->generation.fetch_add(1, std::memory_order_release);
+            slot->next = mFreeHead;
+            mFreeHead = slot->index;
+            mSize -= 1;
         }
-        
+
+        void release(const Handle& handle) {
+            this->release(this->get(handle));
+        }
+
         void releaseFront() {
-            TObject* o = mAlive.front();
-            if (o != nullptr) {
-                mDeath.push_back(0);
+            Iterator iter = this->begin();
+            if (iter != this->end()) {
+                this->release(*iter);
             }
-            mAlive.pop_front();
         }
-        
+
         void releaseBack() {
-            TObject* o = mAlive.back();
-            if (o != nullptr) {
-                mDeath.push_back(0);
+            u32_t index = mSlabs.capacity();
+            while (index > 0) {
+                Slot* slot = mSlabs.at(index - 1);
+                if (slot->isAlive()) {
+                    this->release(slot->object());
+                    return;
+                }
+                index -= 1;
             }
-            mAlive.pop_back();
         }
-        
+
         void releaseAll(std::function<bool(TObject*)> predicate) {
-            if (mAlive.empty())
+            if (mSize == 0)
                 return;
-            auto iter = mAlive.begin();
-            while (iter != mAlive.end()) {
-                TObject* o = *iter;
-                if (o != nullptr && predicate(o)) {
-                    mDeath.push_back(o);
+            u32_t capacity = mSlabs.capacity();
+            for (u32_t index = 0; index < capacity; index++) {
+                Slot* slot = mSlabs.at(index);
+                if (slot->isAlive() && predicate(slot->object())) {
+                    this->release(slot->object());
                 }
-                ++iter;
             }
-            mAlive.clear();
         }
-        
+
         void releaseAll() {
-            if (mAlive.empty())
+            if (mSize == 0)
                 return;
-            auto iter = mAlive.begin();
-            while (iter != mAlive.end()) {
-                TObject* o = *iter;
-                mDeath.push_back(o);
-                ++iter;
+            u32_t capacity = mSlabs.capacity();
+            for (u32_t index = 0; index < capacity; index++) {
+                Slot* slot = mSlabs.at(index);
+                if (slot->isAlive()) {
+                    this->release(slot->object());
+                }
             }
-            mAlive.clear();
         }
-        
+
         void destroy() {
             this->releaseAll();
-            if (mDeath.empty())
-                return;
-            auto iter = mDeath.begin();
-            while (iter != mDeath.end()) {
-                TObject* o = *iter;
-                _DeletePointer(o);
-                ++iter;
+        }
+
+        Handle handle(const TObject* o) const {
+            Handle handle;
+            if (o == nullptr)
+                return handle;
+            Slot* slot = Slot::from(o);
+            handle.index = slot->index;
+            handle.generation = slot->generation.load(std::memory_order_relaxed);
+            return handle;
+        }
+
+        TObject* get(const Handle& handle) const {
+            if (handle.index >= mSlabs.capacity())
+                return nullptr;
+            Slot* slot = mSlabs.at(handle.index);
+            if (slot->generation.load(std::memory_order_relaxed) != handle.generation || !slot->isAlive())
+                return nullptr;
+            return slot->object();
+        }
+
+        bool isAlive(const Handle& handle) const {
+            return this->get(handle) != nullptr;
+        }
+
+    private:
+        PoolSlabs<TObject, BaseSize> mSlabs;
+        u32_t mFreeHead;
+        size_t mSize;
+    };
+
+    /*
+    ============================================================================================
+    ==== ConcurrentPool
+    ==== Pool shared across threads. Each thread keeps a magazine of free slot indices per
+    ==== pool and only takes the depot lock to swap half a magazine in or out.
+    ==== Live objects can not be iterated while other threads acquire or release.
+    ============================================================================================
+    */
+    struct PoolRegistry {
+        std::mutex mutex;
+        std::set<u64_t> alive;
+        u64_t next = 1;
+
+        static PoolRegistry& instance() {
+            // leaked on purpose: threads flush their magazines after static destruction.
+            static PoolRegistry* sInstance = new PoolRegistry();
+            return *sInstance;
+        }
+    };
+
+    template<typename TObject, u32_t BaseSize = 256, u32_t MagazineSize = 32>
+    class ConcurrentPool {
+    public:
+        using Slot = PoolSlot<TObject>;
+        using Handle = PoolHandle;
+
+    public:
+        ConcurrentPool()
+            : mSlabs(), mDepot(), mSize(0) {
+            PoolRegistry& registry = PoolRegistry::instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            mId = registry.next++;
+            registry.alive.insert(mId);
+        }
+
+        ~ConcurrentPool() {
+            {
+                PoolRegistry& registry = PoolRegistry::instance();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.alive.erase(mId);
+            }
+            u32_t capacity = mSlabs.capacity();
+            for (u32_t index = 0; index < capacity; index++) {
+                Slot* slot = mSlabs.at(index);
+                if (slot->isAlive()) {
+                    slot->object()->~TObject();
+                }
             }
-            mDeath.clear();
         }
-    
+
+        _ForbidCopy(ConcurrentPool);
+        _ForbidAssign(ConcurrentPool);
+
+    public:
+        size_t size() const {
+            return mSize.load(std::memory_order_relaxed);
+        }
+
+        size_t capacity() const {
+            return mSlabs.capacity();
+        }
+
+        template<typename... Args>
+        TObject* acquire(Args&&... args) {
+            u32_t index = this->pop();
+            if (index == PoolHandle::kInvalidIndex)
+                return nullptr;
+            Slot* slot = mSlabs.at(index);
+            TObject* ptr = new(slot->storage)TObject(std::forward<Args>(args)...);
+            slot->generation.fetch_add(1, std::memory_order_release);
+            mSize.fetch_add(1, std::memory_order_relaxed);
+            return ptr;
+        }
+
+        void release(TObject* o) {
+            if (o == nullptr)
+                return;
+            Slot* slot = Slot::from(o);
+            if (!slot->isAlive())
+                return;
+            o->~TObject();
+            slot->generation.fetch_add(1, std::memory_order_release);
+            mSize.fetch_sub(1, std::memory_order_relaxed);
+            this->push(slot->index);
+        }
+
+        void release(const Handle& handle) {
+            this->release(this->get(handle));
+        }
+
+        Handle handle(const TObject* o) const {
+            Handle handle;
+            if (o == nullptr)
+                return handle;
+            Slot* slot = Slot::from(o);
+            handle.index = slot->index;
+            handle.generation = slot->generation.load(std::memory_order_acquire);
+            return handle;
+        }
+
+        TObject* get(const Handle& handle) const {
+            if (handle.index >= mSlabs.capacity())
+                return nullptr;
+            Slot* slot = mSlabs.at(handle.index);
+            u32_t generation = slot->generation.load(std::memory_order_acquire);
+            if (generation != handle.generation || (generation & 1) == 0)
+                return nullptr;
+            return slot->object();
+        }
+
+        bool isAlive(const Handle& handle) const {
+            return this->get(handle) != nullptr;
+        }
+
     private:
-        std::list<TObject*> mAlive;
-        std::list<TObject*> mDeath;
+        struct Magazine {
+            u64_t poolId;
+            ConcurrentPool* pool;
+            u32_t count;
+            u32_t items[MagazineSize];
+        };
+
+        struct MagazineCache {
+            std::vector<Magazine> magazines;
+
+            ~MagazineCache() {
+                PoolRegistry& registry = PoolRegistry::instance();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                for (Magazine& magazine: magazines) {
+                    if (magazine.count > 0 && registry.alive.count(magazine.poolId) > 0) {
+                        magazine.pool->unload(magazine, magazine.count);
+                    }
+                }
+            }
+        };
+
+        Magazine& magazine() {
+            static thread_local MagazineCache tCache;
+            std::vector<Magazine>& magazines = tCache.magazines;
+            for (Magazine& magazine: magazines) {
+                if (magazine.poolId == mId)
+                    return magazine;
+            }
+            {
+                // reuse the entry of a pool that has been destroyed.
+                PoolRegistry& registry = PoolRegistry::instance();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                for (Magazine& magazine: magazines) {
+                    if (registry.alive.count(magazine.poolId) == 0) {
+                        magazine.poolId = mId;
+                        magazine.pool = this;
+                        magazine.count = 0;
+                        return magazine;
+                    }
+                }
+            }
+            Magazine& magazine = magazines.emplace_back();
+            magazine.poolId = mId;
+            magazine.pool = this;
+            magazine.count = 0;
+            return magazine;
+        }
+
+        u32_t pop() {
+            Magazine& magazine = this->magazine();
+            if (magazine.count == 0) {
+                this->load(magazine, MagazineSize / 2);
+                if (magazine.count == 0)
+                    return PoolHandle::kInvalidIndex;
+            }
+            magazine.count -= 1;
+            return magazine.items[magazine.count];
+        }
+
+        void push(u32_t index) {
+            Magazine& magazine = this->magazine();
+            if (magazine.count == MagazineSize) {
+                this->unload(magazine, MagazineSize / 2);
+            }
+            magazine.items[magazine.count] = index;
+            magazine.count += 1;
+        }
+
+        void load(Magazine& magazine, u32_t count) {
+            std::lock_guard<std::mutex> lock(mDepotMutex);
+            if (mDepot.empty()) {
+                u32_t first = 0, last = 0;
+                if (!mSlabs.grow(first, last))
+                    return;
+                for (u32_t index = last; index > first; index--) {
+                    mDepot.push_back(index - 1);
+                }
+            }
+            while (magazine.count < count && !mDepot.empty()) {
+                magazine.items[magazine.count] = mDepot.back();
+                magazine.count += 1;
+                mDepot.pop_back();
+            }
+        }
+
+        void unload(Magazine& magazine, u32_t count) {
+            std::lock_guard<std::mutex> lock(mDepotMutex);
+            while (count > 0 && magazine.count > 0) {
+                magazine.count -= 1;
+                mDepot.push_back(magazine.items[magazine.count]);
+                count -= 1;
+            }
+        }
+
+        u64_t mId;
+        PoolSlabs<TObject, BaseSize> mSlabs;
+        std::mutex mDepotMutex;
+        std::vector<u32_t> mDepot;
+        std::atomic<size_t> mSize;
     };
-    
+
 }
 
-#endif//_EOKAS_BASE_ASCIL_H_
+#endif//_EOKAS_BASE_POOL_H_
@@ -0,0 +1,319 @@
+
+#include "./rope.h"
+#include "./slab.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== tree
+    ==== Leaves point into a shared buffer, inner nodes only join two subtrees. Heights of
+    ==== siblings differ by at most one (AVL), joins and cuts are the join based algorithms
+    ==== of Blelloch, Ferizovic and Sun, "Just Join for Parallel Ordered Sets", 2016.
+    ==== Every function takes over the references it is given and returns a new one.
+    ============================================================================================
+    */
+    struct RopeBuffer {
+        std::atomic<u32_t> refs;
+        size_t size;
+
+        char* data() {
+            return (char*) (this + 1);
+        }
+    };
+
+    struct RopeNode {
+        std::atomic<u32_t> refs;
+        u32_t height;
+        size_t size;
+        RopeNode* left;
+        RopeNode* right;
+        RopeBuffer* buffer;
+        const char* data;
+    };
+
+    static RopeNode* rope_retain(RopeNode* node) {
+        if (node != nullptr) {
+            node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return node;
+    }
+
+    static void rope_release(RopeNode* node) {
+        while (node != nullptr && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            RopeNode* next = nullptr;
+            if (node->height == 0) {
+                RopeBuffer* buffer = node->buffer;
+                if (buffer->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    SlabAllocator::free(buffer, sizeof(RopeBuffer) + buffer->size);
+                }
+            } else {
+                rope_release(node->left);
+                next = node->right;
+            }
+            SlabAllocator::free(node, sizeof(RopeNode));
+            node = next;
+        }
+    }
+
+    static u32_t rope_height(const RopeNode* node) {
+        return node != nullptr ? node->height : 0;
+    }
+
+    static RopeNode* rope_leaf(RopeBuffer* buffer, const char* data, size_t size) {
+        RopeNode* node = new(SlabAllocator::alloc(sizeof(RopeNode))) RopeNode();
+        node->refs.store(1, std::memory_order_relaxed);
+        node->height = 0;
+        node->size = size;
+        node->left = nullptr;
+        node->right = nullptr;
+        node->buffer = buffer;
+        node->data = data;
+        buffer->refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    static RopeNode* rope_leaf(const char* first, size_t firstSize, const char* second, size_t secondSize) {
+        size_t size = firstSize + secondSize;
+        if (size == 0)
+            return nullptr;
+        RopeBuffer* buffer = new(SlabAllocator::alloc(sizeof(RopeBuffer) + size)) RopeBuffer();
+        buffer->refs.store(0, std::memory_order_relaxed);
+        buffer->size = size;
+        memcpy(buffer->data(), first, firstSize);
+        if (secondSize > 0) {
+            memcpy(buffer->data() + firstSize, second, secondSize);
+        }
+        return rope_leaf(buffer, buffer->data(), size);
+    }
+
+    static RopeNode* rope_node(RopeNode* left, RopeNode* right) {
+        RopeNode* node = new(SlabAllocator::alloc(sizeof(RopeNode))) RopeNode();
+        node->refs.store(1, std::memory_order_relaxed);
+        node->height = (left->height > right->height ? left->height : right->height) + 1;
+        node->size = left->size + right->size;
+        node->left = left;
+        node->right = right;
+        node->buffer = nullptr;
+        node->data = nullptr;
+        return node;
+    }
+
+    // joins two trees whose heights differ by at most two.
+    static RopeNode* rope_balance(RopeNode* left, RopeNode* right) {
+        if (right->height > left->height + 1) {
+            RopeNode* inner = right->left;
+            RopeNode* outer = right->right;
+            RopeNode* result = nullptr;
+            if (outer->height >= inner->height) {
+                result = rope_node(rope_node(left, rope_retain(inner)), rope_retain(outer));
+            } else {
+                result = rope_node(rope_node(left, rope_retain(inner->left)),
+                                   rope_node(rope_retain(inner->right), rope_retain(outer)));
+            }
+            rope_release(right);
+            return result;
+        }
+        if (left->height > right->height + 1) {
+            RopeNode* inner = left->right;
+            RopeNode* outer = left->left;
+            RopeNode* result = nullptr;
+            if (outer->height >= inner->height) {
+                result = rope_node(rope_retain(outer), rope_node(rope_retain(inner), right));
+            } else {
+                result = rope_node(rope_node(rope_retain(outer), rope_retain(inner->left)),
+                                   rope_node(rope_retain(inner->right), right));
+            }
+            rope_release(left);
+            return result;
+        }
+        return rope_node(left, right);
+    }
+
+    static RopeNode* rope_join(RopeNode* left, RopeNode* right) {
+        if (left == nullptr)
+            return right;
+        if (right == nullptr)
+            return left;
+        if (left->height == 0 && right->height == 0 && left->size + right->size <= Rope::kMergeSize) {
+            RopeNode* merged = rope_leaf(left->data, left->size, right->data, right->size);
+            rope_release(left);
+            rope_release(right);
+            return merged;
+        }
+        if (left->height > right->height + 1) {
+            RopeNode* outer = rope_retain(left->left);
+            RopeNode* inner = rope_join(rope_retain(left->right), right);
+            rope_release(left);
+            return rope_balance(outer, inner);
+        }
+        if (right->height > left->height + 1) {
+            RopeNode* inner = rope_join(left, rope_retain(right->left));
+            RopeNode* outer = rope_retain(right->right);
+            rope_release(right);
+            return rope_balance(inner, outer);
+        }
+        return rope_node(left, right);
+    }
+
+    // [pos, pos + len) of node, which is left alone.
+    static RopeNode* rope_slice(RopeNode* node, size_t pos, size_t len) {
+        if (len == 0)
+            return nullptr;
+        if (pos == 0 && len == node->size)
+            return rope_retain(node);
+        if (node->height == 0)
+            return rope_leaf(node->buffer, node->data + pos, len);
+        size_t leftSize = node->left->size;
+        if (pos + len <= leftSize)
+            return rope_slice(node->left, pos, len);
+        if (pos >= leftSize)
+            return rope_slice(node->right, pos - leftSize, len);
+        RopeNode* head = rope_slice(node->left, pos, leftSize - pos);
+        RopeNode* tail = rope_slice(node->right, 0, pos + len - leftSize);
+        return rope_join(head, tail);
+    }
+
+    static bool rope_foreach(const RopeNode* node, const std::function<bool(const StringView& piece)>& func) {
+        while (node->height > 0) {
+            if (!rope_foreach(node->left, func))
+                return false;
+            node = node->right;
+        }
+        return func(StringView(node->data, node->size));
+    }
+
+    /*
+    ============================================================================================
+    ==== Rope
+    ============================================================================================
+    */
+    Rope::Rope()
+        : mRoot(nullptr) {
+    }
+
+    Rope::Rope(const char* str)
+        : Rope(StringView(str)) {
+    }
+
+    Rope::Rope(const StringView& str)
+        : mRoot(rope_leaf(str.data(), str.length(), nullptr, 0)) {
+    }
+
+    Rope::Rope(const String& str)
+        : Rope(str.view()) {
+    }
+
+    Rope::Rope(const Rope& other)
+        : mRoot(rope_retain(other.mRoot)) {
+    }
+
+    Rope::Rope(Rope&& other) noexcept
+        : mRoot(other.mRoot) {
+        other.mRoot = nullptr;
+    }
+
+    Rope::~Rope() {
+        rope_release(mRoot);
+    }
+
+    Rope& Rope::operator=(const Rope& rhs) {
+        RopeNode* root = rope_retain(rhs.mRoot);
+        rope_release(mRoot);
+        mRoot = root;
+        return *this;
+    }
+
+    Rope& Rope::operator=(Rope&& rhs) noexcept {
+        if (this != &rhs) {
+            rope_release(mRoot);
+            mRoot = rhs.mRoot;
+            rhs.mRoot = nullptr;
+        }
+        return *this;
+    }
+
+    Rope Rope::operator+(const Rope& rhs) const {
+        return Rope(rope_join(rope_retain(mRoot), rope_retain(rhs.mRoot)));
+    }
+
+    Rope& Rope::operator+=(const Rope& rhs) {
+        RopeNode* right = rope_retain(rhs.mRoot);
+        mRoot = rope_join(mRoot, right);
+        return *this;
+    }
+
+    size_t Rope::length() const {
+        return mRoot != nullptr ? mRoot->size : 0;
+    }
+
+    bool Rope::isEmpty() const {
+        return mRoot == nullptr;
+    }
+
+    u32_t Rope::depth() const {
+        return rope_height(mRoot);
+    }
+
+    char Rope::at(size_t index) const {
+        const RopeNode* node = mRoot;
+        if (node == nullptr || index >= node->size)
+            return '\0';
+        while (node->height > 0) {
+            if (index < node->left->size) {
+                node = node->left;
+            } else {
+                index -= node->left->size;
+                node = node->right;
+            }
+        }
+        return node->data[index];
+    }
+
+    Rope Rope::substr(size_t pos, size_t len) const {
+        size_t size = this->length();
+        if (pos >= size)
+            return Rope();
+        len = len < size - pos ? len : size - pos;
+        return Rope(rope_slice(mRoot, pos, len));
+    }
+
+    String Rope::toString() const {
+        size_t length = this->length();
+        String result;
+        if (length == 0)
+            return result;
+        char* dst = result.reserve(length, false);
+        this->foreach([&](const StringView& piece) -> void {
+            memcpy(dst, piece.data(), piece.length());
+            dst += piece.length();
+        });
+        result.resize(length);
+        return result;
+    }
+
+    void Rope::foreach(const std::function<void(const StringView& piece)>& func) const {
+        if (mRoot == nullptr)
+            return;
+        rope_foreach(mRoot, [&](const StringView& piece) -> bool {
+            func(piece);
+            return true;
+        });
+    }
+
+    size_t Rope::writeTo(Stream& stream) const {
+        size_t written = 0;
+        if (mRoot == nullptr)
+            return written;
+        rope_foreach(mRoot, [&](const StringView& piece) -> bool {
+            size_t n = stream.write((void*) piece.data(), piece.length());
+            written += n;
+            return n == piece.length();
+        });
+        return written;
+    }
+
+}
@@ -0,0 +1,65 @@
+#ifndef _EOKAS_BASE_ROPE_H_
+#define _EOKAS_BASE_ROPE_H_
+
+#include "./header.h"
+#include "./string.h"
+#include "./stream.h"
+
+namespace eokas {
+
+    struct RopeNode;
+
+    /*
+    ============================================================================================
+    ==== Rope
+    ==== Immutable text as a height balanced tree of shared pieces, one word by value. Copies
+    ==== share the tree, concatenation joins two trees in O(log n) and substr() cuts one in
+    ==== O(log n), the text itself is never copied by either. Short pieces that meet in a
+    ==== concatenation are merged so appending small bits stays compact.
+    ==== Trees are reference counted atomically, ropes can be shared between threads.
+    ============================================================================================
+    */
+    class Rope {
+    public:
+        static const size_t npos = (size_t) -1;
+        /// pieces up to this many chars are merged when they meet.
+        static const size_t kMergeSize = 128;
+
+    public:
+        Rope();
+        Rope(const char* str);
+        Rope(const StringView& str);
+        Rope(const String& str);
+        Rope(const Rope& other);
+        Rope(Rope&& other) noexcept;
+        ~Rope();
+
+    public:
+        Rope& operator=(const Rope& rhs);
+        Rope& operator=(Rope&& rhs) noexcept;
+        Rope operator+(const Rope& rhs) const;
+        Rope& operator+=(const Rope& rhs);
+
+    public:
+        size_t length() const;
+        bool isEmpty() const;
+        /// levels of the tree, 0 for an empty or single piece rope.
+        u32_t depth() const;
+        char at(size_t index) const;
+        Rope substr(size_t pos, size_t len = npos) const;
+
+        String toString() const;
+        /// the pieces in order.
+        void foreach(const std::function<void(const StringView& piece)>& func) const;
+        /// the bytes the stream took, length() unless it stopped early.
+        size_t writeTo(Stream& stream) const;
+
+    private:
+        explicit Rope(RopeNode* root) : mRoot(root) {}
+
+        RopeNode* mRoot;
+    };
+
+}
+
+#endif//_EOKAS_BASE_ROPE_H_
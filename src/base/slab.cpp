@@ -0,0 +1,227 @@
+
+#include "./slab.h"
+#include "./memory.h"
+#include <cstdlib>
+#include <mutex>
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== size classes
+    ==== 16 byte steps up to 128, then four classes per power of two up to kMaxSize.
+    ============================================================================================
+    */
+    static const size_t kClassCount = 8 + 8 * 4;
+    static const size_t kChunkSize = 64 * 1024;
+
+    static size_t slab_class_index(size_t size) {
+        if (size <= 128)
+            return size <= 16 ? 0 : (size + 15) / 16 - 1;
+        size_t s = size - 1;
+        size_t p = 7;
+        while ((s >> (p + 1)) != 0) {
+            p++;
+        }
+        size_t base = (size_t) 1 << p;
+        return 8 + (p - 7) * 4 + (s - base) / (base / 4);
+    }
+
+    static size_t slab_class_size(size_t index) {
+        if (index < 8)
+            return (index + 1) * 16;
+        size_t k = index - 8;
+        size_t base = (size_t) 1 << (7 + k / 4);
+        return base + (k % 4 + 1) * (base / 4);
+    }
+
+    static size_t slab_batch_count(size_t index) {
+        size_t count = 16 * 1024 / slab_class_size(index);
+        return count < 4 ? 4 : (count > 64 ? 64 : count);
+    }
+
+    struct SlabBlock {
+        SlabBlock* next;
+    };
+
+    /*
+    ============================================================================================
+    ==== central freelist, one per size class
+    ==== It is never destroyed: strings with static storage may release blocks during exit.
+    ============================================================================================
+    */
+    struct SlabCentral {
+        std::mutex mutex;
+        SlabBlock* head = nullptr;
+        size_t count = 0;
+    };
+
+    static SlabCentral* slab_central() {
+        static SlabCentral* sCentral = new SlabCentral[kClassCount];
+        return sCentral;
+    }
+
+    // pops up to `count` blocks, carving a new chunk when the central list runs dry.
+    static SlabBlock* slab_central_acquire(size_t index, size_t count, size_t& acquired) {
+        SlabCentral& central = slab_central()[index];
+        std::lock_guard<std::mutex> lock(central.mutex);
+
+        if (central.head == nullptr) {
+            size_t blockSize = slab_class_size(index);
+            size_t chunkSize = blockSize * count > kChunkSize ? blockSize * count : kChunkSize;
+            size_t blockCount = chunkSize / blockSize;
+            u8_t* chunk = (u8_t*) std::malloc(blockCount * blockSize);
+            if (chunk == nullptr) {
+                acquired = 0;
+                return nullptr;
+            }
+            // chunks are never returned, blocks move between caches without touching the tracker.
+            MemoryTracker::add(MemoryTracker::kSlab, blockCount * blockSize, 1);
+            for (size_t i = 0; i < blockCount; i++) {
+                SlabBlock* block = (SlabBlock*) (chunk + i * blockSize);
+                block->next = central.head;
+                central.head = block;
+            }
+            central.count += blockCount;
+        }
+
+        SlabBlock* head = central.head;
+        SlabBlock* tail = head;
+        acquired = 1;
+        while (acquired < count && tail->next != nullptr) {
+            tail = tail->next;
+            acquired++;
+        }
+        central.head = tail->next;
+        central.count -= acquired;
+        tail->next = nullptr;
+        return head;
+    }
+
+    static void slab_central_release(size_t index, SlabBlock* head, SlabBlock* tail, size_t count) {
+        SlabCentral& central = slab_central()[index];
+        std::lock_guard<std::mutex> lock(central.mutex);
+        tail->next = central.head;
+        central.head = head;
+        central.count += count;
+    }
+
+    /*
+    ============================================================================================
+    ==== thread cache
+    ==== Plain data so it stays usable after the guard below has flushed it at thread exit,
+    ==== from then on the thread talks to the central lists directly.
+    ============================================================================================
+    */
+    struct SlabCache {
+        SlabBlock* heads[kClassCount];
+        size_t counts[kClassCount];
+        bool armed;
+        bool dead;
+    };
+
+    static thread_local SlabCache tSlabCache;
+
+    static void slab_cache_flush(SlabCache& cache, size_t index) {
+        SlabBlock* head = cache.heads[index];
+        if (head == nullptr)
+            return;
+        SlabBlock* tail = head;
+        while (tail->next != nullptr) {
+            tail = tail->next;
+        }
+        slab_central_release(index, head, tail, cache.counts[index]);
+        cache.heads[index] = nullptr;
+        cache.counts[index] = 0;
+    }
+
+    struct SlabCacheGuard {
+        void arm() {
+            tSlabCache.armed = true;
+        }
+
+        ~SlabCacheGuard() {
+            for (size_t index = 0; index < kClassCount; index++) {
+                slab_cache_flush(tSlabCache, index);
+            }
+            tSlabCache.dead = true;
+        }
+    };
+
+    static thread_local SlabCacheGuard tSlabCacheGuard;
+
+    /*
+    ============================================================================================
+    ==== SlabAllocator
+    ============================================================================================
+    */
+    void* SlabAllocator::alloc(size_t size) {
+        if (size > kMaxSize)
+            return MemoryUtility::alloc_aligned(size, 0, false);
+
+        size_t index = slab_class_index(size);
+        SlabCache& cache = tSlabCache;
+
+        if (cache.dead) {
+            size_t acquired = 0;
+            return slab_central_acquire(index, 1, acquired);
+        }
+        if (!cache.armed) {
+            tSlabCacheGuard.arm();
+        }
+
+        SlabBlock* block = cache.heads[index];
+        if (block == nullptr) {
+            size_t acquired = 0;
+            block = slab_central_acquire(index, slab_batch_count(index), acquired);
+            if (block == nullptr)
+                return nullptr;
+            cache.counts[index] = acquired;
+        }
+        cache.heads[index] = block->next;
+        cache.counts[index] -= 1;
+        return block;
+    }
+
+    void SlabAllocator::free(void* ptr, size_t size) {
+        if (ptr == nullptr)
+            return;
+        if (size > kMaxSize) {
+            MemoryUtility::free(ptr);
+            return;
+        }
+
+        size_t index = slab_class_index(size);
+        SlabBlock* block = (SlabBlock*) ptr;
+        SlabCache& cache = tSlabCache;
+
+        if (cache.dead) {
+            slab_central_release(index, block, block, 1);
+            return;
+        }
+
+        block->next = cache.heads[index];
+        cache.heads[index] = block;
+        cache.counts[index] += 1;
+
+        // keep one batch around, hand the overflow back so other threads can reuse it.
+        size_t batch = slab_batch_count(index);
+        if (cache.counts[index] > batch * 2) {
+            SlabBlock* head = cache.heads[index];
+            SlabBlock* tail = head;
+            for (size_t i = 1; i < batch; i++) {
+                tail = tail->next;
+            }
+            cache.heads[index] = tail->next;
+            cache.counts[index] -= batch;
+            slab_central_release(index, head, tail, batch);
+        }
+    }
+
+    size_t SlabAllocator::blockSize(size_t size) {
+        if (size > kMaxSize)
+            return size;
+        return slab_class_size(slab_class_index(size));
+    }
+
+}
@@ -0,0 +1,31 @@
+
+#ifndef _EOKAS_BASE_SLAB_H_
+#define _EOKAS_BASE_SLAB_H_
+
+#include "./header.h"
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== SlabAllocator
+    ==== Thread-safe size-class allocator for small blocks.
+    ==== Each thread keeps a cache of free blocks per size class and exchanges them with a
+    ==== shared central freelist in batches, so the common path takes no lock.
+    ==== Blocks are freed with their size (the same size passed to alloc, or the rounded size
+    ==== returned by blockSize), sizes above kMaxSize go to MemoryUtility and its tag tracking.
+    ============================================================================================
+    */
+    class SlabAllocator {
+    public:
+        static const size_t kMinSize = 16;
+        static const size_t kMaxSize = 32 * 1024;
+
+        static void* alloc(size_t size);
+        static void free(void* ptr, size_t size);
+        static size_t blockSize(size_t size);
+    };
+
+}
+
+#endif//_EOKAS_BASE_SLAB_H_
@@ -1,5 +1,7 @@
 
 #include "./socket.h"
+#include <cerrno>
+#include <climits>
 
 namespace eokas {
     
@@ -207,6 +209,71 @@ namespace eokas {
         return ::send(mHandle, (char*) data, size, 0);
     }
     
+    // buffers one gather call takes at most, IOV_MAX where the system has it.
+#if defined(IOV_MAX)
+    static const size_t kSocketMaxBuffers = IOV_MAX;
+#else
+    static const size_t kSocketMaxBuffers = 1024;
+#endif
+    
+    size_t Socket::send(const MemorySegmentList& segments) const {
+        size_t total = 0;
+        size_t index = 0;   // the first segment not sent in full
+        size_t offset = 0;  // the bytes of it already sent
+#if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+        std::vector<WSABUF> buffers;
+#else
+        std::vector<iovec> buffers;
+#endif
+        while (index < segments.size()) {
+            buffers.clear();
+            size_t pending = 0;
+            for (size_t i = index; i < segments.size() && buffers.size() < kSocketMaxBuffers; i++) {
+                size_t skip = i == index ? offset : 0;
+                char* data = (char*) segments[i].data + skip;
+                size_t size = segments[i].size - skip;
+#if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+                buffers.push_back(WSABUF{(ULONG) size, data});
+#else
+                buffers.push_back(iovec{data, size});
+#endif
+                pending += size;
+            }
+            if (pending == 0)
+                break;
+            
+#if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+            DWORD count = 0;
+            if (::WSASend(mHandle, buffers.data(), (DWORD) buffers.size(), &count, 0, nullptr, nullptr) != 0)
+                break;
+            size_t sent = (size_t) count;
+#else
+            msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = buffers.data();
+            message.msg_iovlen = buffers.size();
+            ssize_t result = ::sendmsg(mHandle, &message, 0);
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result < 0)
+                break;
+            size_t sent = (size_t) result;
+#endif
+            if (sent == 0)
+                break;
+            total += sent;
+            
+            // steps over what went out, a short send resumes inside a segment.
+            while (index < segments.size() && sent >= segments[index].size - offset) {
+                sent -= segments[index].size - offset;
+                index += 1;
+                offset = 0;
+            }
+            offset += sent;
+        }
+        return total;
+    }
+    
     u32_t Socket::recvFrom(void* data, u32_t size, const SocketAddress& addr) {
         sockaddr sa = addr;
         socklen_t len = sizeof(sa);
@@ -3,6 +3,7 @@
 #define  _EOKAS_BASE_SOCKET_H_
 
 #include "./header.h"
+#include "./memory.h"
 
 #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
 
@@ -17,6 +18,7 @@ using socklen_t = int;
 
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -117,6 +119,10 @@ namespace eokas {
         Socket accept() const;
         u32_t recv(void* data, u32_t size) const;
         u32_t send(void* data, u32_t size) const;
+        /// gathers the segments into as few send calls as the system allows and resends what a
+        /// short send left, e.g. SegmentedMemoryStream::segments(). The bytes sent, less than
+        /// the segments hold when an error stopped it.
+        size_t send(const MemorySegmentList& segments) const;
         u32_t recvFrom(void* data, u32_t size, const SocketAddress& addr);
         u32_t sendTo(void* data, u32_t size, const SocketAddress& addr);
     
@@ -1,51 +1,192 @@
 
 #include "./string.h"
+#include "./slab.h"
+#include "./utf8.h"
+#include "./ascil.h"
 #include <cstring>
 #include <algorithm>
 
+#if _EOKAS_ARCH == _EOKAS_ARCH_X64
+#define _EOKAS_STRING_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
 namespace eokas {
     
-    class StringPool {
-    public:
-        static StringPool& instance() {
-            static StringPool sInstance;
-            return sInstance;
+    static char* string_alloc(size_t capacity) {
+        return (char*) SlabAllocator::alloc(capacity);
+    }
+    
+    static void string_free(char* ptr, size_t capacity) {
+        SlabAllocator::free(ptr, capacity);
+    }
+    
+    static_assert(sizeof(String) == String::kInlineSize, "String must stay three words.");
+    
+    /*
+    ============================================================================================
+    ==== substring search
+    ==== Needles of two chars and more. A block of haystack positions is compared against the
+    ==== first and the last char of the needle at once, only positions matching both are
+    ==== checked with memcmp. Loads never reach past the haystack, the rest is scalar.
+    ============================================================================================
+    */
+    using StringSearch = size_t (*)(const char* hay, size_t size, const char* needle, size_t length);
+    
+    static size_t string_search_scalar(const char* hay, size_t size, const char* needle, size_t length) {
+        if (size < length)
+            return String::npos;
+        const char* cur = hay;
+        const char* last = hay + size - length;
+        while (cur <= last) {
+            cur = (const char*) memchr(cur, needle[0], last - cur + 1);
+            if (cur == nullptr)
+                return String::npos;
+            if (cur[length - 1] == needle[length - 1] && memcmp(cur + 1, needle + 1, length - 2) == 0)
+                return cur - hay;
+            cur++;
         }
-        
-        ~StringPool() {
-            if (!mStrings.empty()) {
-                auto iter = mStrings.begin();
-                while (iter != mStrings.end()) {
-                    char* ptr = (char*) (*iter);
-                    if (ptr != nullptr) {
-                        delete[]ptr;
-                    }
-                    ++iter;
-                }
-                mStrings.clear();
+        return String::npos;
+    }
+    
+    // candidates in [0, count), highest first.
+    static size_t string_rsearch_scalar(const char* hay, size_t count, const char* needle, size_t length) {
+        for (size_t i = count; i > 0; i--) {
+            const char* cur = hay + i - 1;
+            if (cur[0] == needle[0] && cur[length - 1] == needle[length - 1] && memcmp(cur + 1, needle + 1, length - 2) == 0)
+                return i - 1;
+        }
+        return String::npos;
+    }
+    
+#if defined(_EOKAS_STRING_SIMD)
+    static u32_t string_ctz(u32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return (u32_t) __builtin_ctz(mask);
+#endif
+    }
+    
+    static u32_t string_highest(u32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return index;
+#else
+        return 31 - (u32_t) __builtin_clz(mask);
+#endif
+    }
+    
+    static size_t string_search_sse2(const char* hay, size_t size, const char* needle, size_t length) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[length - 1]);
+        size_t i = 0;
+        for (; i + length + 15 <= size; i += 16) {
+            __m128i blockFirst = _mm_loadu_si128((const __m128i*) (hay + i));
+            __m128i blockLast = _mm_loadu_si128((const __m128i*) (hay + i + length - 1));
+            __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast));
+            u32_t mask = (u32_t) _mm_movemask_epi8(eq);
+            while (mask != 0) {
+                u32_t bit = string_ctz(mask);
+                if (memcmp(hay + i + bit + 1, needle + 1, length - 2) == 0)
+                    return i + bit;
+                mask &= mask - 1;
             }
         }
-        
-        char* get() {
-            char* ptr = nullptr;
-            if (mStrings.empty()) {
-                ptr = new char[_STRING_MIDDLE_LENGTH + 1];
-            } else {
-                ptr = (char*) mStrings.front();
-                mStrings.pop_front();
+        size_t found = string_search_scalar(hay + i, size - i, needle, length);
+        return found != String::npos ? i + found : found;
+    }
+    
+    static size_t string_rsearch_sse2(const char* hay, size_t count, const char* needle, size_t length) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[length - 1]);
+        for (; count >= 16; count -= 16) {
+            size_t base = count - 16;
+            __m128i blockFirst = _mm_loadu_si128((const __m128i*) (hay + base));
+            __m128i blockLast = _mm_loadu_si128((const __m128i*) (hay + base + length - 1));
+            __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast));
+            u32_t mask = (u32_t) _mm_movemask_epi8(eq);
+            while (mask != 0) {
+                u32_t bit = string_highest(mask);
+                if (memcmp(hay + base + bit + 1, needle + 1, length - 2) == 0)
+                    return base + bit;
+                mask &= ~(1u << bit);
             }
-            memset(ptr, 0, _STRING_MIDDLE_LENGTH + 1);
-            return ptr;
         }
-        
-        void put(char* ptr) {
-            if (ptr == nullptr)
-                return;
-            mStrings.push_back(ptr);
+        return string_rsearch_scalar(hay, count, needle, length);
+    }
+    
+#if defined(__GNUC__)
+    __attribute__((target("avx2")))
+    static size_t string_search_avx2(const char* hay, size_t size, const char* needle, size_t length) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+        size_t i = 0;
+        for (; i + length + 31 <= size; i += 32) {
+            __m256i blockFirst = _mm256_loadu_si256((const __m256i*) (hay + i));
+            __m256i blockLast = _mm256_loadu_si256((const __m256i*) (hay + i + length - 1));
+            __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast));
+            u32_t mask = (u32_t) _mm256_movemask_epi8(eq);
+            while (mask != 0) {
+                u32_t bit = string_ctz(mask);
+                if (memcmp(hay + i + bit + 1, needle + 1, length - 2) == 0)
+                    return i + bit;
+                mask &= mask - 1;
+            }
         }
+        size_t found = string_search_sse2(hay + i, size - i, needle, length);
+        return found != String::npos ? i + found : found;
+    }
+    
+    __attribute__((target("avx2")))
+    static size_t string_rsearch_avx2(const char* hay, size_t count, const char* needle, size_t length) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+        for (; count >= 32; count -= 32) {
+            size_t base = count - 32;
+            __m256i blockFirst = _mm256_loadu_si256((const __m256i*) (hay + base));
+            __m256i blockLast = _mm256_loadu_si256((const __m256i*) (hay + base + length - 1));
+            __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast));
+            u32_t mask = (u32_t) _mm256_movemask_epi8(eq);
+            while (mask != 0) {
+                u32_t bit = string_highest(mask);
+                if (memcmp(hay + base + bit + 1, needle + 1, length - 2) == 0)
+                    return base + bit;
+                mask &= ~(1u << bit);
+            }
+        }
+        return string_rsearch_sse2(hay, count, needle, length);
+    }
+#endif
+#endif
     
-    private:
-        std::list<char*> mStrings;
+    struct StringSearchKernels {
+        StringSearch search;
+        StringSearch rsearch;
+        
+        static const StringSearchKernels& instance() {
+            static const StringSearchKernels sInstance = StringSearchKernels::detect();
+            return sInstance;
+        }
+        
+        static StringSearchKernels detect() {
+#if defined(_EOKAS_STRING_SIMD) && defined(__GNUC__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return {string_search_avx2, string_rsearch_avx2};
+#endif
+#if defined(_EOKAS_STRING_SIMD)
+            return {string_search_sse2, string_rsearch_sse2};
+#else
+            return {string_search_scalar, string_rsearch_scalar};
+#endif
+        }
     };
     
     const size_t String::npos = (size_t) (-1);
@@ -55,20 +196,48 @@ namespace eokas {
     const String String::trueValue = "true";
     const String String::falseValue = "false";
     
+    // the capacity word carries kHeapFlag in the byte that overlaps mInline[kInlineLength].
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    static size_t string_encode_capacity(size_t capacity) {
+        return (capacity << 8) | 0x80;
+    }
+    
+    static size_t string_decode_capacity(size_t word) {
+        return word >> 8;
+    }
+#else
+    static const size_t kStringTopByte = (size_t) 0xFF << (sizeof(size_t) * 8 - 8);
+    
+    static size_t string_encode_capacity(size_t capacity) {
+        return capacity | ((size_t) 0x80 << (sizeof(size_t) * 8 - 8));
+    }
+    
+    static size_t string_decode_capacity(size_t word) {
+        return word & ~kStringTopByte;
+    }
+#endif
+    
+    /// 0: inline, 1: small heap block, 2: large heap block.
     char String::measure(size_t len) {
         if (len >= _STRING_MIDDLE_LENGTH)
             return 2;
-        if (len >= _STRING_LITTLE_LENGTH)
+        if (len > kInlineLength)
             return 1;
         return 0;
     }
     
+    /// capacity for a string growing to `len` bytes: powers of two up to the middle length,
+    /// then half as much again.
     size_t String::predict(size_t len) {
+        if (len <= kInlineSize)
+            return kInlineSize;
         if (len >= _STRING_MIDDLE_LENGTH)
-            return (size_t) (len * 2);
-        if (len >= _STRING_LITTLE_LENGTH)
-            return _STRING_MIDDLE_LENGTH;
-        return _STRING_LITTLE_LENGTH;
+            return len + len / 2;
+        size_t capacity = kInlineSize;
+        while (capacity < len) {
+            capacity *= 2;
+        }
+        return capacity;
     }
     /*
     ============================================================================================
@@ -96,157 +265,47 @@ namespace eokas {
     U-00000000 - U-0000007F: 0xxxxxxx
     U-00000080 - U-000007FF: 110xxxxx 10xxxxxx
     U-00000800 - U-0000FFFF: 1110xxxx 10xxxxxx 10xxxxxx
-    U-00010000 - U-001FFFFF: 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-    U-00200000 - U-03FFFFFF: 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-    U-04000000 - U-7FFFFFFF: 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
+    U-00010000 - U-0010FFFF: 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+    The 5 and 6 byte forms are gone since RFC 3629, so are surrogates, see UTF8.
     */
     MBString String::unicodeToUtf8(const WCString& unicodeStr, bool bom) {
-        std::stringstream utf8;
-        if (bom) {
-            utf8 << "\xef\xbb\xbf"; // utf8 bom is EF BB BF
-        }
-        
-        const wchar_t* pos = unicodeStr.c_str();
-        size_t length = unicodeStr.length();
-        size_t count = 0;
+        const wchar_t* src = unicodeStr.data();
+        size_t size = unicodeStr.length();
         // check and ignore bom in unicodeStr
-        if (length >= 1 && pos[0] == 0xFEFF) {
-            count += 1;
-            pos += 1;
-        }
-        while (count < length) {
-            if (*pos < 0x80) {
-                char c1 = *pos & 0x7f;
-                utf8 << c1;
-            } else if (*pos < 0x800) {
-                char c1 = ((*pos >> 6) & 0x1f) | 0xc0;
-                char c2 = (*pos & 0x3f) | 0x80;
-                utf8 << c1 << c2;
-            } else if (*pos < 0x10000) {
-                char c1 = ((*pos >> 12) & 0x0f) | 0xe0;
-                char c2 = ((*pos >> 6) & 0x3f) | 0x80;
-                char c3 = (*pos & 0x3f) | 0x80;
-                utf8 << c1 << c2 << c3;
-            }
-#if (_EOKAS_UCS == _EOKAS_UCS_4)
-            else if(*pos < 0x200000)
-            {
-                char c1 = ((*pos >> 18) & 0x07) | 0xf0;
-                char c2 = ((*pos >> 12) & 0x3f) | 0x80;
-                char c3 = ((*pos >> 6) & 0x3f) | 0x80;
-                char c4 = (*pos & 0x3f) | 0x80;
-                utf8 << c1 << c2 << c3 << c4;
-            }
-            else if(*pos < 0x4000000)
-            {
-                char c1 = ((*pos >> 24) & 0x03) | 0xf8;
-                char c2 = ((*pos >> 18) & 0x3f) | 0x80;
-                char c3 = ((*pos >> 12) & 0x3f) | 0x80;
-                char c4 = ((*pos >> 6) & 0x3f) | 0x80;
-                char c5 = (*pos & 0x3f) | 0x80;
-                utf8 << c1 << c2 << c3 << c4 << c5;
-            }
-            else if(*pos < 0x80000000)
-            {
-                char c1 = ((*pos >> 30) & 0x01)|0xfc;
-                char c2 = ((*pos >> 24) & 0x3f)|0x80;
-                char c3 = ((*pos >> 18) & 0x3f)|0x80;
-                char c4 = ((*pos >> 12) & 0x3f)|0x80;
-                char c5 = ((*pos >> 6) & 0x3f)|0x80;
-                char c6 = (*pos & 0x3f)|0x80;
-                utf8 << c1 << c2 << c3 << c4 << c5 << c6;
-            }
-#endif//(_EOKAS_UCS == _EOKAS_UCS_4)
-            count += 1;
-            pos += 1;
+        if (size >= 1 && src[0] == 0xFEFF) {
+            src += 1;
+            size -= 1;
         }
         
-        return utf8.str();
+        size_t offset = bom ? 3 : 0;
+        MBString utf8(offset + size * (sizeof(wchar_t) == 2 ? 3 : 4), '\0');
+        if (bom) {
+            utf8.replace(0, 3, "\xef\xbb\xbf"); // utf8 bom is EF BB BF
+        }
+        // ill formed units become U+FFFD.
+        size_t written = UTF8::fromWide(src, size, &utf8[offset], true);
+        utf8.resize(offset + written);
+        return utf8;
     }
     
     WCString String::utf8ToUnicode(const MBString& utf8Str, bool bom) {
-        std::wstringstream unicode;
-        if (bom) {
-            unicode << 0xFEFF; // unicode bom
-        }
-        const char* pos = utf8Str.c_str();
-        size_t length = utf8Str.length();
-        size_t count = 0;
+        const char* src = utf8Str.data();
+        size_t size = utf8Str.length();
         // check and ignore bom in utf8Str
-        if (length >= 3 && int(pos[0]) == 0xEF && int(pos[1]) == 0xBB && int(pos[2]) == 0xBF) {
-            count += 3;
-            pos += 3;
-        }
-        while (count < length) {
-            wchar_t wc = L'\0';
-            u8_t c = *pos;
-            if (c < 0xC0) {
-                count += 1;
-                if (count <= length) {
-                    wc = *pos;
-                    pos += 1;
-                }
-            } else if (c < 0xE0) {
-                count += 2;
-                if (count <= length) {
-                    wc = (pos[0] & 0x1F) << 6;
-                    wc |= (pos[1] & 0x3F);
-                    pos += 2;
-                }
-            } else if (c < 0xF0) {
-                count += 3;
-                if (count <= length) {
-                    wc = (pos[0] & 0x0F) << 12;
-                    wc |= (pos[1] & 0x3F) << 6;
-                    wc |= (pos[2] & 0x3F);
-                    pos += 3;
-                }
-            }
-#if (_EOKAS_UCS == _EOKAS_UCS_4)
-            else if(c < 0xF8)
-            {
-                count += 4;
-                if(count <= length)
-                {
-                    wc = (*pos[0] & 0x07) << 18;
-                    wc |= (*pos[1] & 0x3F) << 12;
-                    wc |= (*pos[2] & 0x3F) << 6;
-                    wc |= (*pos[3] & 0x3F);
-                    pos += 4;
-                }
-            }
-            else if(c < 0xFC)
-            {
-                count += 5;
-                if(count <= length)
-                {
-                    wc = (*pos[0] & 0x03) << 24;
-                    wc |= (*pos[1] & 0x3F) << 18;
-                    wc |= (*pos[2] & 0x3F) << 12;
-                    wc |= (*pos[3] & 0x3F) << 6;
-                    wc |= (*pos[4] & 0x3F);
-                    pos += 5;
-                }
-            }
-            else
-            {
-                count += 6;
-                if(count <= length)
-                {
-                    wc = (*pos[0] & 0x01) << 30;
-                    wc |= (*pos[1] & 0x3F) << 24;
-                    wc |= (*pos[2] & 0x3F) << 18;
-                    wc |= (*pos[3] & 0x3F) << 12;
-                    wc |= (*pos[4] & 0x3F) << 6;
-                    wc |= (*pos[5] & 0x3F);
-                    pos += 6;
-                }
-            }
-#endif//(_EOKAS_UCS == _EOKAS_UCS_4)
-            unicode << wc;
+        if (size >= 3 && (u8_t) src[0] == 0xEF && (u8_t) src[1] == 0xBB && (u8_t) src[2] == 0xBF) {
+            src += 3;
+            size -= 3;
         }
         
-        return unicode.str();
+        size_t offset = bom ? 1 : 0;
+        WCString unicode(offset + size, L'\0');
+        if (bom) {
+            unicode[0] = (wchar_t) 0xFEFF; // unicode bom
+        }
+        // ill formed bytes become U+FFFD.
+        size_t written = UTF8::toWide(src, size, &unicode[offset], true);
+        unicode.resize(offset + written);
+        return unicode;
     }
     
     static u8_t hexchars[] = "0123456789ABCDEF";
@@ -302,8 +361,30 @@ namespace eokas {
     }
     
     String String::format(const char* fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        String result = String::formatVA(fmt, ap);
+        va_end(ap);
+        return result;
+    }
+    
+    String String::formatVA(const char* fmt, va_list ap) {
+        char buffer[_STRING_MIDDLE_LENGTH];
+        va_list copy;
+        va_copy(copy, ap);
+        i32_t size = vsnprintf(buffer, sizeof(buffer), fmt, copy);
+        va_end(copy);
+        if (size <= 0)
+            return String();
+        if ((size_t) size < sizeof(buffer))
+            return String(buffer, (size_t) size);
+        
+        // too long to be inline, goes straight into a heap block.
+        size_t bytes = SlabAllocator::blockSize((size_t) size + 1);
+        char* data = string_alloc(bytes);
+        vsnprintf(data, (size_t) size + 1, fmt, ap);
         String result;
-        _FormatVA(result, fmt);
+        result.adopt(data, (size_t) size, bytes);
         return result;
     }
     
@@ -311,7 +392,7 @@ namespace eokas {
         if (n == 0) return "";
         std::stringstream stream;
         for (size_t i = 0; i < n; i++) {
-            stream << str.mData;
+            stream << str.cstr();
         }
         return stream.str();
     }
@@ -321,11 +402,11 @@ namespace eokas {
             return "";
         std::stringstream stream;
         auto iter = segments.begin();
-        stream << iter->mData;
+        stream << iter->cstr();
         ++iter;
         while (iter != segments.end()) {
-            stream << delim.mData;
-            stream << iter->mData;
+            stream << delim.cstr();
+            stream << iter->cstr();
             ++iter;
         }
         return stream.str();
@@ -336,123 +417,130 @@ namespace eokas {
             return "";
         std::stringstream stream;
         auto iter = segments.begin();
-        stream << iter->first.mData << conn.mData << iter->second.mData;
+        stream << iter->first.cstr() << conn.cstr() << iter->second.cstr();
         ++iter;
         while (iter != segments.end()) {
-            stream << delim.mData;
-            stream << iter->first.mData << conn.mData << iter->second.mData;
+            stream << delim.cstr();
+            stream << iter->first.cstr() << conn.cstr() << iter->second.cstr();
             ++iter;
         }
         return stream.str();
     }
     
-    String::String(char chr, size_t len)
-        : mData(mValue), mSize(0), mCapacity(_STRING_LITTLE_LENGTH), mMetric(0) {
-        mValue[0] = '\0';
+    void String::reset() {
+        mInline[0] = '\0';
+        mInline[kInlineLength] = (char) kInlineLength;
+    }
+    
+    void String::adopt(char* data, size_t size, size_t capacity) {
+        mHeap.data = data;
+        mHeap.size = size;
+        mHeap.capacity = string_encode_capacity(capacity);
+    }
+    
+    // room for `len` chars, the content is kept. grow leaves headroom for further appends,
+    // otherwise the block is as tight as the slab classes allow.
+    char* String::reserve(size_t len, bool grow) {
+        size_t capacity = this->capacity();
+        if (len <= capacity)
+            return this->buffer();
+        size_t size = this->length();
+        size_t bytes = SlabAllocator::blockSize(grow ? String::predict(len + 1) : len + 1);
+        char* data = string_alloc(bytes);
+        memcpy(data, this->buffer(), size + 1);
+        if (this->isHeap()) {
+            string_free(mHeap.data, capacity + 1);
+        }
+        this->adopt(data, size, bytes);
+        return data;
+    }
+    
+    void String::resize(size_t len) {
+        if (this->isHeap()) {
+            mHeap.data[len] = '\0';
+            mHeap.size = len;
+        } else {
+            mInline[len] = '\0';
+            mInline[kInlineLength] = (char) (kInlineLength - len);
+        }
+    }
+    
+    String::String(char chr, size_t len) {
+        this->reset();
         len = chr != '\0' ? len : 0;
         if (len > 0) {
-            mMetric = String::measure(len);
-            if (mMetric == 1) {
-                mData = StringPool::instance().get();
-                mCapacity = _STRING_MIDDLE_LENGTH;
-            } else if (mMetric == 2) {
-                mCapacity = String::predict(len + 1);
-                mData = new char[mCapacity];
-            }
-            memset(mData, chr, len);
-            mData[len] = '\0';
-            mSize = len;
+            memset(this->reserve(len, false), chr, len);
+            this->resize(len);
         }
     }
     
-    String::String(const char* mbcstr, size_t len)
-        : mData(mValue), mSize(0), mCapacity(_STRING_LITTLE_LENGTH), mMetric(0) {
-        mValue[0] = '\0';
+    String::String(const char* mbcstr, size_t len) {
+        this->reset();
         if (mbcstr != nullptr) {
-            len = std::min(len, strlen(mbcstr));
+            // stop at a terminator, but never look past `len` chars.
+            const char* end = len == npos ? nullptr : (const char*) memchr(mbcstr, '\0', len);
+            len = len == npos ? strlen(mbcstr) : (end != nullptr ? end - mbcstr : len);
             if (len > 0) {
-                mMetric = String::measure(len);
-                if (mMetric == 1) {
-                    mData = StringPool::instance().get();
-                    mCapacity = _STRING_MIDDLE_LENGTH;
-                } else if (mMetric == 2) {
-                    mCapacity = String::predict(len + 1);
-                    mData = new char[mCapacity];
-                }
-                memcpy(mData, mbcstr, len);
-                mData[len] = '\0';
-                mSize = len;
+                memcpy(this->reserve(len, false), mbcstr, len);
+                this->resize(len);
             }
         }
     }
     
     String::String(const MBString& mbstr)
-        : mData(mValue), mSize(0), mCapacity(_STRING_LITTLE_LENGTH), mMetric(0) {
-        new(this)String(mbstr.c_str());
+        : String(mbstr.c_str()) {
     }
     
     String::String(const WCString& wcstr)
-        : mData(mValue), mSize(0), mCapacity(_STRING_LITTLE_LENGTH), mMetric(0) {
-        new(this)String(String::unicodeToUtf8(wcstr, false).c_str());
-    }
-    
-    String::String(const String& other)
-        : mData(mValue), mSize(0), mCapacity(_STRING_LITTLE_LENGTH), mMetric(0) {
-        new(this)String(other.mData);
-    }
-    
-    String::String(String&& other)
-        : mData(mValue), mSize(other.mSize), mCapacity(other.mCapacity), mMetric(other.mMetric) {
-        mValue[0] = '\0';
-        size_t len = mSize;
-        if (mMetric == 0) {
-            memcpy(mData, other.mData, len);
-            mData[len] = '\0';
-        } else if (mMetric == 1 || mMetric == 2) {
-            mData = other.mData;
-            other.mData = nullptr;
-            other.clear();
+        : String(String::unicodeToUtf8(wcstr, false).c_str()) {
+    }
+    
+    String::String(const StringView& view)
+        : String(view.data(), view.length()) {
+    }
+    
+    String::String(const String& other) {
+        if (!other.isHeap()) {
+            memcpy(&mHeap, &other.mHeap, sizeof(Heap));
+            return;
         }
+        this->reset();
+        size_t len = other.mHeap.size;
+        memcpy(this->reserve(len, false), other.mHeap.data, len);
+        this->resize(len);
+    }
+    
+    String::String(String&& other) noexcept {
+        memcpy(&mHeap, &other.mHeap, sizeof(Heap));
+        other.reset();
     }
     
     String::~String() {
-        this->clear();
+        if (this->isHeap()) {
+            string_free(mHeap.data, this->capacity() + 1);
+        }
     }
     
     String& String::operator=(const String& rhs) {
         if (this == &rhs)
             return *this;
-        this->clear();
-        mSize = rhs.mSize;
-        mCapacity = rhs.mCapacity;
-        mMetric = rhs.mMetric;
-        size_t len = mSize;
-        if (mMetric == 1) {
-            mData = StringPool::instance().get();
-        } else if (mMetric == 2) {
-            mData = new char[mCapacity];
+        size_t len = rhs.length();
+        if (len > this->capacity()) {
+            this->clear();
         }
-        memcpy(mData, rhs.mData, len);
-        mData[len] = '\0';
+        memcpy(this->reserve(len, false), rhs.buffer(), len);
+        this->resize(len);
         return *this;
     }
     
-    String& String::operator=(String&& rhs) {
+    String& String::operator=(String&& rhs) noexcept {
         if (this == &rhs)
             return *this;
-        this->clear();
-        mSize = rhs.mSize;
-        mCapacity = rhs.mCapacity;
-        mMetric = rhs.mMetric;
-        size_t len = mSize;
-        if (mMetric == 0) {
-            memcpy(mData, rhs.mData, len);
-            mData[len] = '\0';
-        } else if (mMetric == 1 || mMetric == 2) {
-            mData = rhs.mData;
-            rhs.mData = nullptr;
-            rhs.clear();
+        if (this->isHeap()) {
+            string_free(mHeap.data, this->capacity() + 1);
         }
+        memcpy(&mHeap, &rhs.mHeap, sizeof(Heap));
+        rhs.reset();
         return *this;
     }
     
@@ -461,57 +549,45 @@ namespace eokas {
     }
     
     String String::operator+(const String& rhs) const {
-        size_t len1 = mSize;
+        size_t len1 = this->length();
         if (len1 == 0)
             return rhs;
         
-        size_t len2 = rhs.mSize;
+        size_t len2 = rhs.length();
         if (len2 == 0)
             return *this;
         
         String result;
-        char metric = String::measure(len1 + len2);
-        size_t capacity = _STRING_LITTLE_LENGTH;
-        char* ptr = result.mData;
-        if (metric == 1) {
-            capacity = _STRING_MIDDLE_LENGTH;
-            ptr = StringPool::instance().get();
-        } else if (metric == 2) {
-            capacity = String::predict(len1 + len2 + 1);
-            ptr = new char[capacity];
-        }
-        memcpy(ptr, mData, len1);
-        memcpy(ptr + len1, rhs.mData, len2);
-        ptr[len1 + len2] = '\0';
-        result.mData = ptr;
-        result.mSize = len1 + len2;
-        result.mCapacity = capacity;
-        result.mMetric = metric;
+        char* ptr = result.reserve(len1 + len2, false);
+        memcpy(ptr, this->buffer(), len1);
+        memcpy(ptr + len1, rhs.buffer(), len2);
+        result.resize(len1 + len2);
         return result;
     }
     
     bool String::operator>(const String& rhs) const {
-        return std::strcmp(mData, rhs.mData) > 0;
+        return this->compare(rhs) > 0;
     }
     
     bool String::operator<(const String& rhs) const {
-        return std::strcmp(mData, rhs.mData) < 0;
+        return this->compare(rhs) < 0;
     }
     
     bool String::operator>=(const String& rhs) const {
-        return std::strcmp(mData, rhs.mData) >= 0;
+        return this->compare(rhs) >= 0;
     }
     
     bool String::operator<=(const String& rhs) const {
-        return std::strcmp(mData, rhs.mData) <= 0;
+        return this->compare(rhs) <= 0;
     }
     
     bool String::operator==(const String& rhs) const {
-        return std::strcmp(mData, rhs.mData) == 0;
+        size_t len = this->length();
+        return len == rhs.length() && memcmp(this->buffer(), rhs.buffer(), len) == 0;
     }
     
     bool String::operator!=(const String& rhs) const {
-        return std::strcmp(mData, rhs.mData) != 0;
+        return !(*this == rhs);
     }
     
     const char* String::operator*() const {
@@ -519,20 +595,10 @@ namespace eokas {
     }
     
     String& String::clear() {
-        if (mData != nullptr) {
-            if (mMetric == 1) {
-                StringPool::instance().put(mData);
-            } else if (mMetric == 2) {
-                delete[]mData;
-            }
-            mData = nullptr;
+        if (this->isHeap()) {
+            string_free(mHeap.data, this->capacity() + 1);
         }
-        
-        mData = mValue;
-        mSize = 0;
-        mCapacity = _STRING_LITTLE_LENGTH;
-        mMetric = 0;
-        mValue[0] = '\0';
+        this->reset();
         return *this;
     }
     
@@ -540,58 +606,23 @@ namespace eokas {
         if (this == &str || str.isEmpty())
             return *this;
         
-        size_t len1 = mSize;
-        size_t len2 = str.mSize;
-        
-        size_t capacity = mCapacity;
-        char metric = String::measure(len1 + len2);
-        if (metric == mMetric) {
-            if (metric == 0 || metric == 1) {
-                memcpy(mData + len1, str.mData, len2);
-                mData[len1 + len2] = '\0';
-            } else if (metric == 2) {
-                if (capacity >= len1 + len2 + 1) {
-                    memcpy(mData + len1, str.mData, len2);
-                    mData[len1 + len2] = '\0';
-                } else {
-                    capacity = String::predict(len1 + len2 + 1);
-                    char* ptr = new char[capacity];
-                    
-                    memcpy(ptr, mData, len1);
-                    memcpy(ptr + len1, str.mData, len2);
-                    ptr[len1 + len2] = '\0';
-                    
-                    delete[]mData;
-                    mData = ptr;
-                }
-            }
-        } else {
-            if (metric == 1) {
-                capacity = _STRING_MIDDLE_LENGTH;
-                char* ptr = StringPool::instance().get();
-                
-                memcpy(ptr, mData, len1);
-                memcpy(ptr + len1, str.mData, len2);
-                ptr[len1 + len2] = '\0';
-                
-                mData = ptr;
-            } else if (metric == 2) {
-                capacity = String::predict(len1 + len2 + 1);
-                char* ptr = new char[capacity];
-                
-                memcpy(ptr, mData, len1);
-                memcpy(ptr + len1, str.mData, len2);
-                ptr[len1 + len2] = '\0';
-                
-                if (mMetric == 1) {
-                    StringPool::instance().put(mData);
-                }
-                mData = ptr;
-            }
+        return this->append(str.buffer(), str.length());
+    }
+    
+    String& String::append(const char* data, size_t length) {
+        if (length == 0)
+            return *this;
+        size_t len1 = this->length();
+        const char* ptr = this->buffer();
+        if (data >= ptr && data <= ptr + len1) {
+            // appending a piece of itself, the block may move.
+            String piece(StringView(data, length));
+            return this->append(piece);
         }
-        mSize = len1 + len2;
-        mCapacity = capacity;
-        mMetric = metric;
+        
+        char* dst = this->reserve(len1 + length, true);
+        memcpy(dst + len1, data, length);
+        this->resize(len1 + length);
         return *this;
     }
     
@@ -599,167 +630,92 @@ namespace eokas {
         if (this == &str || str.isEmpty())
             return *this;
         
-        if (pos > mSize) pos = mSize;
-        
-        size_t len1 = mSize;
-        size_t len2 = str.mSize;
+        size_t len1 = this->length();
+        size_t len2 = str.length();
+        if (pos > len1) pos = len1;
         
-        size_t capacity = mCapacity;
-        char metric = String::measure(len1 + len2);
-        if (metric == mMetric) {
-            if (metric == 0 || metric == 1) {
-                memcpy(mData + pos + len2, mData + pos, len1 - pos);
-                memcpy(mData + pos, str.mData, len2);
-                mData[len1 + len2] = '\0';
-            } else if (metric == 2) {
-                if (capacity >= len1 + len2 + 1) {
-                    memcpy(mData + pos + len2, mData + pos, len1 - pos);
-                    memcpy(mData + pos, str.mData, len2);
-                    mData[len1 + len2] = '\0';
-                } else {
-                    capacity = String::predict(len1 + len2 + 1);
-                    char* ptr = new char[capacity];
-                    
-                    memcpy(ptr, mData, pos);
-                    memcpy(ptr + pos, str.mData, len2);
-                    memcpy(ptr + pos + len2, mData + pos, len1 - pos);
-                    ptr[len1 + len2] = '\0';
-                    
-                    delete[]mData;
-                    mData = ptr;
-                }
-            }
-        } else {
-            if (metric == 1) {
-                capacity = _STRING_MIDDLE_LENGTH;
-                char* ptr = StringPool::instance().get();
-                
-                memcpy(ptr, mData, pos);
-                memcpy(ptr + pos, str.mData, len2);
-                memcpy(ptr + pos + len2, mData + pos, len1 - pos);
-                ptr[len1 + len2] = '\0';
-                
-                mData = ptr;
-            } else if (metric == 2) {
-                capacity = String::predict(len1 + len2 + 1);
-                char* ptr = new char[capacity];
-                
-                memcpy(ptr, mData, pos);
-                memcpy(ptr + pos, str.mData, len2);
-                memcpy(ptr + pos + len2, mData + pos, len1 - pos);
-                ptr[len1 + len2] = '\0';
-                
-                if (mMetric == 1) {
-                    StringPool::instance().put(mData);
-                }
-                mData = ptr;
-            }
-        }
-        mSize = len1 + len2;
-        mCapacity = capacity;
-        mMetric = metric;
+        char* ptr = this->reserve(len1 + len2, true);
+        memmove(ptr + pos + len2, ptr + pos, len1 - pos);
+        memcpy(ptr + pos, str.buffer(), len2);
+        this->resize(len1 + len2);
         return *this;
     }
     
     String& String::remove(size_t pos, size_t len) {
-        if (pos > mSize) pos = mSize;
-        if (pos + len > mSize) len = mSize - pos;
+        size_t size = this->length();
+        if (pos > size) pos = size;
+        if (len > size - pos) len = size - pos;
         if (len == 0)
             return *this;
-        if (len == mSize)
+        if (len == size)
             return this->clear();
         
-        size_t nlen = mSize - len;
-        char metric = String::measure(nlen);
-        if (metric == mMetric) {
-            memcpy(mData + pos, mData + pos + len, mSize - pos - len);
-            mData[nlen] = '\0';
-            mSize = nlen;
+        size_t nlen = size - len;
+        if (this->isHeap() && nlen <= kInlineLength) {
+            // shrunk enough to live inline again, give the heap block back.
+            char* data = mHeap.data;
+            size_t bytes = this->capacity() + 1;
+            memcpy(mInline, data, pos);
+            memcpy(mInline + pos, data + pos + len, size - pos - len);
+            mInline[nlen] = '\0';
+            mInline[kInlineLength] = (char) (kInlineLength - nlen);
+            string_free(data, bytes);
         } else {
-            if (metric == 0) {
-                char* ptr = mValue;
-                memcpy(ptr, mData, pos);
-                memcpy(ptr + pos, mData + pos + len, mSize - pos - len);
-                ptr[nlen] = '\0';
-                if (mMetric == 1) {
-                    StringPool::instance().put(mData);
-                } else if (mMetric == 2) {
-                    delete[]mData;
-                }
-                mData = ptr;
-                mSize = nlen;
-                mCapacity = _STRING_LITTLE_LENGTH;
-                mMetric = metric;
-            } else if (metric == 1) {
-                char* ptr = StringPool::instance().get();
-                memcpy(ptr, mData, pos);
-                memcpy(ptr + pos, mData + pos + len, mSize - pos - len);
-                ptr[nlen] = '\0';
-                
-                delete[]mData;
-                
-                mData = ptr;
-                mSize = nlen;
-                mCapacity = _STRING_MIDDLE_LENGTH;
-                mMetric = metric;
-            }
+            char* ptr = this->buffer();
+            memmove(ptr + pos, ptr + pos + len, size - pos - len);
+            this->resize(nlen);
         }
         return *this;
     }
     
     size_t String::length() const {
-        return mSize;
+        if (this->isHeap())
+            return mHeap.size;
+        return kInlineLength - (u8_t) mInline[kInlineLength];
+    }
+    
+    size_t String::capacity() const {
+        if (this->isHeap())
+            return string_decode_capacity(mHeap.capacity) - 1;
+        return kInlineLength;
     }
     
     const char* String::cstr() const {
-        return mData;
+        return this->buffer();
     }
     
     bool String::isEmpty() const {
-        return mData[0] == '\0';
+        return this->buffer()[0] == '\0';
     }
     
     char String::at(size_t index) const {
-        if (index >= mSize)
+        if (index >= this->length())
             return '\0';
-        return mData[index];
+        return this->buffer()[index];
+    }
+    
+    int String::compare(const StringView& str) const {
+        return this->view().compare(str);
     }
     
     size_t String::find(char chr, size_t pos) const {
-        const char* ptr = ::strchr(mData + pos, chr);
-        if (ptr == nullptr)
-            return npos;
-        return ptr - mData;
+        return this->view().find(chr, pos);
     }
     
-    size_t String::find(const String& str, size_t pos) const {
-        const char* ptr = ::strstr(mData + pos, str.mData);
-        if (ptr == nullptr)
-            return npos;
-        return ptr - mData;
+    size_t String::find(const StringView& str, size_t pos) const {
+        return this->view().find(str, pos);
     }
     
     size_t String::rfind(char chr) const {
-        const char* ptr = ::strrchr(mData, chr);
-        if (ptr == nullptr)
-            return npos;
-        return ptr - mData;
+        return this->view().rfind(chr);
     }
     
-    size_t String::rfind(const String& str) const {
-        const String& rs = this->reverse();
-        const String& rf = str.reverse();
-        
-        const char* ptr = ::strstr(rs.mData, rf.mData);
-        if (ptr == nullptr)
-            return npos;
-        size_t rp = ptr - rs.mData + rf.length();
-        return this->length() - rp;
+    size_t String::rfind(const StringView& str) const {
+        return this->view().rfind(str);
     }
     
-    bool String::contains(const String& str) const {
-        char* ptr = ::strstr(mData, str.mData);
-        return ptr != nullptr;
+    bool String::contains(const StringView& str) const {
+        return this->view().contains(str);
     }
     
     bool String::containsOne(const StringVector& strs) const {
@@ -782,12 +738,8 @@ namespace eokas {
         return true;
     }
     
-    bool String::startsWith(const String& str) const {
-        size_t len1 = this->length();
-        size_t len2 = str.length();
-        if (len1 < len2 || len2 == 0)
-            return false;
-        return memcmp(mData, str.mData, len2) == 0;
+    bool String::startsWith(const StringView& str) const {
+        return this->view().startsWith(str);
     }
     
     bool String::startsWith(const StringVector& strs) const {
@@ -800,12 +752,8 @@ namespace eokas {
         return false;
     }
     
-    bool String::endsWith(const String& str) const {
-        size_t len1 = this->length();
-        size_t len2 = str.length();
-        if (len1 < len2 || len2 == 0)
-            return false;
-        return memcmp(mData + len1 - len2, str.mData, len2) == 0;
+    bool String::endsWith(const StringView& str) const {
+        return this->view().endsWith(str);
     }
     
     bool String::endsWith(const StringVector& strs) const {
@@ -820,21 +768,13 @@ namespace eokas {
     
     String String::toUpper() const {
         String result(*this);
-        char* ptr = result.mData;
-        while (*ptr != '\0') {
-            *ptr = (char) toupper(*ptr);
-            ptr++;
-        }
+        Ascil::toUpper(result.buffer(), result.buffer(), result.length());
         return result;
     }
     
     String String::toLower() const {
         String result(*this);
-        char* ptr = result.mData;
-        while (*ptr != '\0') {
-            *ptr = (char) tolower(*ptr);
-            ptr++;
-        }
+        Ascil::toLower(result.buffer(), result.buffer(), result.length());
         return result;
     }
     
@@ -842,8 +782,8 @@ namespace eokas {
         if (this->isEmpty())
             return "";
         String result(*this);
-        char* src = this->mData;
-        char* dst = result.mData + result.length() - 1;
+        const char* src = this->buffer();
+        char* dst = result.buffer() + result.length() - 1;
         while (*src != '\0') {
             *dst-- = *src++;
         }
@@ -851,7 +791,7 @@ namespace eokas {
     }
     
     String String::substr(size_t pos, size_t len) const {
-        return String(mData + pos, len);
+        return String(this->view().substr(pos, len));
     }
     
     String String::left(size_t len) const {
@@ -861,62 +801,312 @@ namespace eokas {
     String String::right(size_t len) const {
         size_t slen = this->length();
         if (slen < len)
-            return mData;
+            return *this;
         return this->substr(slen - len, len);
     }
     
-    String String::replace(const String& str1, const String& str2) const {
-        String result(*this);
-        size_t index = result.find(str1);
-        while (index != npos) {
-            result = result.remove(index, str1.length()).insert(index, str2);
-            index = result.find(str1, index + str2.length());
+    String String::replace(const StringView& str1, const StringView& str2) const {
+        StringView source = this->view();
+        if (str1.isEmpty())
+            return *this;
+        
+        // count first, so the result is allocated once.
+        size_t count = 0;
+        for (size_t index = source.find(str1); index != npos; index = source.find(str1, index + str1.length())) {
+            count++;
+        }
+        if (count == 0)
+            return *this;
+        
+        size_t size = source.length() - count * str1.length() + count * str2.length();
+        String result;
+        char* dst = result.reserve(size, false);
+        size_t beg = 0;
+        for (size_t index = source.find(str1); index != npos; index = source.find(str1, beg)) {
+            memcpy(dst, source.data() + beg, index - beg);
+            dst += index - beg;
+            memcpy(dst, str2.data(), str2.length());
+            dst += str2.length();
+            beg = index + str1.length();
         }
+        memcpy(dst, source.data() + beg, source.length() - beg);
+        result.resize(size);
         return result;
     }
     
     String String::replace(const StringMap& nameValues) const {
-        String result(*this);
-        auto iter = nameValues.begin();
-        while (iter != nameValues.end()) {
-            result = result.replace(iter->first, iter->second);
-            ++iter;
+        StringView source = this->view();
+        
+        // names bucketed by their first char, longest first, so the longest name wins where
+        // several start at the same position.
+        std::vector<const StringMap::value_type*> names[256];
+        bool any = false;
+        for (const auto& pair: nameValues) {
+            if (pair.first.isEmpty())
+                continue;
+            names[(u8_t) pair.first.at(0)].push_back(&pair);
+            any = true;
         }
+        if (!any)
+            return *this;
+        for (auto& bucket: names) {
+            std::sort(bucket.begin(), bucket.end(), [](const StringMap::value_type* a, const StringMap::value_type* b) {
+                return a->first.length() > b->first.length();
+            });
+        }
+        
+        struct Match {
+            size_t pos;
+            const StringMap::value_type* pair;
+        };
+        std::vector<Match> matches;
+        size_t size = source.length();
+        size_t pos = 0;
+        while (pos < source.length()) {
+            const Match* found = nullptr;
+            for (const StringMap::value_type* pair: names[(u8_t) source[pos]]) {
+                if (source.substr(pos).startsWith(pair->first)) {
+                    matches.push_back({pos, pair});
+                    found = &matches.back();
+                    break;
+                }
+            }
+            if (found == nullptr) {
+                pos++;
+                continue;
+            }
+            size = size - found->pair->first.length() + found->pair->second.length();
+            pos += found->pair->first.length();
+        }
+        if (matches.empty())
+            return *this;
+        
+        String result;
+        char* dst = result.reserve(size, false);
+        size_t beg = 0;
+        for (const Match& match: matches) {
+            memcpy(dst, source.data() + beg, match.pos - beg);
+            dst += match.pos - beg;
+            memcpy(dst, match.pair->second.cstr(), match.pair->second.length());
+            dst += match.pair->second.length();
+            beg = match.pos + match.pair->first.length();
+        }
+        memcpy(dst, source.data() + beg, source.length() - beg);
+        result.resize(size);
         return result;
     }
     
     String String::trim(bool left, bool right) const {
-        if (this->isEmpty())
-            return "";
-        
+        return String(this->trimView(left, right));
+    }
+    
+    StringVector String::split(const String& delim) const {
+        StringVector result;
+        for (const StringView& token: StringTokenizer(*this, delim)) {
+            result.push_back(String(token));
+        }
+        return result;
+    }
+    
+    StringView String::view() const {
+        return StringView(this->buffer(), this->length());
+    }
+    
+    StringView String::substrView(size_t pos, size_t len) const {
+        return this->view().substr(pos, len);
+    }
+    
+    StringView String::trimView(bool left, bool right) const {
+        return this->view().trim(left, right);
+    }
+    
+    StringViewVector String::splitView(const StringView& delim) const {
+        return this->view().split(delim);
+    }
+    
+    /*
+    ============================================================================================
+    ==== StringView
+    ============================================================================================
+    */
+    StringView::StringView(const char* cstr)
+        : mData(cstr != nullptr ? cstr : ""), mSize(cstr != nullptr ? strlen(cstr) : 0) {
+    }
+    
+    StringView::StringView(const String& str)
+        : mData(str.cstr()), mSize(str.length()) {
+    }
+    
+    char StringView::at(size_t index) const {
+        if (index >= mSize)
+            return '\0';
+        return mData[index];
+    }
+    
+    int StringView::compare(const StringView& rhs) const {
+        size_t len = mSize < rhs.mSize ? mSize : rhs.mSize;
+        int result = len > 0 ? memcmp(mData, rhs.mData, len) : 0;
+        if (result != 0)
+            return result;
+        return mSize < rhs.mSize ? -1 : (mSize > rhs.mSize ? 1 : 0);
+    }
+    
+    size_t StringView::find(char chr, size_t pos) const {
+        if (pos >= mSize)
+            return npos;
+        const char* ptr = (const char*) memchr(mData + pos, chr, mSize - pos);
+        if (ptr == nullptr)
+            return npos;
+        return ptr - mData;
+    }
+    
+    size_t StringView::find(const StringView& str, size_t pos) const {
+        if (pos > mSize || str.mSize > mSize - pos)
+            return npos;
+        if (str.mSize == 0)
+            return pos;
+        if (str.mSize == 1)
+            return this->find(str.mData[0], pos);
+        size_t found = StringSearchKernels::instance().search(mData + pos, mSize - pos, str.mData, str.mSize);
+        return found != npos ? pos + found : npos;
+    }
+    
+    size_t StringView::rfind(char chr) const {
+        for (size_t i = mSize; i > 0; i--) {
+            if (mData[i - 1] == chr)
+                return i - 1;
+        }
+        return npos;
+    }
+    
+    size_t StringView::rfind(const StringView& str) const {
+        if (str.mSize > mSize)
+            return npos;
+        if (str.mSize == 0)
+            return mSize;
+        if (str.mSize == 1)
+            return this->rfind(str.mData[0]);
+        return StringSearchKernels::instance().rsearch(mData, mSize - str.mSize + 1, str.mData, str.mSize);
+    }
+    
+    bool StringView::contains(const StringView& str) const {
+        return this->find(str) != npos;
+    }
+    
+    bool StringView::startsWith(const StringView& str) const {
+        if (mSize < str.mSize || str.mSize == 0)
+            return false;
+        return memcmp(mData, str.mData, str.mSize) == 0;
+    }
+    
+    bool StringView::endsWith(const StringView& str) const {
+        if (mSize < str.mSize || str.mSize == 0)
+            return false;
+        return memcmp(mData + mSize - str.mSize, str.mData, str.mSize) == 0;
+    }
+    
+    StringView StringView::substr(size_t pos, size_t len) const {
+        if (pos > mSize)
+            pos = mSize;
+        if (len > mSize - pos)
+            len = mSize - pos;
+        return StringView(mData + pos, len);
+    }
+    
+    StringView StringView::left(size_t len) const {
+        return this->substr(0, len);
+    }
+    
+    StringView StringView::right(size_t len) const {
+        if (len > mSize)
+            return *this;
+        return this->substr(mSize - len, len);
+    }
+    
+    StringView StringView::trim(bool left, bool right) const {
         const char* beg = mData;
-        const char* end = mData + this->length();
+        const char* end = mData + mSize;
         if (left) {
-            while (isspace(*beg))beg++;
+            while (beg < end && isspace((u8_t) *beg)) beg++;
         }
         if (right) {
-            while (isspace(*(end-1))) end--;
+            while (end > beg && isspace((u8_t) *(end - 1))) end--;
         }
-        return this->substr(beg - mData, end - beg);
+        return StringView(beg, end - beg);
     }
     
-    StringVector String::split(const String& delim) const {
-        StringVector result;
-        size_t len = this->length();
-        size_t beg = 0;
+    StringViewVector StringView::split(const StringView& delim) const {
+        StringViewVector result;
+        for (const StringView& token: StringTokenizer(*this, delim)) {
+            result.push_back(token);
+        }
+        return result;
+    }
+    
+    String StringView::toString() const {
+        return String(*this);
+    }
+    
+    bool operator==(const StringView& lhs, const StringView& rhs) {
+        return lhs.length() == rhs.length() && lhs.compare(rhs) == 0;
+    }
+    
+    bool operator!=(const StringView& lhs, const StringView& rhs) {
+        return !(lhs == rhs);
+    }
+    
+    bool operator<(const StringView& lhs, const StringView& rhs) {
+        return lhs.compare(rhs) < 0;
+    }
+    
+    bool operator>(const StringView& lhs, const StringView& rhs) {
+        return lhs.compare(rhs) > 0;
+    }
+    
+    bool operator<=(const StringView& lhs, const StringView& rhs) {
+        return lhs.compare(rhs) <= 0;
+    }
+    
+    bool operator>=(const StringView& lhs, const StringView& rhs) {
+        return lhs.compare(rhs) >= 0;
+    }
+    
+    /*
+    ============================================================================================
+    ==== StringTokenizer
+    ============================================================================================
+    */
+    StringTokenizer::Iterator::Iterator(const StringView& source, const StringView& delim, size_t pos)
+        : mSource(source), mDelim(delim), mPos(pos), mNext(pos), mToken() {
+        if (pos != StringView::npos) {
+            this->advance();
+        }
+    }
+    
+    StringTokenizer::Iterator& StringTokenizer::Iterator::operator++() {
+        this->advance();
+        return *this;
+    }
+    
+    void StringTokenizer::Iterator::advance() {
+        size_t len = mSource.length();
+        size_t beg = mNext;
         while (beg < len) {
-            size_t end = this->find(delim, beg);
-            if (end == -1) {
-                result.push_back(this->substr(beg));
-                break;
+            size_t end = mDelim.isEmpty() ? StringView::npos : mSource.find(mDelim, beg);
+            if (end == StringView::npos) {
+                end = len;
             }
-            
             if (end > beg) {
-                result.push_back(this->substr(beg, end - beg));
+                mPos = beg;
+                mNext = end < len ? end + mDelim.length() : len;
+                mToken = mSource.substr(beg, end - beg);
+                return;
             }
-            beg = end + delim.length();
+            beg = end + mDelim.length();
         }
-        return result;
+        mPos = StringView::npos;
+        mNext = len;
+        mToken = StringView();
     }
     
     /*
@@ -943,11 +1133,11 @@ namespace eokas {
     }
     
     StringValue::StringValue(i8_t value)
-        : mValue(value) {
+        : mValue(String::valueToString(value)) {
     }
     
     StringValue::StringValue(u8_t value)
-        : mValue(value) {
+        : mValue(String::valueToString(value)) {
     }
     
     StringValue::StringValue(i16_t value)
@@ -1065,7 +1255,7 @@ namespace eokas {
     }
     
     StringValue::operator u8_t() const {
-        return String::stringToValue<i8_t>(mValue);
+        return String::stringToValue<u8_t>(mValue);
     }
     
     StringValue::operator i16_t() const {
@@ -3,8 +3,11 @@
 #define  _EOKAS_BASE_STRING_H_
 
 #include "./header.h"
+#include "./number.h"
 #include <sstream>
 #include <cstdarg>
+#include <limits>
+#include <type_traits>
 
 namespace eokas {
 
@@ -12,38 +15,107 @@ typedef std::list<String> StringList;
 typedef std::vector<String> StringVector;
 typedef std::map<String, String> StringMap;
 
-#ifndef _STRING_LITTLE_LENGTH
-#define _STRING_LITTLE_LENGTH 16
-#endif//_STRING_LITTLE_LENGTH
 #ifndef _STRING_MIDDLE_LENGTH
 #define _STRING_MIDDLE_LENGTH 256
 #endif//_STRING_MIDDLE_LENGTH
 
-#ifndef _FormatVA
-#define _FormatVA(ret, fmt) \
-{ \
-		va_list ap = {0}; \
-    \
-    va_start(ap, fmt); \
-    i32_t size = vsnprintf(nullptr, 0, fmt, ap); \
-    va_end(ap); \
-    \
-    char* buff = new char[size + 1]; \
-    \
-    va_start(ap, fmt); \
-    vsnprintf(buff, size + 1, fmt, ap); \
-    buff[size] = '\0'; \
-    va_end(ap); \
-    \
-    ret = String(buff); \
-    delete[]buff; \
-}
-#endif//_FormatVA
+class StringView;
+
+typedef std::vector<StringView> StringViewVector;
 
+/*
+============================================================================================
+==== StringView
+==== A pointer and a length into chars owned by someone else, nothing is copied or freed.
+==== The chars are not terminated, use toString() to hand them to C APIs. A view must not
+==== outlive the String or buffer it looks into.
+============================================================================================
+*/
+class StringView
+{
+public:
+  static const size_t npos = (size_t)(-1);
+
+public:
+  StringView()
+    :mData(""), mSize(0)
+  {}
+  StringView(const char* cstr);
+  StringView(const char* data, size_t length)
+    :mData(data), mSize(length)
+  {}
+  StringView(const String& str);
+
+public:
+  const char* data() const
+  {
+    return mData;
+  }
+  size_t length() const
+  {
+    return mSize;
+  }
+  bool isEmpty() const
+  {
+    return mSize == 0;
+  }
+  const char* begin() const
+  {
+    return mData;
+  }
+  const char* end() const
+  {
+    return mData + mSize;
+  }
+  char operator[](size_t index) const
+  {
+    return mData[index];
+  }
+  char at(size_t index) const;
+
+  int compare(const StringView& rhs) const;
+  size_t find(char chr, size_t pos = 0) const;
+  size_t find(const StringView& str, size_t pos = 0) const;
+  size_t rfind(char chr) const;
+  size_t rfind(const StringView& str) const;
+  bool contains(const StringView& str) const;
+  bool startsWith(const StringView& str) const;
+  bool endsWith(const StringView& str) const;
+
+  StringView substr(size_t pos, size_t len = npos) const;
+  StringView left(size_t len) const;
+  StringView right(size_t len) const;
+  StringView trim(bool left = true, bool right = true) const;
+  StringViewVector split(const StringView& delim) const;
+  String toString() const;
+
+private:
+  const char* mData;
+  size_t mSize;
+};
+
+bool operator==(const StringView& lhs, const StringView& rhs);
+bool operator!=(const StringView& lhs, const StringView& rhs);
+bool operator<(const StringView& lhs, const StringView& rhs);
+bool operator>(const StringView& lhs, const StringView& rhs);
+bool operator<=(const StringView& lhs, const StringView& rhs);
+bool operator>=(const StringView& lhs, const StringView& rhs);
+
+/*
+============================================================================================
+==== String
+==== Three words, no vtable. Up to kInlineLength chars live in the object itself, the last
+==== byte holds kInlineLength - length, which is also the terminator of a full inline string.
+==== Longer strings go to the slab allocator, the last byte then carries kHeapFlag inside
+==== the capacity word. Moving steals the three words and leaves an empty inline string.
+============================================================================================
+*/
 class String
 {
 public:
   static const size_t npos;
+  static const size_t kInlineSize = sizeof(char*) + sizeof(size_t) * 2;
+  static const size_t kInlineLength = kInlineSize - 1;
   static const String empty;
   static const String zero;
   static const String one;
@@ -61,7 +133,10 @@ public:
   static WCString utf8ToUnicode(const MBString& utf8Str, bool bom);
   static String encodeURL(const String& str);
   static String decodeURL(const String& str);
+  /// printf style, see Format for {} fields checked at compile time.
   static String format(const char* fmt, ...);
+  /// one vsnprintf into a stack buffer, a second one straight into the String if it is longer.
+  static String formatVA(const char* fmt, va_list ap);
   static String repeat(const String& str, size_t n);
   static String join(const StringVector& segments, const String& delim);
   static String join(const StringMap& segments, const String& conn, const String& delim);
@@ -69,13 +144,19 @@ public:
   /*
   ============================================================================================
   ==== type casting functions
+  ==== Numbers go through NumberChars, locale free and without a stream, other types still
+  ==== use operator<< and operator>>. i8_t and u8_t are numbers here, char is a character.
   ============================================================================================
   */
   template<typename T>
   inline static String valueToString(const T& value);
 
+  template<typename T>
+  inline static T stringToValue(const StringView& str);
   template<typename T>
   inline static T stringToValue(const String& str);
+  template<typename T>
+  inline static T stringToValue(const char* str);
 
   template<typename T>
   inline static T binstrToValue(const String& str);
@@ -88,13 +169,14 @@ public:
   String(const char* mbcstr, size_t len = npos);
   String(const MBString& mbstr);
   String(const WCString& wcstr);
+  explicit String(const StringView& view);
   String(const String& other);
-  String(String&& other);
-  virtual ~String();
+  String(String&& other) noexcept;
+  ~String();
 
 public:
   String& operator=(const String& rhs);
-  String& operator=(String&& rhs);
+  String& operator=(String&& rhs) noexcept;
   String& operator+=(const String& rhs);
   String operator+(const String& rhs) const;
   bool operator>(const String& rhs) const;
@@ -108,24 +190,27 @@ public:
 public:
   String& clear();
   String& append(const String& str);
+  String& append(const char* data, size_t length);
   String& insert(size_t pos, const String& str);
   String& remove(size_t pos, size_t len);
 
   size_t length() const;
+  size_t capacity() const;
   const char* cstr() const;
   bool isEmpty() const;
   char at(size_t index) const;
+  int compare(const StringView& str) const;
   size_t find(char chr, size_t pos = 0) const;
-  size_t find(const String& str, size_t pos = 0) const;
+  size_t find(const StringView& str, size_t pos = 0) const;
   size_t rfind(char chr) const;
-  size_t rfind(const String& str) const;
+  size_t rfind(const StringView& str) const;
 
-  bool contains(const String& str) const;
+  bool contains(const StringView& str) const;
   bool containsOne(const StringVector& strs) const;
   bool containsAll(const StringVector& strs) const;
-  bool startsWith(const String& str) const;
+  bool startsWith(const StringView& str) const;
   bool startsWith(const StringVector& strs) const;
-  bool endsWith(const String& str) const;
+  bool endsWith(const StringView& str) const;
   bool endsWith(const StringVector& strs) const;
   String toUpper() const;
   String toLower() const;
@@ -133,29 +218,157 @@ public:
   String substr(size_t pos, size_t len = npos) const;
   String left(size_t len) const;
   String right(size_t len) const;
-  String replace(const String& str1, const String& str2) const;
+  /// every match of str1, left to right, in one pass.
+  String replace(const StringView& str1, const StringView& str2) const;
+  /// one pass over the string, where several names match at a position the longest one
+  /// wins. Replaced text is not searched again.
   String replace(const StringMap& nameValues) const;
   String trim(bool left = true, bool right = true) const;
   StringVector split(const String& delim) const;
 
+  /// views into this string, valid until it is modified or destroyed.
+  StringView view() const;
+  StringView substrView(size_t pos, size_t len = npos) const;
+  StringView trimView(bool left = true, bool right = true) const;
+  StringViewVector splitView(const StringView& delim) const;
+
 private:
-  char* mData;
-  size_t mSize;
-  size_t mCapacity;
-  i32_t mMetric;
-  char mValue[_STRING_LITTLE_LENGTH];
+  // they size the result once and write it in place.
+  friend class StringBuilder;
+  friend class Rope;
+
+  static const u8_t kHeapFlag = 0x80;
+
+  struct Heap
+  {
+    char* data;
+    size_t size;
+    size_t capacity;
+  };
+
+  bool isHeap() const
+  {
+    return ((u8_t)mInline[kInlineLength] & kHeapFlag) != 0;
+  }
+
+  char* buffer()
+  {
+    return this->isHeap() ? mHeap.data : mInline;
+  }
+
+  const char* buffer() const
+  {
+    return this->isHeap() ? mHeap.data : mInline;
+  }
+
+  void reset();
+  void adopt(char* data, size_t size, size_t capacity);
+  char* reserve(size_t len, bool grow);
+  void resize(size_t len);
+
+  union
+  {
+    Heap mHeap;
+    char mInline[kInlineSize];
+  };
+};
+/*
+============================================================================================
+==== StringTokenizer
+==== Walks the non-empty pieces between delimiters without collecting them, the same pieces
+==== split() returns:
+====     for (StringView token : StringTokenizer(line, ",")) { ... }
+============================================================================================
+*/
+class StringTokenizer
+{
+public:
+  class Iterator
+  {
+  public:
+    Iterator(const StringView& source, const StringView& delim, size_t pos);
+
+    const StringView& operator*() const
+    {
+      return mToken;
+    }
+    const StringView* operator->() const
+    {
+      return &mToken;
+    }
+    Iterator& operator++();
+    bool operator==(const Iterator& rhs) const
+    {
+      return mPos == rhs.mPos;
+    }
+    bool operator!=(const Iterator& rhs) const
+    {
+      return mPos != rhs.mPos;
+    }
+
+  private:
+    void advance();
+
+    StringView mSource;
+    StringView mDelim;
+    size_t mPos;
+    size_t mNext;
+    StringView mToken;
+  };
+
+public:
+  StringTokenizer(const StringView& source, const StringView& delim)
+    :mSource(source), mDelim(delim)
+  {}
+
+  Iterator begin() const
+  {
+    return Iterator(mSource, mDelim, 0);
+  }
+  Iterator end() const
+  {
+    return Iterator(mSource, mDelim, StringView::npos);
+  }
+
+private:
+  StringView mSource;
+  StringView mDelim;
 };
+
 /*
 ============================================================================================
 ==== template implementations for class String
 ============================================================================================
 */
+template<typename T>
+struct StringNumber
+{
+  static const bool value = std::is_floating_point<T>::value || (std::is_integral<T>::value && !std::is_same<T, char>::value && !std::is_same<T, bool>::value);
+};
+
 template<typename T>
 inline String String::valueToString(const T& value)
 {
-  std::stringstream stream;
-  stream << value;
-  return stream.str();
+  if constexpr (StringNumber<T>::value)
+  {
+    char buffer[NumberChars::kMaxChars];
+    size_t length;
+    if constexpr (std::is_same<T, f32_t>::value)
+      length = NumberChars::format(buffer, value);
+    else if constexpr (std::is_floating_point<T>::value)
+      length = NumberChars::format(buffer, (f64_t) value);
+    else if constexpr (std::is_signed<T>::value)
+      length = NumberChars::format(buffer, (i64_t) value);
+    else
+      length = NumberChars::format(buffer, (u64_t) value);
+    return String(buffer, length);
+  }
+  else
+  {
+    std::stringstream stream;
+    stream << value;
+    return stream.str();
+  }
 }
 template<>
 inline String String::valueToString<bool>(const bool& value)
@@ -164,19 +377,73 @@ inline String String::valueToString<bool>(const bool& value)
 }
 
 template<typename T>
-inline T String::stringToValue(const String& str)
+inline T String::stringToValue(const StringView& str)
 {
-  T value = 0;
-  std::stringstream stream(str.mData);
-  stream >> value;
-  return value;
+  if constexpr (StringNumber<T>::value)
+  {
+    // leading white space is skipped like operator>> does, the number ends at the first
+    // char that does not fit, integers out of the range of T are clamped.
+    const char* begin = str.data();
+    const char* end = begin + str.length();
+    while (begin != end && (*begin == ' ' || (*begin >= '\t' && *begin <= '\r')))
+      begin++;
+    if constexpr (std::is_same<T, f32_t>::value)
+    {
+      f32_t value = 0;
+      NumberChars::parse(begin, end, value);
+      return value;
+    }
+    else if constexpr (std::is_floating_point<T>::value)
+    {
+      f64_t value = 0;
+      NumberChars::parse(begin, end, value);
+      return (T) value;
+    }
+    else if constexpr (std::is_signed<T>::value)
+    {
+      i64_t value = 0;
+      NumberChars::parse(begin, end, value);
+      if (value < (i64_t) std::numeric_limits<T>::min())
+        return std::numeric_limits<T>::min();
+      if (value > (i64_t) std::numeric_limits<T>::max())
+        return std::numeric_limits<T>::max();
+      return (T) value;
+    }
+    else
+    {
+      u64_t value = 0;
+      NumberChars::parse(begin, end, value);
+      if (value > (u64_t) std::numeric_limits<T>::max())
+        return std::numeric_limits<T>::max();
+      return (T) value;
+    }
+  }
+  else
+  {
+    T value = 0;
+    std::stringstream stream(std::string(str.data(), str.length()));
+    stream >> value;
+    return value;
+  }
 }
 template<>
-inline bool String::stringToValue<bool>(const String& str)
+inline bool String::stringToValue<bool>(const StringView& str)
 {
   return (str == "true" || str == "TRUE" || str == "True" || str == "1");
 }
 
+template<typename T>
+inline T String::stringToValue(const String& str)
+{
+  return String::stringToValue<T>(str.view());
+}
+
+template<typename T>
+inline T String::stringToValue(const char* str)
+{
+  return String::stringToValue<T>(StringView(str));
+}
+
 template<typename T>
 inline T String::binstrToValue(const String& str)
 {
@@ -0,0 +1,294 @@
+
+#include "./tracker.h"
+#include "./json.h"
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+
+#if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+#include <windows.h>
+#elif defined(__GLIBC__) || defined(__APPLE__)
+#define _EOKAS_TRACKER_BACKTRACE 1
+#include <execinfo.h>
+#endif
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== counters and names
+    ==== Plain statics that need no constructor, blocks may be tracked during static init.
+    ============================================================================================
+    */
+    struct alignas(64) TrackerCounters {
+        std::atomic<i64_t> liveBytes;
+        std::atomic<i64_t> liveCount;
+        std::atomic<i64_t> totalBytes;
+        std::atomic<i64_t> totalCount;
+        std::atomic<i64_t> peakBytes;
+    };
+
+    static TrackerCounters sTrackerCounters[MemoryTracker::kMaxTags];
+    static char sTrackerNames[MemoryTracker::kMaxTags][MemoryTracker::kMaxNameLength + 1] = {"untagged", "slab"};
+    static std::atomic<u32_t> sTrackerTagCount{2};
+    static std::mutex sTrackerTagMutex;
+
+    static std::atomic<size_t> sTrackerSampleInterval{0};
+    static std::atomic<u64_t> sTrackerSampleId{0};
+    static thread_local MemoryTag tTrackerTag = MemoryTracker::kUntagged;
+    static thread_local i64_t tTrackerCountdown = 0;
+    static thread_local u64_t tTrackerSeed = 0;
+
+    struct TrackerSamples {
+        std::mutex mutex;
+        std::unordered_map<const void*, MemorySample> samples;
+
+        static TrackerSamples& instance() {
+            // leaked on purpose: blocks may be freed during static destruction.
+            static TrackerSamples* sInstance = new TrackerSamples();
+            return *sInstance;
+        }
+    };
+
+    // exponential distance with the interval as mean, so samples form a Poisson process over bytes.
+    static i64_t tracker_sample_distance(size_t interval) {
+        u64_t& seed = tTrackerSeed;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        f64_t uniform = ((seed >> 11) + 1) * (1.0 / 9007199254740992.0);
+        f64_t distance = -std::log(uniform) * (f64_t) interval;
+        return distance < 1.0 ? 1 : (i64_t) distance;
+    }
+
+    static u32_t tracker_capture(void** frames, u32_t count) {
+#if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+        return RtlCaptureStackBackTrace(2, count, frames, nullptr);
+#elif defined(_EOKAS_TRACKER_BACKTRACE)
+        int depth = backtrace(frames, (int) count);
+        return depth > 0 ? (u32_t) depth : 0;
+#else
+        return 0;
+#endif
+    }
+
+    /*
+    ============================================================================================
+    ==== MemorySnapshot
+    ============================================================================================
+    */
+    MemorySnapshot MemorySnapshot::diff(const MemorySnapshot& before) const {
+        MemorySnapshot result;
+        for (const MemoryTagStats& stats: tags) {
+            MemoryTagStats delta = stats;
+            for (const MemoryTagStats& old: before.tags) {
+                if (old.tag != stats.tag)
+                    continue;
+                delta.liveBytes -= old.liveBytes;
+                delta.liveCount -= old.liveCount;
+                delta.totalBytes -= old.totalBytes;
+                delta.totalCount -= old.totalCount;
+                break;
+            }
+            result.tags.push_back(delta);
+        }
+
+        u64_t last = 0;
+        for (const MemorySample& sample: before.samples) {
+            last = std::max(last, sample.id);
+        }
+        for (const MemorySample& sample: samples) {
+            if (sample.id > last) {
+                result.samples.push_back(sample);
+            }
+        }
+        return result;
+    }
+
+    const MemoryTagStats* MemorySnapshot::find(const String& name) const {
+        for (const MemoryTagStats& stats: tags) {
+            if (stats.name == name)
+                return &stats;
+        }
+        return nullptr;
+    }
+
+    /*
+    ============================================================================================
+    ==== MemoryTracker
+    ============================================================================================
+    */
+    MemoryTag MemoryTracker::tag(const String& name) {
+        char key[kMaxNameLength + 1] = {0};
+        strncpy(key, name.cstr(), kMaxNameLength);
+
+        std::lock_guard<std::mutex> lock(sTrackerTagMutex);
+        u32_t count = sTrackerTagCount.load(std::memory_order_relaxed);
+        for (u32_t i = 0; i < count; i++) {
+            if (strcmp(sTrackerNames[i], key) == 0)
+                return (MemoryTag) i;
+        }
+        if (count >= kMaxTags)
+            return kUntagged;
+        memcpy(sTrackerNames[count], key, sizeof(key));
+        sTrackerTagCount.store(count + 1, std::memory_order_release);
+        return (MemoryTag) count;
+    }
+
+    String MemoryTracker::name(MemoryTag tag) {
+        if (tag >= sTrackerTagCount.load(std::memory_order_acquire))
+            return String();
+        return String(sTrackerNames[tag]);
+    }
+
+    MemoryTag MemoryTracker::current() {
+        return tTrackerTag;
+    }
+
+    MemoryTag MemoryTracker::exchange(MemoryTag tag) {
+        MemoryTag previous = tTrackerTag;
+        tTrackerTag = tag;
+        return previous;
+    }
+
+    void MemoryTracker::setSampleInterval(size_t bytes) {
+        sTrackerSampleInterval.store(bytes, std::memory_order_relaxed);
+    }
+
+    size_t MemoryTracker::sampleInterval() {
+        return sTrackerSampleInterval.load(std::memory_order_relaxed);
+    }
+
+    // untagged blocks are not counted, allocations outside any scope touch no shared line.
+    void MemoryTracker::add(MemoryTag tag, size_t bytes, i64_t count) {
+        if (tag == kUntagged || tag >= kMaxTags)
+            return;
+        TrackerCounters& counters = sTrackerCounters[tag];
+        i64_t live = counters.liveBytes.fetch_add((i64_t) bytes, std::memory_order_relaxed) + (i64_t) bytes;
+        counters.liveCount.fetch_add(count, std::memory_order_relaxed);
+        counters.totalBytes.fetch_add((i64_t) bytes, std::memory_order_relaxed);
+        counters.totalCount.fetch_add(count, std::memory_order_relaxed);
+
+        i64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    void MemoryTracker::remove(MemoryTag tag, size_t bytes, i64_t count) {
+        if (tag == kUntagged || tag >= kMaxTags)
+            return;
+        TrackerCounters& counters = sTrackerCounters[tag];
+        counters.liveBytes.fetch_sub((i64_t) bytes, std::memory_order_relaxed);
+        counters.liveCount.fetch_sub(count, std::memory_order_relaxed);
+    }
+
+    bool MemoryTracker::sample(MemoryTag tag, const void* ptr, size_t size) {
+        size_t interval = sTrackerSampleInterval.load(std::memory_order_relaxed);
+        if (interval == 0)
+            return false;
+
+        if (tTrackerSeed == 0) {
+            // first allocation on this thread only arms the countdown.
+            tTrackerSeed = ((u64_t) (size_t) &tTrackerSeed * 0x9E3779B97F4A7C15ull) | 1;
+            tTrackerCountdown = tracker_sample_distance(interval);
+        }
+        tTrackerCountdown -= (i64_t) size;
+        if (tTrackerCountdown > 0)
+            return false;
+        tTrackerCountdown = tracker_sample_distance(interval);
+
+        void* frames[kMaxFrames];
+        u32_t depth = tracker_capture(frames, kMaxFrames);
+
+        MemorySample sample;
+        sample.id = sTrackerSampleId.fetch_add(1, std::memory_order_relaxed) + 1;
+        sample.tag = tag;
+        sample.size = size;
+        // unbiased estimate: a block of `size` bytes is picked with p = 1 - e^(-size/interval).
+        f64_t probability = 1.0 - std::exp(-(f64_t) size / (f64_t) interval);
+        sample.weight = probability > 0.0 ? (size_t) ((f64_t) size / probability) : interval;
+        sample.stack.assign(frames, frames + depth);
+
+        TrackerSamples& samples = TrackerSamples::instance();
+        std::lock_guard<std::mutex> lock(samples.mutex);
+        samples.samples[ptr] = std::move(sample);
+        return true;
+    }
+
+    void MemoryTracker::unsample(const void* ptr) {
+        TrackerSamples& samples = TrackerSamples::instance();
+        std::lock_guard<std::mutex> lock(samples.mutex);
+        samples.samples.erase(ptr);
+    }
+
+    MemorySnapshot MemoryTracker::snapshot() {
+        MemorySnapshot snapshot;
+        u32_t count = sTrackerTagCount.load(std::memory_order_acquire);
+        for (u32_t i = kUntagged + 1; i < count; i++) {
+            TrackerCounters& counters = sTrackerCounters[i];
+            MemoryTagStats stats;
+            stats.tag = (MemoryTag) i;
+            stats.name = String(sTrackerNames[i]);
+            stats.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+            stats.liveCount = counters.liveCount.load(std::memory_order_relaxed);
+            stats.totalBytes = counters.totalBytes.load(std::memory_order_relaxed);
+            stats.totalCount = counters.totalCount.load(std::memory_order_relaxed);
+            stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+            snapshot.tags.push_back(stats);
+        }
+
+        {
+            TrackerSamples& samples = TrackerSamples::instance();
+            std::lock_guard<std::mutex> lock(samples.mutex);
+            snapshot.samples.reserve(samples.samples.size());
+            for (auto& pair: samples.samples) {
+                snapshot.samples.push_back(pair.second);
+            }
+        }
+        std::sort(snapshot.samples.begin(), snapshot.samples.end(), [](const MemorySample& a, const MemorySample& b) {
+            return a.id < b.id;
+        });
+        return snapshot;
+    }
+
+    String MemoryTracker::dump() {
+        return dump(snapshot());
+    }
+
+    String MemoryTracker::dump(const MemorySnapshot& snapshot) {
+        HomNode tags(HomType::Array);
+        for (const MemoryTagStats& stats: snapshot.tags) {
+            HomNode node(HomType::Object);
+            node.set("name", HomNode(stats.name));
+            node.set("live_bytes", HomNode((f64_t) stats.liveBytes));
+            node.set("live_count", HomNode((f64_t) stats.liveCount));
+            node.set("total_bytes", HomNode((f64_t) stats.totalBytes));
+            node.set("total_count", HomNode((f64_t) stats.totalCount));
+            node.set("peak_bytes", HomNode((f64_t) stats.peakBytes));
+            tags.add(node);
+        }
+
+        HomNode samples(HomType::Array);
+        for (const MemorySample& sample: snapshot.samples) {
+            HomNode stack(HomType::Array);
+            for (void* frame: sample.stack) {
+                stack.add(HomNode(String::format("%p", frame)));
+            }
+            HomNode node(HomType::Object);
+            node.set("tag", HomNode(MemoryTracker::name(sample.tag)));
+            node.set("size", HomNode((f64_t) sample.size));
+            node.set("weight", HomNode((f64_t) sample.weight));
+            node.set("stack", stack);
+            samples.add(node);
+        }
+
+        HomNode root(HomType::Object);
+        root.set("tags", tags);
+        root.set("samples", samples);
+        return JSON::stringify(root);
+    }
+
+}
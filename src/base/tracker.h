@@ -0,0 +1,121 @@
+#ifndef _EOKAS_BASE_TRACKER_H_
+#define _EOKAS_BASE_TRACKER_H_
+
+#include "./header.h"
+#include "./string.h"
+
+namespace eokas {
+
+    using MemoryTag = u16_t;
+
+    /*
+    ============================================================================================
+    ==== MemoryTagStats / MemorySample / MemorySnapshot
+    ============================================================================================
+    */
+    struct MemoryTagStats {
+        MemoryTag tag = 0;
+        String name;
+        i64_t liveBytes = 0;
+        i64_t liveCount = 0;
+        i64_t totalBytes = 0;
+        i64_t totalCount = 0;
+        i64_t peakBytes = 0;
+    };
+
+    struct MemorySample {
+        u64_t id = 0;
+        MemoryTag tag = 0;
+        size_t size = 0;
+        /// estimated bytes this sample stands for.
+        size_t weight = 0;
+        std::vector<void*> stack;
+    };
+
+    struct MemorySnapshot {
+        std::vector<MemoryTagStats> tags;
+        std::vector<MemorySample> samples;
+
+        /// counters relative to `before`, peaks stay absolute, only samples taken since.
+        MemorySnapshot diff(const MemorySnapshot& before) const;
+        const MemoryTagStats* find(const String& name) const;
+    };
+
+    /*
+    ============================================================================================
+    ==== MemoryTracker
+    ==== Live bytes, counts and high-water marks per tag, for blocks from MemoryUtility,
+    ==== MemoryBuffer, alloc_v, arenas (committed bytes) and the slab allocator (chunks).
+    ==== Blocks are charged to the tag of the innermost MemoryTagScope of the allocating thread
+    ==== and credited back to the same tag, whichever thread frees them. Tagging is opt in:
+    ==== blocks made outside any scope are kUntagged and not counted at all, so they pay no
+    ==== atomic on a shared counter.
+    ==== Call stacks are sampled about once per sampleInterval() bytes, off by default. The
+    ==== countdown is thread local, so unsampled allocations only pay a subtraction.
+    ============================================================================================
+    */
+    class MemoryTracker {
+    public:
+        static const MemoryTag kUntagged = 0;
+        /// chunks carved by SlabAllocator, charged here whatever scope is active.
+        static const MemoryTag kSlab = 1;
+        static const u32_t kMaxTags = 256;
+        static const u32_t kMaxNameLength = 47;
+        static const u32_t kMaxFrames = 24;
+
+        /// registers the name on first use, kUntagged once all tags are taken. Names are cut
+        /// to kMaxNameLength.
+        static MemoryTag tag(const String& name);
+        static String name(MemoryTag tag);
+        static MemoryTag current();
+
+        /// 0 turns sampling off.
+        static void setSampleInterval(size_t bytes);
+        static size_t sampleInterval();
+
+        static void add(MemoryTag tag, size_t bytes, i64_t count);
+        static void remove(MemoryTag tag, size_t bytes, i64_t count);
+
+        /// true when a stack was recorded for the block, it must be dropped when it is freed.
+        static bool sample(MemoryTag tag, const void* ptr, size_t size);
+        static void unsample(const void* ptr);
+
+        static MemorySnapshot snapshot();
+        static String dump();
+        static String dump(const MemorySnapshot& snapshot);
+
+    private:
+        friend class MemoryTagScope;
+
+        static MemoryTag exchange(MemoryTag tag);
+    };
+
+    /*
+    ============================================================================================
+    ==== MemoryTagScope
+    ============================================================================================
+    */
+    class MemoryTagScope {
+    public:
+        explicit MemoryTagScope(MemoryTag tag)
+            : mPrevious(MemoryTracker::exchange(tag)) {
+        }
+
+        explicit MemoryTagScope(const String& name)
+            : mPrevious(MemoryTracker::exchange(MemoryTracker::tag(name))) {
+        }
+
+        ~MemoryTagScope() {
+            MemoryTracker::exchange(mPrevious);
+        }
+
+        _ForbidCopy(MemoryTagScope);
+        _ForbidAssign(MemoryTagScope);
+
+    private:
+        MemoryTag mPrevious;
+    };
+
+}
+
+#endif//_EOKAS_BASE_TRACKER_H_
@@ -0,0 +1,650 @@
+
+#include "./utf8.h"
+#include <cstring>
+
+#if _EOKAS_ARCH == _EOKAS_ARCH_X64
+#define _EOKAS_UTF8_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define _EOKAS_UTF8_TARGET(isa)
+#else
+#define _EOKAS_UTF8_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace eokas {
+
+    static u32_t utf8_ctz(u32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return (u32_t) __builtin_ctz(mask);
+#endif
+    }
+
+    /*
+    ============================================================================================
+    ==== scalar
+    ============================================================================================
+    */
+    // length of the well formed sequence at p, 0 if it is ill formed or cut off by end.
+    static size_t utf8_sequence(const u8_t* p, const u8_t* end, u32_t& code) {
+        u8_t b0 = p[0];
+        if (b0 < 0x80) {
+            code = b0;
+            return 1;
+        }
+        size_t left = (size_t) (end - p);
+        if (b0 < 0xC2) {
+            return 0;
+        }
+        if (b0 < 0xE0) {
+            if (left < 2 || (p[1] & 0xC0) != 0x80)
+                return 0;
+            code = ((u32_t) (b0 & 0x1F) << 6) | (p[1] & 0x3F);
+            return 2;
+        }
+        if (b0 < 0xF0) {
+            u8_t low = b0 == 0xE0 ? 0xA0 : 0x80;
+            u8_t high = b0 == 0xED ? 0x9F : 0xBF;
+            if (left < 3 || p[1] < low || p[1] > high || (p[2] & 0xC0) != 0x80)
+                return 0;
+            code = ((u32_t) (b0 & 0x0F) << 12) | ((u32_t) (p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+            return 3;
+        }
+        if (b0 < 0xF5) {
+            u8_t low = b0 == 0xF0 ? 0x90 : 0x80;
+            u8_t high = b0 == 0xF4 ? 0x8F : 0xBF;
+            if (left < 4 || p[1] < low || p[1] > high || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80)
+                return 0;
+            code = ((u32_t) (b0 & 0x07) << 18) | ((u32_t) (p[1] & 0x3F) << 12) | ((u32_t) (p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+            return 4;
+        }
+        return 0;
+    }
+
+    // bytes the sequence started by lead takes, 0 for bytes that cannot start one.
+    static u32_t utf8_lead_length(u8_t lead) {
+        if (lead < 0x80)
+            return 1;
+        if (lead < 0xC2)
+            return 0;
+        if (lead < 0xE0)
+            return 2;
+        if (lead < 0xF0)
+            return 3;
+        return lead < 0xF5 ? 4 : 0;
+    }
+
+    static size_t utf8_ascii_prefix(const u8_t* data, size_t size) {
+        size_t i = 0;
+#if defined(_EOKAS_UTF8_X64)
+        for (; i + 16 <= size; i += 16) {
+            u32_t mask = (u32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) (data + i)));
+            if (mask != 0)
+                return i + utf8_ctz(mask);
+        }
+#endif
+        while (i < size && data[i] < 0x80) {
+            i++;
+        }
+        return i;
+    }
+
+    static bool utf8_validate_scalar(const u8_t* data, size_t size) {
+        const u8_t* end = data + size;
+        for (const u8_t* p = data; p < end;) {
+            p += utf8_ascii_prefix(p, (size_t) (end - p));
+            if (p == end)
+                break;
+            u32_t code;
+            size_t length = utf8_sequence(p, end, code);
+            if (length == 0)
+                return false;
+            p += length;
+        }
+        return true;
+    }
+
+#if defined(_EOKAS_UTF8_X64)
+    /*
+    ============================================================================================
+    ==== lookup kernels
+    ==== Three 16 entry tables, indexed by the high and low nibble of the previous byte and the
+    ==== high nibble of the current one, flag the errors a byte pair can show. The AND of the
+    ==== three is zero for a valid pair, except where a third or fourth byte of a sequence is
+    ==== expected, which the 0x80 bit flips back.
+    ============================================================================================
+    */
+    static const u8_t kUtf8TooShort = 1 << 0;
+    static const u8_t kUtf8TooLong = 1 << 1;
+    static const u8_t kUtf8Overlong3 = 1 << 2;
+    static const u8_t kUtf8TooLarge = 1 << 3;
+    static const u8_t kUtf8Surrogate = 1 << 4;
+    static const u8_t kUtf8Overlong2 = 1 << 5;
+    static const u8_t kUtf8TooLarge1000 = 1 << 6;
+    static const u8_t kUtf8Overlong4 = 1 << 6;
+    static const u8_t kUtf8TwoConts = 1 << 7;
+    static const u8_t kUtf8Carry = kUtf8TooShort | kUtf8TooLong | kUtf8TwoConts;
+
+    static const u8_t kUtf8Byte1High[16] = {
+        kUtf8TooLong, kUtf8TooLong, kUtf8TooLong, kUtf8TooLong,
+        kUtf8TooLong, kUtf8TooLong, kUtf8TooLong, kUtf8TooLong,
+        kUtf8TwoConts, kUtf8TwoConts, kUtf8TwoConts, kUtf8TwoConts,
+        kUtf8TooShort | kUtf8Overlong2,
+        kUtf8TooShort,
+        kUtf8TooShort | kUtf8Overlong3 | kUtf8Surrogate,
+        kUtf8TooShort | kUtf8TooLarge | kUtf8TooLarge1000 | kUtf8Overlong4,
+    };
+
+    static const u8_t kUtf8Byte1Low[16] = {
+        kUtf8Carry | kUtf8Overlong3 | kUtf8Overlong2 | kUtf8Overlong4,
+        kUtf8Carry | kUtf8Overlong2,
+        kUtf8Carry,
+        kUtf8Carry,
+        kUtf8Carry | kUtf8TooLarge,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000 | kUtf8Surrogate,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+        kUtf8Carry | kUtf8TooLarge | kUtf8TooLarge1000,
+    };
+
+    static const u8_t kUtf8Byte2High[16] = {
+        kUtf8TooShort, kUtf8TooShort, kUtf8TooShort, kUtf8TooShort,
+        kUtf8TooShort, kUtf8TooShort, kUtf8TooShort, kUtf8TooShort,
+        kUtf8TooLong | kUtf8Overlong2 | kUtf8TwoConts | kUtf8Overlong3 | kUtf8TooLarge1000 | kUtf8Overlong4,
+        kUtf8TooLong | kUtf8Overlong2 | kUtf8TwoConts | kUtf8Overlong3 | kUtf8TooLarge,
+        kUtf8TooLong | kUtf8Overlong2 | kUtf8TwoConts | kUtf8Surrogate | kUtf8TooLarge,
+        kUtf8TooLong | kUtf8Overlong2 | kUtf8TwoConts | kUtf8Surrogate | kUtf8TooLarge,
+        kUtf8TooShort, kUtf8TooShort, kUtf8TooShort, kUtf8TooShort,
+    };
+
+    // the last three bytes of a block must not start a sequence that runs past them.
+    static const u8_t kUtf8Incomplete[32] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF,
+    };
+
+    _EOKAS_UTF8_TARGET("ssse3")
+    static __m128i utf8_check_ssse3(__m128i input, __m128i prev) {
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+        __m128i byte1High = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) kUtf8Byte1High), _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+        __m128i byte1Low = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) kUtf8Byte1Low), _mm_and_si128(prev1, nibble));
+        __m128i byte2High = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) kUtf8Byte2High), _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+        __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+        __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+        __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+        __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8((char) (0xE0 - 0x80)));
+        __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char) (0xF0 - 0x80)));
+        __m128i expected = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char) 0x80));
+        return _mm_xor_si128(expected, special);
+    }
+
+    _EOKAS_UTF8_TARGET("ssse3")
+    static bool utf8_validate_ssse3(const u8_t* data, size_t size) {
+        const __m128i incompleteMax = _mm_loadu_si128((const __m128i*) (kUtf8Incomplete + 16));
+        __m128i error = _mm_setzero_si128();
+        __m128i prev = _mm_setzero_si128();
+        __m128i prevIncomplete = _mm_setzero_si128();
+        u8_t tail[16];
+        for (size_t i = 0; i < size; i += 16) {
+            __m128i input;
+            if (size - i >= 16) {
+                input = _mm_loadu_si128((const __m128i*) (data + i));
+            } else {
+                // zeros are ASCII, a sequence cut off by the end shows as too short.
+                memset(tail, 0, sizeof(tail));
+                memcpy(tail, data + i, size - i);
+                input = _mm_loadu_si128((const __m128i*) tail);
+            }
+            if (_mm_movemask_epi8(input) == 0) {
+                error = _mm_or_si128(error, prevIncomplete);
+            } else {
+                error = _mm_or_si128(error, utf8_check_ssse3(input, prev));
+                prevIncomplete = _mm_subs_epu8(input, incompleteMax);
+            }
+            prev = input;
+        }
+        error = _mm_or_si128(error, prevIncomplete);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+    }
+
+#if !defined(_MSC_VER) || defined(__clang__)
+    _EOKAS_UTF8_TARGET("avx2")
+    static __m256i utf8_table_avx2(const u8_t* table) {
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) table));
+    }
+
+    _EOKAS_UTF8_TARGET("avx2")
+    static __m256i utf8_check_avx2(__m256i input, __m256i prev) {
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        // prev and input side by side, shifted by one, two and three bytes across the lanes.
+        __m256i joined = _mm256_permute2x128_si256(prev, input, 0x21);
+        __m256i prev1 = _mm256_alignr_epi8(input, joined, 15);
+        __m256i byte1High = _mm256_shuffle_epi8(utf8_table_avx2(kUtf8Byte1High), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+        __m256i byte1Low = _mm256_shuffle_epi8(utf8_table_avx2(kUtf8Byte1Low), _mm256_and_si256(prev1, nibble));
+        __m256i byte2High = _mm256_shuffle_epi8(utf8_table_avx2(kUtf8Byte2High), _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+        __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+
+        __m256i prev2 = _mm256_alignr_epi8(input, joined, 14);
+        __m256i prev3 = _mm256_alignr_epi8(input, joined, 13);
+        __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char) (0xE0 - 0x80)));
+        __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char) (0xF0 - 0x80)));
+        __m256i expected = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char) 0x80));
+        return _mm256_xor_si256(expected, special);
+    }
+
+    _EOKAS_UTF8_TARGET("avx2")
+    static bool utf8_validate_avx2(const u8_t* data, size_t size) {
+        const __m256i incompleteMax = _mm256_loadu_si256((const __m256i*) kUtf8Incomplete);
+        __m256i error = _mm256_setzero_si256();
+        __m256i prev = _mm256_setzero_si256();
+        __m256i prevIncomplete = _mm256_setzero_si256();
+        u8_t tail[32];
+        for (size_t i = 0; i < size; i += 32) {
+            __m256i input;
+            if (size - i >= 32) {
+                input = _mm256_loadu_si256((const __m256i*) (data + i));
+            } else {
+                memset(tail, 0, sizeof(tail));
+                memcpy(tail, data + i, size - i);
+                input = _mm256_loadu_si256((const __m256i*) tail);
+            }
+            if (_mm256_movemask_epi8(input) == 0) {
+                error = _mm256_or_si256(error, prevIncomplete);
+            } else {
+                error = _mm256_or_si256(error, utf8_check_avx2(input, prev));
+                prevIncomplete = _mm256_subs_epu8(input, incompleteMax);
+            }
+            prev = input;
+        }
+        error = _mm256_or_si256(error, prevIncomplete);
+        bool valid = _mm256_testz_si256(error, error) != 0;
+        _mm256_zeroupper();
+        return valid;
+    }
+#endif
+
+    static bool utf8_supports_ssse3() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] = {0};
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3");
+#endif
+    }
+#endif
+
+    using UTF8Validate = bool (*)(const u8_t* data, size_t size);
+
+    struct UTF8Kernels {
+        const char* name;
+        UTF8Validate validate;
+
+        static const UTF8Kernels& instance() {
+            static const UTF8Kernels sInstance = UTF8Kernels::detect();
+            return sInstance;
+        }
+
+        static UTF8Kernels detect() {
+#if defined(_EOKAS_UTF8_X64) && (!defined(_MSC_VER) || defined(__clang__))
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return {"avx2", utf8_validate_avx2};
+#endif
+#if defined(_EOKAS_UTF8_X64)
+            if (utf8_supports_ssse3())
+                return {"ssse3", utf8_validate_ssse3};
+#endif
+            return {"scalar", utf8_validate_scalar};
+        }
+    };
+
+    /*
+    ============================================================================================
+    ==== transcoding
+    ==== Unit is char16_t, char32_t or wchar_t, two byte units carry UTF-16.
+    ============================================================================================
+    */
+    template<typename Unit>
+    static size_t utf8_widen_ascii(const u8_t* src, size_t size, Unit* dst) {
+        size_t i = 0;
+#if defined(_EOKAS_UTF8_X64)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= size; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*) (src + i));
+            if (_mm_movemask_epi8(bytes) != 0)
+                break;
+            __m128i low = _mm_unpacklo_epi8(bytes, zero);
+            __m128i high = _mm_unpackhi_epi8(bytes, zero);
+            if (sizeof(Unit) == 2) {
+                _mm_storeu_si128((__m128i*) (dst + i), low);
+                _mm_storeu_si128((__m128i*) (dst + i + 8), high);
+            } else {
+                _mm_storeu_si128((__m128i*) (dst + i), _mm_unpacklo_epi16(low, zero));
+                _mm_storeu_si128((__m128i*) (dst + i + 4), _mm_unpackhi_epi16(low, zero));
+                _mm_storeu_si128((__m128i*) (dst + i + 8), _mm_unpacklo_epi16(high, zero));
+                _mm_storeu_si128((__m128i*) (dst + i + 12), _mm_unpackhi_epi16(high, zero));
+            }
+        }
+#endif
+        for (; i < size && src[i] < 0x80; i++) {
+            dst[i] = (Unit) src[i];
+        }
+        return i;
+    }
+
+    template<typename Unit>
+    static size_t utf8_decode(const u8_t* src, size_t size, Unit* dst, bool replace) {
+        const u8_t* end = src + size;
+        Unit* out = dst;
+        for (const u8_t* p = src; p < end;) {
+            size_t run = utf8_widen_ascii(p, (size_t) (end - p), out);
+            p += run;
+            out += run;
+            if (p == end)
+                break;
+            u32_t code;
+            size_t length = utf8_sequence(p, end, code);
+            if (length == 0) {
+                if (!replace)
+                    return UTF8::kInvalid;
+                code = 0xFFFD;
+                length = 1;
+            }
+            p += length;
+            if (sizeof(Unit) == 2 && code >= 0x10000) {
+                code -= 0x10000;
+                *out++ = (Unit) (0xD800 + (code >> 10));
+                *out++ = (Unit) (0xDC00 + (code & 0x3FF));
+            } else {
+                *out++ = (Unit) code;
+            }
+        }
+        return (size_t) (out - dst);
+    }
+
+    template<typename Unit>
+    static size_t utf8_narrow_ascii(const Unit* src, size_t size, u8_t* dst) {
+        size_t i = 0;
+#if defined(_EOKAS_UTF8_X64)
+        const __m128i zero = _mm_setzero_si128();
+        if (sizeof(Unit) == 2) {
+            const __m128i mask = _mm_set1_epi16((short) 0xFF80);
+            for (; i + 8 <= size; i += 8) {
+                __m128i units = _mm_loadu_si128((const __m128i*) (src + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, mask), zero)) != 0xFFFF)
+                    break;
+                _mm_storel_epi64((__m128i*) (dst + i), _mm_packus_epi16(units, zero));
+            }
+        } else {
+            const __m128i mask = _mm_set1_epi32((int) 0xFFFFFF80);
+            for (; i + 4 <= size; i += 4) {
+                __m128i units = _mm_loadu_si128((const __m128i*) (src + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(units, mask), zero)) != 0xFFFF)
+                    break;
+                __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(units, zero), zero);
+                int word = _mm_cvtsi128_si32(bytes);
+                memcpy(dst + i, &word, 4);
+            }
+        }
+#endif
+        for (; i < size && (u32_t) src[i] < 0x80; i++) {
+            dst[i] = (u8_t) src[i];
+        }
+        return i;
+    }
+
+    template<typename Unit>
+    static size_t utf8_encode(const Unit* src, size_t size, u8_t* dst, bool replace) {
+        const Unit* end = src + size;
+        u8_t* out = dst;
+        for (const Unit* p = src; p < end;) {
+            size_t run = utf8_narrow_ascii(p, (size_t) (end - p), out);
+            p += run;
+            out += run;
+            if (p == end)
+                break;
+            u32_t code = (u32_t) *p++;
+            if (sizeof(Unit) == 2 && code >= 0xD800 && code < 0xDC00 && p < end && (u32_t) *p >= 0xDC00 && (u32_t) *p < 0xE000) {
+                code = 0x10000 + ((code - 0xD800) << 10) + ((u32_t) *p++ - 0xDC00);
+            } else if ((code >= 0xD800 && code < 0xE000) || code > 0x10FFFF) {
+                if (!replace)
+                    return UTF8::kInvalid;
+                code = 0xFFFD;
+            }
+            if (code < 0x800) {
+                *out++ = (u8_t) (0xC0 | (code >> 6));
+                *out++ = (u8_t) (0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                *out++ = (u8_t) (0xE0 | (code >> 12));
+                *out++ = (u8_t) (0x80 | ((code >> 6) & 0x3F));
+                *out++ = (u8_t) (0x80 | (code & 0x3F));
+            } else {
+                *out++ = (u8_t) (0xF0 | (code >> 18));
+                *out++ = (u8_t) (0x80 | ((code >> 12) & 0x3F));
+                *out++ = (u8_t) (0x80 | ((code >> 6) & 0x3F));
+                *out++ = (u8_t) (0x80 | (code & 0x3F));
+            }
+        }
+        return (size_t) (out - dst);
+    }
+
+    template<typename Unit>
+    static size_t utf8_encoded_length(const Unit* data, size_t size) {
+        size_t length = 0;
+        for (size_t i = 0; i < size; i++) {
+            u32_t code = (u32_t) data[i];
+            if (sizeof(Unit) == 2 && code >= 0xD800 && code < 0xE000) {
+                // half of a pair, the pair takes four bytes.
+                length += 2;
+            } else {
+                length += 1 + (code >= 0x80) + (code >= 0x800) + (code >= 0x10000);
+            }
+        }
+        return length;
+    }
+
+    /*
+    ============================================================================================
+    ==== UTF8
+    ============================================================================================
+    */
+    const char* UTF8::kernel() {
+        return UTF8Kernels::instance().name;
+    }
+
+    bool UTF8::validate(const char* data, size_t size) {
+        const u8_t* bytes = (const u8_t*) data;
+        size_t ascii = utf8_ascii_prefix(bytes, size);
+        if (ascii == size)
+            return true;
+        return UTF8Kernels::instance().validate(bytes + ascii, size - ascii);
+    }
+
+    size_t UTF8::findInvalid(const char* data, size_t size) {
+        const u8_t* bytes = (const u8_t*) data;
+        const u8_t* end = bytes + size;
+        for (const u8_t* p = bytes; p < end;) {
+            p += utf8_ascii_prefix(p, (size_t) (end - p));
+            if (p == end)
+                break;
+            u32_t code;
+            size_t length = utf8_sequence(p, end, code);
+            if (length == 0)
+                return (size_t) (p - bytes);
+            p += length;
+        }
+        return size;
+    }
+
+    size_t UTF8::asciiPrefix(const char* data, size_t size) {
+        return utf8_ascii_prefix((const u8_t*) data, size);
+    }
+
+    size_t UTF8::utf16Length(const char* data, size_t size) {
+        size_t length = 0;
+        for (size_t i = 0; i < size; i++) {
+            u8_t c = (u8_t) data[i];
+            length += ((c & 0xC0) != 0x80) + (c >= 0xF0);
+        }
+        return length;
+    }
+
+    size_t UTF8::utf32Length(const char* data, size_t size) {
+        size_t length = 0;
+        for (size_t i = 0; i < size; i++) {
+            length += ((u8_t) data[i] & 0xC0) != 0x80;
+        }
+        return length;
+    }
+
+    size_t UTF8::wideLength(const char* data, size_t size) {
+        return sizeof(wchar_t) == 2 ? utf16Length(data, size) : utf32Length(data, size);
+    }
+
+    size_t UTF8::utf8Length(const char16_t* data, size_t size) {
+        return utf8_encoded_length(data, size);
+    }
+
+    size_t UTF8::utf8Length(const char32_t* data, size_t size) {
+        return utf8_encoded_length(data, size);
+    }
+
+    size_t UTF8::utf8Length(const wchar_t* data, size_t size) {
+        return utf8_encoded_length(data, size);
+    }
+
+    size_t UTF8::toUtf16(const char* src, size_t size, char16_t* dst, bool replace) {
+        return utf8_decode((const u8_t*) src, size, dst, replace);
+    }
+
+    size_t UTF8::toUtf32(const char* src, size_t size, char32_t* dst, bool replace) {
+        return utf8_decode((const u8_t*) src, size, dst, replace);
+    }
+
+    size_t UTF8::toWide(const char* src, size_t size, wchar_t* dst, bool replace) {
+        return utf8_decode((const u8_t*) src, size, dst, replace);
+    }
+
+    size_t UTF8::fromUtf16(const char16_t* src, size_t size, char* dst, bool replace) {
+        return utf8_encode(src, size, (u8_t*) dst, replace);
+    }
+
+    size_t UTF8::fromUtf32(const char32_t* src, size_t size, char* dst, bool replace) {
+        return utf8_encode(src, size, (u8_t*) dst, replace);
+    }
+
+    size_t UTF8::fromWide(const wchar_t* src, size_t size, char* dst, bool replace) {
+        return utf8_encode(src, size, (u8_t*) dst, replace);
+    }
+
+    /*
+    ============================================================================================
+    ==== UTF8Decoder
+    ============================================================================================
+    */
+    UTF8Decoder::UTF8Decoder()
+        : mPending()
+        , mPendingSize(0)
+        , mFailed(false) {
+    }
+
+    // dst is null when only validating.
+    template<typename Unit>
+    size_t UTF8Decoder::process(const char* data, size_t size, Unit* dst) {
+        if (mFailed)
+            return UTF8::kInvalid;
+        const u8_t* bytes = (const u8_t*) data;
+        size_t written = 0;
+
+        // complete the sequence the last chunk ended in.
+        if (mPendingSize > 0) {
+            u32_t length = utf8_lead_length(mPending[0]);
+            size_t take = length - mPendingSize < size ? length - mPendingSize : size;
+            memcpy(mPending + mPendingSize, bytes, take);
+            mPendingSize += (u32_t) take;
+            bytes += take;
+            size -= take;
+            if (mPendingSize < length)
+                return 0;
+            u32_t code;
+            if (utf8_sequence(mPending, mPending + length, code) == 0) {
+                mFailed = true;
+                return UTF8::kInvalid;
+            }
+            if (dst != nullptr) {
+                written = utf8_decode(mPending, length, dst, false);
+            }
+            mPendingSize = 0;
+        }
+
+        // hold back a sequence this chunk cuts off.
+        size_t keep = 0;
+        for (size_t back = 1; back <= 3 && back <= size; back++) {
+            u8_t c = bytes[size - back];
+            if ((c & 0xC0) == 0x80)
+                continue;
+            keep = utf8_lead_length(c) > back ? back : 0;
+            break;
+        }
+        size -= keep;
+
+        if (dst != nullptr) {
+            size_t decoded = utf8_decode(bytes, size, dst + written, false);
+            if (decoded == UTF8::kInvalid) {
+                mFailed = true;
+                return UTF8::kInvalid;
+            }
+            written += decoded;
+        } else if (!UTF8::validate((const char*) bytes, size)) {
+            mFailed = true;
+            return UTF8::kInvalid;
+        }
+        memcpy(mPending, bytes + size, keep);
+        mPendingSize = (u32_t) keep;
+        return written;
+    }
+
+    bool UTF8Decoder::feed(const char* data, size_t size) {
+        return this->process<char32_t>(data, size, nullptr) != UTF8::kInvalid;
+    }
+
+    size_t UTF8Decoder::decode(const char* data, size_t size, char16_t* dst) {
+        return this->process(data, size, dst);
+    }
+
+    size_t UTF8Decoder::decode(const char* data, size_t size, char32_t* dst) {
+        return this->process(data, size, dst);
+    }
+
+    size_t UTF8Decoder::decode(const char* data, size_t size, wchar_t* dst) {
+        return this->process(data, size, dst);
+    }
+
+    bool UTF8Decoder::finish() {
+        bool ok = !mFailed && mPendingSize == 0;
+        mPendingSize = 0;
+        mFailed = false;
+        return ok;
+    }
+
+    bool UTF8Decoder::failed() const {
+        return mFailed;
+    }
+
+}
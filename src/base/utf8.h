@@ -0,0 +1,88 @@
+#ifndef _EOKAS_BASE_UTF8_H_
+#define _EOKAS_BASE_UTF8_H_
+
+#include "./header.h"
+
+namespace eokas {
+
+    /*
+    ============================================================================================
+    ==== UTF8
+    ==== Validation and bulk transcoding between UTF-8 and UTF-16 / UTF-32 in caller buffers.
+    ==== Well formed means shortest forms only, no surrogates and nothing above U+10FFFF.
+    ==== Validation runs 16 or 32 bytes at a time with lookup tables (Keiser and Lemire,
+    ==== "Validating UTF-8 in less than one instruction per byte", 2021), the transcoders copy
+    ==== runs of ASCII a vector at a time and decode the rest one code point at a time.
+    ==== wchar_t is UTF-16 with _EOKAS_UCS_2 (Windows) and UTF-32 with _EOKAS_UCS_4.
+    ============================================================================================
+    */
+    class UTF8 {
+    public:
+        /// returned by the transcoders for ill formed input.
+        static const size_t kInvalid = (size_t) -1;
+
+        /// "avx2", "ssse3" or "scalar", the validation kernel in use.
+        static const char* kernel();
+
+        static bool validate(const char* data, size_t size);
+        /// offset of the first ill formed or cut off sequence, size if there is none.
+        static size_t findInvalid(const char* data, size_t size);
+        /// bytes of plain ASCII at the start of data.
+        static size_t asciiPrefix(const char* data, size_t size);
+
+        /// units the transcoded text takes, for well formed input.
+        static size_t utf16Length(const char* data, size_t size);
+        static size_t utf32Length(const char* data, size_t size);
+        static size_t wideLength(const char* data, size_t size);
+        static size_t utf8Length(const char16_t* data, size_t size);
+        static size_t utf8Length(const char32_t* data, size_t size);
+        static size_t utf8Length(const wchar_t* data, size_t size);
+
+        /// decode into dst and return the units written, size units always fit.
+        /// Ill formed input returns kInvalid, or with replace every ill formed byte becomes U+FFFD.
+        static size_t toUtf16(const char* src, size_t size, char16_t* dst, bool replace = false);
+        static size_t toUtf32(const char* src, size_t size, char32_t* dst, bool replace = false);
+        static size_t toWide(const char* src, size_t size, wchar_t* dst, bool replace = false);
+
+        /// encode into dst and return the bytes written, 3 bytes per UTF-16 unit and 4 bytes
+        /// per UTF-32 unit always fit. Lone surrogates and values above U+10FFFF are ill formed.
+        static size_t fromUtf16(const char16_t* src, size_t size, char* dst, bool replace = false);
+        static size_t fromUtf32(const char32_t* src, size_t size, char* dst, bool replace = false);
+        static size_t fromWide(const wchar_t* src, size_t size, char* dst, bool replace = false);
+    };
+
+    /*
+    ============================================================================================
+    ==== UTF8Decoder
+    ==== The same for input that arrives in chunks, a sequence may be split between chunks.
+    ==== Once a chunk is ill formed the decoder stays failed until finish().
+    ============================================================================================
+    */
+    class UTF8Decoder {
+    public:
+        UTF8Decoder();
+
+        /// validates the next chunk, false once the stream is ill formed.
+        bool feed(const char* data, size_t size);
+        /// decodes the next chunk into dst, which holds size + 2 units, and returns the units
+        /// written. kInvalid once the stream is ill formed.
+        size_t decode(const char* data, size_t size, char16_t* dst);
+        size_t decode(const char* data, size_t size, char32_t* dst);
+        size_t decode(const char* data, size_t size, wchar_t* dst);
+
+        /// true if the stream was well formed and ended on a whole sequence, then starts over.
+        bool finish();
+        bool failed() const;
+
+    private:
+        template<typename Unit>
+        size_t process(const char* data, size_t size, Unit* dst);
+
+        u8_t mPending[4];
+        u32_t mPendingSize;
+        bool mFailed;
+    };
+
+}
+
+#endif//_EOKAS_BASE_UTF8_H_
@@ -1,12 +1,22 @@
 #include "./library.h"
 #include "./schema.h"
 #include "./value.h"
+#include <algorithm>
 
 namespace eokas::datapot {
-    Library::Library(const String& name)
+    // counts come from the file, a corrupt one must not reserve more records than the bytes
+    // left in the stream could hold.
+    static size_t library_reserve_hint(Stream& stream, u32_t count, size_t recordSize) {
+        size_t size = stream.size();
+        size_t pos = stream.pos();
+        size_t left = size > pos ? size - pos : 0;
+        return std::min<size_t>(count, left / recordSize);
+    }
+    
+    Library::Library(const String& name, MemoryArena* arena)
         : mName(name)
         , mSchemas()
-        , mValues(mSchemas)
+        , mValues(mSchemas, arena)
         , mRoot() { }
     
     Library::~Library() {
@@ -90,9 +100,11 @@ namespace eokas::datapot {
             return true;
         };
         
-        auto readValueList = [this, &readValue](BinaryStream& stream, std::vector<Value>& list)->bool {
+        auto readValueList = [this, &readValue](BinaryStream& stream, auto& list)->bool {
             u32_t count = -1;
             if(!stream.read(count)) return false;
+            // a value is its u32 schema index and its u64.
+            list.reserve(list.size() + library_reserve_hint(stream, count, sizeof(u32_t) + sizeof(u64_t)));
             for(u32_t index = 0; index < count; index++) {
                 Value& value = list.emplace_back();
                 if(!readValue(stream, value))
@@ -101,7 +113,7 @@ namespace eokas::datapot {
             return true;
         };
         
-        auto readValueMap = [this, &readValue](BinaryStream& stream, std::map<String, Value>& map)->bool {
+        auto readValueMap = [this, &readValue](BinaryStream& stream, ValueMap& map)->bool {
             u32_t count = -1;
             if(!stream.read(count)) return false;
             for(u32_t index = 0; index < count; index++) {
@@ -119,20 +131,23 @@ namespace eokas::datapot {
         
         u32_t listCount = 0;
         if(!stream.read(listCount)) return false;
+        mValues.lists.reserve(mValues.lists.size() + library_reserve_hint(stream, listCount, sizeof(u32_t)));
         for(u32_t index = 0; index < listCount; index++) {
-            List& list = mValues.lists.emplace_back();
+            List& list = mValues.lists.emplace_back(mValues.arena());
             if(!readValueList(stream, list.elements)) return false;
         }
         
         u32_t objectCount = 0;
         if(!stream.read(objectCount)) return false;
+        mValues.objects.reserve(mValues.objects.size() + library_reserve_hint(stream, objectCount, sizeof(u32_t)));
         for(u32_t index = 0; index < objectCount; index++) {
-            Object& obj = mValues.objects.emplace_back();
+            Object& obj = mValues.objects.emplace_back(mValues.arena());
             if(!readValueMap(stream, obj.members)) return false;
         }
         
         u32_t stringCount = 0;
         if(!stream.read(stringCount)) return false;
+        mValues.strings.reserve(mValues.strings.size() + library_reserve_hint(stream, stringCount, 1));
         for(u32_t index = 0; index < stringCount; index++) {
             String& str = mValues.strings.emplace_back();
             if(!stream.read(str)) return false;
@@ -187,14 +202,14 @@ namespace eokas::datapot {
             }
         }
         
-        auto saveValueList = [this](BinaryStream& stream, const std::vector<Value>& list) {
+        auto saveValueList = [this](BinaryStream& stream, const auto& list) {
             stream.write(u32_t(list.size()));
             for(const auto& value : list) {
                 stream.write(mSchemas.indexOf(value.schema->name()));
                 stream.write(value.value.u64);
             }
         };
-        auto saveValueMap = [this](BinaryStream& stream, const std::map<String, Value>& map) {
+        auto saveValueMap = [this](BinaryStream& stream, const ValueMap& map) {
             stream.write(u32_t(map.size()));
             for(auto& pair : map) {
                 stream.write(pair.first);
@@ -9,7 +9,9 @@
 namespace eokas::datapot {
     class Library {
     public:
-        Library(const String& name);
+        /// list and object storage is placed in the arena when one is given,
+        /// the arena must outlive the library.
+        Library(const String& name, MemoryArena* arena = nullptr);
         virtual ~Library();
         
         const String& name() const { return mName; }
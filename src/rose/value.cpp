@@ -3,8 +3,9 @@
 #include "./schema.h"
 
 namespace eokas::datapot {
-    ValueHeap::ValueHeap(SchemaHeap& schemaHeap)
-        : mSchemaHeap(schemaHeap) { }
+    ValueHeap::ValueHeap(SchemaHeap& schemaHeap, MemoryArena* arena)
+        : mSchemaHeap(schemaHeap)
+        , mArena(arena) { }
 
     ValueHeap::~ValueHeap() {
         this->clear();
@@ -94,7 +95,7 @@ namespace eokas::datapot {
         if(schema->type() == SchemaType::List)
         {
             size_t index = this->lists.size();
-            List& list = this->lists.emplace_back();
+            List& list = this->lists.emplace_back(mArena);
 
             Value& value = this->values.emplace_back();
             value.set(schema, u32_t(index));
@@ -105,7 +106,7 @@ namespace eokas::datapot {
         if(schema->type() == SchemaType::Struct)
         {
             size_t index = this->objects.size();
-            Object& object = this->objects.emplace_back();
+            Object& object = this->objects.emplace_back(mArena);
 
             Value& value = this->values.emplace_back();
             value.set(schema, u32_t(index));
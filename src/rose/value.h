@@ -38,8 +38,14 @@ namespace eokas::datapot {
         }
     };
     
+    using ValueVector = std::vector<Value, ArenaAllocator<Value>>;
+    using ValueMap = std::map<String, Value, std::less<String>, ArenaAllocator<std::pair<const String, Value>>>;
+    
     struct List {
-        std::vector<Value> elements;
+        ValueVector elements;
+
+        List(MemoryArena* arena = nullptr)
+            : elements(ArenaAllocator<Value>(arena)) { }
 
         Value& get(u32_t index) {
             return elements.at(index);
@@ -64,7 +70,10 @@ namespace eokas::datapot {
     };
     
     struct Object {
-        std::map<String, Value> members;
+        ValueMap members;
+
+        Object(MemoryArena* arena = nullptr)
+            : members(ArenaAllocator<std::pair<const String, Value>>(arena)) { }
 
         Value& get(const String& name) {
             return members.at(name);
@@ -77,7 +86,7 @@ namespace eokas::datapot {
     
     class ValueHeap {
     public:
-        ValueHeap(SchemaHeap& schemaHeap);
+        ValueHeap(SchemaHeap& schemaHeap, MemoryArena* arena = nullptr);
         virtual ~ValueHeap();
 
         std::vector<Value> values;
@@ -118,8 +127,11 @@ namespace eokas::datapot {
 
         void clear();
 
+        MemoryArena* arena() const { return mArena; }
+
     private:
         SchemaHeap& mSchemaHeap;
+        MemoryArena* mArena;
     };
 }
 
@@ -0,0 +1,68 @@
+
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(arena)
+{
+    MemoryArena arena(16 * 1024 * 1024);
+    _eokas_test_check(arena.reserved() >= 16 * 1024 * 1024);
+    _eokas_test_check(arena.used() == 0);
+
+    // bump allocation and alignment
+    {
+        void* a = arena.alloc(3, 1);
+        void* b = arena.alloc(8, 64);
+        _eokas_test_check(a != nullptr && b != nullptr);
+        _eokas_test_check(((size_t) b % 64) == 0);
+        _eokas_test_check(arena.owns(a) && arena.owns(b));
+    }
+
+    // commit on demand
+    {
+        size_t committed = arena.committed();
+        void* big = arena.alloc(1024 * 1024);
+        _eokas_test_check(big != nullptr);
+        memset(big, 0xAB, 1024 * 1024);
+        _eokas_test_check(arena.committed() > committed);
+    }
+
+    // markers
+    {
+        size_t used = arena.used();
+        {
+            MemoryArenaScope scope(arena);
+            i64_t* values = arena.makeArray<i64_t>(1000);
+            _eokas_test_check(values != nullptr && values[999] == 0);
+            _eokas_test_check(arena.used() > used);
+        }
+        _eokas_test_check(arena.used() == used);
+    }
+
+    // exhaustion returns null instead of throwing
+    {
+        _eokas_test_check(arena.alloc(arena.reserved() + 1) == nullptr);
+    }
+
+    // containers on top of the arena
+    {
+        std::vector<i32_t, ArenaAllocator<i32_t>> list{ArenaAllocator<i32_t>(&arena)};
+        for (i32_t i = 0; i < 1000; i++) {
+            list.push_back(i);
+        }
+        _eokas_test_check(list.size() == 1000 && list[500] == 500);
+        _eokas_test_check(arena.owns(list.data()));
+    }
+
+    // json documents
+    {
+        HomNode doc = JSON::parse("{\"name\": \"eokas\", \"files\": [1, 2, 3]}", &arena);
+        _eokas_test_check(doc.isObject());
+        _eokas_test_check(doc.get("name").asString() == "eokas");
+        _eokas_test_check(doc.get("files").get(2).asNumber() == 3);
+    }
+
+    arena.reset(true);
+    _eokas_test_check(arena.used() == 0);
+
+    return 0;
+}
@@ -1,7 +1,17 @@
 
 #include "../engine/main.h"
+#include <random>
 using namespace eokas;
 
+template<typename Match>
+static size_t ascil_reference_run(const char* data, size_t size, Match match) {
+    size_t i = 0;
+    while (i < size && match((u8_t) data[i])) {
+        i += 1;
+    }
+    return i;
+}
+
 _eokas_test_case(ascil)
 {
     {
@@ -33,5 +43,83 @@ _eokas_test_case(ascil)
         _eokas_test_check(x.isPunct() && !y.isPunct());
     }
 
+    // the table agrees with the C library in the C locale
+    {
+        bool same = true;
+        for (int c = 0; c < 256; c++) {
+            char chr = (char) c;
+            bool ascii = c < 128;
+            same = same && _ascil_is_number(chr) == (ascii && isdigit(c) != 0);
+            same = same && _ascil_is_alpha(chr) == (ascii && isalpha(c) != 0);
+            same = same && _ascil_is_punct(chr) == (ascii && ispunct(c) != 0);
+            same = same && _ascil_is_hex(chr) == (ascii && isxdigit(c) != 0);
+            same = same && _ascil_is_white(chr) == (ascii && isspace(c) != 0);
+            same = same && _ascil_is_control(chr) == (ascii && c != 0 && iscntrl(c) != 0);
+            same = same && Ascil(chr).toUpper() == (ascii ? (char) toupper(c) : chr);
+        }
+        _eokas_test_check(same);
+    }
+
+    // bulk runs, case mapping and compare against one char at a time
+    {
+        std::mt19937 rng(11);
+        const char alphabet[] = " \t\n\r\v\f_09azAZ@[`{~\x7f\x80\xff";
+        bool runs = true;
+        bool cases = true;
+        bool compares = true;
+        for (int round = 0; round < 3000; round++) {
+            size_t size = rng() % 100;
+            u32_t bias = rng() % 4;
+            char data[100];
+            for (size_t i = 0; i < size; i++) {
+                // long runs of one class now and then
+                data[i] = bias == 0 ? ' ' : (bias == 1 ? (char) ('0' + rng() % 10) : alphabet[rng() % (sizeof(alphabet) - 1)]);
+                if (rng() % 40 == 0) {
+                    data[i] = alphabet[rng() % (sizeof(alphabet) - 1)];
+                }
+            }
+            runs = runs && Ascil::whiteLength(data, size) == ascil_reference_run(data, size, [](u8_t c) { return c == ' ' || (c >= 9 && c <= 13); });
+            runs = runs && Ascil::numberLength(data, size) == ascil_reference_run(data, size, [](u8_t c) { return c >= '0' && c <= '9'; });
+            runs = runs && Ascil::identifierLength(data, size) == ascil_reference_run(data, size, [](u8_t c) { return c < 128 && (isalnum(c) || c == '_'); });
+
+            char upper[100];
+            char lower[100];
+            Ascil::toUpper(upper, data, size);
+            Ascil::toLower(lower, data, size);
+            for (size_t i = 0; i < size; i++) {
+                u8_t c = (u8_t) data[i];
+                cases = cases && upper[i] == (c < 128 ? (char) toupper(c) : data[i]);
+                cases = cases && lower[i] == (c < 128 ? (char) tolower(c) : data[i]);
+            }
+
+            char other[100];
+            memcpy(other, rng() % 2 ? upper : lower, size);
+            compares = compares && Ascil::compareIgnoreCase(data, other, size) == 0;
+            if (size > 0) {
+                size_t at = rng() % size;
+                other[at] = (char) (other[at] + 1);
+                int expected = 0;
+                for (size_t i = 0; i < size; i++) {
+                    int x = tolower((u8_t) data[i]);
+                    int y = tolower((u8_t) other[i]);
+                    if ((u8_t) data[i] >= 128) x = (u8_t) data[i];
+                    if ((u8_t) other[i] >= 128) y = (u8_t) other[i];
+                    if (x != y) {
+                        expected = x - y;
+                        break;
+                    }
+                }
+                int result = Ascil::compareIgnoreCase(data, other, size);
+                compares = compares && (result < 0) == (expected < 0) && (result > 0) == (expected > 0);
+            }
+        }
+        _eokas_test_check(runs);
+        _eokas_test_check(cases);
+        _eokas_test_check(compares);
+        _eokas_test_check(Ascil::equalsIgnoreCase("Content-Type", 12, "content-type", 12));
+        _eokas_test_check(Ascil::compareIgnoreCase("abc", 3, "ABCD", 4) < 0 && !Ascil::equalsIgnoreCase("a", 1, "b", 1));
+        _eokas_test_check(String("Hello, World 42").toUpper() == "HELLO, WORLD 42" && String("\xC3\x89" "Ab").toLower() == "\xC3\x89" "ab");
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,195 @@
+
+#include "../engine/main.h"
+#include <array>
+using namespace eokas;
+
+static void async_spawn(ThreadPool& pool, std::atomic<int>& leaves, int depth) {
+    if (depth == 0) {
+        leaves++;
+        return;
+    }
+    pool.exec([&pool, &leaves, depth]() {
+        async_spawn(pool, leaves, depth - 1);
+    });
+    pool.exec([&pool, &leaves, depth]() {
+        async_spawn(pool, leaves, depth - 1);
+    });
+}
+
+_eokas_test_case(async)
+{
+    // owner pops LIFO, thieves take every item exactly once
+    {
+        WorkStealingDeque<int> deque(4);
+        std::vector<int> items(100000);
+        std::vector<std::atomic<int>> taken(items.size());
+        for (auto& flag: taken) {
+            flag = 0;
+        }
+
+        deque.push(&items[0]);
+        deque.push(&items[1]);
+        _eokas_test_check(deque.pop() == &items[1]);
+        _eokas_test_check(deque.steal() == &items[0]);
+        _eokas_test_check(deque.pop() == nullptr && deque.empty());
+
+        std::atomic<bool> done{false};
+        std::vector<std::thread> thieves;
+        for (int t = 0; t < 4; t++) {
+            thieves.emplace_back([&]() {
+                while (!done || !deque.empty()) {
+                    int* item = deque.steal();
+                    if (item != nullptr) {
+                        taken[item - items.data()]++;
+                    }
+                }
+            });
+        }
+        for (size_t i = 0; i < items.size(); i++) {
+            deque.push(&items[i]);
+            if (i % 3 == 0) {
+                int* item = deque.pop();
+                if (item != nullptr) {
+                    taken[item - items.data()]++;
+                }
+            }
+        }
+        done = true;
+        for (auto& thread: thieves) {
+            thread.join();
+        }
+        bool once = true;
+        for (auto& flag: taken) {
+            once = once && flag == 1;
+        }
+        _eokas_test_check(once);
+    }
+
+    // exec stays source compatible in both modes
+    {
+        ThreadPool shared;
+        ThreadPool stealing(8, ThreadPoolMode::WorkStealing);
+        _eokas_test_check(stealing.size() == 8 && stealing.mode() == ThreadPoolMode::WorkStealing);
+        _eokas_test_check(ThreadPool::maxSize() >= THREADPOOL_MAX_NUM);
+
+        std::vector<std::future<int>> results;
+        for (int i = 0; i < 100; i++) {
+            results.push_back(shared.exec([](int a, int b) { return a * b; }, i, 2));
+            results.push_back(stealing.exec([](int a, int b) { return a * b; }, i, 3));
+        }
+        int sum = 0;
+        for (auto& result: results) {
+            sum += result.get();
+        }
+        _eokas_test_check(sum == 4950 * 5);
+    }
+
+    // a draining task may still post while the pool is being destroyed
+    {
+        std::atomic<int> ran{0};
+        {
+            ThreadPool pool(1);
+            pool.post([&pool, &ran]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                pool.post([&ran]() { ran += 1; });
+                ran += 1;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        _eokas_test_check(ran == 2);
+    }
+
+    // nested tasks spread over the workers through stealing
+    {
+        std::atomic<int> leaves{0};
+        {
+            ThreadPool pool(4, ThreadPoolMode::WorkStealing);
+            pool.exec([&pool, &leaves]() {
+                async_spawn(pool, leaves, 12);
+            }).get();
+        }
+        _eokas_test_check(leaves == 4096);
+    }
+
+    // small callables stay inline, big ones move to the heap
+    {
+        int calls = 0;
+        Task small([&calls]() { calls++; });
+        Task moved(std::move(small));
+        _eokas_test_check(!small && moved);
+        moved();
+
+        std::array<u64_t, 16> payload{};
+        payload[15] = 2;
+        Task big([&calls, payload]() { calls += (int) payload[15]; });
+        Task other;
+        other = std::move(big);
+        other();
+        _eokas_test_check(calls == 3);
+
+        auto counter = std::make_shared<int>(0);
+        {
+            Task owner([counter]() {});
+            _eokas_test_check(counter.use_count() == 2);
+        }
+        _eokas_test_check(counter.use_count() == 1);
+    }
+
+    // post, spawn and pooled futures
+    {
+        ThreadPool pool(4, ThreadPoolMode::WorkStealing);
+        std::atomic<int> posted{0};
+        for (int i = 0; i < 10000; i++) {
+            pool.post([&posted](int n) { posted += n; }, 1);
+        }
+
+        std::vector<Future<int>> results;
+        for (int i = 0; i < 1000; i++) {
+            results.push_back(pool.spawn([](int a) { return a + 1; }, i));
+        }
+        int sum = 0;
+        for (auto& result: results) {
+            sum += result.get();
+        }
+        _eokas_test_check(sum == 500500);
+
+        Future<void> done = pool.spawn([&posted]() {
+            posted += 1;
+        });
+        done.get();
+        _eokas_test_check(!done.valid());
+
+        Future<int> failed = pool.spawn([]() -> int {
+            throw std::runtime_error("failed");
+        });
+        bool caught = false;
+        try {
+            failed.get();
+        }
+        catch (const std::runtime_error&) {
+            caught = true;
+        }
+        _eokas_test_check(caught);
+
+        Promise<String> promise;
+        Future<String> future = promise.getFuture();
+        std::thread producer([&promise]() {
+            promise.setValue(String("ready"));
+        });
+        _eokas_test_check(future.get() == "ready");
+        producer.join();
+
+        Future<int> broken;
+        {
+            Promise<int> dropped;
+            broken = dropped.getFuture();
+        }
+        _eokas_test_check(broken.isReady());
+
+        while (posted < 10001) {
+            std::this_thread::yield();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "../engine/main.h"
+#include <atomic>
+#include <thread>
+#include <set>
+using namespace eokas;
+
+_eokas_test_case(atom)
+{
+    // equal names share one id, the empty name is id 0
+    {
+        Atom empty;
+        _eokas_test_check(empty.isEmpty() && empty.id() == 0 && empty.name() == "");
+        _eokas_test_check(Atom("") == empty && Atom::fromId(0) == empty);
+
+        Atom name("name");
+        String copy("na");
+        copy += "me";
+        _eokas_test_check(!name.isEmpty() && Atom(copy) == name && Atom(StringView("names", 4)) == name);
+        _eokas_test_check(name.name() == "name" && name.length() == 4 && strcmp(name.cstr(), "name") == 0);
+        _eokas_test_check(name.hash() == Atom(copy).hash() && name != Atom("Name"));
+        _eokas_test_check(Atom::fromId(name.id()) == name && Atom::fromId(0xFFFFFFF0).isEmpty());
+
+        _eokas_test_check(Atom::lookup("atom test never interned").isEmpty());
+        _eokas_test_check(Atom::lookup("name") == name);
+
+        // names from data stop at a limit, names already in stay reachable
+        _eokas_test_check(Atom::tryIntern("name", 1) == name && Atom::tryIntern("", 1).isEmpty());
+        _eokas_test_check(Atom::tryIntern("atom test over the limit", 1).isEmpty());
+        _eokas_test_check(Atom::lookup("atom test over the limit").isEmpty());
+        Atom under = Atom::tryIntern("atom test under the limit");
+        _eokas_test_check(!under.isEmpty() && Atom::lookup("atom test under the limit") == under);
+
+        // the macro interns once per call site
+        Atom first;
+        for (int i = 0; i < 3; i++) {
+            Atom literal = _Atom("version");
+            first = i == 0 ? literal : first;
+            _eokas_test_check(literal == first && literal == Atom("version"));
+        }
+    }
+
+    // threads interning overlapping names agree on every id
+    {
+        const int threads = 4;
+        const int names = 3000;
+        std::vector<std::vector<u32_t>> ids(threads, std::vector<u32_t>(names));
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (int i = 0; i < names; i++) {
+                    int n = (i * 7 + t * 131) % names;
+                    ids[t][n] = Atom(String::format("atom.key.%d", n)).id();
+                }
+            });
+        }
+        // every id fromId() hands out while others intern already has its name.
+        std::atomic<bool> interning{true};
+        bool named = true;
+        std::thread reader([&]() {
+            while (interning.load()) {
+                Atom last = Atom::fromId(Atom::count() - 1);
+                named = named && !last.isEmpty() && last.length() > 0;
+            }
+        });
+        for (auto& worker: workers) {
+            worker.join();
+        }
+        interning.store(false);
+        reader.join();
+        _eokas_test_check(named);
+        bool agree = true;
+        std::set<u32_t> distinct;
+        for (int n = 0; n < names; n++) {
+            for (int t = 1; t < threads; t++) {
+                agree = agree && ids[t][n] == ids[0][n];
+            }
+            distinct.insert(ids[0][n]);
+            agree = agree && Atom::fromId(ids[0][n]).name() == String::format("atom.key.%d", n);
+        }
+        _eokas_test_check(agree && distinct.size() == (size_t) names);
+        _eokas_test_check(Atom::count() > (u32_t) names);
+    }
+
+    // objects and rows key on atoms, lookups of unknown names stay misses
+    {
+        HomNode object(HomType::Object);
+        for (int i = 0; i < 40; i++) {
+            object.set(String::format("member%d", i), HomNode((f64_t) i));
+        }
+        object.set(Atom("member7"), HomNode(true));
+        _eokas_test_check(object.get("member7").asBoolean() && object.get(Atom("member39")).asNumber() == 39);
+        _eokas_test_check(object.get("member40").isNull() && object.get("not interned anywhere").isNull());
+
+        std::vector<String> order;
+        object.foreach([&](const String& key, const HomNode&) { order.push_back(key); });
+        _eokas_test_check(order.size() == 40 && order.front() == "member0" && order.back() == "member39");
+
+        DataRow row;
+        DataCell cell;
+        _eokas_test_check(row.setCell("width", &cell) && object.set("member7", HomNode(false)));
+        _eokas_test_check(row.getCell(Atom("width")) == &cell && row.getCell("height") == nullptr);
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(builder)
+{
+    // small text stays in the builder
+    {
+        StringBuilder builder;
+        _eokas_test_check(builder.isEmpty() && builder.toString() == "");
+        builder << "x=" << 42 << ", y=" << -1.5 << ", " << true << ' ' << (u8_t) 7;
+        _eokas_test_check(builder.toString() == "x=42, y=-1.5, true 7");
+        _eokas_test_check(builder.length() == 20);
+        builder.clear();
+        builder.append('-', 3).append(StringView("ab"));
+        _eokas_test_check(builder.toString() == "---ab");
+    }
+
+    // growth by chunks keeps every byte in order
+    {
+        StringBuilder builder;
+        String expected;
+        for (int i = 0; i < 20000; i++) {
+            String piece = String::valueToString(i) + (i % 7 == 0 ? String('#', (size_t) (i % 300)) : String(","));
+            builder << piece;
+            expected += piece;
+        }
+        builder.append('z', 5000);
+        expected += String('z', 5000);
+        _eokas_test_check(builder.length() == expected.length());
+        _eokas_test_check(builder.toString() == expected);
+
+        size_t pieces = 0;
+        size_t total = 0;
+        builder.foreach([&](const StringView& piece) -> void {
+            pieces += 1;
+            total += piece.length();
+        });
+        _eokas_test_check(total == expected.length() && pieces < 16);
+
+        SegmentedMemoryStream stream(4096);
+        stream.open();
+        _eokas_test_check(builder.writeTo(stream) == expected.length());
+        _eokas_test_check(memcmp(stream.linearize(), expected.cstr(), expected.length()) == 0);
+    }
+
+    // a reserve hint up front means one chunk
+    {
+        StringBuilder builder(100000);
+        for (int i = 0; i < 10000; i++) {
+            builder.append("0123456789", 10);
+        }
+        size_t pieces = 0;
+        builder.foreach([&](const StringView&) -> void {
+            pieces += 1;
+        });
+        _eokas_test_check(pieces == 1 && builder.length() == 100000);
+    }
+
+    // over a stream only the unwritten part is held
+    {
+        SegmentedMemoryStream stream(4096);
+        stream.open();
+        String expected;
+        {
+            StringBuilder builder(stream);
+            for (int i = 0; i < 20000; i++) {
+                builder << "line " << i << '\n';
+                expected += "line ";
+                expected += String::valueToString(i);
+                expected += "\n";
+                _eokas_test_check(builder.length() <= StringBuilder::kStreamChunkSize);
+            }
+            builder.append('x', 100000);
+            expected += String('x', 100000);
+            _eokas_test_check(builder.flush() && builder.length() == 0);
+            builder << "tail";
+            expected += "tail";
+        }
+        _eokas_test_check(stream.size() == expected.length());
+        _eokas_test_check(memcmp(stream.linearize(), expected.cstr(), expected.length()) == 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(bulk)
+{
+    size_t threshold = MemoryBulk::threshold();
+
+    // every head, body and tail split lands the same bytes as libc
+    {
+        MemoryBulk::setThreshold(0);
+        std::vector<u8_t> src(5100), dst(5100), expect(5100);
+        for (size_t i = 0; i < src.size(); i++) {
+            src[i] = (u8_t) (i * 31 + 7);
+        }
+        bool matches = true;
+        for (size_t offset = 0; offset < 70; offset += 3) {
+            for (size_t size: {0, 1, 63, 64, 255, 256, 257, 1000, 4999}) {
+                memset(dst.data(), 0xEE, dst.size());
+                memset(expect.data(), 0xEE, expect.size());
+                MemoryBulk::copy(dst.data() + offset, src.data() + (offset % 5), size);
+                memcpy(expect.data() + offset, src.data() + (offset % 5), size);
+                matches = matches && dst == expect;
+
+                MemoryBulk::fill(dst.data() + offset, 0x3C, size);
+                memset(expect.data() + offset, 0x3C, size);
+                matches = matches && dst == expect;
+            }
+        }
+        _eokas_test_check(matches);
+        MemoryBulk::setThreshold(threshold);
+    }
+
+    // the pool splits large blocks into chunks, blocks below the threshold stay on libc
+    {
+        ThreadPool pool(4, ThreadPoolMode::WorkStealing);
+        size_t size = MemoryBulk::kMinChunk * 2 + 12345;
+        MemoryBuffer src(size, 64, eMemoryFlags_NoZero);
+        MemoryBuffer dst(size + 1, 64, eMemoryFlags_NoZero);
+        u8_t* from = (u8_t*) src.data();
+        u8_t* to = (u8_t*) dst.data() + 1;
+        for (size_t i = 0; i < size; i++) {
+            from[i] = (u8_t) (i ^ (i >> 8));
+        }
+
+        MemoryBulk::copy(pool, to, from, size);
+        _eokas_test_check(memcmp(to, from, size) == 0);
+        MemoryBulk::fill(pool, to, 0x11, size);
+        _eokas_test_check(to[0] == 0x11 && to[size / 2] == 0x11 && to[size - 1] == 0x11);
+        MemoryUtility::copy(to, from, size);
+        _eokas_test_check(memcmp(to, from, size) == 0);
+    }
+
+    return 0;
+}
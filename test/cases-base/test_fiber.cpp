@@ -0,0 +1,111 @@
+#include "../engine/main.h"
+#include <vector>
+using namespace eokas;
+
+_eokas_test_case(fiber)
+{
+    const int kTasks = 64;
+
+    // stacks go back to the pool and come out again
+    if (Fiber::isSupported()) {
+        for (int i = 0; i < 8; i++) {
+            Fiber* fiber = Fiber::create(nullptr, [](void*) {}, nullptr);
+            _eokas_test_check(fiber != nullptr);
+            Fiber::destroy(fiber);
+        }
+        _eokas_test_check(Fiber::current() == nullptr);
+    }
+
+    // more waiting tasks than workers: the waits park fibers instead of threads
+    {
+        ThreadPool pool(2, ThreadPoolMode::Fiber);
+        FiberEvent gate;
+        std::atomic<int> passed{0};
+        std::atomic<int> onFiber{0};
+        std::vector<Future<void>> futures;
+        for (int i = 0; i < kTasks; i++) {
+            futures.push_back(pool.spawn([&]() {
+                if (Fiber::current() != nullptr) {
+                    onFiber++;
+                }
+                gate.wait();
+                passed++;
+            }));
+        }
+        if (Fiber::isSupported()) {
+            // posted last, only runs when the waiters above left the workers
+            pool.post([&gate]() {
+                gate.set();
+            });
+        }
+        else {
+            gate.set();
+        }
+        for (Future<void>& future: futures) {
+            future.get();
+        }
+        _eokas_test_check(passed == kTasks);
+        _eokas_test_check(!Fiber::isSupported() || onFiber == kTasks);
+    }
+
+    // a task waiting on the future of another task
+    {
+        ThreadPool pool(2, ThreadPoolMode::Fiber);
+        std::vector<Future<int>> futures;
+        for (int i = 0; i < kTasks; i++) {
+            futures.push_back(pool.spawn([&pool, i]() {
+                Future<int> inner = pool.spawn([i]() {
+                    return i * 2;
+                });
+                return inner.get() + 1;
+            }));
+        }
+        bool correct = true;
+        for (int i = 0; i < kTasks; i++) {
+            correct = correct && futures[i].get() == i * 2 + 1;
+        }
+        _eokas_test_check(correct);
+    }
+
+    // fiber mutex shared by fibers and a plain thread
+    {
+        ThreadPool pool(4, ThreadPoolMode::Fiber);
+        FiberMutex mutex;
+        int counter = 0;
+        std::vector<Future<void>> futures;
+        for (int i = 0; i < kTasks; i++) {
+            futures.push_back(pool.spawn([&mutex, &counter]() {
+                for (int k = 0; k < 1000; k++) {
+                    std::lock_guard<FiberMutex> lock(mutex);
+                    counter++;
+                }
+            }));
+        }
+        for (int k = 0; k < 1000; k++) {
+            std::lock_guard<FiberMutex> lock(mutex);
+            counter++;
+        }
+        for (Future<void>& future: futures) {
+            future.get();
+        }
+        _eokas_test_check(counter == (kTasks + 1) * 1000);
+        _eokas_test_check(mutex.try_lock());
+        mutex.unlock();
+    }
+
+    // event reset and thread waiters
+    {
+        FiberEvent event;
+        _eokas_test_check(!event.isSet());
+        std::thread waiter([&event]() {
+            event.wait();
+        });
+        event.set();
+        waiter.join();
+        _eokas_test_check(event.isSet());
+        event.reset();
+        _eokas_test_check(!event.isSet());
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(format)
+{
+    // fields, indices and braces
+    {
+        _eokas_test_check(Format::string(_Format("{} + {} = {}"), 1, 2u, 3LL) == "1 + 2 = 3");
+        _eokas_test_check(Format::string(_Format("{1}-{0}-{1}"), "a", String("b")) == "b-a-b");
+        _eokas_test_check(Format::string(_Format("{{{}}}"), 'x') == "{x}");
+        _eokas_test_check(Format::string(_Format("no fields")) == "no fields");
+        _eokas_test_check(Format::string(_Format("{} {} {}"), true, (i8_t) -5, (u8_t) 200) == "true -5 200");
+        _eokas_test_check(Format::string(_Format("{}|{:.3}"), StringView("view"), "truncate") == "view|tru");
+    }
+
+    // integers
+    {
+        _eokas_test_check(Format::string(_Format("{:5}|{:<5}|{:^5}|{:*>5}"), 42, 42, 42, 42) == "   42|42   | 42  |***42");
+        _eokas_test_check(Format::string(_Format("{:05}|{:+}|{: }|{:+05}"), -42, 7, 7, 7) == "-0042|+7| 7|+0007");
+        _eokas_test_check(Format::string(_Format("{:x}|{:#X}|{:#b}|{:o}|{:c}"), 255, 255, 5, 8, 65) == "ff|0XFF|0b101|10|A");
+        _eokas_test_check(Format::string(_Format("{}"), (i64_t) -9223372036854775807LL - 1) == "-9223372036854775808");
+        _eokas_test_check(Format::string(_Format("{}"), (u64_t) 18446744073709551615ULL) == "18446744073709551615");
+        _eokas_test_check(Format::string(_Format("{:d}"), 'A') == "65");
+    }
+
+    // floats: shortest by default, printf with a type or precision, always '.'
+    {
+        _eokas_test_check(Format::string(_Format("{} {} {}"), 0.1, 0.1f, 1e21) == "0.1 0.1 1e+21");
+        _eokas_test_check(Format::string(_Format("{:.2f}|{:8.3f}|{:<8.1f}|"), 3.14159, -2.5, 1.25) == "3.14|  -2.500|1.2     |");
+        _eokas_test_check(Format::string(_Format("{:e}|{:.3}|{:+g}"), 12345.678, 3.14159, 2.0) == "1.234568e+04|3.14|+2");
+        _eokas_test_check(Format::string(_Format("{:08.2f}|{:.1f}"), -3.14159, std::numeric_limits<f64_t>::infinity()) == "-0003.14|inf");
+        _eokas_test_check(Format::string(_Format("{}"), -0.0) == "-0");
+    }
+
+    // pointers and UTF-8 text
+    {
+        const void* ptr = (const void*) (uintptr_t) 0x1234;
+        _eokas_test_check(Format::string(_Format("{}|{}"), ptr, nullptr) == "0x1234|0x0");
+        _eokas_test_check(Format::string(_Format("[{:^5}]"), "\xC3\xA9t\xC3\xA9") == "[ \xC3\xA9t\xC3\xA9 ]");
+        _eokas_test_check(Format::string(_Format("{:.2}"), "\xC3\xA9t\xC3\xA9") == "\xC3\xA9t");
+    }
+
+    // the types of the base library
+    {
+        _eokas_test_check(Format::string(_Format("{}"), Vector3(1, 2.5f, -3)) == "(1, 2.5, -3)");
+        _eokas_test_check(Format::string(_Format("{:.1f}"), Vector3(1, 2, 3)) == "(1.0, 2.0, 3.0)");
+        String identity = Format::string(_Format("{}"), Matrix4::IDENTITY);
+        _eokas_test_check(identity == "((1, 0, 0, 0), (0, 1, 0, 0), (0, 0, 1, 0), (0, 0, 0, 1))");
+        _eokas_test_check(Format::string(_Format("{}"), Color(1, 0.5f, 0, 1)) == "rgba(1, 0.5, 0, 1)");
+        _eokas_test_check(Format::string(_Format("{:x}|{:X}"), Color(1, 0.5f, 0, 1), Color(0, 0, 2, -1)) == "#ff8000ff|#0000FF00");
+        _eokas_test_check(Format::string(_Format("{}"), TimeSpan(0, 1, 2, 3)) == "01:02:03");
+        _eokas_test_check(Format::string(_Format("{}"), TimeSpan(2, 3, 4, 5, 6, 7)) == "2.03:04:05.006007");
+        _eokas_test_check(Format::string(_Format("[{:>10}]"), TimeSpan(-(i64_t) 1500000)) == "[-00:00:01.500000]");
+    }
+
+    // appenders: a fixed buffer truncates and tells the length it needed
+    {
+        char buffer[8];
+        size_t size = Format::to(buffer, sizeof(buffer), _Format("{}-{}"), 12345, 67890);
+        _eokas_test_check(size == 11 && strcmp(buffer, "12345-6") == 0);
+        size = Format::to(buffer, sizeof(buffer), _Format("{}"), 1);
+        _eokas_test_check(size == 1 && strcmp(buffer, "1") == 0);
+
+        String line = "x=";
+        Format::append(line, _Format("{:>4}"), 7);
+        _eokas_test_check(line == "x=   7");
+
+        // longer than the stack buffer, flushed in pieces
+        String big = Format::string(_Format("{}{:>600}{}"), '[', 1, ']');
+        _eokas_test_check(big.length() == 602 && big.startsWith("[    ") && big.endsWith(" 1]"));
+
+        std::string stl;
+        Format::append(stl, _Format("{}:{}"), "k", 2.5);
+        _eokas_test_check(stl == "k:2.5");
+    }
+
+    // run time formats: bad fields are copied as they are
+    {
+        _eokas_test_check(Format::string("{} and {}", 1) == "1 and {}");
+        _eokas_test_check(Format::string(String("{:q"), 1) == "{:q");
+        _eokas_test_check(Format::string(StringView("{2}|}"), 1, 2) == "{2}|}");
+    }
+
+    // printf style, one pass on the stack and a second one only for long text
+    {
+        _eokas_test_check(String::format("%02d:%s", 5, "ok") == "05:ok");
+        String wide = String::format("%300d", 1);
+        _eokas_test_check(wide.length() == 300 && wide.endsWith(" 1"));
+        _eokas_test_check(String::format("%s", "") == "");
+    }
+
+    return 0;
+}
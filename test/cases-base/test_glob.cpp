@@ -0,0 +1,182 @@
+
+#include "../engine/main.h"
+#include <random>
+#include <regex>
+using namespace eokas;
+
+// the same pattern for std::regex, for patterns of letters, '.', '/', '*' and '?'.
+static std::string glob_regex(const std::string& pattern) {
+    std::string result;
+    for (char c : pattern) {
+        if (c == '*') {
+            result += "[^/]*";
+        } else if (c == '?') {
+            result += "[^/]";
+        } else if (c == '.') {
+            result += "\\.";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+_eokas_test_case(glob)
+{
+    {
+        Glob glob("*.png");
+        _eokas_test_check(glob.match("a.png"));
+        _eokas_test_check(glob.match(".png"));
+        _eokas_test_check(!glob.match("a.PNG"));
+        _eokas_test_check(!glob.match("a.png.bak"));
+        _eokas_test_check(!glob.match("dir/a.png"));
+        _eokas_test_check(glob.pattern() == "*.png");
+    }
+    {
+        Glob glob("*.png", Glob::kIgnoreCase);
+        _eokas_test_check(glob.match("A.PNG") && glob.match("a.Png"));
+        _eokas_test_check(Glob("[a-c]?", Glob::kIgnoreCase).match("B1"));
+    }
+    {
+        Glob glob("file?.txt");
+        _eokas_test_check(glob.match("file1.txt"));
+        _eokas_test_check(!glob.match("file.txt") && !glob.match("file12.txt") && !glob.match("file/.txt"));
+        _eokas_test_check(Glob("").match("") && !Glob("").match("a"));
+        _eokas_test_check(Glob("abc").match("abc") && !Glob("abc").match("abcd"));
+    }
+    {
+        _eokas_test_check(Glob("[abc].x").match("b.x") && !Glob("[abc].x").match("d.x"));
+        _eokas_test_check(Glob("[a-z0-9]").match("q") && Glob("[a-z0-9]").match("7") && !Glob("[a-z0-9]").match("Q"));
+        _eokas_test_check(Glob("[!a-z]").match("Q") && !Glob("[!a-z]").match("q"));
+        _eokas_test_check(Glob("[^a-z]").match("Q") && !Glob("[^a-z]").match("/"));
+        _eokas_test_check(Glob("[]]").match("]") && Glob("[!]]").match("a") && !Glob("[!]]").match("]"));
+        _eokas_test_check(Glob("[a-]").match("-") && Glob("[\\]x]").match("]"));
+        _eokas_test_check(Glob("[ab").match("[ab") && !Glob("[ab").match("a"));
+    }
+    {
+        Glob glob("src/**/*.cpp");
+        _eokas_test_check(glob.match("src/a.cpp"));
+        _eokas_test_check(glob.match("src/base/a.cpp"));
+        _eokas_test_check(glob.match("src/base/x/y/a.cpp"));
+        _eokas_test_check(!glob.match("srcbase/a.cpp"));
+        _eokas_test_check(!glob.match("src/a.h"));
+        _eokas_test_check(Glob("**/*.h").match("a.h") && Glob("**/*.h").match("x/y/a.h"));
+        _eokas_test_check(Glob("a/**").match("a/") && Glob("a/**").match("a/b/c") && !Glob("a/**").match("a"));
+        _eokas_test_check(Glob("a**b").match("a/x/b") && Glob("a**b").match("ab"));
+        _eokas_test_check(!Glob("**/x").match("ax"));
+    }
+    {
+        Glob glob("*.{png,jpg,tga}");
+        _eokas_test_check(glob.match("a.png") && glob.match("a.jpg") && glob.match("a.tga"));
+        _eokas_test_check(!glob.match("a.bmp") && !glob.match("a.{png,jpg,tga}"));
+        _eokas_test_check(Glob("{a,b{c,d}}e").match("bde") && Glob("{a,b{c,d}}e").match("ae") && !Glob("{a,b{c,d}}e").match("be"));
+        _eokas_test_check(Glob("x{,.bak}").match("x") && Glob("x{,.bak}").match("x.bak"));
+        _eokas_test_check(Glob("{src,test}/**/*.h").match("test/a.h") && Glob("{src,test}/**/*.h").match("src/x/a.h"));
+        _eokas_test_check(Glob("a{b").match("a{b") && Glob("a}b").match("a}b") && Glob("a,b").match("a,b"));
+        _eokas_test_check(Glob("{[},]}").match("}") && Glob("{[},]}").match(","));
+    }
+    {
+        _eokas_test_check(Glob("\\*").match("*") && !Glob("\\*").match("a"));
+        _eokas_test_check(Glob("a\\{b,c}").match("a{b,c}") && Glob("a\\").match("a\\"));
+    }
+    {
+        GlobSet set(StringViewVector{"*.png", "*.jpg", "tex_*", "*", "**/*.png"});
+        _eokas_test_check(set.size() == 5);
+        std::vector<u32_t> indices;
+        _eokas_test_check(set.match("tex_a.png", indices) == 4);
+        _eokas_test_check(indices == std::vector<u32_t>({0, 2, 3, 4}));
+        _eokas_test_check(set.matchFirst("b.jpg") == 1);
+        _eokas_test_check(set.matchFirst("x/b.jpg") == GlobSet::npos && !set.matchAny("x/b.jpg"));
+        _eokas_test_check(set.matchFirst("x/b.png") == 4);
+
+        StringVector patterns = {"*.PNG"};
+        GlobSet moved(GlobSet(patterns, Glob::kIgnoreCase));
+        _eokas_test_check(moved.matchAny("a.png") && !GlobSet(StringViewVector()).matchAny(""));
+    }
+
+    // many similar patterns grow too big a DFA, the NFA answers instead.
+    {
+        StringVector patterns;
+        for (u32_t i = 0; i < 24; i++) {
+            patterns.push_back(String("*") + String((char) ('a' + i)) + "*?????");
+        }
+        GlobSet set(patterns);
+        std::vector<u32_t> indices;
+        _eokas_test_check(set.match("zaybz123456", indices) == 2);
+        _eokas_test_check(indices == std::vector<u32_t>({0, 1}));
+        _eokas_test_check(!set.matchAny("abcde"));
+    }
+
+    // random patterns against std::regex.
+    {
+        std::mt19937 rng(7);
+        const char alphabet[] = "ab./";
+        const char symbols[] = "ab./*?";
+        size_t mismatches = 0;
+        for (u32_t round = 0; round < 2000; round++) {
+            std::string pattern;
+            size_t length = rng() % 6;
+            for (size_t i = 0; i < length; i++) {
+                char c = symbols[rng() % 6];
+                if (c == '*' && !pattern.empty() && pattern.back() == '*')
+                    continue;
+                pattern += c;
+            }
+            Glob glob(StringView(pattern.data(), pattern.length()));
+            std::regex regex(glob_regex(pattern));
+            for (u32_t k = 0; k < 20; k++) {
+                std::string name;
+                size_t size = rng() % 7;
+                for (size_t i = 0; i < size; i++) {
+                    name += alphabet[rng() % 4];
+                }
+                bool expected = std::regex_match(name, regex);
+                mismatches += glob.match(StringView(name.data(), name.length())) != expected ? 1 : 0;
+            }
+        }
+        _eokas_test_check(mismatches == 0);
+    }
+
+    // a single glob and a set agree with regex and with globs one by one.
+    {
+        std::mt19937 rng(11);
+        const char* extensions[] = {"png", "jpg", "tga", "fbx", "json", "wav", "txt", "PNG"};
+        std::vector<std::string> names;
+        for (u32_t i = 0; i < 2000; i++) {
+            std::string name = "asset_" + std::to_string(rng() % 100000) + "_lod" + std::to_string(rng() % 4);
+            names.push_back(name + "." + extensions[rng() % 8]);
+        }
+        std::regex regex(glob_regex("*.png"), std::regex::icase);
+        Glob glob("*.png", Glob::kIgnoreCase);
+        size_t mismatches = 0;
+        for (auto& name : names) {
+            mismatches += glob.match(StringView(name.data(), name.length())) != std::regex_match(name, regex) ? 1 : 0;
+        }
+        _eokas_test_check(mismatches == 0);
+
+        StringVector patterns = {"*.png", "*.jpg", "*.tga", "*.fbx", "*_lod0.*", "asset_1*", "*.{wav,ogg}", "*.json"};
+        std::vector<Glob> globs;
+        for (auto& pattern : patterns) {
+            globs.push_back(Glob(pattern));
+        }
+        GlobSet set(patterns);
+        std::vector<u32_t> indices;
+        std::vector<u32_t> expected;
+        mismatches = 0;
+        for (auto& name : names) {
+            StringView view(name.data(), name.length());
+            indices.clear();
+            expected.clear();
+            set.match(view, indices);
+            for (u32_t k = 0; k < globs.size(); k++) {
+                if (globs[k].match(view)) {
+                    expected.push_back(k);
+                }
+            }
+            mismatches += indices != expected ? 1 : 0;
+        }
+        _eokas_test_check(mismatches == 0);
+    }
+
+    return 0;
+}
@@ -1,5 +1,6 @@
 
 #include "../engine/main.h"
+using namespace eokas;
 
 _eokas_test_case(hash)
 {
@@ -19,5 +20,74 @@ _eokas_test_case(hash)
         _eokas_test_check(sha256 == "216fd0525ecaffc3b4a48fc5e98e1e69f387f2627c789df2e8b9c5e90df9c09b");
     }
 
+    // known digests
+    {
+        _eokas_test_check(md5("") == "d41d8cd98f00b204e9800998ecf8427e");
+        _eokas_test_check(md5("abc") == "900150983cd24fb0d6963f7d28e17f72");
+        _eokas_test_check(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        _eokas_test_check(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        _eokas_test_check(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+                          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+        u8_t digest[SHA256::DIGEST_SIZE];
+        SHA256 sha;
+        sha.update("abc", 3);
+        sha.finalize(digest);
+        _eokas_test_check(digest[0] == 0xba && digest[31] == 0xad);
+        _eokas_test_check(digestHex(digest, 2) == "ba78" && digestHex(digest, 0) == "");
+        // finalize starts over
+        sha.update("abc", 3);
+        _eokas_test_check(sha.finalizeHex() == sha256("abc"));
+    }
+
+    // pieces of any size give the same digest as the whole
+    {
+        String text;
+        for (u32_t i = 0; i < 1000; i++) {
+            text += (char) ('a' + i * 7 % 26);
+        }
+        String md5Whole = md5(text);
+        String shaWhole = sha256(text);
+        const size_t steps[] = {1, 3, 55, 56, 63, 64, 65, 127, 333};
+        for (size_t step : steps) {
+            MD5 m;
+            SHA256 s;
+            for (size_t pos = 0; pos < text.length(); pos += step) {
+                size_t size = step < text.length() - pos ? step : text.length() - pos;
+                m.update(text.cstr() + pos, size);
+                s.update(text.cstr() + pos, size);
+            }
+            _eokas_test_check(m.finalizeHex() == md5Whole);
+            _eokas_test_check(s.finalizeHex() == shaWhole);
+        }
+    }
+
+    // streams, a million 'a' spans several read blocks
+    {
+        size_t size = 1000000;
+        std::vector<u8_t> data(size * 3, 'a');
+        MemoryStream md5Stream(data.data(), size);
+        md5Stream.open();
+        _eokas_test_check(MD5::hashStream(md5Stream) == "7707d6ae4e027c70eea2a935c2296f21");
+
+        MemoryStream shaStream(data.data(), size);
+        shaStream.open();
+        u8_t digest[SHA256::DIGEST_SIZE];
+        _eokas_test_check(SHA256::hashStream(shaStream, digest));
+        _eokas_test_check(digestHex(digest, SHA256::DIGEST_SIZE) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+        MemoryStream big(data.data(), data.size());
+        big.open();
+        SHA256 sha;
+        _eokas_test_check(sha.update(big) == data.size());
+        String streamed = sha.finalizeHex();
+        _eokas_test_check(sha256(String((const char*) data.data(), data.size())) == streamed);
+
+        // a stream that stops short of its end gives no digest.
+        MemoryStream closed(data.data(), size);
+        _eokas_test_check(MD5::hashStream(closed) == "" && sha256(closed) == "");
+        _eokas_test_check(!SHA256::hashStream(closed, digest));
+    }
+
     return 0;
 }
@@ -0,0 +1,92 @@
+
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(job)
+{
+    ThreadPool pool(4, ThreadPoolMode::WorkStealing);
+
+    // diamond: a -> (b, c) -> d
+    {
+        std::atomic<int> step{0};
+        int a = 0, b = 0, c = 0, d = 0;
+        JobGraph graph(pool);
+        JobRef ja = graph.add([&]() { a = ++step; });
+        JobRef jb = graph.add([&]() { b = ++step; });
+        JobRef jc = graph.add([&]() { c = ++step; });
+        JobRef jd = graph.add([&]() { d = ++step; });
+        graph.precede(ja, jb);
+        graph.precede(ja, jc);
+        graph.precede(jb, jd);
+        graph.precede(jc, jd);
+        graph.wait();
+        _eokas_test_check(a == 1 && b > a && c > a && d == 4);
+        _eokas_test_check(!jd->after(ja));
+    }
+
+    // continuations run in order without blocking a worker
+    {
+        std::vector<int> order;
+        JobRef first = Job::create(pool, [&order]() { order.push_back(1); });
+        JobRef last = first->then([&order]() { order.push_back(2); })->then([&order]() { order.push_back(3); });
+        first->submit();
+        last->wait();
+        _eokas_test_check(order.size() == 3 && order[0] == 1 && order[2] == 3);
+
+        // a continuation of a finished job starts right away
+        int late = 0;
+        first->then([&late]() { late = 1; })->wait();
+        _eokas_test_check(late == 1);
+    }
+
+    // when_all and when_any
+    {
+        std::atomic<int> count{0};
+        std::vector<JobRef> jobs;
+        for (int i = 0; i < 100; i++) {
+            jobs.push_back(Job::create(pool, [&count]() { count++; }));
+        }
+        JobRef all = when_all(pool, jobs);
+        std::atomic<int> fired{0};
+        JobRef any = when_any(pool, jobs)->then([&fired]() { fired++; });
+        for (JobRef& job: jobs) {
+            job->submit();
+        }
+        all->wait();
+        _eokas_test_check(count == 100);
+        any->wait();
+        _eokas_test_check(fired == 1);
+        _eokas_test_check(when_any(pool, {})->isDone());
+    }
+
+    // wide fan-out and fan-in
+    {
+        std::atomic<i64_t> sum{0};
+        JobGraph graph(pool);
+        JobRef root = graph.add([]() {});
+        JobRef tail = graph.add([]() {});
+        for (int i = 0; i < 1000; i++) {
+            JobRef job = graph.add([&sum, i]() { sum += i; });
+            graph.precede(root, job);
+            graph.precede(job, tail);
+        }
+        graph.wait();
+        _eokas_test_check(sum == 499500 && tail->isDone());
+    }
+
+    // exceptions are rethrown by wait
+    {
+        JobRef job = Job::create(pool, []() { throw std::runtime_error("job"); });
+        job->submit();
+        bool caught = false;
+        try {
+            job->wait();
+        }
+        catch (const std::runtime_error&) {
+            caught = true;
+        }
+        _eokas_test_check(caught);
+    }
+
+    return 0;
+}
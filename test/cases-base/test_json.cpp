@@ -14,6 +14,25 @@ _eokas_test_case(json)
         "\"index\": 100"
     "}";
 
+    HomNode node = JSON::parse(str);
+    _eokas_test_check(node.get("name").asString() == "eokas-json");
+    _eokas_test_check(node.get("index").asNumber() == 100);
+    _eokas_test_check(node.get("files").get(1).asString() == "package.json");
+    _eokas_test_check(JSON::parse("{\"a\\\"b\": [true, -1.5, null]}").get("a\"b").get(1).asNumber() == -1.5);
+
+    // stringify separates items with ", " and escapes what the parser unescapes
+    {
+        String text = JSON::stringify(JSON::parse("{\"a\": [1, \"x\\ny\", false, null], \"q\\\"\": {\"b\": 0.5}}"));
+        _eokas_test_check(text == "{\"a\":[1, \"x\\ny\", false, null], \"q\\\"\":{\"b\":0.5}}");
+        _eokas_test_check(JSON::stringify(JSON::parse(text)) == text);
+        _eokas_test_check(JSON::stringify(JSON::parse("[]")) == "[]");
+
+        SegmentedMemoryStream stream(4096);
+        stream.open();
+        _eokas_test_check(JSON::stringify(JSON::parse(text), stream));
+        _eokas_test_check(stream.size() == text.length() && memcmp(stream.linearize(), text.cstr(), text.length()) == 0);
+    }
+
     /*
     auto obj = static_cast<HomObject*>(JSON::parse(str).get());
     printf("{\n");
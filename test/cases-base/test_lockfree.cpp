@@ -0,0 +1,190 @@
+
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+struct LockfreeItem : public MpscNode {
+    u32_t producer = 0;
+    u32_t sequence = 0;
+};
+
+_eokas_test_case(lockfree)
+{
+    const u32_t kCount = 200000;
+
+    // spsc: order is kept, batches wrap around the ring
+    {
+        SpscQueue<u32_t> queue(100);
+        _eokas_test_check(queue.capacity() == 128);
+        u32_t batch[7] = {0};
+        _eokas_test_check(queue.popBatch(batch, 7) == 0);
+
+        std::thread producer([&queue, kCount]() {
+            u32_t next = 0;
+            u32_t items[16];
+            while (next < kCount) {
+                if (next % 3 == 0) {
+                    u32_t n = std::min<u32_t>(16, kCount - next);
+                    for (u32_t i = 0; i < n; i++) {
+                        items[i] = next + i;
+                    }
+                    next += (u32_t) queue.pushBatch(items, n);
+                }
+                else if (queue.tryPush(next)) {
+                    next++;
+                }
+            }
+        });
+
+        bool ordered = true;
+        u32_t expected = 0;
+        u32_t items[5];
+        while (expected < kCount) {
+            size_t n = queue.popBatch(items, 5);
+            for (size_t i = 0; i < n; i++) {
+                ordered = ordered && items[i] == expected++;
+            }
+        }
+        producer.join();
+        _eokas_test_check(ordered && queue.empty());
+    }
+
+    // mpsc: every item arrives once, each producer in order
+    {
+        const u32_t kProducers = 4;
+        const u32_t kPerProducer = 50000;
+        std::vector<LockfreeItem> items(kProducers * kPerProducer);
+        MpscQueue<LockfreeItem> queue;
+
+        std::vector<std::thread> producers;
+        for (u32_t p = 0; p < kProducers; p++) {
+            producers.emplace_back([&items, &queue, p, kPerProducer]() {
+                LockfreeItem* batch[8];
+                for (u32_t i = 0; i < kPerProducer; i += 8) {
+                    for (u32_t k = 0; k < 8; k++) {
+                        LockfreeItem& item = items[p * kPerProducer + i + k];
+                        item.producer = p;
+                        item.sequence = i + k;
+                        batch[k] = &item;
+                    }
+                    if (i % 16 == 0) {
+                        queue.pushBatch(batch, 8);
+                    }
+                    else {
+                        for (u32_t k = 0; k < 8; k++) {
+                            queue.tryPush(batch[k]);
+                        }
+                    }
+                }
+            });
+        }
+
+        std::vector<u32_t> next(kProducers, 0);
+        bool ordered = true;
+        u32_t received = 0;
+        LockfreeItem* popped[32];
+        while (received < kProducers * kPerProducer) {
+            size_t n = queue.popBatch(popped, 32);
+            for (size_t i = 0; i < n; i++) {
+                ordered = ordered && popped[i]->sequence == next[popped[i]->producer]++;
+            }
+            received += (u32_t) n;
+        }
+        for (auto& thread: producers) {
+            thread.join();
+        }
+        _eokas_test_check(ordered && queue.empty());
+    }
+
+    // mpmc: the sum over all consumers matches the sum over all producers
+    {
+        MpmcQueue<u64_t> queue(256);
+        std::atomic<u64_t> sum{0};
+        std::atomic<u32_t> consumed{0};
+        const u32_t kPerThread = 50000;
+
+        std::vector<std::thread> threads;
+        for (u32_t t = 0; t < 4; t++) {
+            threads.emplace_back([&queue, kPerThread]() {
+                for (u64_t i = 1; i <= kPerThread; i++) {
+                    while (!queue.tryPush(i)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            threads.emplace_back([&queue, &sum, &consumed, kPerThread]() {
+                u64_t items[4];
+                while (consumed.load() < 4 * kPerThread) {
+                    size_t n = queue.popBatch(items, 4);
+                    for (size_t i = 0; i < n; i++) {
+                        sum += items[i];
+                    }
+                    consumed += (u32_t) n;
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        u64_t expected = (u64_t) kPerThread * (kPerThread + 1) / 2 * 4;
+        _eokas_test_check(sum == expected && queue.empty());
+
+        MpmcQueue<String> strings(2);
+        _eokas_test_check(strings.tryPush(String("a")) && strings.tryPush(String("b")));
+        _eokas_test_check(!strings.tryPush(String("c")));
+        String value;
+        _eokas_test_check(strings.tryPop(value) && value == "a");
+    }
+
+    // blocking wrappers sleep on a full or empty queue and wake on close
+    {
+        BlockingQueue<MpmcQueue<u32_t>> queue(16);
+        std::atomic<u64_t> sum{0};
+        std::vector<std::thread> consumers;
+        for (u32_t t = 0; t < 3; t++) {
+            consumers.emplace_back([&queue, &sum]() {
+                u32_t value = 0;
+                while (queue.pop(value)) {
+                    sum += value;
+                }
+            });
+        }
+        for (u32_t i = 1; i <= kCount; i++) {
+            queue.push(i);
+        }
+        queue.close();
+        for (auto& thread: consumers) {
+            thread.join();
+        }
+        _eokas_test_check(sum == (u64_t) kCount * (kCount + 1) / 2);
+        _eokas_test_check(!queue.push(1));
+
+        BlockingQueue<SpscQueue<u32_t>> spsc(4);
+        std::thread producer([&spsc]() {
+            u32_t items[3] = {1, 2, 3};
+            for (u32_t i = 0; i < 1000; i++) {
+                spsc.push(i);
+            }
+            while (spsc.pushBatch(items, 3) == 0);
+            spsc.close();
+        });
+        u32_t value = 0, count = 0;
+        while (spsc.pop(value)) {
+            count++;
+        }
+        producer.join();
+        _eokas_test_check(count >= 1001);
+
+        LockfreeItem node;
+        BlockingQueue<MpscQueue<LockfreeItem>> mpsc;
+        std::thread sender([&mpsc, &node]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            mpsc.push(&node);
+        });
+        LockfreeItem* received = nullptr;
+        _eokas_test_check(mpsc.pop(received) && received == &node);
+        sender.join();
+    }
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(memory)
+{
+    // segmented stream: pages are chained, bytes come back in order
+    {
+        SegmentedMemoryStream stream(64);
+        _eokas_test_check(stream.write((void*) "x", 1) == 0);
+        _eokas_test_check(stream.open());
+        _eokas_test_check(stream.linearize() == nullptr);
+
+        u8_t bytes[1000];
+        for (int i = 0; i < 1000; i++) {
+            bytes[i] = (u8_t) (i * 7);
+        }
+        for (int i = 0; i < 1000; i += 100) {
+            _eokas_test_check(stream.write(bytes + i, 100) == 100);
+        }
+        _eokas_test_check(stream.size() == 1000);
+        _eokas_test_check(stream.capacity() == 1024);
+
+        MemorySegmentList segments = stream.segments();
+        _eokas_test_check(segments.size() == 16);
+        size_t total = 0;
+        bool matches = true;
+        for (const MemorySegment& segment: segments) {
+            matches = matches && memcmp(segment.data, bytes + total, segment.size) == 0;
+            total += segment.size;
+        }
+        _eokas_test_check(total == 1000 && matches);
+
+        // overwrite across a page boundary
+        u8_t patch[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+        _eokas_test_check(stream.seek(60, 0));
+        _eokas_test_check(stream.write(patch, 10) == 10);
+        memcpy(bytes + 60, patch, 10);
+        _eokas_test_check(stream.size() == 1000);
+
+        u8_t readback[1000];
+        _eokas_test_check(stream.seek(0, 0));
+        _eokas_test_check(stream.read(readback, 2000) == 1000);
+        _eokas_test_check(memcmp(readback, bytes, 1000) == 0);
+        _eokas_test_check(stream.eos());
+
+        // one fold, then the same block again
+        u8_t* linear = (u8_t*) stream.linearize();
+        _eokas_test_check(linear != nullptr && memcmp(linear, bytes, 1000) == 0);
+        _eokas_test_check(stream.linearize() == linear);
+        _eokas_test_check(stream.segments().size() == 1);
+
+        // growing after a fold chains new pages behind the block
+        _eokas_test_check(stream.seek(0, 2));
+        _eokas_test_check(stream.write(bytes, 100) == 100);
+        _eokas_test_check(stream.size() == 1100);
+        _eokas_test_check(stream.linearize() != nullptr);
+        _eokas_test_check(memcmp((u8_t*) stream.linearize() + 1000, bytes, 100) == 0);
+
+        SegmentedMemoryStream copy(128);
+        copy.open();
+        _eokas_test_check(stream.writeTo(copy) == 1100);
+        _eokas_test_check(copy.size() == 1100);
+
+        SegmentedMemoryStream moved(std::move(stream));
+        _eokas_test_check(moved.size() == 1100 && stream.size() == 0);
+        moved.clear();
+        _eokas_test_check(moved.size() == 0 && moved.capacity() == 0);
+    }
+
+    // aligned blocks, optionally left uncleared
+    {
+        for (size_t alignment = 8; alignment <= 4096; alignment *= 2) {
+            void* ptr = MemoryUtility::alloc_aligned(100, alignment);
+            _eokas_test_check(ptr != nullptr && (size_t) ptr % alignment == 0);
+            _eokas_test_check(((u8_t*) ptr)[99] == 0);
+            MemoryUtility::free_aligned(ptr);
+        }
+        _eokas_test_check(MemoryUtility::alloc_aligned(64, 48) == nullptr);
+
+        MemoryBuffer buffer(1000, 64, eMemoryFlags_NoZero);
+        _eokas_test_check(buffer.size() == 1000 && (size_t) buffer.data() % 64 == 0);
+        memset(buffer.data(), 0x5A, 1000);
+        _eokas_test_check(buffer.expand(3000));
+        _eokas_test_check(buffer.size() == 4000 && (size_t) buffer.data() % 64 == 0);
+        _eokas_test_check(((u8_t*) buffer.data())[999] == 0x5A);
+
+        MemoryBuffer copy(buffer);
+        _eokas_test_check(copy.alignment() == 64 && (size_t) copy.data() % 64 == 0);
+        _eokas_test_check(memcmp(copy.data(), buffer.data(), 1000) == 0);
+    }
+
+    // huge pages fall back quietly when the system has none to give
+    {
+        size_t size = 4 * 1024 * 1024;
+        MemoryBuffer buffer(size, 64, eMemoryFlags_HugePages);
+        _eokas_test_check(buffer.data() != nullptr && buffer.size() == size);
+        _eokas_test_check(((u8_t*) buffer.data())[size - 1] == 0);
+        memset(buffer.data(), 1, size);
+
+        void* pages = MemoryUtility::alloc_v(size, 3, true);
+        _eokas_test_check(pages != nullptr);
+        MemoryUtility::free_v(pages, size);
+    }
+
+    // pixel storage is aligned, areas are cut per pixel
+    {
+        u32_t pixels[16];
+        for (u32_t i = 0; i < 16; i++) {
+            pixels[i] = i;
+        }
+        Pixelmap map(4, 4, PixelFormat::R32_FLOAT, pixels);
+        _eokas_test_check((size_t) map.data() % 64 == 0);
+        Pixelmap area = map.getArea(1, 2, 2, 2);
+        u32_t* cut = (u32_t*) area.data();
+        _eokas_test_check(cut[0] == 9 && cut[1] == 10 && cut[2] == 13 && cut[3] == 14);
+
+        Pixelmap other(4, 4, PixelFormat::R32_FLOAT);
+        other.setArea(2, 0, area);
+        u32_t* set = (u32_t*) other.data();
+        _eokas_test_check(set[2] == 9 && set[3] == 10 && set[6] == 13 && set[7] == 14 && set[0] == 0);
+    }
+
+    // shared buffers: slices keep the block alive, writers copy before they touch it
+    {
+        u8_t bytes[256];
+        for (int i = 0; i < 256; i++) {
+            bytes[i] = (u8_t) i;
+        }
+        SharedBuffer buffer(bytes, 256);
+        _eokas_test_check(buffer.unique());
+        SharedBuffer head = buffer.slice(0, 16);
+        SharedBuffer tail = buffer.slice(250, 100);
+        _eokas_test_check(!buffer.unique() && head.data() == buffer.data());
+        _eokas_test_check(tail.size() == 6 && tail.data()[0] == 250);
+        _eokas_test_check(buffer.slice(300, 10).size() == 0);
+
+        buffer.reset();
+        const u8_t* original = head.data();
+        _eokas_test_check(original[15] == 15);
+        u8_t* writable = head.mutableData();
+        _eokas_test_check(writable != original);
+        writable[0] = 99;
+        _eokas_test_check(head.data()[0] == 99 && tail.data()[0] == 250);
+        _eokas_test_check(head.unique() && tail.unique());
+        _eokas_test_check(tail.mutableData() == tail.data());
+
+        // streams over a shared buffer hand out slices without copying
+        SharedBuffer source(bytes, 256);
+        MemoryStream stream(source);
+        stream.open();
+        u8_t first[4];
+        _eokas_test_check(stream.read(first, 4) == 4 && first[3] == 3);
+        SharedBuffer part = stream.slice(100);
+        _eokas_test_check(part.size() == 100 && part.data() == source.data() + 4);
+        _eokas_test_check(stream.slice(1000).size() == 152);
+        _eokas_test_check(stream.eos() && stream.slice(1).empty());
+
+        MemoryStream copy(stream);
+        _eokas_test_check(copy.data() == source.data());
+
+        // the first write detaches from the block
+        _eokas_test_check(stream.seek(0, 0));
+        _eokas_test_check(stream.write((void*) "\x7F", 1) == 1);
+        _eokas_test_check(stream.data() != source.data());
+        _eokas_test_check(source.data()[0] == 0 && part.data()[0] == 4);
+        _eokas_test_check(((u8_t*) stream.data())[0] == 0x7F && ((u8_t*) stream.data())[1] == 1);
+        _eokas_test_check(stream.seek(0, 2));
+        _eokas_test_check(stream.write(bytes, 16) == 16);
+        _eokas_test_check(((u8_t*) stream.data())[256 + 15] == 15);
+
+        // a plain stream copies the slice out
+        MemoryStream plain(bytes, 256);
+        plain.open();
+        SharedBuffer copied = plain.slice(8);
+        _eokas_test_check(copied.size() == 8 && copied.data() != bytes && copied.data()[7] == 7);
+    }
+
+    return 0;
+}
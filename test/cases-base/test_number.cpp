@@ -0,0 +1,97 @@
+#include "../engine/main.h"
+#include <clocale>
+using namespace eokas;
+
+static String number_text(f64_t value) {
+    char buffer[NumberChars::kMaxChars];
+    return String(buffer, NumberChars::format(buffer, value));
+}
+
+_eokas_test_case(number)
+{
+    // shortest digits that read back, laid out like JavaScript
+    {
+        _eokas_test_check(number_text(0.1) == "0.1" && number_text(0.3) == "0.3" && number_text(-0.0) == "-0");
+        _eokas_test_check(number_text(100) == "100" && number_text(1234567.0) == "1234567");
+        _eokas_test_check(number_text(1e21) == "1e+21" && number_text(1e20) == "100000000000000000000");
+        _eokas_test_check(number_text(1.5e-7) == "1.5e-7" && number_text(0.000001) == "0.000001");
+        _eokas_test_check(number_text(5e-324) == "5e-324" && number_text(1.7976931348623157e308) == "1.7976931348623157e+308");
+        _eokas_test_check(number_text(2.0 / 3.0) == "0.6666666666666666");
+        _eokas_test_check(String::valueToString(0.1f) == "0.1" && String::valueToString(16777217.0f) == "16777216");
+        _eokas_test_check(String::valueToString(std::numeric_limits<f64_t>::infinity()) == "inf");
+    }
+
+    // integers, clamped to the target type
+    {
+        _eokas_test_check(String::valueToString((i64_t) -9223372036854775807LL - 1) == "-9223372036854775808");
+        _eokas_test_check(String::valueToString((u64_t) 18446744073709551615ULL) == "18446744073709551615");
+        _eokas_test_check(String::valueToString((i8_t) -5) == "-5" && String::valueToString((u8_t) 200) == "200");
+        _eokas_test_check(String::stringToValue<i32_t>("  -42xyz") == -42 && String::stringToValue<i32_t>("12.9") == 12);
+        _eokas_test_check(String::stringToValue<i16_t>("70000") == 32767 && String::stringToValue<u8_t>("300") == 255);
+        _eokas_test_check(String::stringToValue<u64_t>("18446744073709551616") == 18446744073709551615ULL);
+        _eokas_test_check(String::stringToValue<i32_t>("nope") == 0 && String::stringToValue<i32_t>("") == 0);
+
+        StringValue small((i8_t) -7);
+        _eokas_test_check((i8_t) small == -7 && (const String&) small == "-7");
+        _eokas_test_check((u8_t) StringValue((u8_t) 250) == 250);
+    }
+
+    // parsing agrees with the correctly rounded value
+    {
+        _eokas_test_check(String::stringToValue<f64_t>("0.1") == 0.1 && String::stringToValue<f64_t>("-2.5e-3") == -0.0025);
+        _eokas_test_check(String::stringToValue<f64_t>("1e400") == std::numeric_limits<f64_t>::infinity());
+        _eokas_test_check(String::stringToValue<f64_t>("1e-400") == 0 && String::stringToValue<f64_t>("4.9e-324") == 5e-324);
+        _eokas_test_check(String::stringToValue<f64_t>("9007199254740993") == 9007199254740992.0);
+        _eokas_test_check(String::stringToValue<f64_t>("2.2250738585072011e-308") == 2.2250738585072011e-308);
+        _eokas_test_check(String::stringToValue<f64_t>("3.14159265358979323846264338327950288") == 3.141592653589793);
+        _eokas_test_check(String::stringToValue<f32_t>("3.4028235e38") == std::numeric_limits<f32_t>::max());
+        _eokas_test_check(String::stringToValue<f64_t>(StringView("12.5e", 5)) == 12.5);
+
+        f64_t value = -1;
+        const char* text = "e10";
+        _eokas_test_check(NumberChars::parse(text, text + 3, value) == 0 && value == -1);
+        text = "-12.5e2,";
+        _eokas_test_check(NumberChars::parse(text, text + 8, value) == 7 && value == -1250);
+
+        // the locale's decimal point is ignored
+        const char* previous = setlocale(LC_NUMERIC, nullptr);
+        String saved = previous != nullptr ? previous : "C";
+        if (setlocale(LC_NUMERIC, "de_DE.UTF-8") != nullptr) {
+            _eokas_test_check(String::valueToString(1.5) == "1.5" && String::stringToValue<f64_t>("1.5") == 1.5);
+        }
+        setlocale(LC_NUMERIC, saved.cstr());
+    }
+
+    // every written double and float reads back to the same bits
+    {
+        u64_t seed = 0x9E3779B97F4A7C15ULL;
+        bool same = true;
+        for (int i = 0; i < 200000; i++) {
+            seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+            f64_t value;
+            memcpy(&value, &seed, sizeof(value));
+            if (value == value && value - value == 0) {
+                f64_t back = String::stringToValue<f64_t>(String::valueToString(value));
+                same = same && memcmp(&back, &value, sizeof(value)) == 0;
+            }
+            u32_t bits = (u32_t) seed;
+            f32_t single;
+            memcpy(&single, &bits, sizeof(single));
+            if (single == single && single - single == 0) {
+                f32_t back = String::stringToValue<f32_t>(String::valueToString(single));
+                same = same && memcmp(&back, &single, sizeof(single)) == 0;
+            }
+        }
+        _eokas_test_check(same);
+    }
+
+    // JSON numbers take exponents and survive a round trip
+    {
+        HomNode node = JSON::parse("{\"big\": 1.5e300, \"small\": -2E-5, \"third\": 0.3333333333333333}");
+        _eokas_test_check(node.get("big").asNumber() == 1.5e300 && node.get("small").asNumber() == -2e-5);
+        String text = JSON::stringify(node.get("third"));
+        _eokas_test_check(text == "0.3333333333333333");
+    }
+
+    return 0;
+}
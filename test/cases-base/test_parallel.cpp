@@ -0,0 +1,95 @@
+
+#include "../engine/main.h"
+#include <numeric>
+using namespace eokas;
+
+_eokas_test_case(parallel)
+{
+    ThreadPool pool(4, ThreadPoolMode::WorkStealing);
+
+    // every index is visited exactly once
+    {
+        std::vector<int> hits(100000, 0);
+        parallel_for(pool, (size_t) 0, hits.size(), [&hits](size_t i) {
+            hits[i] += 1;
+        });
+        _eokas_test_check(std::count(hits.begin(), hits.end(), 1) == (i64_t) hits.size());
+
+        int touched = 0;
+        parallel_for(pool, 5, 5, [&touched](int) { touched++; });
+        _eokas_test_check(touched == 0);
+    }
+
+    // nested loops join by helping, so they can not deadlock the workers
+    {
+        std::atomic<int> count{0};
+        parallel_for(pool, 0, 64, [&](int) {
+            parallel_for(pool, 0, 64, [&](int) {
+                count++;
+            }, 4);
+        }, 1);
+        _eokas_test_check(count == 64 * 64);
+    }
+
+    // reduce and transform
+    {
+        i64_t sum = parallel_reduce(pool, (i64_t) 0, (i64_t) 1000000, (i64_t) 0,
+            [](i64_t i) { return i; },
+            [](i64_t a, i64_t b) { return a + b; });
+        _eokas_test_check(sum == 499999500000ll);
+
+        std::vector<int> input(50000);
+        std::iota(input.begin(), input.end(), 0);
+        std::vector<int> output(input.size());
+        parallel_transform(pool, input.begin(), input.end(), output.begin(), [](int v) { return v * 2; });
+        _eokas_test_check(output[0] == 0 && output[49999] == 99998);
+    }
+
+    // inclusive scan
+    {
+        std::vector<i64_t> input(100003, 1);
+        std::vector<i64_t> output(input.size());
+        parallel_scan(pool, input.begin(), input.end(), output.begin(), (i64_t) 0,
+            [](i64_t a, i64_t b) { return a + b; });
+        bool ok = true;
+        for (size_t i = 0; i < output.size(); i++) {
+            ok = ok && output[i] == (i64_t) i + 1;
+        }
+        _eokas_test_check(ok);
+    }
+
+    // sort
+    {
+        std::vector<u32_t> values(200000);
+        u32_t seed = 12345;
+        for (u32_t& value: values) {
+            seed = seed * 1664525u + 1013904223u;
+            value = seed;
+        }
+        std::vector<u32_t> expected = values;
+        std::sort(expected.begin(), expected.end());
+        parallel_sort(pool, values.begin(), values.end());
+        _eokas_test_check(values == expected);
+
+        std::vector<String> names = {"delta", "alpha", "charlie", "bravo"};
+        parallel_sort(pool, names.begin(), names.end(), [](const String& a, const String& b) { return a < b; });
+        _eokas_test_check(names[0] == "alpha" && names[3] == "delta");
+    }
+
+    // exceptions surface in the caller
+    {
+        bool caught = false;
+        try {
+            parallel_for(pool, 0, 1000, [](int i) {
+                if (i == 500)
+                    throw std::runtime_error("stop");
+            }, 10);
+        }
+        catch (const std::runtime_error&) {
+            caught = true;
+        }
+        _eokas_test_check(caught);
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+
+#include "../engine/main.h"
+#include <thread>
+#include <atomic>
+using namespace eokas;
+
+struct PoolItem {
+    static std::atomic<int> sAlive;
+    int value;
+
+    PoolItem(int v) : value(v) {
+        sAlive++;
+    }
+
+    ~PoolItem() {
+        sAlive--;
+    }
+};
+
+std::atomic<int> PoolItem::sAlive(0);
+
+_eokas_test_case(pool)
+{
+    // acquire, release and slot reuse
+    {
+        Pool<PoolItem, 4> pool;
+        PoolItem* a = pool.acquire(1);
+        PoolItem* b = pool.acquire(2);
+        _eokas_test_check(pool.size() == 2 && PoolItem::sAlive == 2);
+        pool.release(a);
+        _eokas_test_check(pool.size() == 1 && PoolItem::sAlive == 1);
+        PoolItem* c = pool.acquire(3);
+        _eokas_test_check(c == a && c->value == 3);
+        pool.release(a);
+        pool.release(a);
+        _eokas_test_check(pool.size() == 1 && b->value == 2);
+    }
+    _eokas_test_check(PoolItem::sAlive == 0);
+
+    // growth keeps addresses stable, iteration visits live objects only
+    {
+        Pool<PoolItem, 4> pool;
+        std::vector<PoolItem*> items;
+        for (int i = 0; i < 100; i++) {
+            items.push_back(pool.acquire(i));
+        }
+        for (int i = 0; i < 100; i += 2) {
+            pool.release(items[i]);
+        }
+        int count = 0, sum = 0;
+        for (PoolItem* item: pool) {
+            count++;
+            sum += item->value;
+        }
+        _eokas_test_check(count == 50 && sum == 2500);
+        _eokas_test_check(pool.acquire(0) == items[98]);
+
+        pool.releaseAll([](PoolItem* item) { return item->value >= 50; });
+        _eokas_test_check(pool.size() == 26);
+        pool.releaseFront();
+        pool.releaseBack();
+        _eokas_test_check(pool.size() == 24);
+        _eokas_test_check(*pool.begin() == items[3]);
+    }
+    _eokas_test_check(PoolItem::sAlive == 0);
+
+    // stale handles are detected after reuse
+    {
+        Pool<PoolItem> pool;
+        PoolItem* a = pool.acquire(7);
+        PoolHandle handle = pool.handle(a);
+        _eokas_test_check(pool.get(handle) == a);
+        pool.release(handle);
+        _eokas_test_check(pool.get(handle) == nullptr);
+        PoolItem* b = pool.acquire(8);
+        _eokas_test_check(b == a && !pool.isAlive(handle));
+        _eokas_test_check(pool.isAlive(pool.handle(b)));
+    }
+
+    // concurrent acquire and release through thread magazines
+    {
+        ConcurrentPool<PoolItem, 16, 8> pool;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([&pool, t]() {
+                std::vector<PoolItem*> items;
+                for (int round = 0; round < 50; round++) {
+                    for (int i = 0; i < 64; i++) {
+                        items.push_back(pool.acquire(t * 1000 + i));
+                    }
+                    for (int i = 0; i < 64; i++) {
+                        if (items[i]->value != t * 1000 + i)
+                            return;
+                    }
+                    for (PoolItem* item: items) {
+                        pool.release(item);
+                    }
+                    items.clear();
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        _eokas_test_check(pool.size() == 0 && PoolItem::sAlive == 0);
+        // magazines of exited threads went back to the depot
+        _eokas_test_check(pool.capacity() <= 16 * 64);
+
+        PoolItem* a = pool.acquire(1);
+        PoolHandle handle = pool.handle(a);
+        _eokas_test_check(pool.get(handle) == a);
+        pool.release(a);
+        _eokas_test_check(pool.get(handle) == nullptr);
+    }
+
+    return 0;
+}
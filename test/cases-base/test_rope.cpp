@@ -0,0 +1,76 @@
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(rope)
+{
+    // concatenation, indexing and slicing
+    {
+        Rope empty;
+        _eokas_test_check(empty.isEmpty() && empty.length() == 0 && empty.toString() == "" && empty.at(0) == '\0');
+        Rope hello = Rope("hello, ") + Rope(String("world"));
+        _eokas_test_check(hello.toString() == "hello, world" && hello.length() == 12);
+        _eokas_test_check(hello.at(7) == 'w' && hello.at(12) == '\0');
+        _eokas_test_check(hello.substr(3, 6).toString() == "lo, wo" && hello.substr(7).toString() == "world");
+        _eokas_test_check(hello.substr(20).isEmpty() && hello.substr(0, 0).isEmpty());
+        Rope copy = hello;
+        copy += "!";
+        _eokas_test_check(copy.toString() == "hello, world!" && hello.toString() == "hello, world");
+    }
+
+    // large pieces stay shared, the tree stays balanced
+    {
+        String block('a', 1000);
+        Rope rope;
+        String expected;
+        for (int i = 0; i < 4096; i++) {
+            char c = (char) ('a' + i % 26);
+            String piece(c, 200 + (size_t) (i % 50));
+            if (i % 2 == 0) {
+                rope += piece;
+                expected += piece;
+            } else {
+                rope = Rope(piece) + rope;
+                expected = piece + expected;
+            }
+        }
+        _eokas_test_check(rope.length() == expected.length());
+        _eokas_test_check(rope.toString() == expected);
+        // an AVL tree of n leaves is at most 1.44 log2(n) high.
+        _eokas_test_check(rope.depth() <= 18);
+
+        bool slices = true;
+        for (size_t pos = 0; pos < expected.length(); pos += 9973) {
+            size_t len = (pos * 31) % 70000;
+            Rope slice = rope.substr(pos, len);
+            slices = slices && slice.toString() == expected.substr(pos, len);
+            slices = slices && slice.depth() <= 18;
+        }
+        _eokas_test_check(slices);
+
+        bool chars = true;
+        for (size_t pos = 0; pos < expected.length(); pos += 997) {
+            chars = chars && rope.at(pos) == expected.at(pos);
+        }
+        _eokas_test_check(chars);
+
+        SegmentedMemoryStream stream(4096);
+        stream.open();
+        _eokas_test_check(rope.writeTo(stream) == expected.length());
+        _eokas_test_check(memcmp(stream.linearize(), expected.cstr(), expected.length()) == 0);
+    }
+
+    // short pieces are merged as they are appended
+    {
+        Rope rope;
+        for (int i = 0; i < 10000; i++) {
+            rope += "ab";
+        }
+        size_t pieces = 0;
+        rope.foreach([&](const StringView&) -> void {
+            pieces += 1;
+        });
+        _eokas_test_check(rope.length() == 20000 && pieces <= 20000 / 64);
+    }
+
+    return 0;
+}
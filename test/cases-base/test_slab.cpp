@@ -0,0 +1,52 @@
+
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+_eokas_test_case(slab)
+{
+    // size classes
+    {
+        _eokas_test_check(SlabAllocator::blockSize(1) == 16);
+        _eokas_test_check(SlabAllocator::blockSize(17) == 32);
+        _eokas_test_check(SlabAllocator::blockSize(129) == 160);
+        _eokas_test_check(SlabAllocator::blockSize(SlabAllocator::kMaxSize) == SlabAllocator::kMaxSize);
+        _eokas_test_check(SlabAllocator::blockSize(SlabAllocator::kMaxSize + 1) == SlabAllocator::kMaxSize + 1);
+    }
+
+    // blocks of one class are reused
+    {
+        void* a = SlabAllocator::alloc(40);
+        _eokas_test_check(a != nullptr);
+        SlabAllocator::free(a, 40);
+        void* b = SlabAllocator::alloc(48);
+        _eokas_test_check(a == b);
+        SlabAllocator::free(b, 48);
+    }
+
+    // strings built concurrently on many threads
+    {
+        std::vector<std::thread> threads;
+        std::vector<int> results(8, 0);
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([t, &results]() {
+                int ok = 1;
+                for (int i = 0; i < 2000; i++) {
+                    String str = String::repeat("eokas-", (size_t) (i % 64 + 1));
+                    String copy = str + String(char('a' + t), (size_t) (i % 300));
+                    if (copy.length() != str.length() + (size_t) (i % 300))
+                        ok = 0;
+                }
+                results[t] = ok;
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        for (int ok: results) {
+            _eokas_test_check(ok == 1);
+        }
+    }
+
+    return 0;
+}
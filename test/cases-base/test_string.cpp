@@ -0,0 +1,184 @@
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(string)
+{
+    // three words, up to 23 chars inline on 64-bit targets
+    {
+        _eokas_test_check(sizeof(String) == 3 * sizeof(void*));
+        _eokas_test_check(!std::has_virtual_destructor<String>::value);
+
+        String empty;
+        _eokas_test_check(empty.isEmpty() && empty.length() == 0 && empty.cstr()[0] == '\0');
+
+        String full(String::kInlineLength == 23 ? "abcdefghijklmnopqrstuvw" : "abcdefghijk");
+        _eokas_test_check(full.length() == String::kInlineLength);
+        _eokas_test_check(full.capacity() == String::kInlineLength);
+        _eokas_test_check(full.cstr()[full.length()] == '\0');
+        _eokas_test_check((const void*) full.cstr() >= (const void*) &full && (const void*) full.cstr() < (const void*) (&full + 1));
+
+        String spill = full + "x";
+        _eokas_test_check(spill.length() == String::kInlineLength + 1);
+        _eokas_test_check(spill.capacity() > String::kInlineLength);
+        _eokas_test_check(spill.startsWith(full) && spill.endsWith("x"));
+    }
+
+    // moves steal the block and leave an empty string behind
+    {
+        String big('z', 100);
+        const char* data = big.cstr();
+        String moved(std::move(big));
+        _eokas_test_check(moved.cstr() == data && moved.length() == 100);
+        _eokas_test_check(big.isEmpty() && big.length() == 0);
+
+        String target("short");
+        target = std::move(moved);
+        _eokas_test_check(target.cstr() == data && moved.isEmpty());
+
+        String small("tiny");
+        String other(std::move(small));
+        _eokas_test_check(other == "tiny" && small.isEmpty());
+    }
+
+    // growth, shrink back inline, copies
+    {
+        String text;
+        for (int i = 0; i < 100; i++) {
+            text += "ab";
+        }
+        _eokas_test_check(text.length() == 200 && text.at(199) == 'b');
+        text.remove(10, 180);
+        _eokas_test_check(text.length() == 20 && text.capacity() == String::kInlineLength);
+        _eokas_test_check(text == "ababababababababab" "ab");
+        text.insert(2, String('-', 30));
+        _eokas_test_check(text.length() == 50 && text.at(2) == '-' && text.at(32) == 'a');
+
+        String copy(text);
+        _eokas_test_check(copy == text && copy.cstr() != text.cstr());
+        copy = "back";
+        _eokas_test_check(copy == "back" && copy.length() == 4);
+        copy.clear();
+        _eokas_test_check(copy.isEmpty());
+    }
+
+    // the old API keeps working on both sides of the inline limit
+    {
+        String key("HomNode.children.name");
+        _eokas_test_check(key.find('.') == 7 && key.rfind('.') == 16);
+        _eokas_test_check(key.substr(8, 8) == "children" && key.substr(100) == "");
+        _eokas_test_check(key.toUpper() == "HOMNODE.CHILDREN.NAME");
+        _eokas_test_check(key.split(".").size() == 3);
+        _eokas_test_check(String("  padded value that is longer  ").trim() == "padded value that is longer");
+        _eokas_test_check(String("a-b-c").replace("-", "==") == "a==b==c");
+
+        std::map<String, int> map;
+        map["zeta"] = 1;
+        map["a key that does not fit inline"] = 2;
+        map["alpha"] = 3;
+        _eokas_test_check(map.begin()->second == 2 && map["zeta"] == 1);
+    }
+
+    // views cut without copying, the tokenizer yields what split() returns
+    {
+        String line("  alpha, beta,,gamma ,delta  ");
+        StringView trimmed = line.trimView();
+        _eokas_test_check(trimmed.data() == line.cstr() + 2 && trimmed.length() == line.length() - 4);
+        _eokas_test_check(trimmed.startsWith("alpha") && trimmed.endsWith("delta"));
+
+        StringViewVector pieces = trimmed.split(",");
+        _eokas_test_check(pieces.size() == 4);
+        _eokas_test_check(pieces[1] == " beta" && pieces[2].trim() == "gamma");
+        _eokas_test_check(pieces[3].data() == line.cstr() + line.find("delta"));
+
+        StringVector copies = line.split(",");
+        size_t index = 0;
+        bool same = true;
+        for (StringView token: StringTokenizer(line, ",")) {
+            same = same && index < copies.size() && token == copies[index];
+            index++;
+        }
+        _eokas_test_check(same && index == copies.size());
+        _eokas_test_check(StringTokenizer(",,,", ",").begin() == StringTokenizer(",,,", ",").end());
+
+        StringView path("src/base/string.cpp");
+        _eokas_test_check(path.find('/') == 3 && path.rfind('/') == 8);
+        _eokas_test_check(path.find("base") == 4 && path.find("base", 5) == StringView::npos);
+        _eokas_test_check(path.rfind("s") == 9 && path.substr(9, 6) == "string");
+        _eokas_test_check(path.right(3) == "cpp" && path.left(3).toString() == "src");
+        _eokas_test_check(path.compare("src/base") > 0 && StringView("abc") < StringView("abd"));
+
+        // String lookups take views, so no temporary String is built for them
+        String name("string.cpp");
+        _eokas_test_check(path.endsWith(name) && name.startsWith(path.substr(9, 3)));
+        _eokas_test_check(String(path).contains(name.substrView(0, 6)));
+        _eokas_test_check(name.compare(path.substr(9)) == 0);
+        _eokas_test_check(name.substrView(7) == "cpp" && name.view() == name);
+
+        // appending a piece of itself survives the move to a bigger block
+        String self("0123456789");
+        self.append(self.cstr() + 2, 5);
+        self.append(self.cstr(), self.length());
+        _eokas_test_check(self == "012345678923456" "012345678923456");
+    }
+
+    // search is length aware and agrees with a plain scan, forwards and backwards
+    {
+        const char raw[] = "zero\0zero\0needle\0needle\0tail";
+        StringView bytes(raw, sizeof(raw) - 1);
+        _eokas_test_check(bytes.find(StringView("needle\0", 7)) == 10);
+        _eokas_test_check(bytes.rfind(StringView("needle\0", 7)) == 17);
+        _eokas_test_check(bytes.find(StringView("\0tail", 5)) == 23 && bytes.rfind("zero") == 5);
+
+        std::vector<char> hay(3000);
+        u32_t seed = 12345;
+        for (char& c: hay) {
+            seed = seed * 1103515245 + 12345;
+            c = "ab"[(seed >> 16) & 1];
+        }
+        StringView text(hay.data(), hay.size());
+        bool agrees = true;
+        for (size_t length = 2; length <= 40; length += 3) {
+            for (size_t at: {0, 7, 100, 1500, 2960}) {
+                StringView needle = text.substr(at, length);
+                size_t first = StringView::npos;
+                size_t last = StringView::npos;
+                for (size_t i = 0; i + length <= hay.size(); i++) {
+                    if (memcmp(hay.data() + i, needle.data(), length) == 0) {
+                        first = first == StringView::npos ? i : first;
+                        last = i;
+                    }
+                }
+                agrees = agrees && text.find(needle) == first && text.rfind(needle) == last;
+                agrees = agrees && text.find(needle, first + 1) == (first == last ? StringView::npos : text.substr(first + 1).find(needle) + first + 1);
+            }
+        }
+        _eokas_test_check(agrees);
+        _eokas_test_check(text.find("abc") == StringView::npos && text.rfind("abc") == StringView::npos);
+    }
+
+    // replace builds the result in one pass
+    {
+        _eokas_test_check(String("a.b.c").replace(".", "::") == "a::b::c");
+        _eokas_test_check(String("aaaa").replace("aa", "a") == "aa");
+        _eokas_test_check(String("no match").replace("xyz", "!") == "no match");
+        _eokas_test_check(String("abc").replace("", "!") == "abc");
+        _eokas_test_check(String("${a}${a}").replace("${a}", "") == "");
+
+        String big;
+        for (int i = 0; i < 1000; i++) {
+            big += "key=${value};";
+        }
+        String expanded = big.replace("${value}", "0123456789");
+        _eokas_test_check(expanded.length() == 1000 * 15 && expanded.endsWith("key=0123456789;"));
+
+        StringMap vars;
+        vars["${name}"] = "eokas";
+        vars["${n}"] = "N";
+        vars["${name}s"] = "plural";
+        vars["${ver}"] = "${name}";
+        String tpl("${name} ${n} ${name}s ${ver} ${none}");
+        _eokas_test_check(tpl.replace(vars) == "eokas N plural ${name} ${none}");
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+_eokas_test_case(tracker)
+{
+    MemoryTag tag = MemoryTracker::tag("tracker-test");
+    _eokas_test_check(tag != MemoryTracker::kUntagged);
+    _eokas_test_check(MemoryTracker::tag("tracker-test") == tag);
+    _eokas_test_check(MemoryTracker::name(tag) == "tracker-test");
+    _eokas_test_check(MemoryTracker::name(MemoryTracker::kSlab) == "slab");
+
+    // blocks outside any scope are not counted
+    _eokas_test_check(MemoryTracker::snapshot().find("untagged") == nullptr);
+
+    MemorySnapshot before = MemoryTracker::snapshot();
+
+    // live bytes, counts and the high-water mark follow the tagged blocks
+    void* blocks[10] = {nullptr};
+    {
+        MemoryTagScope scope(tag);
+        _eokas_test_check(MemoryTracker::current() == tag);
+        for (int i = 0; i < 10; i++) {
+            blocks[i] = MemoryUtility::alloc(1000);
+        }
+        blocks[0] = MemoryUtility::realloc(blocks[0], 3000);
+    }
+    _eokas_test_check(MemoryTracker::current() == MemoryTracker::kUntagged);
+
+    MemorySnapshot during = MemoryTracker::snapshot().diff(before);
+    const MemoryTagStats* stats = during.find("tracker-test");
+    _eokas_test_check(stats != nullptr);
+    _eokas_test_check(stats->liveBytes == 12000 && stats->liveCount == 10);
+    _eokas_test_check(stats->peakBytes >= 12000);
+
+    // blocks go back to their own tag from any thread
+    std::thread other([&blocks]() {
+        for (int i = 0; i < 5; i++) {
+            MemoryUtility::free(blocks[i]);
+        }
+    });
+    other.join();
+    for (int i = 5; i < 10; i++) {
+        MemoryUtility::free(blocks[i]);
+    }
+    MemorySnapshot after = MemoryTracker::snapshot().diff(before);
+    stats = after.find("tracker-test");
+    _eokas_test_check(stats->liveBytes == 0 && stats->liveCount == 0);
+    _eokas_test_check(stats->totalCount == 11);
+    _eokas_test_check(stats->peakBytes >= 12000);
+
+    // buffers, mappings and arenas are charged too
+    {
+        MemoryTagScope scope("tracker-test");
+        MemoryBuffer buffer(4096, 64, eMemoryFlags_NoZero);
+        void* pages = MemoryUtility::alloc_v(MemoryUtility::page_size() * 4, 3);
+        MemoryArena arena(1024 * 1024, 4096);
+        arena.alloc(10000);
+
+        MemorySnapshot inside = MemoryTracker::snapshot().diff(before);
+        stats = inside.find("tracker-test");
+        _eokas_test_check(stats->liveCount == 3);
+        _eokas_test_check(stats->liveBytes == (i64_t) (4096 + MemoryUtility::page_size() * 4 + arena.committed()));
+        MemoryUtility::free_v(pages, MemoryUtility::page_size() * 4);
+    }
+    MemorySnapshot released = MemoryTracker::snapshot().diff(before);
+    stats = released.find("tracker-test");
+    _eokas_test_check(stats->liveBytes == 0 && stats->liveCount == 0);
+
+    // sampled stacks come and go with their blocks
+    {
+        MemoryTracker::setSampleInterval(4096);
+        MemoryTagScope scope(tag);
+        std::vector<void*> big;
+        for (int i = 0; i < 64; i++) {
+            big.push_back(MemoryUtility::alloc(64 * 1024));
+        }
+        MemorySnapshot sampled = MemoryTracker::snapshot().diff(before);
+        size_t count = 0;
+        for (const MemorySample& sample: sampled.samples) {
+            if (sample.tag == tag && sample.size == 64 * 1024) {
+                count++;
+                _eokas_test_check(sample.weight >= sample.size);
+            }
+        }
+        // the first block on a thread only arms the countdown
+        _eokas_test_check(count >= 60);
+
+        String json = MemoryTracker::dump(sampled);
+        _eokas_test_check(json.contains("\"tracker-test\""));
+        _eokas_test_check(json.contains("live_bytes"));
+        _eokas_test_check(json.contains("stack"));
+
+        for (void* ptr: big) {
+            MemoryUtility::free(ptr);
+        }
+        MemoryTracker::setSampleInterval(0);
+        size_t left = 0;
+        for (const MemorySample& sample: MemoryTracker::snapshot().samples) {
+            left += sample.tag == tag && sample.size == 64 * 1024 ? 1 : 0;
+        }
+        _eokas_test_check(left == 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(utf8)
+{
+    // the vector kernel agrees with the scalar rules wherever the bad byte lands
+    {
+        const char* good[] = {"plain", "caf\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xEF\xBF\xBF", "\xF4\x8F\xBF\xBF", "\xED\x9F\xBF"};
+        const char* bad[] = {"\xC0\xAF", "\xC1\xBF", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80",
+                             "\xF5\x80\x80\x80", "\x80", "\xC3", "\xE2\x82", "\xF0\x9F\x98", "\xBF\xBF", "\xFF"};
+        bool agrees = true;
+        for (size_t at = 0; at < 70; at += 3) {
+            for (const char* piece: good) {
+                String text = String('a', at) + piece + String('b', 40);
+                agrees = agrees && UTF8::validate(text.cstr(), text.length());
+                agrees = agrees && UTF8::findInvalid(text.cstr(), text.length()) == text.length();
+            }
+            for (const char* piece: bad) {
+                String text = String('a', at) + piece + String('b', at % 7);
+                agrees = agrees && !UTF8::validate(text.cstr(), text.length());
+                agrees = agrees && UTF8::findInvalid(text.cstr(), text.length()) == at;
+            }
+        }
+        _eokas_test_check(agrees);
+        _eokas_test_check(UTF8::validate("", 0) && UTF8::asciiPrefix("abc\xC3\xA9", 5) == 3);
+        _eokas_test_check(UTF8::findInvalid("ab\xC3\xA9\xA9", 5) == 4);
+
+        // random bytes, the kernel in use against the byte by byte rules
+        u32_t seed = 7;
+        bool same = true;
+        std::vector<char> bytes(300);
+        for (int round = 0; round < 3000; round++) {
+            for (char& c: bytes) {
+                seed = seed * 1103515245 + 12345;
+                u32_t r = (seed >> 16) & 0xFF;
+                c = (char) (r < 160 ? r & 0x7F : r);
+            }
+            size_t size = (size_t) (seed % bytes.size());
+            same = same && UTF8::validate(bytes.data(), size) == (UTF8::findInvalid(bytes.data(), size) == size);
+        }
+        _eokas_test_check(same);
+    }
+
+    // transcoding both ways, with lengths known up front
+    {
+        String text = "ascii run long enough for a vector, caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 end";
+        size_t size = text.length();
+        std::vector<char16_t> utf16(size);
+        std::vector<char32_t> utf32(size);
+        size_t units16 = UTF8::toUtf16(text.cstr(), size, utf16.data());
+        size_t units32 = UTF8::toUtf32(text.cstr(), size, utf32.data());
+        _eokas_test_check(units16 == UTF8::utf16Length(text.cstr(), size) && units32 == UTF8::utf32Length(text.cstr(), size));
+        _eokas_test_check(units16 == units32 + 1 && utf32[units32 - 5] == 0x1F600);
+        _eokas_test_check(utf16[units16 - 6] == 0xD83D && utf16[units16 - 5] == 0xDE00);
+
+        std::vector<char> back(size * 4);
+        _eokas_test_check(UTF8::utf8Length(utf16.data(), units16) == size && UTF8::utf8Length(utf32.data(), units32) == size);
+        _eokas_test_check(UTF8::fromUtf16(utf16.data(), units16, back.data()) == size && memcmp(back.data(), text.cstr(), size) == 0);
+        _eokas_test_check(UTF8::fromUtf32(utf32.data(), units32, back.data()) == size && memcmp(back.data(), text.cstr(), size) == 0);
+
+        char16_t lone[] = {'a', 0xD800, 'b'};
+        _eokas_test_check(UTF8::fromUtf16(lone, 3, back.data()) == UTF8::kInvalid);
+        _eokas_test_check(UTF8::fromUtf16(lone, 3, back.data(), true) == 5 && memcmp(back.data(), "a\xEF\xBF\xBD" "b", 5) == 0);
+        _eokas_test_check(UTF8::toUtf32("a\xFF" "b", 3, utf32.data()) == UTF8::kInvalid);
+        _eokas_test_check(UTF8::toUtf32("a\xFF" "b", 3, utf32.data(), true) == 3 && utf32[1] == 0xFFFD);
+
+        WCString wide = String::utf8ToUnicode(text.cstr(), false);
+        _eokas_test_check(wide.length() == UTF8::wideLength(text.cstr(), size));
+        _eokas_test_check(String::unicodeToUtf8(wide, false) == text.cstr());
+        _eokas_test_check(String::utf8ToUnicode("\xEF\xBB\xBFx", true) == L"\xFEFFx");
+        _eokas_test_check(String::unicodeToUtf8(L"x", true) == "\xEF\xBB\xBFx");
+    }
+
+    // chunks split sequences anywhere, the decoder joins them
+    {
+        String text = "\xF0\x9F\x98\x80 mixed caf\xC3\xA9 \xE2\x82\xAC\xE2\x82\xAC tail \xC3\xA9";
+        std::vector<char32_t> whole(text.length());
+        size_t expect = UTF8::toUtf32(text.cstr(), text.length(), whole.data());
+        bool joined = true;
+        for (size_t chunk = 1; chunk <= 7; chunk++) {
+            UTF8Decoder decoder;
+            std::vector<char32_t> out(text.length() + 2);
+            size_t written = 0;
+            for (size_t at = 0; at < text.length(); at += chunk) {
+                size_t size = text.length() - at < chunk ? text.length() - at : chunk;
+                std::vector<char32_t> piece(size + 2);
+                size_t units = decoder.decode(text.cstr() + at, size, piece.data());
+                joined = joined && units != UTF8::kInvalid;
+                for (size_t i = 0; joined && i < units; i++) {
+                    out[written++] = piece[i];
+                }
+            }
+            joined = joined && decoder.finish() && written == expect && memcmp(out.data(), whole.data(), expect * sizeof(char32_t)) == 0;
+        }
+        _eokas_test_check(joined);
+
+        UTF8Decoder validator;
+        _eokas_test_check(validator.feed("ab\xE2", 3) && validator.feed("\x82", 1) && !validator.finish());
+        _eokas_test_check(validator.feed("\xE2\x82", 2) && validator.feed("\xAC!", 2) && validator.finish());
+        _eokas_test_check(!validator.feed("\xED\xA0", 2) || !validator.feed("\x80", 1));
+        _eokas_test_check(validator.failed() && !validator.feed("ok", 2) && !validator.finish() && validator.feed("ok", 2));
+    }
+
+    // JSON rejects ill formed sources and decodes \u escapes
+    {
+        _eokas_test_check(JSON::parse("{\"a\": \"\xC3\xA9\"}").get("a").asString() == "\xC3\xA9");
+        _eokas_test_check(JSON::parse("{\"a\": \"\xC3\"}").isNull());
+        _eokas_test_check(JSON::parse("[\"\\u00e9\\u20AC\\ud83d\\ude00\"]").get(0).asString() == "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+        _eokas_test_check(JSON::parse("[\"\\ud800x\"]").get(0).asString() == "\xEF\xBF\xBDx");
+    }
+
+    // mostly ASCII text well past the vector width
+    {
+        String text;
+        while (text.length() < (1 << 20)) {
+            text += "{\"name\": \"caf\xC3\xA9\", \"value\": 12345, \"tags\": [\"alpha\", \"beta\"]}, ";
+        }
+        std::vector<wchar_t> wide(text.length());
+        _eokas_test_check(UTF8::validate(text.cstr(), text.length()));
+        _eokas_test_check(UTF8::toWide(text.cstr(), text.length(), wide.data()) != UTF8::kInvalid);
+    }
+
+    return 0;
+}